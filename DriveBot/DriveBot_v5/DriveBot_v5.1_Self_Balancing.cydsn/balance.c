@@ -0,0 +1,668 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: balance.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.1_Self_Balancing
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Inverted pendulum controller. The IMU cube streams the quaternion of its
+*   inclinometer filter (quatStream, balance_CMD_QUATERNION), which is turned
+*   into pitch and pitch rate here, and SysTick runs a cascade at balance_RATE_HZ:
+*   an outer velocity loop turns the wheel speed error into a pitch setpoint,
+*   and an inner angle loop turns the pitch error and pitch rate into the
+*   wheel duty. Positive pitch is leaning forward and positive duty drives
+*   forward.
+*
+*   SysTick is read at the start of each loop, so the time since the tick is
+*   the interrupt latency and its spread is the loop jitter.
+*
+* 2018.11.07  - Document Created
+********************************************************************************/
+#include "balance.h"
+#include "micaCommon.h"
+#include "boardTesting.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define TURN_KP             (0.2f)      /* Duty per tick/s of turn error */
+#define SAMPLE_PERIOD       (1.0f / balance_RATE_HZ)
+#define VELOCITY_PERIOD     (SAMPLE_PERIOD * balance_VELOCITY_DIVIDER)
+
+/* Configuration */
+static balance_DRIVE_T driveWheel = NULL;
+static balance_GAINS_S gains;
+static volatile int16 velocityTarget = ZERO;
+static volatile int16 turnTarget = ZERO;
+/* Attitude from the IMU */
+static volatile float pitch = 0.0f;
+static volatile float pitchRate = 0.0f;
+static volatile uint8 attitudeAge = balance_ATTITUDE_TIMEOUT + 1u;
+static float lastPitch = 0.0f;              /* Pitch of the previous quaternion record */
+static uint32 lastTimestamp = ZERO;         /* Timestamp of the previous quaternion record [us] */
+static bool lastValid = false;              /* lastPitch and lastTimestamp are set */
+/* Loop state */
+static volatile uint8 state = balance_STATE_STOPPED;
+static uint16 uprightCount = ZERO;
+static uint8 velocityCount = ZERO;
+static int32 periodStartCount[balance_NUM_WHEELS];   /* Encoder counts at the start of the velocity period */
+static float wheelSpeed[balance_NUM_WHEELS];
+static float lean = 0.0f;
+static float leanIntegral = 0.0f;
+static float angleIntegral = 0.0f;
+static uint32 saturatedRun = ZERO;
+/* Statistics */
+static balance_STATS_S stats;
+
+static void balance_ISR_sysTick(void);
+
+/*******************************************************************************
+* Function Name: balance_limit()
+****************************************************************************//**
+* \brief
+*  Limits a value to +/- limit
+*
+* \param value [in]
+*  Value to limit
+*
+* \param limit [in]
+*  Positive limit
+*
+* \return
+*  The limited value
+*******************************************************************************/
+static float balance_limit(float value, float limit) {
+    if(value > limit) {
+        return limit;
+    } else if(value < -limit) {
+        return -limit;
+    }
+    return value;
+}
+
+/*******************************************************************************
+* Function Name: balance_readCounts()
+****************************************************************************//**
+* \brief
+*  Reads both encoders into an array indexed by wheel
+*
+* \param counts [out]
+*  Encoder counts
+*
+* \return
+*  None
+*******************************************************************************/
+static void balance_readCounts(int32 *counts) {
+    encoder_T encoder;
+    boardTest_getEncoderCounts(&encoder);
+    counts[balance_WHEEL_LEFT] = (int32) encoder.leftCount;
+    counts[balance_WHEEL_RIGHT] = (int32) encoder.rightCount;
+}
+
+/*******************************************************************************
+* Function Name: balance_release()
+****************************************************************************//**
+* \brief
+*  Stops driving the wheels and clears the integrators
+*
+* \return
+*  None
+*******************************************************************************/
+static void balance_release(void) {
+    leanIntegral = 0.0f;
+    angleIntegral = 0.0f;
+    lean = 0.0f;
+    saturatedRun = ZERO;
+    if(driveWheel != NULL) {
+        driveWheel(balance_WHEEL_LEFT, ZERO);
+        driveWheel(balance_WHEEL_RIGHT, ZERO);
+    }
+}
+
+/*******************************************************************************
+* Function Name: balance_init()
+****************************************************************************//**
+* \brief
+*  Loads the default gains and clears the statistics. The encoders and the
+*   motors must be started separately.
+*
+* \param drive [in]
+*  Function that applies a signed duty to a single wheel
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_init(balance_DRIVE_T drive) {
+    balance_stop();
+    driveWheel = drive;
+    gains.angleKp = balance_DEFAULT_ANGLE_KP;
+    gains.angleKi = balance_DEFAULT_ANGLE_KI;
+    gains.angleKd = balance_DEFAULT_ANGLE_KD;
+    gains.velKp = balance_DEFAULT_VEL_KP;
+    gains.velKi = balance_DEFAULT_VEL_KI;
+    gains.maxLean = balance_DEFAULT_MAX_LEAN;
+    velocityTarget = ZERO;
+    turnTarget = ZERO;
+    balance_resetStats();
+}
+
+/*******************************************************************************
+* Function Name: balance_start()
+****************************************************************************//**
+* \brief
+*  Starts the loop. The wheels stay released until the DriveBot is held
+*   upright and attitude packets are arriving.
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_start(void) {
+    balance_readCounts(periodStartCount);
+    velocityCount = ZERO;
+    uprightCount = ZERO;
+    wheelSpeed[balance_WHEEL_LEFT] = 0.0f;
+    wheelSpeed[balance_WHEEL_RIGHT] = 0.0f;
+    lastValid = false;
+    balance_release();
+    state = balance_STATE_WAITING;
+    /* SysTick from SYSCLK at the loop rate */
+    CySysTickStart();
+    CySysTickSetClockSource(CY_SYS_SYST_CSR_CLK_SRC_SYSCLK);
+    CySysTickSetReload((CYDEV_BCLK__SYSCLK__HZ / balance_RATE_HZ) - ONE);
+    CySysTickClear();
+    CySysTickSetCallback(balance_SYSTICK_CALLBACK, balance_ISR_sysTick);
+}
+
+/*******************************************************************************
+* Function Name: balance_stop()
+****************************************************************************//**
+* \brief
+*  Stops the loop and releases the wheels
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_stop(void) {
+    CySysTickSetCallback(balance_SYSTICK_CALLBACK, NULL);
+    state = balance_STATE_STOPPED;
+    balance_release();
+}
+
+/*******************************************************************************
+* Function Name: balance_getState()
+****************************************************************************//**
+* \brief
+*  Gets the state of the loop
+*
+* \return
+*  balance_STATE_<name>
+*******************************************************************************/
+uint8 balance_getState(void) {
+    return state;
+}
+
+/*******************************************************************************
+* Function Name: balance_setAttitude()
+****************************************************************************//**
+* \brief
+*  Passes in the latest attitude from the IMU. The loop releases the wheels
+*   if this is not called for balance_ATTITUDE_TIMEOUT samples.
+*
+* \param newPitch [in]
+*  Pitch, positive leaning forward [rad]
+*
+* \param newPitchRate [in]
+*  Pitch rate [rad/s]
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_setAttitude(float newPitch, float newPitchRate) {
+    uint8 intState = CyEnterCriticalSection();
+    pitch = newPitch;
+    pitchRate = newPitchRate;
+    attitudeAge = ZERO;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: balance_setQuaternion()
+****************************************************************************//**
+* \brief
+*  Passes in the latest orientation from the IMU. Pitch is taken the same way
+*   as quaternionToEuler() on the IMU, and the pitch rate from the change in
+*   pitch since the previous record. The first record, and any after a gap of
+*   more than balance_MAX_RECORD_GAP_US, have a rate of zero.
+*
+* \param timestamp [in]
+*  Time the IMU sampled the orientation [us]
+*
+* \param q1 [in]
+*  Scalar element of the unit quaternion
+*
+* \param q2 [in]
+*  i element
+*
+* \param q3 [in]
+*  j element
+*
+* \param q4 [in]
+*  k element
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_setQuaternion(uint32 timestamp, float q1, float q2, float q3, float q4) {
+    float newPitch = atan2f((2.0f * q3 * q1) - (2.0f * q2 * q4), 1.0f - (2.0f * ((q3 * q3) + (q4 * q4))));
+    float newPitchRate = 0.0f;
+    /* Unsigned difference handles the counter wrapping */
+    uint32 deltaUs = timestamp - lastTimestamp;
+    if(lastValid && (deltaUs > ZERO) && (deltaUs <= balance_MAX_RECORD_GAP_US)) {
+        newPitchRate = (newPitch - lastPitch) / (deltaUs * balance_US_TO_S);
+    }
+    lastPitch = newPitch;
+    lastTimestamp = timestamp;
+    lastValid = true;
+    balance_setAttitude(newPitch, newPitchRate);
+}
+
+/*******************************************************************************
+* Function Name: balance_setVelocity()
+****************************************************************************//**
+* \brief
+*  Sets the speed the DriveBot balances at
+*
+* \param forward [in]
+*  Average wheel speed, positive is forward [ticks/s]
+*
+* \param turn [in]
+*  Half the difference of the wheel speeds, positive turns right [ticks/s]
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_setVelocity(int16 forward, int16 turn) {
+    velocityTarget = forward;
+    turnTarget = turn;
+}
+
+/*******************************************************************************
+* Function Name: balance_setGains()
+****************************************************************************//**
+* \brief
+*  Replaces the gains of both loops
+*
+* \param newGains [in]
+*  Gains, all finite and not negative
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 balance_setGains(balance_GAINS_S *newGains) {
+    float *values = (float *) newGains;
+    uint8 i;
+    for(i = ZERO; i < (sizeof(balance_GAINS_S) / sizeof(float)); i++) {
+        /* Also rejects NaN */
+        if(!((values[i] >= 0.0f) && (values[i] <= FLT_MAX))) {
+            return balance_ERR_GAIN;
+        }
+    }
+    uint8 intState = CyEnterCriticalSection();
+    gains = *newGains;
+    CyExitCriticalSection(intState);
+    return balance_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: balance_getGains()
+****************************************************************************//**
+* \brief
+*  Gets the active gains
+*
+* \param activeGains [out]
+*  Gains of both loops
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_getGains(balance_GAINS_S *activeGains) {
+    *activeGains = gains;
+}
+
+/*******************************************************************************
+* Function Name: balance_getStats()
+****************************************************************************//**
+* \brief
+*  Copies the loop statistics
+*
+* \param statsOut [out]
+*  Statistics since the last reset
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_getStats(balance_STATS_S *statsOut) {
+    uint8 intState = CyEnterCriticalSection();
+    *statsOut = stats;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: balance_resetStats()
+****************************************************************************//**
+* \brief
+*  Clears the loop statistics
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_resetStats(void) {
+    uint8 intState = CyEnterCriticalSection();
+    memset(&stats, ZERO, sizeof(stats));
+    stats.latencyMin = UINT32_MAX;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: balance_update()
+****************************************************************************//**
+* \brief
+*  Runs one sample of the cascade. Called from SysTick, only call directly
+*   when the loop is not running.
+*
+* \return
+*  None
+*******************************************************************************/
+void balance_update(void) {
+    uint32 reload = CySysTickGetReload();
+    uint32 startValue = CySysTickGetValue();
+    /* Latency from the tick, SysTick counts down */
+    uint32 latency = reload - startValue;
+    stats.samples++;
+    if(latency < stats.latencyMin) {
+        stats.latencyMin = latency;
+    }
+    if(latency > stats.latencyMax) {
+        stats.latencyMax = latency;
+    }
+    /* Snapshot of the attitude */
+    float pitchNow = pitch;
+    float pitchRateNow = pitchRate;
+    if(attitudeAge <= balance_ATTITUDE_TIMEOUT) {
+        attitudeAge++;
+    }
+    /* Wheel speeds over the velocity period */
+    int32 counts[balance_NUM_WHEELS];
+    balance_readCounts(counts);
+    uint8 i;
+    if(++velocityCount >= balance_VELOCITY_DIVIDER) {
+        velocityCount = ZERO;
+        for(i = ZERO; i < balance_NUM_WHEELS; i++) {
+            wheelSpeed[i] = (counts[i] - periodStartCount[i]) / VELOCITY_PERIOD;
+            periodStartCount[i] = counts[i];
+        }
+        /* Outer loop, lean towards the direction that needs speed */
+        if(state == balance_STATE_BALANCING) {
+            float speed = (wheelSpeed[balance_WHEEL_LEFT] + wheelSpeed[balance_WHEEL_RIGHT]) * 0.5f;
+            float error = velocityTarget - speed;
+            leanIntegral = balance_limit(leanIntegral + (gains.velKi * error * VELOCITY_PERIOD), gains.maxLean);
+            float leanRequest = (gains.velKp * error) + leanIntegral;
+            lean = balance_limit(leanRequest, gains.maxLean);
+            if(lean != leanRequest) {
+                stats.leanLimited++;
+            }
+        }
+    }
+    /* Supervisor */
+    if(attitudeAge > balance_ATTITUDE_TIMEOUT) {
+        if(state != balance_STATE_NO_ATTITUDE) {
+            if(state == balance_STATE_BALANCING) {
+                stats.attitudeTimeouts++;
+            }
+            state = balance_STATE_NO_ATTITUDE;
+            balance_release();
+        }
+    } else if(state == balance_STATE_NO_ATTITUDE) {
+        state = balance_STATE_WAITING;
+        uprightCount = ZERO;
+    } else if((state == balance_STATE_BALANCING) && ((pitchNow > balance_FALL_ANGLE) || (pitchNow < -balance_FALL_ANGLE))) {
+        state = balance_STATE_FALLEN;
+        uprightCount = ZERO;
+        balance_release();
+    }
+    /* Wait to be held upright before driving */
+    if((state == balance_STATE_WAITING) || (state == balance_STATE_FALLEN)) {
+        if((pitchNow < balance_UPRIGHT_ANGLE) && (pitchNow > -balance_UPRIGHT_ANGLE)) {
+            if(++uprightCount >= balance_UPRIGHT_SAMPLES) {
+                balance_release();
+                state = balance_STATE_BALANCING;
+            }
+        } else {
+            uprightCount = ZERO;
+        }
+    }
+    /* Inner loop */
+    if(state == balance_STATE_BALANCING) {
+        float error = pitchNow - lean;
+        float unsaturated = (gains.angleKp * error) + (gains.angleKd * pitchRateNow);
+        /* Integrate unless it pushes further into saturation */
+        float step = gains.angleKi * error * SAMPLE_PERIOD;
+        float total = unsaturated + angleIntegral;
+        if(!(((total >= balance_DUTY_MAX) && (step > 0.0f)) || ((total <= -balance_DUTY_MAX) && (step < 0.0f)))) {
+            angleIntegral = balance_limit(angleIntegral + step, balance_DUTY_MAX);
+        }
+        float duty = unsaturated + angleIntegral;
+        /* Steering on top of the balance */
+        float turnSpeed = (wheelSpeed[balance_WHEEL_LEFT] - wheelSpeed[balance_WHEEL_RIGHT]) * 0.5f;
+        float turnDuty = TURN_KP * (turnTarget - turnSpeed);
+        float left = duty + turnDuty;
+        float right = duty - turnDuty;
+        if((left >= balance_DUTY_MAX) || (left <= -balance_DUTY_MAX) || (right >= balance_DUTY_MAX) || (right <= -balance_DUTY_MAX)) {
+            stats.saturated++;
+            if(++saturatedRun > stats.saturatedRunMax) {
+                stats.saturatedRunMax = saturatedRun;
+            }
+        } else {
+            saturatedRun = ZERO;
+        }
+        if(driveWheel != NULL) {
+            driveWheel(balance_WHEEL_LEFT, (int16) balance_limit(left, balance_DUTY_MAX));
+            driveWheel(balance_WHEEL_RIGHT, (int16) balance_limit(right, balance_DUTY_MAX));
+        }
+    }
+    /* Execution time, unless the tick wrapped */
+    uint32 endValue = CySysTickGetValue();
+    if(endValue <= startValue) {
+        uint32 execution = startValue - endValue;
+        if(execution > stats.executionMax) {
+            stats.executionMax = execution;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: balance_getInt16()
+****************************************************************************//**
+* \brief
+*  Reads a signed MSB first half word
+*
+* \param data [in]
+*  Location of the MSB
+*
+* \return
+*  The value
+*******************************************************************************/
+static int16 balance_getInt16(uint8 *data) {
+    return (int16) ((data[ZERO] << BITS_ONE_BYTE) | data[ONE]);
+}
+
+/*******************************************************************************
+* Function Name: balance_putWord()
+****************************************************************************//**
+* \brief
+*  Writes a word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param word [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 balance_putWord(uint8 *data, uint32 word) {
+    uint8 i = ZERO;
+    data[i++] = (word >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[i++] = word & MASK_BYTE_ONE;
+    return i;
+}
+
+/*******************************************************************************
+* Function Name: balance_getWord()
+****************************************************************************//**
+* \brief
+*  Reads an MSB first word
+*
+* \param data [in]
+*  Location of the MSB
+*
+* \return
+*  The value
+*******************************************************************************/
+static uint32 balance_getWord(uint8 *data) {
+    return ((uint32) data[0] << (3 * BITS_ONE_BYTE)) | ((uint32) data[1] << (2 * BITS_ONE_BYTE)) |
+        ((uint32) data[2] << BITS_ONE_BYTE) | data[3];
+}
+
+/*******************************************************************************
+* Function Name: balance_handleCommand()
+****************************************************************************//**
+* \brief
+*  Handles the balance_CMD_<name> commands. Errors are reported in the flags
+*   of the response. balance_CMD_QUATERNION arrives at the loop rate and should
+*   not be answered.
+*
+* \param rxPacket [in]
+*  Pointer to the packet containing the command
+*
+* \param txPacket [out]
+*  Pointer to the response packet
+*
+* \return
+*  Returns the error of associated with the operation
+*******************************************************************************/
+uint32 balance_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket) {
+    uint8 *payload = rxPacket->payload;
+    switch(rxPacket->cmd) {
+        /* quatStream records, oldest first */
+        case balance_CMD_QUATERNION: {
+            uint16 len = rxPacket->payloadLen;
+            if((len == ZERO) || (len % balance_LEN_QUAT_RECORD)) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            uint16 i;
+            for(i = ZERO; i < len; i += balance_LEN_QUAT_RECORD) {
+                uint8 *record = &payload[i];
+                float q[balance_NUM_QUAT];
+                uint8 j;
+                for(j = ZERO; j < balance_NUM_QUAT; j++) {
+                    q[j] = balance_getInt16(&record[balance_INDEX_QUAT + (j * TWO)]) * balance_QUAT_SCALE;
+                }
+                balance_setQuaternion(balance_getWord(record), q[0], q[1], q[2], q[3]);
+            }
+            break;
+        }
+        /* Forward and turn speed */
+        case balance_CMD_VELOCITY: {
+            if(rxPacket->payloadLen != balance_LEN_VELOCITY) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            balance_setVelocity(balance_getInt16(&payload[ZERO]), balance_getInt16(&payload[TWO]));
+            txPacket->payload[ZERO] = state;
+            txPacket->payloadLen = ONE;
+            break;
+        }
+        /* Set the gains, an empty payload only queries them */
+        case balance_CMD_GAINS: {
+            balance_GAINS_S newGains;
+            float *values = (float *) &newGains;
+            uint8 numGains = sizeof(balance_GAINS_S) / sizeof(float);
+            uint8 i;
+            if(rxPacket->payloadLen == balance_LEN_GAINS) {
+                for(i = ZERO; i < numGains; i++) {
+                    uint32 word = balance_getWord(&payload[i * sizeof(float)]);
+                    memcpy(&values[i], &word, sizeof(float));
+                }
+                if(balance_setGains(&newGains)) {
+                    txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                }
+            } else if(rxPacket->payloadLen != ZERO) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+            }
+            /* Respond with the active gains */
+            balance_getGains(&newGains);
+            uint8 len = ZERO;
+            for(i = ZERO; i < numGains; i++) {
+                uint32 word;
+                memcpy(&word, &values[i], sizeof(float));
+                len += balance_putWord(&txPacket->payload[len], word);
+            }
+            txPacket->payloadLen = len;
+            break;
+        }
+        /* Loop timing and saturation */
+        case balance_CMD_STATS: {
+            if(rxPacket->payloadLen > ONE) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            balance_STATS_S snapshot;
+            balance_getStats(&snapshot);
+            uint32 *words = (uint32 *) &snapshot;
+            uint8 len = ZERO;
+            uint8 i;
+            txPacket->payload[len++] = state;
+            for(i = ZERO; i < (sizeof(balance_STATS_S) / sizeof(uint32)); i++) {
+                len += balance_putWord(&txPacket->payload[len], words[i]);
+            }
+            txPacket->payloadLen = len;
+            if((rxPacket->payloadLen == ONE) && (payload[ZERO] != ZERO)) {
+                balance_resetStats();
+            }
+            break;
+        }
+        /* Command not found */
+        default: {
+            txPacket->flags |= packets_FLAG_INVALID_CMD;
+            break;
+        }
+    }
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* ISR Name: balance_ISR_sysTick()
+********************************************************************************
+* Summary:
+*   Runs the cascade at balance_RATE_HZ
+* Interrupt:
+*   SysTick
+*
+*******************************************************************************/
+static void balance_ISR_sysTick(void) {
+    balance_update();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,131 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: balance.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.1_Self_Balancing
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for balance.c
+*
+* 2018.11.07  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef balance_H
+    #define balance_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "packets.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Wheels */
+    #define balance_WHEEL_LEFT              (0u)
+    #define balance_WHEEL_RIGHT             (1u)
+    #define balance_NUM_WHEELS              (2u)
+    /* Loop rates - the angle loop runs from SysTick, the velocity loop every Nth sample */
+    #ifndef balance_RATE_HZ
+        #define balance_RATE_HZ             (200u)
+    #endif
+    #define balance_VELOCITY_DIVIDER        (4u)
+    #define balance_SYSTICK_CALLBACK        (0u)
+    /* Output, signed duty in PWM counts */
+    #ifndef balance_DUTY_MAX
+        #define balance_DUTY_MAX            (255)
+    #endif
+    /* Safety */
+    #define balance_ATTITUDE_TIMEOUT        (4u)        /**< Samples without a quaternion record before releasing */
+    #define balance_MAX_RECORD_GAP_US       (100000u)   /**< Longer gaps between records restart the pitch rate */
+    #define balance_FALL_ANGLE              (0.6f)      /**< Pitch that is treated as a fall [rad] */
+    #define balance_UPRIGHT_ANGLE           (0.05f)     /**< Pitch that re-arms the loop after a fall [rad] */
+    #define balance_UPRIGHT_SAMPLES         (balance_RATE_HZ / 2u) /**< Samples upright before re-arming */
+    /* Default gains */
+    #define balance_DEFAULT_ANGLE_KP        (1000.0f)   /**< Duty per rad */
+    #define balance_DEFAULT_ANGLE_KI        (0.0f)      /**< Duty per rad.s */
+    #define balance_DEFAULT_ANGLE_KD        (60.0f)     /**< Duty per rad/s */
+    #define balance_DEFAULT_VEL_KP          (0.0002f)   /**< Rad of lean per tick/s */
+    #define balance_DEFAULT_VEL_KI          (0.0002f)   /**< Rad of lean per tick */
+    #define balance_DEFAULT_MAX_LEAN        (0.15f)     /**< Largest pitch setpoint [rad] */
+    /* Commands, sent to the DriveBot from the IMU */
+    /* quatStream records from the IMU inclinometer, no response. Each record
+    * must arrive within balance_ATTITUDE_TIMEOUT samples, so the IMU sends one
+    * record per packet (dev_inclinometer STREAM_RECORDS = 1) */
+    #define balance_CMD_QUATERNION          (0x51u)
+    #define balance_CMD_VELOCITY            (0x41u)     /* Set the forward and turn speed */
+    #define balance_CMD_GAINS               (0x42u)     /* Set or query the gains */
+    #define balance_CMD_STATS               (0x43u)     /* Read the loop statistics, a non-zero byte clears them */
+    /* Payloads, all values MSB first */
+    #define balance_LEN_QUAT_RECORD         (12u)       /* [timestamp x4 us][q1 x2][q2 x2][q3 x2][q4 x2], Q14 */
+    #define balance_INDEX_QUAT              (4u)        /* First element of a quaternion record */
+    #define balance_NUM_QUAT                (4u)
+    #define balance_LEN_VELOCITY            (4u)        /* [forward x2][turn x2] ticks/s */
+    #define balance_LEN_GAINS               (24u)       /* Six IEEE-754 floats in balance_GAINS_S order */
+    #define balance_LEN_STATS               (33u)       /* [state] then eight words in balance_STATS_S order */
+    #define balance_QUAT_SCALE              (1.0f / 16384.0f)
+    #define balance_US_TO_S                 (0.000001f)
+    /* States */
+    #define balance_STATE_STOPPED           (0u)        /**< Loop not running */
+    #define balance_STATE_WAITING           (1u)        /**< Waiting to be held upright */
+    #define balance_STATE_BALANCING         (2u)        /**< Driving the wheels */
+    #define balance_STATE_FALLEN            (3u)        /**< Pitch passed balance_FALL_ANGLE */
+    #define balance_STATE_NO_ATTITUDE       (4u)        /**< Quaternion records stopped arriving */
+    /* Error codes */
+    #define balance_ERR_OK                  (0u)
+    #define balance_ERR_GAIN                (1u)        /* Negative or non-finite gain */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Gains of both loops */
+    typedef struct {
+        float angleKp;          /**< Inner loop, duty per rad */
+        float angleKi;          /**< Inner loop, duty per rad.s */
+        float angleKd;          /**< Inner loop, duty per rad/s of pitch rate */
+        float velKp;            /**< Outer loop, rad of lean per tick/s */
+        float velKi;            /**< Outer loop, rad of lean per tick */
+        float maxLean;          /**< Limit of the pitch setpoint [rad] */
+    } balance_GAINS_S;
+
+    /* Loop statistics, times in SYSCLK cycles */
+    typedef struct {
+        uint32 samples;         /**< Angle loop iterations */
+        uint32 latencyMin;      /**< Shortest SysTick wrap to loop start */
+        uint32 latencyMax;      /**< Longest SysTick wrap to loop start, max - min is the jitter */
+        uint32 executionMax;    /**< Longest loop execution */
+        uint32 saturated;       /**< Samples with the duty at balance_DUTY_MAX */
+        uint32 saturatedRunMax; /**< Longest run of saturated samples */
+        uint32 leanLimited;     /**< Velocity loop samples with the lean at its limit */
+        uint32 attitudeTimeouts;/**< Releases because the attitude stopped arriving */
+    } balance_STATS_S;
+
+    /* Drives a single wheel, duty is -balance_DUTY_MAX to balance_DUTY_MAX */
+    typedef void (*balance_DRIVE_T)(uint8 wheel, int16 duty);
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void balance_init(balance_DRIVE_T drive);
+    void balance_start(void);
+    void balance_stop(void);
+    uint8 balance_getState(void);
+    void balance_setAttitude(float pitch, float pitchRate);
+    void balance_setQuaternion(uint32 timestamp, float q1, float q2, float q3, float q4);
+    void balance_setVelocity(int16 forward, int16 turn);
+    uint32 balance_setGains(balance_GAINS_S *gains);
+    void balance_getGains(balance_GAINS_S *gains);
+    void balance_getStats(balance_STATS_S *stats);
+    void balance_resetStats(void);
+    void balance_update(void);
+    uint32 balance_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket);
+
+#endif /* balance_H */
+/* [] END OF FILE */
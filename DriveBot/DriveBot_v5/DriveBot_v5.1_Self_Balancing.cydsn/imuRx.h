@@ -0,0 +1,58 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: imuRx.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.1_Self_Balancing
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for imuRx.c
+*
+* 2018.11.14  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef imuRx_H
+    #define imuRx_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    #define imuRx_BUFFER_LEN            (256u)  /* Must be a power of 2 */
+    #define imuRx_BUFFER_MASK           (imuRx_BUFFER_LEN - 1u)
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Receive statistics */
+    typedef struct {
+        uint32 bytesReceived;   /**< Bytes placed into the ring */
+        uint32 bytesDropped;    /**< Bytes lost because the ring was full */
+        uint32 fifoOverflows;   /**< Hardware RX FIFO overflow events */
+        uint16 highWater;       /**< Maximum number of bytes held in the ring */
+    } imuRx_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void imuRx_Start(void);
+    void imuRx_Stop(void);
+    uint16 imuRx_getBytesPending(void);
+    uint16 imuRx_peekSpan(uint8 **span);
+    void imuRx_consume(uint16 len);
+    uint16 imuRx_read(uint8 *data, uint16 maxLen);
+    void imuRx_flush(void);
+    void imuRx_getStats(imuRx_STATS_S *stats);
+    void imuRx_resetStats(void);
+
+#endif /* imuRx_H */
+/* [] END OF FILE */
@@ -27,6 +27,8 @@
 
 #include "project.h"
 #include "boardTesting.h"
+#include "balance.h"
+#include "imuRx.h"
 #include <stdbool.h>
 
 /*  -------------- DEBUGGING --------------
@@ -54,7 +56,18 @@
 
 
 
+/* Direction bits of Motors_motorControlReg, set to drive a wheel forward.
+* The Motors component keeps the control register layout of DriveBot_v5.0
+* main.h (MICA_MOTOR_<side>_SHIFT): left direction in bit 0, right in bit 4,
+* each with its enable two bits above */
+#define MOTORS_CTRL_FORWARD_L       (0x01u)
+#define MOTORS_CTRL_FORWARD_R       (0x10u)
+/* Statistics print period, in samples of the balance loop */
+#define STATS_PRINT_SAMPLES         (balance_RATE_HZ)
+
 /* --------- Local Variables --------- */
+void driveWheel(uint8 wheel, int16 duty);
+void processImuByte(packets_BUFFER_FULL_S *buffer, uint8 byte);
 
 /*******************************************************************************
 * Function Name: main()
@@ -324,20 +337,148 @@ int main(void) {
 #endif /* MICA_DEBUG */
 /* %%%%%%%%%%%%%%%%%%  End Debugging  %%%%%%%%%%%%%%%%%% */
     
-    /* Infinite Loop */
-//    Motors_Start();
-    uint8 ch = 0x66;
+    /* Balance on the orientation streamed by the IMU over UART. Statistics are
+    * printed over the USB UART while not balancing, as the prints block. Green
+    * LED waiting to be held upright, blue balancing, red fallen or no attitude */
     UART_USB_Start();
+    imuRx_Start();
+    QuadDec_L_Start();
+    QuadDec_R_Start();
+    Motors_Start();
+    Motors_Enable();
+    /* Packets from the IMU */
+    packets_BUFFER_FULL_S packetBuffer;
+    packets_initialize(&packetBuffer);
+    uint32 error = packets_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
+    if(error){
+        LEDS_Write(LEDS_ON_MAGENTA);
+        for(;;){}
+    }
+    balance_init(driveWheel);
+    balance_start();
+    uint8 lastState = balance_STATE_STOPPED;
+    uint32 lastPrintSample = ZERO;
+    
+    /* Infinite Loop */
     for(;;)
     {
-//        Motors_Test(TWO, Motors_SPEED_MAX);
-//        //led_DB_pin_Write( ~ led_DB_pin_Read());
+        /* Process everything the receive interrupt has queued from the IMU */
+        uint8 *span;
+        uint16 len;
+        while((len = imuRx_peekSpan(&span)) > ZERO){
+            uint16 i;
+            for(i = ZERO; i < len; i++){
+                processImuByte(&packetBuffer, span[i]);
+            }
+            imuRx_consume(len);
+        }
+        /* Indicate the state */
+        uint8 state = balance_getState();
+        if(state != lastState){
+            lastState = state;
+            switch(state){
+                case balance_STATE_BALANCING:
+                    LEDS_Write(LEDS_ON_BLUE);
+                    break;
+                case balance_STATE_WAITING:
+                    LEDS_Write(LEDS_ON_GREEN);
+                    break;
+                default:
+                    LEDS_Write(LEDS_ON_RED);
+                    break;
+            }
+        }
+        /* Display the loop statistics, never while balancing */
+        if(state == balance_STATE_BALANCING){
+            continue;
+        }
+        balance_STATS_S stats;
+        balance_getStats(&stats);
+        if((stats.samples - lastPrintSample) >= STATS_PRINT_SAMPLES){
+            lastPrintSample = stats.samples;
+            imuRx_STATS_S rxStats;
+            imuRx_getStats(&rxStats);
+            iprintf_clearScreen();
+            iprintf("State: %d\r\nSamples: %lu\r\n", state, stats.samples);
+            iprintf("Latency: %lu - %lu cycles, jitter %lu\r\n", stats.latencyMin, stats.latencyMax, stats.latencyMax - stats.latencyMin);
+            iprintf("Execution max: %lu cycles\r\n", stats.executionMax);
+            iprintf("Saturated: %lu, longest run %lu\r\n", stats.saturated, stats.saturatedRunMax);
+            iprintf("Lean limited: %lu\r\nAttitude timeouts: %lu\r\n", stats.leanLimited, stats.attitudeTimeouts);
+            iprintf("IMU bytes: %lu, dropped %lu, FIFO overflows %lu\r\n", rxStats.bytesReceived, rxStats.bytesDropped, rxStats.fifoOverflows);
+        }
+    }
+}
 
-        
-//        
-        UART_USB_UartPutChar(ch);
-        CyDelay(1000);
-        
+/*******************************************************************************
+* Function Name: processImuByte()
+********************************************************************************
+* Summary:
+*   Adds a byte received from the IMU to the packet being received, and
+*   handles the packet once it is complete. Quaternion records arrive at the
+*   loop rate and are not answered.
+*
+* Parameters:
+*   buffer - Packet buffer of the IMU link
+*   byte - Received byte
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void processImuByte(packets_BUFFER_FULL_S *buffer, uint8 byte){
+    uint32 err = packets_processRxByte(buffer, byte);
+    if(err){
+        packets_flushRxBuffers(buffer);
+    }
+    if(buffer->receive.bufferState != packets_BUFFER_RECEIVE_COMPLETE){
+        return;
+    }
+    packets_PACKET_S *rxPacket = &(buffer->receive.packet);
+    packets_PACKET_S *txPacket = &(buffer->send.packet);
+    if(!packets_parsePacket(buffer)){
+        txPacket->moduleId = rxPacket->moduleId;
+        txPacket->cmd = rxPacket->cmd;
+        txPacket->flags = packets_FLAG_RESP;
+        txPacket->payloadLen = ZERO;
+        balance_handleCommand(rxPacket, txPacket);
+        if((rxPacket->cmd != balance_CMD_QUATERNION) && !packets_constructPacket(buffer)){
+            UART_SpiUartPutArray(buffer->send.processBuffer.buffer, buffer->send.processBuffer.bufferIndex);
+        }
+        packets_flushTxBuffers(buffer);
+    }
+    packets_flushRxBuffers(buffer);
+}
+
+/*******************************************************************************
+* Function Name: driveWheel()
+********************************************************************************
+* Summary:
+*   Drives a single wheel for balance. The magnitude sets the compare of the
+*   wheel's PWM and the sign sets its direction bit in the motor control
+*   register.
+*
+* Parameters:
+*   wheel - balance_WHEEL_<side>
+*   duty - Signed duty, -balance_DUTY_MAX to balance_DUTY_MAX
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void driveWheel(uint8 wheel, int16 duty){
+    uint8 forwardBit = (wheel == balance_WHEEL_LEFT) ? MOTORS_CTRL_FORWARD_L : MOTORS_CTRL_FORWARD_R;
+    uint8 control = Motors_motorControlReg_Read();
+    if(duty < 0){
+        control &= ~forwardBit;
+        duty = -duty;
+    } else {
+        control |= forwardBit;
+    }
+    Motors_motorControlReg_Write(control);
+    if(wheel == balance_WHEEL_LEFT){
+        Motors_PWM_M1_WriteCompare((uint16) duty);
+    } else {
+        Motors_PWM_M2_WriteCompare((uint16) duty);
     }
 }
 
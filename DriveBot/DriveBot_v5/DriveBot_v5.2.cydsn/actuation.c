@@ -0,0 +1,549 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: actuation.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Packet driven motor service. Packets from the IMU are read from imuRx by
+*   packets_processRxQueue(), and the commands drive the wheels closed loop
+*   through speedControl or open loop at a fixed duty. The same packets carry
+*   the telemetry stream back to the IMU.
+*
+*   A watchdog ramps the duty of both wheels down to zero when no command has
+*   arrived for the timeout, so losing the IMU link does not leave the DriveBot
+*   driving. The time from the service reading a command to the new duty being
+*   written to the PWM is recorded in microseconds.
+*
+* 2018.11.09  - Document Created
+********************************************************************************/
+#include "actuation.h"
+#include "micaCommon.h"
+#include "imuRx.h"
+#include "memPool.h"
+#include "telemetry.h"
+#include <string.h>
+
+/* Packets to and from the IMU */
+static packets_BUFFER_FULL_S actuationPackets;
+static speedControl_DRIVE_T driveOutput = NULL;
+/* Time */
+static volatile uint32 msCount = ZERO;
+/* State */
+static uint8 mode = actuation_MODE_IDLE;
+static uint16 timeoutMs = actuation_DEFAULT_TIMEOUT_MS;
+static uint32 lastCommandMs = ZERO;
+static uint32 lastRampMs = ZERO;
+static int16 rampDuty[speedControl_NUM_WHEELS];
+/* Latency */
+static uint32 rxStartUs = ZERO;                 /* When the service started reading the pending bytes */
+static volatile bool latencyPending = false;
+static volatile uint32 latencyStartUs = ZERO;
+static actuation_LATENCY_S latency;
+
+static void actuation_ISR_sysTick(void);
+
+/*******************************************************************************
+* Function Name: actuation_nowUs()
+****************************************************************************//**
+* \brief
+*  Microseconds from the millisecond count and the SysTick down counter
+*
+* \return
+*  Current time [us]
+*******************************************************************************/
+static uint32 actuation_nowUs(void) {
+    uint32 ms;
+    uint32 value;
+    /* Read again if the tick interrupt ran in between */
+    do {
+        ms = msCount;
+        value = CySysTickGetValue();
+    } while(ms != msCount);
+    uint32 period = CySysTickGetReload() + ONE;
+    return (ms * actuation_US_PER_MS) + (((period - ONE - value) * actuation_US_PER_MS) / period);
+}
+
+/*******************************************************************************
+* Function Name: actuation_drive()
+****************************************************************************//**
+* \brief
+*  Drives a wheel for speedControl, and records the latency of the first
+*   write after a command
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \param duty [in]
+*  Signed duty
+*
+* \return
+*  None
+*******************************************************************************/
+static void actuation_drive(uint8 wheel, int16 duty) {
+    if(driveOutput != NULL) {
+        driveOutput(wheel, duty);
+    }
+    if(latencyPending) {
+        latencyPending = false;
+        uint32 elapsed = actuation_nowUs() - latencyStartUs;
+        /* A tick that was still pending can make the time run backwards */
+        if(elapsed <= INT32_MAX) {
+            latency.count++;
+            latency.total += elapsed;
+            if(elapsed < latency.min) {
+                latency.min = elapsed;
+            }
+            if(elapsed > latency.max) {
+                latency.max = elapsed;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: actuation_rxGetBytesPending()
+****************************************************************************//**
+* \brief
+*  Bytes waiting in imuRx, for the packets library
+*
+* \return
+*  Number of bytes
+*******************************************************************************/
+static uint32 actuation_rxGetBytesPending(void) {
+    return imuRx_getBytesPending();
+}
+
+/*******************************************************************************
+* Function Name: actuation_rxReadByte()
+****************************************************************************//**
+* \brief
+*  Reads a byte from imuRx, for the packets library
+*
+* \return
+*  The byte
+*******************************************************************************/
+static uint8 actuation_rxReadByte(void) {
+    uint8 data = ZERO;
+    imuRx_read(&data, ONE);
+    return data;
+}
+
+/*******************************************************************************
+* Function Name: actuation_txPutArray()
+****************************************************************************//**
+* \brief
+*  Sends bytes to the IMU, for the packets library
+*
+* \param data [in]
+*  Bytes to send
+*
+* \param len [in]
+*  Number of bytes
+*
+* \return
+*  packets_ERR_SUCCESS, the SCB blocks until the bytes are queued
+*******************************************************************************/
+static uint32 actuation_txPutArray(const uint8 *data, uint16 len) {
+    UART_IMU_SpiUartPutArray(data, len);
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: actuation_ackHandler()
+****************************************************************************//**
+* \brief
+*  Responses from the IMU are not used
+*
+* \param packet [in]
+*  Pointer to the received packet
+*
+* \return
+*  Returns the error of associated with the operation
+*******************************************************************************/
+static uint32 actuation_ackHandler(packets_PACKET_S *packet) {
+    (void) packet;
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: actuation_start()
+****************************************************************************//**
+* \brief
+*  Creates the packet buffers from the memory pool and starts speedControl with both wheels
+*   released. imuRx, dualEncoder and the motors must be started separately.
+*
+* \param drive [in]
+*  Function that applies a signed duty to a single wheel
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 actuation_start(speedControl_DRIVE_T drive) {
+    uint32 error = packets_initialize(&actuationPackets);
+    if(!error) {
+        error = memPool_generateBuffers(&actuationPackets, packets_LEN_BLOCK_PACKET);
+    }
+    if(error) {
+        return actuation_ERR_PACKETS;
+    }
+    actuationPackets.comms.rxGetBytesPending = actuation_rxGetBytesPending;
+    actuationPackets.comms.rxReadByte = actuation_rxReadByte;
+    actuationPackets.comms.txPutArray = actuation_txPutArray;
+    actuationPackets.comms.ackCallback = actuation_ackHandler;
+    actuationPackets.comms.cmdCallback = actuation_handleCommand;
+    /* Millisecond time base */
+    CySysTickStart();
+    CySysTickSetCallback(actuation_SYSTICK_CALLBACK, actuation_ISR_sysTick);
+    /* Closed loop with both wheels released */
+    driveOutput = drive;
+    speedControl_init(actuation_drive);
+    speedControl_start();
+    mode = actuation_MODE_IDLE;
+    lastCommandMs = msCount;
+    actuation_resetLatency();
+    return actuation_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: actuation_watchdog()
+****************************************************************************//**
+* \brief
+*  Ramps both wheels to zero duty once commands have stopped for the timeout
+*
+* \param now [in]
+*  Current time [ms]
+*
+* \return
+*  None
+*******************************************************************************/
+static void actuation_watchdog(uint32 now) {
+    uint8 i;
+    bool driving = (mode == actuation_MODE_SPEED) || (mode == actuation_MODE_PWM);
+    if(driving && (timeoutMs != ZERO) && ((now - lastCommandMs) >= timeoutMs)) {
+        /* Hold the present duty open loop and ramp it from there */
+        mode = actuation_MODE_TIMEOUT;
+        lastRampMs = now;
+        for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+            rampDuty[i] = speedControl_getDuty(i);
+            speedControl_setDuty(i, rampDuty[i]);
+        }
+    }
+    if(mode == actuation_MODE_TIMEOUT) {
+        int16 step = (int16) (((now - lastRampMs) * speedControl_DUTY_MAX) / actuation_RAMP_MS);
+        if(step == ZERO) {
+            return;
+        }
+        lastRampMs = now;
+        for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+            if(rampDuty[i] > step) {
+                rampDuty[i] -= step;
+            } else if(rampDuty[i] < -step) {
+                rampDuty[i] += step;
+            } else {
+                rampDuty[i] = ZERO;
+            }
+            speedControl_setDuty(i, rampDuty[i]);
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: actuation_putInt16()
+****************************************************************************//**
+* \brief
+*  Writes a half word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param value [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 actuation_putInt16(uint8 *data, int16 value) {
+    data[ZERO] = (((uint16) value) >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[ONE] = ((uint16) value) & MASK_BYTE_ONE;
+    return TWO;
+}
+
+/*******************************************************************************
+* Function Name: actuation_sendPacket()
+****************************************************************************//**
+* \brief
+*  Sends a packet to the IMU. Only call from the main loop, as command
+*   responses use the same buffer.
+*
+* \param cmd [in]
+*  The command value to write
+*
+* \param payloadLen [in]
+*  Length of the payload
+*
+* \param payload [in]
+*  Pointer to the payload
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 actuation_sendPacket(uint8 cmd, uint16 payloadLen, uint8 *payload) {
+    packets_PACKET_S *txPacket = &(actuationPackets.send.packet);
+    txPacket->cmd = cmd;
+    txPacket->flags = packets_FLAG_NONE;
+    txPacket->payloadLen = payloadLen;
+    if(payloadLen) {
+        memcpy(txPacket->payload, payload, payloadLen);
+    }
+    return packets_sendPacket(&actuationPackets);
+}
+
+/*******************************************************************************
+* Function Name: actuation_process()
+****************************************************************************//**
+* \brief
+*  Handles every pending command, then runs the watchdog. Call from the main
+*   loop.
+*
+* \return
+*  Error from processing the received bytes
+*******************************************************************************/
+uint32 actuation_process(void) {
+    uint32 error = packets_ERR_SUCCESS;
+    if(imuRx_getBytesPending()) {
+        rxStartUs = actuation_nowUs();
+        error = packets_processRxQueue(&actuationPackets);
+    }
+    actuation_watchdog(msCount);
+    return error;
+}
+
+/*******************************************************************************
+* Function Name: actuation_getMode()
+****************************************************************************//**
+* \brief
+*  Gets how the wheels are being driven
+*
+* \return
+*  actuation_MODE_<name>
+*******************************************************************************/
+uint8 actuation_getMode(void) {
+    return mode;
+}
+
+/*******************************************************************************
+* Function Name: actuation_getLatency()
+****************************************************************************//**
+* \brief
+*  Copies the command to PWM latency
+*
+* \param latencyOut [out]
+*  Latency since the last reset
+*
+* \return
+*  None
+*******************************************************************************/
+void actuation_getLatency(actuation_LATENCY_S *latencyOut) {
+    uint8 intState = CyEnterCriticalSection();
+    *latencyOut = latency;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: actuation_resetLatency()
+****************************************************************************//**
+* \brief
+*  Clears the command to PWM latency
+*
+* \return
+*  None
+*******************************************************************************/
+void actuation_resetLatency(void) {
+    uint8 intState = CyEnterCriticalSection();
+    latency.count = ZERO;
+    latency.min = UINT32_MAX;
+    latency.max = ZERO;
+    latency.total = ZERO;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: actuation_getInt16()
+****************************************************************************//**
+* \brief
+*  Reads a signed MSB first half word
+*
+* \param data [in]
+*  Location of the MSB
+*
+* \return
+*  The value
+*******************************************************************************/
+static int16 actuation_getInt16(uint8 *data) {
+    return (int16) ((data[ZERO] << BITS_ONE_BYTE) | data[ONE]);
+}
+
+/*******************************************************************************
+* Function Name: actuation_putWord()
+****************************************************************************//**
+* \brief
+*  Writes a word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param word [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 actuation_putWord(uint8 *data, uint32 word) {
+    uint8 i = ZERO;
+    data[i++] = (word >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[i++] = word & MASK_BYTE_ONE;
+    return i;
+}
+
+/*******************************************************************************
+* Function Name: actuation_handleCommand()
+****************************************************************************//**
+* \brief
+*  Handles the actuation_CMD_<name> and speedControl_CMD_<name> commands.
+*   Every command feeds the watchdog. Errors are reported in the flags of the
+*   response.
+*
+* \param rxPacket [in]
+*  Pointer to the packet containing the command
+*
+* \param txPacket [out]
+*  Pointer to the response packet
+*
+* \return
+*  Returns the error of associated with the operation
+*******************************************************************************/
+uint32 actuation_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket) {
+    uint8 *payload = rxPacket->payload;
+    uint8 intState;
+    lastCommandMs = msCount;
+    switch(rxPacket->cmd) {
+        /* Closed loop speeds, timed to the next loop sample */
+        case speedControl_CMD_SPEED: {
+            intState = CyEnterCriticalSection();
+            speedControl_handleCommand(rxPacket, txPacket);
+            if(!(txPacket->flags & packets_FLAG_INVALID_ARGS)) {
+                mode = actuation_MODE_SPEED;
+                latencyStartUs = rxStartUs;
+                latencyPending = true;
+            }
+            CyExitCriticalSection(intState);
+            break;
+        }
+        case speedControl_CMD_GAINS:
+        case speedControl_CMD_PROFILE: {
+            speedControl_handleCommand(rxPacket, txPacket);
+            break;
+        }
+        case speedControl_CMD_STOP: {
+            speedControl_handleCommand(rxPacket, txPacket);
+            mode = actuation_MODE_IDLE;
+            break;
+        }
+        /* Open loop duty, written immediately */
+        case actuation_CMD_PWM: {
+            if(rxPacket->payloadLen != actuation_LEN_PWM) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            intState = CyEnterCriticalSection();
+            latencyStartUs = rxStartUs;
+            latencyPending = true;
+            speedControl_setDuty(speedControl_WHEEL_LEFT, actuation_getInt16(&payload[ZERO]));
+            speedControl_setDuty(speedControl_WHEEL_RIGHT, actuation_getInt16(&payload[TWO]));
+            CyExitCriticalSection(intState);
+            mode = actuation_MODE_PWM;
+            break;
+        }
+        /* Zero duty held until the next drive command */
+        case actuation_CMD_BRAKE: {
+            speedControl_setDuty(speedControl_WHEEL_LEFT, ZERO);
+            speedControl_setDuty(speedControl_WHEEL_RIGHT, ZERO);
+            mode = actuation_MODE_BRAKE;
+            break;
+        }
+        /* Telemetry period and batching, an empty payload only queries them */
+        case actuation_CMD_TELEMETRY: {
+            if(rxPacket->payloadLen == actuation_LEN_TELEMETRY) {
+                if(telemetry_configure((uint16) actuation_getInt16(&payload[ZERO]), payload[TWO])) {
+                    txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                }
+            } else if(rxPacket->payloadLen != ZERO) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+            }
+            uint8 len = actuation_putInt16(txPacket->payload, (int16) telemetry_getPeriod());
+            txPacket->payload[len++] = telemetry_getRecords();
+            txPacket->payloadLen = len;
+            break;
+        }
+        /* Command timeout, an empty payload only queries it */
+        case actuation_CMD_WATCHDOG: {
+            if(rxPacket->payloadLen == actuation_LEN_WATCHDOG) {
+                timeoutMs = (uint16) actuation_getInt16(&payload[ZERO]);
+            } else if(rxPacket->payloadLen != ZERO) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+            }
+            txPacket->payloadLen = actuation_putInt16(txPacket->payload, (int16) timeoutMs);
+            break;
+        }
+        /* Command to PWM latency */
+        case actuation_CMD_LATENCY: {
+            if(rxPacket->payloadLen > ONE) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            actuation_LATENCY_S snapshot;
+            actuation_getLatency(&snapshot);
+            uint8 len = ZERO;
+            len += actuation_putWord(&txPacket->payload[len], snapshot.count);
+            len += actuation_putWord(&txPacket->payload[len], snapshot.count ? snapshot.min : ZERO);
+            len += actuation_putWord(&txPacket->payload[len], snapshot.max);
+            len += actuation_putWord(&txPacket->payload[len], snapshot.count ? (snapshot.total / snapshot.count) : ZERO);
+            txPacket->payloadLen = len;
+            if((rxPacket->payloadLen == ONE) && (payload[ZERO] != ZERO)) {
+                actuation_resetLatency();
+            }
+            break;
+        }
+        /* Command not found */
+        default: {
+            txPacket->flags |= packets_FLAG_INVALID_CMD;
+            break;
+        }
+    }
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* ISR Name: actuation_ISR_sysTick()
+********************************************************************************
+* Summary:
+*   Counts milliseconds for the watchdog
+* Interrupt:
+*   SysTick
+*
+*******************************************************************************/
+static void actuation_ISR_sysTick(void) {
+    msCount++;
+}
+
+/* [] END OF FILE */
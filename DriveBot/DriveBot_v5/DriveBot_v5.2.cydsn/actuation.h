@@ -0,0 +1,82 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: actuation.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for actuation.c
+*
+* 2018.11.09  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef actuation_H
+    #define actuation_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "packets.h"
+    #include "speedControl.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* SysTick runs at 1 ms, slot 0 is left for the application */
+    #define actuation_SYSTICK_CALLBACK      (1u)
+    #define actuation_US_PER_MS             (1000u)
+    /* Watchdog */
+    #define actuation_DEFAULT_TIMEOUT_MS    (250u)  /* Commands must arrive faster than this */
+    #define actuation_RAMP_MS               (250u)  /* Time to ramp from full duty to zero */
+    /* Commands, sent to the DriveBot from the IMU. speedControl_CMD_<name> are also accepted */
+    #define actuation_CMD_PWM               (0x20u) /* Open loop duty of both wheels */
+    #define actuation_CMD_BRAKE             (0x21u) /* Zero duty on both wheels until the next drive command */
+    #define actuation_CMD_TELEMETRY         (0x22u) /* Set or query the telemetry stream */
+    #define actuation_CMD_WATCHDOG          (0x23u) /* Set or query the command timeout, zero disables it */
+    #define actuation_CMD_LATENCY           (0x24u) /* Read the command to PWM latency, a non-zero byte clears it */
+    /* Payloads, all values MSB first */
+    #define actuation_LEN_PWM               (4u)    /* [left x2][right x2] signed duty */
+    #define actuation_LEN_TELEMETRY         (3u)    /* [period x2 ms][records per frame], zero period stops it */
+    #define actuation_LEN_WATCHDOG          (2u)    /* [timeout x2] ms */
+    #define actuation_LEN_LATENCY           (16u)   /* [count x4][min x4][max x4][mean x4] us */
+    /* Modes */
+    #define actuation_MODE_IDLE             (0u)    /* Wheels released */
+    #define actuation_MODE_SPEED            (1u)    /* Closed loop speed */
+    #define actuation_MODE_PWM              (2u)    /* Open loop duty */
+    #define actuation_MODE_BRAKE            (3u)    /* Held at zero duty */
+    #define actuation_MODE_TIMEOUT          (4u)    /* Commands stopped, ramping down */
+    /* Error codes */
+    #define actuation_ERR_OK                (0u)
+    #define actuation_ERR_PACKETS           (1u)    /* Packet buffers could not be created */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Time from a command being received to its duty being written, us */
+    typedef struct {
+        uint32 count;           /**< Commands measured */
+        uint32 min;             /**< Shortest latency */
+        uint32 max;             /**< Longest latency */
+        uint32 total;           /**< Sum of the latencies, for the mean */
+    } actuation_LATENCY_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    uint32 actuation_start(speedControl_DRIVE_T drive);
+    uint32 actuation_process(void);
+    uint32 actuation_sendPacket(uint8 cmd, uint16 payloadLen, uint8 *payload);
+    uint8 actuation_getMode(void);
+    void actuation_getLatency(actuation_LATENCY_S *latency);
+    void actuation_resetLatency(void);
+    uint32 actuation_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket);
+
+#endif /* actuation_H */
+/* [] END OF FILE */
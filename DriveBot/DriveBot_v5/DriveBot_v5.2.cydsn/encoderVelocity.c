@@ -0,0 +1,315 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: encoderVelocity.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Wheel velocity and acceleration from the encoders, updated once per
+*   control loop sample. At low speed a sample holds only a few counts, so the
+*   speed is the counts between two timed edges divided by the time between
+*   them. With no new edge the speed is limited to one count over the time
+*   since the last edge, and decays to zero. Above encoderVelocity_COUNT_ENTER
+*   counts per sample the change in count over the sample period is used
+*   instead. The raw measurement goes through an alpha-beta filter that
+*   tracks the velocity and the acceleration. All arithmetic is integer.
+*
+*   Edge timestamps come from the function passed to encoderVelocity_init(),
+*   e.g. a timer that captures on the encoder edges. Without one the edges are
+*   stamped with the sample time, which still resolves speeds below one count
+*   per sample.
+*
+* 2018.11.08  - Document Created
+********************************************************************************/
+#include "encoderVelocity.h"
+#include "micaCommon.h"
+
+/* Estimator state of a single wheel */
+typedef struct {
+    int32 lastCount;            /* Count at the previous sample */
+    int32 edgeCount;            /* Count at the last timed edge */
+    uint32 edgeTime;            /* Timestamp of the last timed edge */
+    bool edgeValid;             /* The last edge can start a period */
+    encoderVelocity_ESTIMATE_S estimate;
+} VELOCITY_WHEEL_S;
+
+static VELOCITY_WHEEL_S wheels[encoderVelocity_NUM_WHEELS];
+static encoderVelocity_READ_T readCapture = NULL;
+static uint32 lastNow = ZERO;
+
+/*******************************************************************************
+* Function Name: encoderVelocity_abs()
+****************************************************************************//**
+* \brief
+*  Magnitude of a value
+*
+* \param value [in]
+*  Signed value
+*
+* \return
+*  The magnitude
+*******************************************************************************/
+static int64 encoderVelocity_abs(int64 value) {
+    return (value < 0) ? -value : value;
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_read()
+****************************************************************************//**
+* \brief
+*  Reads both wheels. Without a capture function the counts come from
+*   dualEncoder and every edge is stamped with the sample time.
+*
+* \param captures [out]
+*  Reading of each wheel
+*
+* \param now [in]
+*  Timestamp of the sample
+*
+* \return
+*  None
+*******************************************************************************/
+static void encoderVelocity_read(encoderVelocity_CAPTURE_S *captures, uint32 now) {
+    uint8 i;
+    if(readCapture != NULL) {
+        for(i = ZERO; i < encoderVelocity_NUM_WHEELS; i++) {
+            readCapture(i, &captures[i]);
+        }
+    } else {
+        ENCODER_DUAL_T encoder;
+        dualEncoder_getEncoderCounts(&encoder);
+        captures[encoderVelocity_WHEEL_LEFT].count = encoder.leftCount;
+        captures[encoderVelocity_WHEEL_RIGHT].count = encoder.rightCount;
+        for(i = ZERO; i < encoderVelocity_NUM_WHEELS; i++) {
+            captures[i].edgeTime = now;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_init()
+****************************************************************************//**
+* \brief
+*  Sets where the edge timestamps come from. dualEncoder must be started
+*   separately, and encoderVelocity_reset() called before the first update.
+*
+* \param read [in]
+*  Function that reads the count and last edge timestamp of a wheel, in the
+*   same time base as encoderVelocity_update(). NULL to use the sample time.
+*
+* \return
+*  None
+*******************************************************************************/
+void encoderVelocity_init(encoderVelocity_READ_T read) {
+    readCapture = read;
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_reset()
+****************************************************************************//**
+* \brief
+*  Zeros the estimates and starts from the current counts
+*
+* \param now [in]
+*  Timestamp, encoderVelocity_TIMER_HZ
+*
+* \return
+*  None
+*******************************************************************************/
+void encoderVelocity_reset(uint32 now) {
+    encoderVelocity_CAPTURE_S captures[encoderVelocity_NUM_WHEELS];
+    encoderVelocity_read(captures, now);
+    uint8 intState = CyEnterCriticalSection();
+    uint8 i;
+    for(i = ZERO; i < encoderVelocity_NUM_WHEELS; i++) {
+        VELOCITY_WHEEL_S *w = &wheels[i];
+        w->lastCount = captures[i].count;
+        w->edgeCount = captures[i].count;
+        w->edgeTime = now;
+        w->edgeValid = false;
+        w->estimate.velocity = ZERO;
+        w->estimate.acceleration = ZERO;
+        w->estimate.raw = ZERO;
+        w->estimate.mode = encoderVelocity_MODE_PERIOD;
+    }
+    lastNow = now;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_update()
+****************************************************************************//**
+* \brief
+*  Measures the speed of both wheels and updates the filters. Call once per
+*   control loop sample.
+*
+* \param now [in]
+*  Timestamp of the sample, encoderVelocity_TIMER_HZ
+*
+* \return
+*  None
+*******************************************************************************/
+void encoderVelocity_update(uint32 now) {
+    encoderVelocity_CAPTURE_S captures[encoderVelocity_NUM_WHEELS];
+    encoderVelocity_read(captures, now);
+    uint32 samplePeriod = now - lastNow;
+    lastNow = now;
+    if(samplePeriod == ZERO) {
+        return;
+    }
+    uint8 i;
+    for(i = ZERO; i < encoderVelocity_NUM_WHEELS; i++) {
+        VELOCITY_WHEEL_S *w = &wheels[i];
+        encoderVelocity_ESTIMATE_S *e = &w->estimate;
+        int32 count = captures[i].count;
+        int32 delta = count - w->lastCount;
+        w->lastCount = count;
+        int64 raw = e->raw;
+        bool newEdge = (count != w->edgeCount);
+        if(e->mode == encoderVelocity_MODE_COUNT) {
+            /* Change in count over the sample */
+            raw = ((int64) delta * encoderVelocity_TIMER_HZ << encoderVelocity_SHIFT) / samplePeriod;
+            if(encoderVelocity_abs(delta) <= encoderVelocity_COUNT_EXIT) {
+                e->mode = encoderVelocity_MODE_PERIOD;
+            }
+        } else if(newEdge) {
+            /* Counts between two timed edges */
+            uint32 period = captures[i].edgeTime - w->edgeTime;
+            if(w->edgeValid && (period > ZERO)) {
+                raw = ((int64) (count - w->edgeCount) * encoderVelocity_TIMER_HZ << encoderVelocity_SHIFT) / period;
+            } else {
+                /* First edge after stopping only starts the period */
+                raw = ZERO;
+            }
+            if(encoderVelocity_abs(delta) >= encoderVelocity_COUNT_ENTER) {
+                e->mode = encoderVelocity_MODE_COUNT;
+            }
+        } else {
+            uint32 since = now - w->edgeTime;
+            if(since >= encoderVelocity_STOP_TIME) {
+                raw = ZERO;
+                w->edgeValid = false;
+            } else if(since > ZERO) {
+                /* No edge yet, so at most one count since the last one */
+                int64 bound = ((int64) encoderVelocity_TIMER_HZ << encoderVelocity_SHIFT) / since;
+                if(raw > bound) {
+                    raw = bound;
+                } else if(raw < -bound) {
+                    raw = -bound;
+                }
+            }
+        }
+        if(newEdge) {
+            w->edgeCount = count;
+            w->edgeTime = captures[i].edgeTime;
+            w->edgeValid = true;
+        }
+        /* Alpha-beta filter */
+        int64 predicted = e->velocity + ((int64) e->acceleration * samplePeriod) / encoderVelocity_TIMER_HZ;
+        int64 residual = raw - predicted;
+        e->velocity = (int32) (predicted + (encoderVelocity_ALPHA * residual) / (1 << encoderVelocity_SHIFT));
+        e->acceleration += (int32) (((encoderVelocity_BETA * residual) / (1 << encoderVelocity_SHIFT)) * encoderVelocity_TIMER_HZ / samplePeriod);
+        e->raw = (int32) raw;
+    }
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_getCount()
+****************************************************************************//**
+* \brief
+*  Encoder count of a wheel at the last update
+*
+* \param wheel [in]
+*  encoderVelocity_WHEEL_<side>
+*
+* \return
+*  Quadrature count, zero for an unknown wheel
+*******************************************************************************/
+int32 encoderVelocity_getCount(uint8 wheel) {
+    if(wheel >= encoderVelocity_NUM_WHEELS) {
+        return ZERO;
+    }
+    return wheels[wheel].lastCount;
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_getVelocity()
+****************************************************************************//**
+* \brief
+*  Filtered velocity of a wheel
+*
+* \param wheel [in]
+*  encoderVelocity_WHEEL_<side>
+*
+* \return
+*  Velocity in ticks/s, zero for an unknown wheel
+*******************************************************************************/
+int16 encoderVelocity_getVelocity(uint8 wheel) {
+    if(wheel >= encoderVelocity_NUM_WHEELS) {
+        return ZERO;
+    }
+    int32 velocity = wheels[wheel].estimate.velocity / (1 << encoderVelocity_SHIFT);
+    if(velocity > INT16_MAX) {
+        return INT16_MAX;
+    } else if(velocity < -INT16_MAX) {
+        return -INT16_MAX;
+    }
+    return (int16) velocity;
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_getAcceleration()
+****************************************************************************//**
+* \brief
+*  Filtered acceleration of a wheel
+*
+* \param wheel [in]
+*  encoderVelocity_WHEEL_<side>
+*
+* \return
+*  Acceleration in ticks/s^2, zero for an unknown wheel
+*******************************************************************************/
+int32 encoderVelocity_getAcceleration(uint8 wheel) {
+    if(wheel >= encoderVelocity_NUM_WHEELS) {
+        return ZERO;
+    }
+    return wheels[wheel].estimate.acceleration / (1 << encoderVelocity_SHIFT);
+}
+
+/*******************************************************************************
+* Function Name: encoderVelocity_getEstimate()
+****************************************************************************//**
+* \brief
+*  Copies the full estimate of a wheel
+*
+* \param wheel [in]
+*  encoderVelocity_WHEEL_<side>
+*
+* \param estimate [out]
+*  Q8 velocity and acceleration, raw measurement and method. Zeroed for an
+*   unknown wheel.
+*
+* \return
+*  None
+*******************************************************************************/
+void encoderVelocity_getEstimate(uint8 wheel, encoderVelocity_ESTIMATE_S *estimate) {
+    if(wheel >= encoderVelocity_NUM_WHEELS) {
+        estimate->velocity = ZERO;
+        estimate->acceleration = ZERO;
+        estimate->raw = ZERO;
+        estimate->mode = encoderVelocity_MODE_PERIOD;
+        return;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    *estimate = wheels[wheel].estimate;
+    CyExitCriticalSection(intState);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,84 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: encoderVelocity.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for encoderVelocity.c
+*
+* 2018.11.08  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef encoderVelocity_H
+    #define encoderVelocity_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Wheels */
+    #define encoderVelocity_WHEEL_LEFT          (0u)
+    #define encoderVelocity_WHEEL_RIGHT         (1u)
+    #define encoderVelocity_NUM_WHEELS          (2u)
+    /* Timestamps are free running and count up at this rate */
+    #ifndef encoderVelocity_TIMER_HZ
+        #define encoderVelocity_TIMER_HZ        (1000000u)
+    #endif
+    /* Method switching, counts per sample with hysteresis */
+    #define encoderVelocity_COUNT_ENTER         (8)     /* Switch to counting at or above */
+    #define encoderVelocity_COUNT_EXIT          (4)     /* Switch back to edge timing at or below */
+    /* No edge for this long is treated as stopped [timer ticks] */
+    #define encoderVelocity_STOP_TIME           (encoderVelocity_TIMER_HZ / 4u)
+    /* Estimates are Q8 */
+    #define encoderVelocity_SHIFT               (8u)
+    /* Alpha-beta filter, Q8. Beta = alpha^2 / (2 - alpha) is critically damped */
+    #define encoderVelocity_ALPHA               (128)   /* 0.5 */
+    #define encoderVelocity_BETA                (43)    /* 0.167 */
+    /* Method used for the last raw measurement */
+    #define encoderVelocity_MODE_PERIOD         (0u)    /* Counts between edge timestamps */
+    #define encoderVelocity_MODE_COUNT          (1u)    /* Counts over the sample period */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Encoder reading of a single wheel */
+    typedef struct {
+        int32 count;            /**< Quadrature count */
+        uint32 edgeTime;        /**< Timestamp of the edge that produced count */
+    } encoderVelocity_CAPTURE_S;
+
+    /* Filtered estimate of a single wheel */
+    typedef struct {
+        int32 velocity;         /**< Q8 ticks/s */
+        int32 acceleration;     /**< Q8 ticks/s^2 */
+        int32 raw;              /**< Unfiltered measurement, Q8 ticks/s */
+        uint8 mode;             /**< encoderVelocity_MODE_<name> */
+    } encoderVelocity_ESTIMATE_S;
+
+    /* Reads the count and the last edge timestamp of a wheel */
+    typedef void (*encoderVelocity_READ_T)(uint8 wheel, encoderVelocity_CAPTURE_S *capture);
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void encoderVelocity_init(encoderVelocity_READ_T read);
+    void encoderVelocity_reset(uint32 now);
+    void encoderVelocity_update(uint32 now);
+    int32 encoderVelocity_getCount(uint8 wheel);
+    int16 encoderVelocity_getVelocity(uint8 wheel);
+    int32 encoderVelocity_getAcceleration(uint8 wheel);
+    void encoderVelocity_getEstimate(uint8 wheel, encoderVelocity_ESTIMATE_S *estimate);
+
+#endif /* encoderVelocity_H */
+/* [] END OF FILE */
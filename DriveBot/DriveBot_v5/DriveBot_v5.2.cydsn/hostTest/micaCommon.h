@@ -0,0 +1,23 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: micaCommon.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2 host test
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* Brief:
+*   Stands in for the micaCommon component header on a Linux host. The
+*   constants keep the component's unsigned types.
+*
+* 2018.11.15  - Document Created
+********************************************************************************/
+#ifndef HOST_MICA_COMMON_H
+    #define HOST_MICA_COMMON_H
+    #define ZERO    (0u)
+    #define ONE     (1u)
+    #define TWO     (2u)
+#endif /* HOST_MICA_COMMON_H */
+/* [] END OF FILE */
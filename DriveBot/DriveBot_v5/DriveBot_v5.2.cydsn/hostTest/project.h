@@ -0,0 +1,32 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: project.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2 host test
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* Brief:
+*   Stands in for the generated project.h when the hardware independent
+*   modules are built on a Linux host
+*
+* 2018.11.15  - Document Created
+********************************************************************************/
+#ifndef HOST_PROJECT_H
+    #define HOST_PROJECT_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef uint64_t uint64;
+    typedef int8_t int8;
+    typedef int16_t int16;
+    typedef int32_t int32;
+    typedef int64_t int64;
+#endif /* HOST_PROJECT_H */
+/* [] END OF FILE */
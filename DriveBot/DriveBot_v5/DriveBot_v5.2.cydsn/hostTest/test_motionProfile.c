@@ -0,0 +1,161 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: test_motionProfile.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2 host test
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* Brief:
+*   Runs motionProfile.c on a Linux host with the speedControl duty defaults.
+*   Checks ramps in both directions and a full duty reversal, then runs the
+*   reversal through a first order model of the wheel to find how slow the
+*   drivetrain can be before the speedControl current estimate counts a peak.
+*
+*   Build and run from the project directory:
+*     gcc -std=gnu99 -Wall -I hostTest -I . hostTest/test_motionProfile.c motionProfile.c -o test_motionProfile && ./test_motionProfile
+*
+* 2018.11.15  - Document Created
+********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "motionProfile.h"
+#include "micaCommon.h"
+
+/* Defaults of speedControl.h */
+#define DUTY_MAX            (255)
+#define DUTY_RATE           (2550u)     /* Full duty in 100 ms [counts/s] */
+#define DUTY_JERK           (51000u)    /* Full rate in 50 ms [counts/s^2] */
+#define RATE_HZ             (100u)
+#define MAX_SAMPLES         (1000u)
+/* Wheel model */
+#define TAU_STEP_MS         (5u)
+#define TAU_MAX_MS          (500u)
+
+/* Test helpers */
+static uint32 failures = ZERO;
+
+static void check(const char *name, int32 actual, int32 expected){
+    bool pass = (actual == expected);
+    printf("%s: %s (got %d, expected %d)\n", pass ? "PASS" : "FAIL", name, actual, expected);
+    failures += pass ? ZERO : ONE;
+}
+
+/* Steps the profile to its goal, checking that no step is larger than the
+* limits allow and that the goal is never passed. The rate of a trapezoid
+* changes at once, so jerk is only checked for an S-curve. Returns the
+* samples taken */
+static int32 runToGoal(motionProfile_S *profile, int32 goal, bool sCurve, int32 *firstValue, bool *withinLimits){
+    int32 start = motionProfile_getValue(profile);
+    int32 last = start;
+    int32 lastRate = ZERO;
+    int32 maxStep = (int32) (DUTY_RATE / RATE_HZ) + 1;
+    int32 maxRateChange = (int32) (DUTY_JERK / (RATE_HZ * RATE_HZ)) + 1;
+    int32 low = (start < goal) ? start : goal;
+    int32 high = (start < goal) ? goal : start;
+    *withinLimits = true;
+    motionProfile_setGoal(profile, goal);
+    uint32 i;
+    for(i = ZERO; (i < MAX_SAMPLES) && !motionProfile_isDone(profile); i++){
+        int32 value = motionProfile_step(profile);
+        if(i == ZERO){
+            *firstValue = value;
+        }
+        int32 rate = value - last;
+        if((abs(rate) > maxStep) || (sCurve && (abs(rate - lastRate) > maxRateChange)) || (value < low) || (value > high)){
+            *withinLimits = false;
+        }
+        last = value;
+        lastRate = rate;
+    }
+    return (int32) i;
+}
+
+/* Counts the peaks of the speedControl current estimate over a full duty
+* reversal and back. The wheel speed is held as the duty its back EMF
+* cancels, which follows the applied duty with time constant tauMs. */
+static uint32 reversalPeaks(motionProfile_LIMITS_S *limits, uint32 tauMs){
+    motionProfile_S profile;
+    motionProfile_setLimits(&profile, limits, RATE_HZ);
+    motionProfile_reset(&profile, DUTY_MAX);
+    float emf = (float) DUTY_MAX;
+    float alpha = (1000.0f / RATE_HZ) / (float) (tauMs + (1000u / RATE_HZ));
+    uint32 count = ZERO;
+    bool peak = false;
+    int32 goals[2] = {-DUTY_MAX, DUTY_MAX};
+    uint8 g;
+    for(g = ZERO; g < 2u; g++){
+        motionProfile_setGoal(&profile, goals[g]);
+        uint32 i;
+        for(i = ZERO; i < RATE_HZ; i++){
+            /* The estimate uses the speed measured before the new duty acts */
+            int32 duty = motionProfile_step(&profile);
+            float drive = (float) duty - emf;
+            emf += alpha * ((float) duty - emf);
+            bool now = (drive > DUTY_MAX) || (drive < -DUTY_MAX);
+            if(now && !peak){
+                count++;
+            }
+            peak = now;
+        }
+    }
+    return count;
+}
+
+int main(void){
+    motionProfile_S profile;
+    motionProfile_LIMITS_S trapezoid = {DUTY_RATE, motionProfile_JERK_NONE};
+    motionProfile_LIMITS_S sCurve = {DUTY_RATE, DUTY_JERK};
+    motionProfile_LIMITS_S unlimited = {motionProfile_RATE_NONE, motionProfile_JERK_NONE};
+    int32 first;
+    bool withinLimits;
+
+    /* Trapezoid, both directions take the same samples */
+    motionProfile_setLimits(&profile, &trapezoid, RATE_HZ);
+    motionProfile_reset(&profile, ZERO);
+    int32 upSamples = runToGoal(&profile, DUTY_MAX, false, &first, &withinLimits);
+    check("Up ramp first step", first, 25);
+    check("Up ramp within limits", withinLimits, true);
+    motionProfile_reset(&profile, ZERO);
+    check("Down ramp samples", runToGoal(&profile, -DUTY_MAX, false, &first, &withinLimits), upSamples);
+    check("Down ramp first step", first, -25);
+    check("Down ramp within limits", withinLimits, true);
+    check("Down ramp ends on the goal", motionProfile_getValue(&profile), -DUTY_MAX);
+
+    /* S-curve reversal from full forward, slows before it turns around */
+    motionProfile_setLimits(&profile, &sCurve, RATE_HZ);
+    motionProfile_reset(&profile, DUTY_MAX);
+    int32 reverseSamples = runToGoal(&profile, -DUTY_MAX, true, &first, &withinLimits);
+    check("Reversal ramps rather than steps", first, 249);
+    check("Reversal within limits", withinLimits, true);
+    check("Reversal ends on the goal", motionProfile_getValue(&profile), -DUTY_MAX);
+    check("Reversal back takes the same samples", runToGoal(&profile, DUTY_MAX, true, &first, &withinLimits), reverseSamples);
+    check("Reversal back within limits", withinLimits, true);
+    printf("Full reversal: %d samples at %u Hz\n", reverseSamples, RATE_HZ);
+
+    /* No rate limit steps straight to the goal */
+    motionProfile_setLimits(&profile, &unlimited, RATE_HZ);
+    motionProfile_reset(&profile, DUTY_MAX);
+    check("Unlimited reversal", runToGoal(&profile, -DUTY_MAX, false, &first, &withinLimits), ONE);
+    check("Unlimited reversal value", first, -DUTY_MAX);
+
+    /* Peaks of the current estimate against how slowly the wheel responds */
+    uint32 tauMs;
+    uint32 slowestWithoutPeaks = ZERO;
+    for(tauMs = TAU_STEP_MS; tauMs <= TAU_MAX_MS; tauMs += TAU_STEP_MS){
+        if(reversalPeaks(&sCurve, tauMs) != ZERO){
+            break;
+        }
+        slowestWithoutPeaks = tauMs;
+    }
+    printf("Default profile: no peaks up to a wheel time constant of %u ms\n", slowestWithoutPeaks);
+    check("Unlimited reversal peaks, 10 ms wheel", reversalPeaks(&unlimited, 10u), 2);
+    check("Default profile peaks, 50 ms wheel", reversalPeaks(&sCurve, 50u), ZERO);
+
+    printf("\n%u failure(s)\n", failures);
+    return (failures == ZERO) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,250 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: imuRx.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Interrupt driven circular receive buffer for the IMU UART. The RX FIFO
+*   is emptied in the interrupt, so bytes are not lost while the main loop
+*   is busy. The packet layer drains the ring in bulk.
+*
+* 2018.08.22  - Document Created
+********************************************************************************/
+#include "imuRx.h"
+#include "micaCommon.h"
+#include <string.h>
+
+/* Ring buffer - head is written by the ISR, tail by the main loop */
+static uint8 rxRing[imuRx_BUFFER_LEN];
+static volatile uint16 rxHead = ZERO;
+static volatile uint16 rxTail = ZERO;
+/* Statistics */
+static volatile imuRx_STATS_S rxStats;
+
+static void imuRx_ISR(void);
+
+/*******************************************************************************
+* Function Name: imuRx_Start()
+****************************************************************************//**
+* \brief
+*  Starts the IMU UART and routes the RX FIFO not empty interrupt into the ring
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_Start(void) {
+    imuRx_flush();
+    imuRx_resetStats();
+    UART_IMU_Start();
+    UART_IMU_SetCustomInterruptHandler(imuRx_ISR);
+    UART_IMU_SetRxInterruptMode(UART_IMU_INTR_RX_NOT_EMPTY | UART_IMU_INTR_RX_OVERFLOW);
+    UART_IMU_EnableInt();
+}
+
+/*******************************************************************************
+* Function Name: imuRx_Stop()
+****************************************************************************//**
+* \brief
+*  Stops the IMU UART and the receive interrupt
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_Stop(void) {
+    UART_IMU_DisableInt();
+    UART_IMU_SetRxInterruptMode(ZERO);
+    UART_IMU_Stop();
+}
+
+/*******************************************************************************
+* Function Name: imuRx_getBytesPending()
+****************************************************************************//**
+* \brief
+*  Returns the number of bytes waiting in the ring
+*
+* \return
+*  Number of bytes available to read
+*******************************************************************************/
+uint16 imuRx_getBytesPending(void) {
+    return (rxHead - rxTail) & imuRx_BUFFER_MASK;
+}
+
+/*******************************************************************************
+* Function Name: imuRx_peekSpan()
+****************************************************************************//**
+* \brief
+*  Returns the largest contiguous run of received bytes, without removing them
+*   from the ring. Call imuRx_consume() once the bytes have been processed.
+*
+* \param span [out]
+*  Location to place the pointer to the first byte
+*
+* \return
+*  Number of contiguous bytes at span
+*******************************************************************************/
+uint16 imuRx_peekSpan(uint8 **span) {
+    uint16 head = rxHead;
+    uint16 tail = rxTail;
+    *span = &rxRing[tail];
+    /* Data wraps, only return up to the end of the buffer */
+    if(head < tail) {
+        return imuRx_BUFFER_LEN - tail;
+    }
+    return head - tail;
+}
+
+/*******************************************************************************
+* Function Name: imuRx_consume()
+****************************************************************************//**
+* \brief
+*  Removes bytes from the ring that were processed in place
+*
+* \param len
+*  Number of bytes to remove
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_consume(uint16 len) {
+    uint16 pending = imuRx_getBytesPending();
+    if(len > pending){
+        len = pending;
+    }
+    rxTail = (rxTail + len) & imuRx_BUFFER_MASK;
+}
+
+/*******************************************************************************
+* Function Name: imuRx_read()
+****************************************************************************//**
+* \brief
+*  Copies received bytes out of the ring
+*
+* \param data [out]
+*  Location to place the bytes
+*
+* \param maxLen
+*  Maximum number of bytes to copy
+*
+* \return
+*  Number of bytes copied
+*******************************************************************************/
+uint16 imuRx_read(uint8 *data, uint16 maxLen) {
+    uint16 copied = ZERO;
+    /* At most two runs, before and after the wrap */
+    while(copied < maxLen) {
+        uint8 *span;
+        uint16 len = imuRx_peekSpan(&span);
+        if(len == ZERO) {
+            break;
+        }
+        if(len > (maxLen - copied)) {
+            len = maxLen - copied;
+        }
+        memcpy(&data[copied], span, len);
+        imuRx_consume(len);
+        copied += len;
+    }
+    return copied;
+}
+
+/*******************************************************************************
+* Function Name: imuRx_flush()
+****************************************************************************//**
+* \brief
+*  Discards all of the received data
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_flush(void) {
+    uint8 intState = CyEnterCriticalSection();
+    rxTail = rxHead;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: imuRx_getStats()
+****************************************************************************//**
+* \brief
+*  Returns a snapshot of the receive statistics
+*
+* \param stats [out]
+*  Location to place the statistics
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_getStats(imuRx_STATS_S *stats) {
+    uint8 intState = CyEnterCriticalSection();
+    stats->bytesReceived = rxStats.bytesReceived;
+    stats->bytesDropped = rxStats.bytesDropped;
+    stats->fifoOverflows = rxStats.fifoOverflows;
+    stats->highWater = rxStats.highWater;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: imuRx_resetStats()
+****************************************************************************//**
+* \brief
+*  Clears the receive statistics
+*
+* \return
+*  None
+*******************************************************************************/
+void imuRx_resetStats(void) {
+    uint8 intState = CyEnterCriticalSection();
+    rxStats.bytesReceived = ZERO;
+    rxStats.bytesDropped = ZERO;
+    rxStats.fifoOverflows = ZERO;
+    rxStats.highWater = ZERO;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* ISR Name: imuRx_ISR()
+********************************************************************************
+* Summary:
+*   Empties the RX FIFO into the ring. Bytes that do not fit are counted
+*   and discarded.
+* Interrupt:
+*   UART_IMU_SCB_IRQ
+*
+*******************************************************************************/
+static void imuRx_ISR(void) {
+    uint32 source = UART_IMU_GetRxInterruptSourceMasked();
+    /* The hardware FIFO overflowed before the interrupt was serviced */
+    if(source & UART_IMU_INTR_RX_OVERFLOW) {
+        rxStats.fifoOverflows++;
+    }
+    /* Drain the FIFO */
+    uint16 head = rxHead;
+    while(UART_IMU_SpiUartGetRxBufferSize()) {
+        uint8 data = (uint8) UART_IMU_SpiUartReadRxData();
+        uint16 next = (head + ONE) & imuRx_BUFFER_MASK;
+        if(next == rxTail) {
+            rxStats.bytesDropped++;
+        } else {
+            rxRing[head] = data;
+            head = next;
+            rxStats.bytesReceived++;
+        }
+    }
+    rxHead = head;
+    /* Track the peak usage */
+    uint16 pending = (head - rxTail) & imuRx_BUFFER_MASK;
+    if(pending > rxStats.highWater) {
+        rxStats.highWater = pending;
+    }
+    UART_IMU_ClearRxInterruptSource(source);
+}
+
+/* [] END OF FILE */
@@ -26,8 +26,17 @@
 #include "project.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "packet_testing.h"
 #include "testRunner.h"
+#include "packet_benchmark.h"
+#include "packetsBulk.h"
+#include "imuRx.h"
+#include "memPool.h"
+#include "speedControl.h"
+#include "encoderVelocity.h"
+#include "actuation.h"
+#include "telemetry.h"
 
 /*  -------------- DEBUGGING --------------
 * Uncomment MICA_DEBUG to enable general debugging.
@@ -69,26 +78,40 @@
 */
 #ifdef MICA_TEST
 //    #define MICA_TEST_DIRECTION_CHANGE  /* See how fast/torqy the accelration change is */
-//    #define MICA_TEST_PID_SPEED         /* Simple control loop set speed */
+//    #define MICA_TEST_PID_SPEED         /* Closed loop wheel speeds commanded over the IMU UART */
 //    #define MICA_TEST_PACKETS_SELF         /* Self test (no UART) of the packets */
 //    #define MICA_TEST_MALLOC            /* Test heap memory allocation */
 //    #define MICA_TEST_PACKET_SPAWN            /*spawning packets */
 //    #define MICA_TEST_PACKETS_ERRORS       /* Test various error on packts */
     #define MICA_TEST_PACKETS           /* Test Packet communication */
 //    #define MICA_TEST_PACKETS_ISR        /* Receive packets from IMU via interrupt and print results */
+//    #define MICA_TEST_PACKETS_BENCHMARK  /* Measure the cycles/throughput of the packet codec */
+//    #define MICA_TEST_PACKETS_BULK       /* Receive packets from the IMU a span at a time */
+//    #define MICA_TEST_UART_STRESS        /* Measure sustained IMU UART throughput and drops */
+//    #define MICA_TEST_MEM_POOL           /* Fixed block pool allocation and packet buffers */
 #endif
 /* -------------- END TEST LEVEL --------------  */
 
+/* Direction bits of Motors_motorControlReg, set to drive a wheel forward.
+* The Motors component keeps the control register layout of DriveBot_v5.0
+* main.h (MICA_MOTOR_<side>_SHIFT): left direction in bit 0, right in bit 4,
+* each with its enable two bits above */
+#define MOTORS_CTRL_FORWARD_L       (0x01u)
+#define MOTORS_CTRL_FORWARD_R       (0x10u)
+
 /* --------- Local Variables --------- */
 
 void ISR_imuUart(void);
 void ISR_Timer(void);
 void ISR_toggleMotorState(void);
 void ISR_toggleBtnTest(void);
+void ISR_sysTick(void);
+void driveWheel(uint8 wheel, int16 duty);
 /* State variables */
 volatile bool flag_pendingRxByte = false;
 volatile bool motorsState = false;
 volatile bool timerExpired = false;
+volatile uint32 sysTickMs = 0;
 /*******************************************************************************
 * Function Name: main()
 ********************************************************************************
@@ -427,7 +450,17 @@ int main(void) {
 #endif /* MICA_DEBUG */
 #ifdef MICA_TEST
     #if defined MICA_TEST_DIRECTION_CHANGE
-        /* Investigate if the motors can flip up drivebot */
+        /* Investigate if the motors can flip up drivebot. Full duty reversals
+        * go through the duty profile, so they are fast but the current is
+        * bounded. Expected outcome:
+        * 0. Green LED on, the button toggles the motors
+        * 1. Cyan forwards and yellow backwards every 600 ms
+        * 2. Peak current counts of each wheel are printed over the USB UART
+        *    after each reversal. With the default profile they stay at zero
+        *    while the wheels respond within about 120 ms (modelled in
+        *    hostTest/test_motionProfile.c), a count every reversal means the
+        *    drivetrain is slower than that */
+        #define DIRECTION_CHANGE_MS     (600u)
         /* Initialize Button interrupts */
         boardTest_EnableBtnInterrupts();
         /* ISR to call when button is pressed */
@@ -435,63 +468,109 @@ int main(void) {
         CyGlobalIntEnable;
         /* Start hardware blocks */
         Motors_Start();
+        dualEncoder_Start();
+        UART_USB_Start();
+        speedControl_init(driveWheel);
+        speedControl_start();
         LEDS_Write(LEDS_ON_GREEN);
+        int16 duty = speedControl_DUTY_MAX;
 
         /* Infinite Loop */
         for(;;){
             if(motorsState){
-                /* Forwards */
-                LEDS_Write(LEDS_ON_CYAN);
-                Motors_Move(Motors_FORWARD, Motors_SPEED_MAX);
-                MICA_delayMs(600);
-                /* Back */
-                LEDS_Write(LEDS_ON_YELLOW);
-                Motors_Move(Motors_BACKWARD, Motors_SPEED_MAX);
-                MICA_delayMs(600);
+                LEDS_Write((duty > 0) ? LEDS_ON_CYAN : LEDS_ON_YELLOW);
+                speedControl_setDuty(speedControl_WHEEL_LEFT, duty);
+                speedControl_setDuty(speedControl_WHEEL_RIGHT, duty);
+                MICA_delayMs(DIRECTION_CHANGE_MS);
+                usbUart_print("Peaks left: %lu, right: %lu\r\n", (unsigned long) speedControl_getPeakCount(speedControl_WHEEL_LEFT),
+                    (unsigned long) speedControl_getPeakCount(speedControl_WHEEL_RIGHT));
+                duty = -duty;
             } else {
                 /* Idle mode */
+                speedControl_setDuty(speedControl_WHEEL_LEFT, ZERO);
+                speedControl_setDuty(speedControl_WHEEL_RIGHT, ZERO);
                 LEDS_Write(LEDS_ON_GREEN);   
             }
         }
         /* End MICA_TEST_DIRECTION_CHANGE */
     #elif defined MICA_TEST_PID_SPEED
-        /* Test a simple PID loop */
+        /* Closed loop wheel speeds. Speeds and gains are commanded over the IMU
+        * UART with speedControl_CMD_<name> packets, and the button enables the
+        * motors. Expected outcome:
+        * 0. Green LED on, motors disabled
+        * 1. Target and measured speeds and the duty of each wheel are printed
+        *    over the USB UART four times a second
+        * 2. Blue LED toggles on each command, the response holds the measured speeds
+        * 3. Wheel speeds track the targets under load */
+        #define PID_PRINT_MS    (250u)
         /* Initialize Button interrupts */
         boardTest_EnableBtnInterrupts();
-        
-        /* Assign Interrupt vectors */
         boardTest_SetBtnPressIsr( ISR_toggleMotorState );
-        timer_interrupt_StartEx(ISR_Timer);
         CyGlobalIntEnable;
         /* Start hardware blocks */
         Motors_Start();
-        QuadDec_L_Start();
-        QuadDec_R_Start();
+        Motors_Disable();
+        dualEncoder_Start();
         UART_USB_Start();
-        SystemTimer_Start();
-        /* Set the timer count (down counter) */
-        SystemTimer_WritePeriod(25000);
-        /* Initial LED state */
+        imuRx_Start();
+        CySysTickStart();
+        CySysTickSetCallback(ZERO, ISR_sysTick);
+        /* Packets from the IMU */
+        packets_BUFFER_FULL_S packetBuffer;
+        packets_initialize(&packetBuffer);
+        uint32 error = memPool_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
+        if(error){
+            LEDS_Write(LEDS_ON_RED);
+            for(;;){}
+        }
+        /* Start the loop with both wheels released */
+        speedControl_init(driveWheel);
+        speedControl_start();
         LEDS_Write(LEDS_ON_GREEN);
-
+        uint32 lastMs = sysTickMs;
 
         /* Infinite Loop */
         for(;;){
-            if(timerExpired){
-                /* Clear the flag */
-                timerExpired = false;
-                /* Get the encoder values */
-                encoder_T encoder;
-                boardTest_getEncoderCounts(&encoder);
-                /* Clear the screen */
+            /* Process everything received from the IMU */
+            uint8 *span;
+            uint16 spanLen = imuRx_peekSpan(&span);
+            if(spanLen){
+                uint16 bytesUsed;
+                uint32 err = packetsBulk_processRxBuffer(&packetBuffer, span, spanLen, &bytesUsed);
+                imuRx_consume(bytesUsed);
+                if(err){
+                    packets_flushRxBuffers(&packetBuffer);
+                }
+                if(packetBuffer.receive.bufferState == packets_BUFFER_RECEIVE_COMPLETE) {
+                    LEDS_B_Toggle();
+                    packets_PACKET_S *rxPacket = &(packetBuffer.receive.packet);
+                    packets_PACKET_S *txPacket = &(packetBuffer.send.packet);
+                    if(!packets_parsePacket(&packetBuffer)){
+                        /* Respond to the command */
+                        txPacket->moduleId = rxPacket->moduleId;
+                        txPacket->cmd = rxPacket->cmd;
+                        txPacket->flags = packets_FLAG_RESP;
+                        txPacket->payloadLen = ZERO;
+                        speedControl_handleCommand(rxPacket, txPacket);
+                        if(!packets_constructPacket(&packetBuffer)){
+                            UART_IMU_SpiUartPutArray(packetBuffer.send.processBuffer.buffer, packetBuffer.send.processBuffer.bufferIndex);
+                        }
+                        packets_flushTxBuffers(&packetBuffer);
+                    }
+                    packets_flushRxBuffers(&packetBuffer);
+                }
+            }
+            /* Display the loop */
+            if((sysTickMs - lastMs) >= PID_PRINT_MS){
+                lastMs = sysTickMs;
                 usbUart_clearScreen();
-                /* Write out the values */
-                usbUart_print("Left: %d\r\nRight: %d\r\n", encoder.leftCount, encoder.rightCount);
-                /* Toggle Red led */
+                usbUart_print("Motors: %s\r\n", motorsState ? "on" : "off");
+                usbUart_print("Left: %d ticks/s, %ld ticks/s^2, duty %d\r\n", speedControl_getSpeed(speedControl_WHEEL_LEFT),
+                    (long) encoderVelocity_getAcceleration(encoderVelocity_WHEEL_LEFT), speedControl_getDuty(speedControl_WHEEL_LEFT));
+                usbUart_print("Right: %d ticks/s, %ld ticks/s^2, duty %d\r\n", speedControl_getSpeed(speedControl_WHEEL_RIGHT),
+                    (long) encoderVelocity_getAcceleration(encoderVelocity_WHEEL_RIGHT), speedControl_getDuty(speedControl_WHEEL_RIGHT));
                 LEDS_R_Toggle();
             }
-
-            
         }
     /* End MICA_TEST_PID_SPEED */
     #elif defined MICA_TEST_PACKETS_SELF
@@ -502,7 +581,7 @@ int main(void) {
         /* Create a packet object and generate buffers */
         packets_BUFFER_FULL_S packetBuffer;
         /* Generate a new buffer */
-        uint32 error = packets_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);    
+        uint32 error = memPool_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);    
         /* Halt on error */
         if(error){
             LEDS_Write(LEDS_ON_RED);
@@ -927,7 +1006,7 @@ int main(void) {
         /* Initialize variables */
         packets_BUFFER_FULL_S packetBuffer;
         packets_initialize(&packetBuffer);
-        uint32 error = packets_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
+        uint32 error = memPool_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
         /* Ensure packet buffers were created properly */
         if(error){
             LEDS_Write(LEDS_ON_RED);
@@ -972,7 +1051,7 @@ int main(void) {
         /* Initialize variables */
         packets_BUFFER_FULL_S packetBuffer;
         packets_initialize(&packetBuffer);
-        uint32 error = packets_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
+        uint32 error = memPool_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
         /* Ensure packet buffers were created properly */
         if(error){
             LEDS_Write(LEDS_ON_RED);
@@ -1013,6 +1092,224 @@ int main(void) {
             }
         }
     /* End MICA_TEST_PACKETS_ISR */
+    #elif defined MICA_TEST_PACKETS_BENCHMARK
+        /* Benchmark the packet codec and print the results via the USB uart.
+        * Increase the heap to measure the larger payload sizes.
+        * Expected outcome: Table of cycles per packet and bytes/s for construct,
+        * byte-wise receive and parse for payloads of 0 - 512 bytes */
+        UART_USB_Start();
+        usbUart_clearScreen();
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Run the suite */
+        bench_runPacketSuite();
+        LEDS_Write(LEDS_ON_BLUE);
+        /* Infinite loop */
+        for(;;){}
+    /* End MICA_TEST_PACKETS_BENCHMARK */
+    #elif defined MICA_TEST_PACKETS_BULK
+        /* Receive packets from the IMU by draining the RX FIFO into a span and
+        * processing it in a single call. Print the result via the USB uart.
+        * Expected outcome: Same output as MICA_TEST_PACKETS */
+        #define RX_SPAN_LEN     (16u)
+        /* Start the Components */
+        UART_USB_Start();
+        UART_IMU_Start();
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Initialize variables */
+        packets_BUFFER_FULL_S packetBuffer;
+        packets_initialize(&packetBuffer);
+        uint32 error = memPool_generateBuffers(&packetBuffer, packets_LEN_BLOCK_PACKET);
+        /* Ensure packet buffers were created properly */
+        if(error){
+            LEDS_Write(LEDS_ON_RED);
+            for(;;){}
+        }
+        uint8 rxSpan[RX_SPAN_LEN];
+        /* Infinite loop */
+        for(;;){
+            /* Drain everything pending in the FIFO */
+            uint16 spanLen = ZERO;
+            while((spanLen < RX_SPAN_LEN) && UART_IMU_SpiUartGetRxBufferSize()){
+                rxSpan[spanLen++] = (uint8) UART_IMU_UartGetByte();
+            }
+            /* Process the span, a span may hold the end of one packet and the start of another */
+            uint16 spanIndex = ZERO;
+            while(spanIndex < spanLen){
+                uint16 bytesUsed;
+                uint32 err = packetsBulk_processRxBuffer(&packetBuffer, &rxSpan[spanIndex], spanLen - spanIndex, &bytesUsed);
+                spanIndex += bytesUsed;
+                /* Inidicate errors */
+                if(err){
+                    LEDS_G_Toggle();
+                    /* Reset the receive packet */
+                    packets_flushRxBuffers(&packetBuffer);
+                }
+                /* Check if complete */
+                if(packetBuffer.receive.bufferState == packets_BUFFER_RECEIVE_COMPLETE) {
+                    LEDS_B_Toggle();
+                    /* Parse the packet */
+                    packets_parsePacket(&packetBuffer);
+                    packets_PACKET_S* rxPacket = &(packetBuffer.receive.packet);
+                    /* Clear the screen and print out the data */
+                    usbUart_print("\n\r\nModule: %x \r\nCommand: %x\r\nPayload Len: %x\r\n", rxPacket->moduleId, rxPacket->cmd, rxPacket->payloadLen);
+                    usbUart_print("Payload:");
+                    uint8 i;
+                    for(i=ZERO; i< rxPacket->payloadLen; i++){
+                        usbUart_print(" %x", rxPacket->payload[i]);
+                    }
+                    packets_flushRxBuffers(&packetBuffer);
+                }
+            }
+        }
+    /* End MICA_TEST_PACKETS_BULK */
+    #elif defined MICA_TEST_UART_STRESS
+        /* Stress the IMU UART receive ring. Feed a repeating 0x00 - 0xFF byte
+        * pattern into UART_IMU (from the IMU or a USB-serial adapter) at the baud
+        * rate under test. Results are printed once a second, which also keeps
+        * the main loop busy the way the application would.
+        * Expected outcome: Bytes/s near baud/10 with no drops, sequence errors
+        * or FIFO overflows. Raise the UART_IMU baud rate until any become non-zero */
+        #define STRESS_PERIOD_MS    (1000u)
+        UART_USB_Start();
+        usbUart_clearScreen();
+        imuRx_Start();
+        LEDS_Write(LEDS_ON_GREEN);
+        /* 1 ms time base */
+        CySysTickStart();
+        CySysTickSetCallback(ZERO, ISR_sysTick);
+        /* Pattern tracking */
+        uint8 expected = ZERO;
+        bool synced = false;
+        uint32 sequenceErrors = ZERO;
+        uint32 lastMs = sysTickMs;
+        uint32 lastBytes = ZERO;
+        /* Infinite loop */
+        for(;;){
+            /* Check the pattern in place, then release the bytes */
+            uint8 *span;
+            uint16 spanLen = imuRx_peekSpan(&span);
+            uint16 i;
+            for(i = ZERO; i < spanLen; i++){
+                if(synced && (span[i] != expected)){
+                    sequenceErrors++;
+                }
+                synced = true;
+                expected = span[i] + ONE;
+            }
+            imuRx_consume(spanLen);
+            /* Report */
+            uint32 nowMs = sysTickMs;
+            if((nowMs - lastMs) >= STRESS_PERIOD_MS){
+                imuRx_STATS_S stats;
+                imuRx_getStats(&stats);
+                uint32 bytesPerSec = ((stats.bytesReceived - lastBytes) * STRESS_PERIOD_MS) / (nowMs - lastMs);
+                lastBytes = stats.bytesReceived;
+                lastMs = nowMs;
+                usbUart_print("B/s: %u, Total: %u, Dropped: %u, FIFO overflows: %u, Seq errors: %u, Peak: %u/%u\r\n", 
+                    bytesPerSec, stats.bytesReceived, stats.bytesDropped, stats.fifoOverflows, sequenceErrors, stats.highWater, imuRx_BUFFER_LEN - ONE);
+                /* Any loss turns the LED red */
+                if(stats.bytesDropped || stats.fifoOverflows || sequenceErrors){
+                    LEDS_Write(LEDS_ON_RED);
+                }
+            }
+        }
+    /* End MICA_TEST_UART_STRESS */
+    #elif defined MICA_TEST_MEM_POOL
+        /* Exhaust and refill each class of the memory pool, time alloc/free and
+        * run a packet round trip through pool backed buffers.
+        * Expected outcome: All tests pass, alloc and free cycles are the same for
+        * every block of a class, high water equals the number of blocks */
+        LEDS_Write(LEDS_ON_GREEN);
+        UART_USB_Start();
+        usbUart_clearScreen();
+        bench_startCycleCounter();
+        memPool_init();
+        usbUart_print("\r\n*** Memory Pool ***\r\n");
+        /* Exhaust each class */
+        uint16 classSizes[memPool_NUM_CLASSES] = {memPool_SIZE_SMALL, memPool_SIZE_MEDIUM, memPool_SIZE_LARGE};
+        uint16 classCounts[memPool_NUM_CLASSES] = {memPool_COUNT_SMALL, memPool_COUNT_MEDIUM, memPool_COUNT_LARGE};
+        uint8 c;
+        for(c = ZERO; c < memPool_NUM_CLASSES; c++){
+            void *blocks[memPool_COUNT_SMALL + memPool_COUNT_MEDIUM + memPool_COUNT_LARGE];
+            uint32 maxCycles = ZERO;
+            uint32 minCycles = BENCH_SYSTICK_MAX;
+            uint32 error = ZERO;
+            uint16 i;
+            for(i = ZERO; i < classCounts[c]; i++){
+                uint32 start = bench_getCycles();
+                blocks[i] = memPool_alloc(classSizes[c]);
+                uint32 cycles = bench_elapsedCycles(start, bench_getCycles());
+                maxCycles = (cycles > maxCycles) ? cycles : maxCycles;
+                minCycles = (cycles < minCycles) ? cycles : minCycles;
+                error |= (blocks[i] == NULL);
+            }
+            runTest(printTestResults("Allocate all blocks", error, ZERO, ""));
+            usbUart_print("  Block %u: alloc %u-%u cycles\r\n", classSizes[c], minCycles, maxCycles);
+            /* Class is empty */
+            runTest(printTestResults("Empty class fails", (memPool_alloc(classSizes[c]) == NULL), true, ""));
+            /* Release */
+            maxCycles = ZERO;
+            minCycles = BENCH_SYSTICK_MAX;
+            for(i = ZERO; i < classCounts[c]; i++){
+                uint32 start = bench_getCycles();
+                error |= memPool_free(blocks[i]);
+                uint32 cycles = bench_elapsedCycles(start, bench_getCycles());
+                maxCycles = (cycles > maxCycles) ? cycles : maxCycles;
+                minCycles = (cycles < minCycles) ? cycles : minCycles;
+            }
+            runTest(printTestResults("Free all blocks", error, ZERO, ""));
+            usbUart_print("  Block %u: free %u-%u cycles\r\n", classSizes[c], minCycles, maxCycles);
+            /* Statistics */
+            memPool_STATS_S stats;
+            memPool_getStats(c, &stats);
+            runTest(printTestResults("High water", stats.highWater, classCounts[c], ""));
+            runTest(printTestResults("Failures", stats.failures, ONE, ""));
+            runTest(printTestResults("In use", stats.inUse, ZERO, ""));
+        }
+        /* Invalid frees */
+        uint8 notPooled[4];
+        runTest(printTestResults("Free non-pool pointer", memPool_free(notPooled), memPool_ERR_INVALID, ""));
+        runTest(printTestResults("Oversize request", (memPool_alloc(memPool_SIZE_LARGE + ONE) == NULL), true, ""));
+        
+        usbUart_print("\r\n*** Pool Packet Buffers ***\r\n");
+        {
+            packets_BUFFER_FULL_S packetBuffer;
+            packets_initialize(&packetBuffer);
+            uint32 error = memPool_generateBuffers(&packetBuffer, memPool_SIZE_SMALL);
+            runTest(printTestResults("Generate buffers", error, packets_ERR_SUCCESS, ""));
+            if(!error){
+                /* Round trip */
+                uint8 dummyData[3] = {0x01, 0x03, 0x05};
+                packetBuffer.send.packet.moduleId = 5;
+                packetBuffer.send.packet.cmd = 0xCC;
+                packetBuffer.send.packet.payloadLen = sizeof(dummyData);
+                memcpy(packetBuffer.send.packet.payload, dummyData, sizeof(dummyData));
+                error |= packets_constructPacket(&packetBuffer);
+                uint16 j;
+                for(j = ZERO; j < packetBuffer.send.processBuffer.bufferIndex; j++){
+                    error |= packets_processRxByte(&packetBuffer, packetBuffer.send.processBuffer.buffer[j]);
+                }
+                error |= packets_parsePacket(&packetBuffer);
+                char msg[20] = "";
+                if(!error && memcmp(packetBuffer.receive.packet.payload, dummyData, sizeof(dummyData))){
+                    sprintf(msg, "Payload mismatch");
+                }
+                runTest(printTestResults("Round trip", error, packets_ERR_SUCCESS, msg));
+            }
+            runTest(printTestResults("Destroy buffers", memPool_destroyBuffers(&packetBuffer), packets_ERR_SUCCESS, ""));
+            /* Repeated creation must not leak */
+            uint16 i;
+            error = packets_ERR_SUCCESS;
+            for(i = ZERO; i < 1000; i++){
+                error |= memPool_generateBuffers(&packetBuffer, memPool_SIZE_SMALL);
+                error |= memPool_destroyBuffers(&packetBuffer);
+            }
+            runTest(printTestResults("Generate/destroy 1000x", error, packets_ERR_SUCCESS, ""));
+        }
+        printTestCount();
+        /* Infinite loop */
+        for(;;){}
+    /* End MICA_TEST_MEM_POOL */
     #else 
         #error "At least ONE MICA_TEST_<case> must be defined if MICA_TEST is defined"
     #endif
@@ -1022,10 +1319,23 @@ int main(void) {
 #endif /* MICA_TEST */
 /* %%%%%%%%%%%%%%%%%%  End Debugging & Testing  %%%%%%%%%%%%%%%%%% */
     
+    /* Start hardware blocks */
+    Motors_Start();
+    dualEncoder_Start();
+    imuRx_Start();
+    /* Commands from the IMU drive the wheels */
+    if(actuation_start(driveWheel)){
+        LEDS_Write(LEDS_ON_RED);
+        for(;;){}
+    }
+    /* Wheel state goes back over the same link */
+    telemetry_start(actuation_sendPacket);
+    LEDS_Write(LEDS_ON_GREEN);
     /* Infinite Loop */
     for(;;)
     {
-
+        actuation_process();
+        telemetry_process();
     }
 }
 
@@ -1099,5 +1409,52 @@ void ISR_Timer(void){
     timerExpired = true;
 }
 
+/*******************************************************************************
+* ISR Name: ISR_sysTick()
+********************************************************************************
+* Summary:
+*   Millisecond time base
+*
+* Interrupt: 
+*       SysTick
+*
+*******************************************************************************/
+void ISR_sysTick(void){
+    sysTickMs++;
+}
+
+/*******************************************************************************
+* Function Name: driveWheel()
+********************************************************************************
+* Summary:
+*   Drives a single wheel for speedControl. The magnitude sets the compare of
+*   the wheel's PWM and the sign sets its direction bit in the motor control
+*   register.
+*
+* Parameters:
+*   wheel - speedControl_WHEEL_<side>
+*   duty - Signed duty, -speedControl_DUTY_MAX to speedControl_DUTY_MAX
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void driveWheel(uint8 wheel, int16 duty){
+    uint8 forwardBit = (wheel == speedControl_WHEEL_LEFT) ? MOTORS_CTRL_FORWARD_L : MOTORS_CTRL_FORWARD_R;
+    uint8 control = Motors_motorControlReg_Read();
+    if(duty < 0){
+        control &= ~forwardBit;
+        duty = -duty;
+    } else {
+        control |= forwardBit;
+    }
+    Motors_motorControlReg_Write(control);
+    if(wheel == speedControl_WHEEL_LEFT){
+        Motors_PWM_M1_WriteCompare((uint16) duty);
+    } else {
+        Motors_PWM_M2_WriteCompare((uint16) duty);
+    }
+}
+
 
 /* [] END OF FILE */
\ No newline at end of file
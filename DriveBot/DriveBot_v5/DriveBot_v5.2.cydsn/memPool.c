@@ -0,0 +1,340 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: memPool.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Fixed block memory pool. Blocks are taken from statically sized arrays
+*   of three size classes, each with its own free list, so allocation and
+*   release are constant time and do not use the heap. Each class keeps a
+*   bit per block so a block freed twice is caught instead of corrupting the
+*   free list.
+*
+* 2018.08.23  - Document Created
+********************************************************************************/
+#include "memPool.h"
+#include "micaCommon.h"
+
+#if (memPool_SIZE_SMALL > memPool_SIZE_MEDIUM)
+    #error "memPool_SIZE_SMALL must not be larger than memPool_LEN_PAYLOAD"
+#endif
+#if (memPool_COUNT_SMALL > 32u) || (memPool_COUNT_MEDIUM > 32u) || (memPool_COUNT_LARGE > 32u)
+    #error "memPool classes hold at most 32 blocks"
+#endif
+
+/* Storage, declared as words to keep every block word aligned */
+static uint32 poolSmall[(memPool_SIZE_SMALL * memPool_COUNT_SMALL) / sizeof(uint32)];
+static uint32 poolMedium[(memPool_SIZE_MEDIUM * memPool_COUNT_MEDIUM) / sizeof(uint32)];
+static uint32 poolLarge[(memPool_SIZE_LARGE * memPool_COUNT_LARGE) / sizeof(uint32)];
+
+/* A free block holds the pointer to the next free block */
+typedef struct memPool_FREE_T {
+    struct memPool_FREE_T *next;
+} memPool_FREE_S;
+
+/* Size class */
+typedef struct {
+    uint8 *base;                /**< First block */
+    uint8 *end;                 /**< One past the last block */
+    memPool_FREE_S *freeList;   /**< Head of the free list */
+    uint32 allocated;           /**< Bit per block, set while allocated */
+    memPool_STATS_S stats;      /**< Usage statistics */
+} memPool_CLASS_S;
+
+static memPool_CLASS_S poolClasses[memPool_NUM_CLASSES];
+static uint32 oversizeFailures = ZERO;
+static bool poolInitialized = false;
+
+/*******************************************************************************
+* Function Name: memPool_initClass()
+****************************************************************************//**
+* \brief
+*  Links every block of a size class into its free list
+*
+* \param poolClass
+*   Pointer to the class to initialize
+*
+* \param storage
+*   Memory backing the class
+*
+* \param blockSize
+*   Size of each block
+*
+* \param numBlocks
+*   Number of blocks
+*
+* \return
+*  None
+*******************************************************************************/
+static void memPool_initClass(memPool_CLASS_S *poolClass, uint32 *storage, uint16 blockSize, uint16 numBlocks) {
+    poolClass->base = (uint8 *) storage;
+    poolClass->end = poolClass->base + ((uint32) blockSize * numBlocks);
+    poolClass->freeList = NULL;
+    poolClass->allocated = ZERO;
+    poolClass->stats.blockSize = blockSize;
+    poolClass->stats.numBlocks = numBlocks;
+    poolClass->stats.inUse = ZERO;
+    poolClass->stats.highWater = ZERO;
+    poolClass->stats.failures = ZERO;
+    /* Link from the last block back, so the first block is allocated first */
+    uint16 i = numBlocks;
+    while(i > ZERO){
+        i--;
+        memPool_FREE_S *block = (memPool_FREE_S *) (poolClass->base + ((uint32) blockSize * i));
+        block->next = poolClass->freeList;
+        poolClass->freeList = block;
+    }
+}
+
+/*******************************************************************************
+* Function Name: memPool_init()
+****************************************************************************//**
+* \brief
+*  Initializes the pool. Any blocks previously allocated are returned.
+*   Called automatically on the first allocation.
+*
+* \return
+*  None
+*******************************************************************************/
+void memPool_init(void) {
+    uint8 intState = CyEnterCriticalSection();
+    memPool_initClass(&poolClasses[memPool_CLASS_SMALL], poolSmall, memPool_SIZE_SMALL, memPool_COUNT_SMALL);
+    memPool_initClass(&poolClasses[memPool_CLASS_MEDIUM], poolMedium, memPool_SIZE_MEDIUM, memPool_COUNT_MEDIUM);
+    memPool_initClass(&poolClasses[memPool_CLASS_LARGE], poolLarge, memPool_SIZE_LARGE, memPool_COUNT_LARGE);
+    oversizeFailures = ZERO;
+    poolInitialized = true;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: memPool_alloc()
+****************************************************************************//**
+* \brief
+*  Allocates a block from the smallest size class that fits the request.
+*   A request is only ever served by that one class, so the time taken does
+*   not depend on the state of the pool.
+*
+* \param size
+*   Number of bytes required
+*
+* \return
+*  Pointer to the block, or NULL if the class is empty or the size is too large
+*******************************************************************************/
+void* memPool_alloc(uint16 size) {
+    if(!poolInitialized){
+        memPool_init();
+    }
+    /* Select the class */
+    uint8 sizeClass;
+    if(size <= memPool_SIZE_SMALL){
+        sizeClass = memPool_CLASS_SMALL;
+    } else if(size <= memPool_SIZE_MEDIUM){
+        sizeClass = memPool_CLASS_MEDIUM;
+    } else if(size <= memPool_SIZE_LARGE){
+        sizeClass = memPool_CLASS_LARGE;
+    } else {
+        oversizeFailures++;
+        return NULL;
+    }
+    memPool_CLASS_S *poolClass = &poolClasses[sizeClass];
+    /* Pop the head of the free list */
+    uint8 intState = CyEnterCriticalSection();
+    memPool_FREE_S *block = poolClass->freeList;
+    if(block != NULL){
+        poolClass->freeList = block->next;
+        poolClass->allocated |= (ONE << (((uint8 *) block - poolClass->base) / poolClass->stats.blockSize));
+        poolClass->stats.inUse++;
+        if(poolClass->stats.inUse > poolClass->stats.highWater){
+            poolClass->stats.highWater = poolClass->stats.inUse;
+        }
+    } else {
+        poolClass->stats.failures++;
+    }
+    CyExitCriticalSection(intState);
+    return block;
+}
+
+/*******************************************************************************
+* Function Name: memPool_free()
+****************************************************************************//**
+* \brief
+*  Returns a block to the pool
+*
+* \param block
+*   Pointer returned by memPool_alloc(). NULL is ignored.
+*
+* \return
+*  Error code of the operation
+*   memPool_ERR_SUCCESS - Block was released
+*   memPool_ERR_INVALID - Pointer does not point to the start of a pool block
+*   memPool_ERR_DOUBLE_FREE - Block is already free, asserts in debug builds
+*******************************************************************************/
+uint32 memPool_free(void *block) {
+    if(block == NULL){
+        return memPool_ERR_SUCCESS;
+    }
+    uint8 *addr = (uint8 *) block;
+    uint8 i;
+    for(i = ZERO; i < memPool_NUM_CLASSES; i++){
+        memPool_CLASS_S *poolClass = &poolClasses[i];
+        if((addr >= poolClass->base) && (addr < poolClass->end)){
+            /* Must be the start of a block */
+            uint32 offset = (uint32) (addr - poolClass->base);
+            if((offset % poolClass->stats.blockSize) != ZERO){
+                return memPool_ERR_INVALID;
+            }
+            uint32 blockMask = ONE << (offset / poolClass->stats.blockSize);
+            uint8 intState = CyEnterCriticalSection();
+            if((poolClass->allocated & blockMask) == ZERO){
+                CyExitCriticalSection(intState);
+                CYASSERT(false);
+                return memPool_ERR_DOUBLE_FREE;
+            }
+            poolClass->allocated &= ~blockMask;
+            /* Push onto the free list */
+            memPool_FREE_S *freeBlock = (memPool_FREE_S *) block;
+            freeBlock->next = poolClass->freeList;
+            poolClass->freeList = freeBlock;
+            if(poolClass->stats.inUse > ZERO){
+                poolClass->stats.inUse--;
+            }
+            CyExitCriticalSection(intState);
+            return memPool_ERR_SUCCESS;
+        }
+    }
+    return memPool_ERR_INVALID;
+}
+
+/*******************************************************************************
+* Function Name: memPool_getStats()
+****************************************************************************//**
+* \brief
+*  Returns the usage statistics of a size class
+*
+* \param sizeClass
+*   Class to query, memPool_CLASS_SMALL/MEDIUM/LARGE
+*
+* \param stats [out]
+*   Location to place the statistics
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 memPool_getStats(uint8 sizeClass, memPool_STATS_S *stats) {
+    if(sizeClass >= memPool_NUM_CLASSES){
+        return memPool_ERR_CLASS;
+    }
+    if(!poolInitialized){
+        memPool_init();
+    }
+    uint8 intState = CyEnterCriticalSection();
+    *stats = poolClasses[sizeClass].stats;
+    CyExitCriticalSection(intState);
+    return memPool_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: memPool_getOversizeFailures()
+****************************************************************************//**
+* \brief
+*  Returns the number of requests larger than the largest block size
+*
+* \return
+*  Number of oversize requests
+*******************************************************************************/
+uint32 memPool_getOversizeFailures(void) {
+    return oversizeFailures;
+}
+
+/*******************************************************************************
+* Function Name: memPool_generateBuffers()
+****************************************************************************//**
+* \brief
+*  Pool backed replacement for packets_generateBuffers(). The send and receive
+*   payloads hold payloadLen bytes, and the process buffers hold a full frame
+*   of payloadLen + memPool_PACKET_OVERHEAD bytes. Release with
+*   memPool_destroyBuffers(), not packets_destoryBuffers().
+*
+* \param packetBuffer
+*   Pointer to the packet buffer to populate
+*
+* \param payloadLen
+*   Maximum payload length
+*
+* \return
+*  Error code of the operation
+*   packets_ERR_SUCCESS - Buffers were created
+*   packets_ERR_MEMORY - The pool could not supply the blocks
+*******************************************************************************/
+uint32 memPool_generateBuffers(packets_BUFFER_FULL_S *packetBuffer, uint16 payloadLen) {
+    uint32 frameLen = (uint32) payloadLen + memPool_PACKET_OVERHEAD;
+    if(frameLen > memPool_SIZE_LARGE){
+        return packets_ERR_MEMORY;
+    }
+    uint8 *txPayload = memPool_alloc(payloadLen);
+    uint8 *rxPayload = memPool_alloc(payloadLen);
+    uint8 *txBuffer = memPool_alloc((uint16) frameLen);
+    uint8 *rxBuffer = memPool_alloc((uint16) frameLen);
+    /* Release everything on failure */
+    if((txPayload == NULL) || (rxPayload == NULL) || (txBuffer == NULL) || (rxBuffer == NULL)){
+        memPool_free(txPayload);
+        memPool_free(rxPayload);
+        memPool_free(txBuffer);
+        memPool_free(rxBuffer);
+        return packets_ERR_MEMORY;
+    }
+    /* Send */
+    packetBuffer->send.packet.payload = txPayload;
+    packetBuffer->send.packet.payloadMax = payloadLen;
+    packetBuffer->send.processBuffer.buffer = txBuffer;
+    packetBuffer->send.processBuffer.bufferLen = (uint16) frameLen;
+    /* Receive */
+    packetBuffer->receive.packet.payload = rxPayload;
+    packetBuffer->receive.packet.payloadMax = payloadLen;
+    packetBuffer->receive.processBuffer.buffer = rxBuffer;
+    packetBuffer->receive.processBuffer.bufferLen = (uint16) frameLen;
+    /* Reset indices and state */
+    return packets_flushBuffers(packetBuffer);
+}
+
+/*******************************************************************************
+* Function Name: memPool_destroyBuffers()
+****************************************************************************//**
+* \brief
+*  Returns the buffers created by memPool_generateBuffers() to the pool
+*
+* \param packetBuffer
+*   Pointer to the packet buffer
+*
+* \return
+*  Error code of the operation
+*   packets_ERR_SUCCESS - Buffers were released
+*   packets_ERR_MEMORY - A buffer did not come from the pool
+*******************************************************************************/
+uint32 memPool_destroyBuffers(packets_BUFFER_FULL_S *packetBuffer) {
+    uint32 error = memPool_ERR_SUCCESS;
+    error |= memPool_free(packetBuffer->send.packet.payload);
+    error |= memPool_free(packetBuffer->send.processBuffer.buffer);
+    error |= memPool_free(packetBuffer->receive.packet.payload);
+    error |= memPool_free(packetBuffer->receive.processBuffer.buffer);
+    /* Clear the references */
+    packetBuffer->send.packet.payload = NULL;
+    packetBuffer->send.packet.payloadMax = ZERO;
+    packetBuffer->send.processBuffer.buffer = NULL;
+    packetBuffer->send.processBuffer.bufferLen = ZERO;
+    packetBuffer->receive.packet.payload = NULL;
+    packetBuffer->receive.packet.payloadMax = ZERO;
+    packetBuffer->receive.processBuffer.buffer = NULL;
+    packetBuffer->receive.processBuffer.bufferLen = ZERO;
+    return error ? packets_ERR_MEMORY : packets_ERR_SUCCESS;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,209 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: motionProfile.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Moves a value to its goal at a limited rate, stepped once per sample.
+*   With only a rate limit the value ramps linearly (trapezoidal). With a jerk
+*   limit the rate itself ramps, and starts falling once the distance needed
+*   to stop reaches the distance left, giving an S-curve. A new goal can be
+*   set at any time and the profile continues from its current value and
+*   rate, so a reversal slows down before it turns around.
+*
+*   Values are whole units of whatever is profiled, and are held in Q12 so slow
+*   ramps still move every sample. All arithmetic is integer.
+*
+* 2018.11.11  - Document Created
+********************************************************************************/
+#include "motionProfile.h"
+#include "micaCommon.h"
+
+/*******************************************************************************
+* Function Name: motionProfile_perSample()
+****************************************************************************//**
+* \brief
+*  Converts a limit to Q12 per sample. A limit that rounds to zero becomes the
+*   smallest step so it is not mistaken for no limit.
+*
+* \param limit [in]
+*  Limit in units per second, or per second squared
+*
+* \param divisor [in]
+*  Samples per second, or squared
+*
+* \return
+*  The limit per sample, Q12
+*******************************************************************************/
+static int32 motionProfile_perSample(uint32 limit, uint64 divisor) {
+    if(limit == ZERO) {
+        return ZERO;
+    }
+    uint64 step = ((uint64) limit << motionProfile_SHIFT) / divisor;
+    if(step == ZERO) {
+        return ONE;
+    } else if(step > (INT32_MAX >> ONE)) {
+        return (INT32_MAX >> ONE);
+    }
+    return (int32) step;
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_reset()
+****************************************************************************//**
+* \brief
+*  Holds the profile at rest at a value
+*
+* \param profile [in]
+*  Profile to reset
+*
+* \param value [in]
+*  Starting value and goal, within +/- INT16_MAX
+*
+* \return
+*  None
+*******************************************************************************/
+void motionProfile_reset(motionProfile_S *profile, int32 value) {
+    profile->value = value * (1 << motionProfile_SHIFT);
+    profile->goal = profile->value;
+    profile->rate = ZERO;
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_setLimits()
+****************************************************************************//**
+* \brief
+*  Sets the limits of a profile. Takes effect on the next step, from the
+*   current value and rate.
+*
+* \param profile [in]
+*  Profile to change
+*
+* \param limits [in]
+*  Rate and jerk limits, motionProfile_RATE_NONE and motionProfile_JERK_NONE
+*   disable them
+*
+* \param sampleHz [in]
+*  Rate that motionProfile_step() is called at
+*
+* \return
+*  None
+*******************************************************************************/
+void motionProfile_setLimits(motionProfile_S *profile, motionProfile_LIMITS_S *limits, uint32 sampleHz) {
+    profile->rateStep = motionProfile_perSample(limits->rate, sampleHz);
+    profile->jerkStep = motionProfile_perSample(limits->jerk, (uint64) sampleHz * sampleHz);
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_setGoal()
+****************************************************************************//**
+* \brief
+*  Sets the value to move to
+*
+* \param profile [in]
+*  Profile to change
+*
+* \param goal [in]
+*  New goal, within +/- INT16_MAX
+*
+* \return
+*  None
+*******************************************************************************/
+void motionProfile_setGoal(motionProfile_S *profile, int32 goal) {
+    profile->goal = goal * (1 << motionProfile_SHIFT);
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_step()
+****************************************************************************//**
+* \brief
+*  Advances the profile by one sample
+*
+* \param profile [in]
+*  Profile to advance
+*
+* \return
+*  The new value
+*******************************************************************************/
+int32 motionProfile_step(motionProfile_S *profile) {
+    int32 error = profile->goal - profile->value;
+    if(profile->rateStep == ZERO) {
+        /* No limit */
+        profile->value = profile->goal;
+        profile->rate = ZERO;
+        return motionProfile_getValue(profile);
+    }
+    /* Signs are tested against a signed 0, ZERO would make the comparisons unsigned */
+    int32 desired = (error > 0) ? profile->rateStep : ((error < 0) ? -profile->rateStep : 0);
+    if(profile->jerkStep == ZERO) {
+        profile->rate = desired;
+    } else {
+        /* Start slowing once stopping takes the rest of the distance */
+        int64 rate = profile->rate;
+        if(((rate > 0) && (error > 0)) || ((rate < 0) && (error < 0))) {
+            int64 stopping = (rate * rate) / (2 * (int64) profile->jerkStep);
+            int64 remaining = (error < 0) ? -(int64) error : error;
+            if(stopping >= remaining) {
+                desired = 0;
+            }
+        }
+        if(desired > profile->rate + profile->jerkStep) {
+            profile->rate += profile->jerkStep;
+        } else if(desired < profile->rate - profile->jerkStep) {
+            profile->rate -= profile->jerkStep;
+        } else {
+            profile->rate = desired;
+        }
+    }
+    /* Stop on the goal rather than passing it */
+    int32 next = profile->value + profile->rate;
+    if(((error > 0) && (next >= profile->goal)) || ((error < 0) && (next <= profile->goal))) {
+        profile->value = profile->goal;
+        profile->rate = ZERO;
+    } else {
+        profile->value = next;
+    }
+    return motionProfile_getValue(profile);
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_getValue()
+****************************************************************************//**
+* \brief
+*  Current value of a profile
+*
+* \param profile [in]
+*  Profile to read
+*
+* \return
+*  The value in whole units, rounded toward zero
+*******************************************************************************/
+int32 motionProfile_getValue(motionProfile_S *profile) {
+    return profile->value / (1 << motionProfile_SHIFT);
+}
+
+/*******************************************************************************
+* Function Name: motionProfile_isDone()
+****************************************************************************//**
+* \brief
+*  Reports if a profile has reached its goal
+*
+* \param profile [in]
+*  Profile to check
+*
+* \return
+*  True when the value is at the goal and not moving
+*******************************************************************************/
+bool motionProfile_isDone(motionProfile_S *profile) {
+    return (profile->value == profile->goal) && (profile->rate == ZERO);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: motionProfile.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for motionProfile.c
+*
+* 2018.11.11  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef motionProfile_H
+    #define motionProfile_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Internal values are Q12 per sample */
+    #define motionProfile_SHIFT             (12u)
+    /* Limits, zero disables them */
+    #define motionProfile_RATE_NONE         (0u)    /* Step straight to the goal */
+    #define motionProfile_JERK_NONE         (0u)    /* Trapezoidal, the rate changes instantly */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Limits in the units of the profiled value, e.g. duty counts or ticks/s */
+    typedef struct {
+        uint32 rate;            /**< Largest rate of change [units/s] */
+        uint32 jerk;            /**< Largest change of the rate [units/s^2] */
+    } motionProfile_LIMITS_S;
+
+    /* Profile of a single value */
+    typedef struct {
+        int32 goal;             /**< Value being moved to, Q12 */
+        int32 value;            /**< Current value, Q12 */
+        int32 rate;             /**< Change per sample, Q12 */
+        int32 rateStep;         /**< Largest rate per sample, Q12. Zero when unlimited */
+        int32 jerkStep;         /**< Largest change of rate per sample, Q12. Zero when trapezoidal */
+    } motionProfile_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void motionProfile_reset(motionProfile_S *profile, int32 value);
+    void motionProfile_setLimits(motionProfile_S *profile, motionProfile_LIMITS_S *limits, uint32 sampleHz);
+    void motionProfile_setGoal(motionProfile_S *profile, int32 goal);
+    int32 motionProfile_step(motionProfile_S *profile);
+    int32 motionProfile_getValue(motionProfile_S *profile);
+    bool motionProfile_isDone(motionProfile_S *profile);
+
+#endif /* motionProfile_H */
+/* [] END OF FILE */
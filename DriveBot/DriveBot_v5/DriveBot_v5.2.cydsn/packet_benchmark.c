@@ -0,0 +1,261 @@
+/***************************************************************************
+*                                       MICA
+* File: packet_benchmark.c
+* Workspace: micaComponents
+* Project Name: libMica
+* Version: v1.0
+* Author: Craig Cheney
+*
+* Brief:
+*  Throughput benchmark for the packets codec. Measures the cost of
+*  constructing, receiving (byte-wise and span based) and parsing packets
+*  across a range of payload sizes using the SysTick counter as a cycle counter.
+*
+* Authors:
+*   Craig Cheney
+*
+* Change Log:
+*   2018.08.20 CC - Document created
+*   2018.08.21 CC - Added span based receive
+********************************************************************************/
+#include "packet_benchmark.h"
+#include "packetsBulk.h"
+#include "micaCommon.h"
+#include "usbUart.h"
+#include <string.h>
+
+/* Payload sizes to measure */
+static const uint16 benchSizes[BENCH_NUM_SIZES] = {0, 16, 32, 64, 128, 256, 512};
+
+/*******************************************************************************
+* Function Name: bench_startCycleCounter()
+****************************************************************************//**
+* \brief
+*  Configures SysTick as a free running, interrupt-free down counter clocked
+*  from SYSCLK so it can be used to time code in CPU cycles.
+*
+* \return
+*  None
+*******************************************************************************/
+void bench_startCycleCounter(void){
+    CySysTickStop();
+    CySysTickDisableInterrupt();
+    CySysTickSetClockSource(CY_SYS_SYST_CSR_CLK_SRC_SYSCLK);
+    CySysTickSetReload(BENCH_SYSTICK_MAX);
+    CySysTickClear();
+    CySysTickEnable();
+}
+
+/*******************************************************************************
+* Function Name: bench_getCycles()
+****************************************************************************//**
+* \brief
+*  Returns the current value of the cycle counter
+*
+* \return
+*  Current SysTick count (counts down)
+*******************************************************************************/
+uint32 bench_getCycles(void){
+    return CySysTickGetValue();
+}
+
+/*******************************************************************************
+* Function Name: bench_elapsedCycles()
+****************************************************************************//**
+* \brief
+*  Returns the number of cycles between two counter samples, accounting for
+*  a single wrap of the 24-bit down counter.
+*
+* \param start
+*   Counter value at the start of the measurement
+*
+* \param stop
+*   Counter value at the end of the measurement
+*
+* \return
+*  Elapsed cycles
+*******************************************************************************/
+uint32 bench_elapsedCycles(uint32 start, uint32 stop){
+    return (start - stop) & BENCH_SYSTICK_MAX;
+}
+
+/*******************************************************************************
+* Function Name: bench_bytesPerSecond()
+****************************************************************************//**
+* \brief
+*  Converts a number of bytes processed in a number of cycles into a rate
+*
+* \param bytes
+*   Number of bytes processed
+*
+* \param cycles
+*   Number of cycles taken
+*
+* \return
+*  Bytes per second, or zero if no cycles were measured
+*******************************************************************************/
+uint32 bench_bytesPerSecond(uint32 bytes, uint32 cycles){
+    if(cycles == ZERO){
+        return ZERO;
+    }
+    return (uint32) (((uint64) bytes * BENCH_CPU_HZ) / cycles);
+}
+
+/*******************************************************************************
+* Function Name: bench_packetSize()
+****************************************************************************//**
+* \brief
+*  Benchmarks construct, byte-wise receive, span receive and parse for a
+*  single payload size. Buffers are allocated for the size under test and
+*  released before returning. Cycles are reported as the average per packet.
+*
+* \param payloadLen
+*   Length of the payload to benchmark
+*
+* \param result [out]
+*   Results of the benchmark
+*
+* \return
+*  Error code of the operation. packets_ERR_MEMORY indicates the buffers
+*  could not be allocated for this size.
+*******************************************************************************/
+uint32 bench_packetSize(uint16 payloadLen, BENCH_RESULT_S* result){
+    packets_BUFFER_FULL_S packetBuffer;
+    uint32 encodeCycles = ZERO;
+    uint32 rxCycles = ZERO;
+    uint32 rxBulkCycles = ZERO;
+    uint32 parseCycles = ZERO;
+    uint32 error;
+    /* Reset the results */
+    result->payloadLen = payloadLen;
+    result->frameLen = ZERO;
+    result->encodeCycles = ZERO;
+    result->rxCycles = ZERO;
+    result->rxBulkCycles = ZERO;
+    result->parseCycles = ZERO;
+    /* Allocate room for the full frame */
+    packets_initialize(&packetBuffer);
+    error = packets_generateBuffers(&packetBuffer, payloadLen + BENCH_PACKET_OVERHEAD);
+    if(!error){
+        /* Fill the payload with a known pattern */
+        packets_PACKET_S* txPacket = &(packetBuffer.send.packet);
+        uint16 i;
+        for(i = ZERO; i < payloadLen; i++){
+            txPacket->payload[i] = (uint8) i;
+        }
+
+        uint16 iteration;
+        for(iteration = ZERO; (iteration < BENCH_ITERATIONS) && !error; iteration++){
+            txPacket->moduleId = 5;
+            txPacket->cmd = 0xCC;
+            txPacket->payloadLen = payloadLen;
+            txPacket->flags = packets_FLAG_NONE;
+            /* Encode */
+            uint32 start = bench_getCycles();
+            error |= packets_constructPacket(&packetBuffer);
+            encodeCycles += bench_elapsedCycles(start, bench_getCycles());
+            if(error){ break; }
+            /* Byte-wise receive */
+            packets_BUFFER_PROCESS_S* txBuffer = &(packetBuffer.send.processBuffer);
+            uint16 frameLen = txBuffer->bufferIndex;
+            uint16 j;
+            start = bench_getCycles();
+            for(j = ZERO; j < frameLen; j++){
+                error |= packets_processRxByte(&packetBuffer, txBuffer->buffer[j]);
+            }
+            rxCycles += bench_elapsedCycles(start, bench_getCycles());
+            if(error){ break; }
+            if(packetBuffer.receive.bufferState != packets_BUFFER_RECEIVE_COMPLETE){
+                error = packets_ERR_INCOMPLETE;
+                break;
+            }
+            /* Parse */
+            start = bench_getCycles();
+            error |= packets_parsePacket(&packetBuffer);
+            parseCycles += bench_elapsedCycles(start, bench_getCycles());
+            /* Verify the round trip */
+            if(!error && (packetBuffer.receive.packet.payloadLen != payloadLen)){
+                error = packets_ERR_LENGTH;
+            }
+            if(error){ break; }
+            /* Span receive of the same frame */
+            packets_flushRxBuffers(&packetBuffer);
+            uint16 bytesUsed;
+            start = bench_getCycles();
+            error |= packetsBulk_processRxBuffer(&packetBuffer, txBuffer->buffer, frameLen, &bytesUsed);
+            rxBulkCycles += bench_elapsedCycles(start, bench_getCycles());
+            /* Must consume exactly one complete frame */
+            if(!error && ((bytesUsed != frameLen) || (packetBuffer.receive.processBuffer.bufferIndex != frameLen) ||
+                (packetBuffer.receive.bufferState != packets_BUFFER_RECEIVE_COMPLETE))){
+                error = packets_ERR_INCOMPLETE;
+            }
+            if(!error && memcmp(packetBuffer.receive.processBuffer.buffer, txBuffer->buffer, frameLen)){
+                error = packets_ERR_CHECKSUM;
+            }
+            result->frameLen = frameLen;
+            /* Reset for the next iteration */
+            packets_flushBuffers(&packetBuffer);
+        }
+        packets_destoryBuffers(&packetBuffer);
+    }
+    /* Average per packet */
+    if(!error){
+        result->encodeCycles = encodeCycles / BENCH_ITERATIONS;
+        result->rxCycles = rxCycles / BENCH_ITERATIONS;
+        result->rxBulkCycles = rxBulkCycles / BENCH_ITERATIONS;
+        result->parseCycles = parseCycles / BENCH_ITERATIONS;
+    }
+    result->error = error;
+    return error;
+}
+
+/*******************************************************************************
+* Function Name: bench_printResult()
+****************************************************************************//**
+* \brief
+*  Prints a single line of benchmark results over the USB UART
+*
+* \param result
+*   Pointer to the results to print
+*
+* \return
+*  None
+*******************************************************************************/
+void bench_printResult(BENCH_RESULT_S* result){
+    if(result->error == packets_ERR_MEMORY){
+        usbUart_print("%4u | skipped (insufficient heap)\r\n", result->payloadLen);
+    } else if(result->error){
+        usbUart_print("%4u | Failed: 0x%x\r\n", result->payloadLen, result->error);
+    } else {
+        usbUart_print("%4u | %5u | %7u %8u | %7u %8u | %7u %8u | %7u %8u\r\n",
+            result->payloadLen, result->frameLen,
+            result->encodeCycles, bench_bytesPerSecond(result->frameLen, result->encodeCycles),
+            result->rxCycles, bench_bytesPerSecond(result->frameLen, result->rxCycles),
+            result->rxBulkCycles, bench_bytesPerSecond(result->frameLen, result->rxBulkCycles),
+            result->parseCycles, bench_bytesPerSecond(result->frameLen, result->parseCycles));
+    }
+}
+
+/*******************************************************************************
+* Function Name: bench_runPacketSuite()
+****************************************************************************//**
+* \brief
+*  Runs the codec benchmark for every payload size in benchSizes and prints
+*  a table of cycles per packet and bytes per second for each stage.
+*
+* \return
+*  None
+*******************************************************************************/
+void bench_runPacketSuite(void){
+    BENCH_RESULT_S result;
+    uint8 i;
+    bench_startCycleCounter();
+    usbUart_print("Packet codec benchmark, %u Hz, %u packets/size\r\n", BENCH_CPU_HZ, BENCH_ITERATIONS);
+    usbUart_print(" len | frame | encode  (B/s)    | rx byte (B/s)    | rx span (B/s)    | parse   (B/s)\r\n");
+    for(i = ZERO; i < BENCH_NUM_SIZES; i++){
+        bench_packetSize(benchSizes[i], &result);
+        bench_printResult(&result);
+    }
+}
+
+/* [] END OF FILE */
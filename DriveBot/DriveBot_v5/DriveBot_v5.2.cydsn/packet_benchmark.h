@@ -0,0 +1,62 @@
+/***************************************************************************
+*                                       MICA
+* File: packet_benchmark.h
+* Workspace: micaComponents
+* Project Name: libMica
+* Version: v1.0
+* Author: Craig Cheney
+*
+* Brief:
+*  Throughput benchmark for the packets codec. Measures the cost of
+*  constructing, receiving (byte-wise and span based) and parsing packets
+*  across a range of payload sizes using the SysTick counter as a cycle counter.
+*
+* Authors:
+*   Craig Cheney
+*
+* Change Log:
+*   2018.08.20 CC - Document created
+*   2018.08.21 CC - Added span based receive
+********************************************************************************/
+#ifndef PACKET_BENCHMARK_H
+    #define PACKET_BENCHMARK_H
+
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include <stdbool.h>
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    #define BENCH_PACKET_OVERHEAD       (12u)   /* Framing bytes around the payload */
+    #define BENCH_ITERATIONS            (16u)   /* Packets timed per payload size */
+    #define BENCH_NUM_SIZES             (7u)    /* Number of payload sizes tested */
+    #define BENCH_SYSTICK_MAX           (0x00FFFFFFu) /* 24-bit SysTick reload */
+    #define BENCH_CPU_HZ                (CYDEV_BCLK__SYSCLK__HZ)
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Results of a single payload size, averaged per packet */
+    typedef struct {
+        uint16 payloadLen;      /**< Length of the payload tested */
+        uint16 frameLen;        /**< Length of the full frame on the wire */
+        uint32 error;           /**< Error encountered while benchmarking */
+        uint32 encodeCycles;    /**< Cycles to construct a packet */
+        uint32 rxCycles;        /**< Cycles to process every byte of a frame */
+        uint32 rxBulkCycles;    /**< Cycles to process a frame as a single span */
+        uint32 parseCycles;     /**< Cycles to parse a received packet */
+    } BENCH_RESULT_S;
+    /***************************************
+    * Function Prototypes
+    ***************************************/
+    void bench_startCycleCounter(void);
+    uint32 bench_getCycles(void);
+    uint32 bench_elapsedCycles(uint32 start, uint32 stop);
+    uint32 bench_bytesPerSecond(uint32 bytes, uint32 cycles);
+    uint32 bench_packetSize(uint16 payloadLen, BENCH_RESULT_S* result);
+    void bench_printResult(BENCH_RESULT_S* result);
+    void bench_runPacketSuite(void);
+#endif /* PACKET_BENCHMARK_H */
+
+/* [] END OF FILE */
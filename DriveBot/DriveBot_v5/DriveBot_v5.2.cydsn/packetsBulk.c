@@ -0,0 +1,139 @@
+/***************************************************************************
+*                                       MICA
+* File: packetsBulk.c
+* Workspace: micaComponents
+* Project Name: libMica
+* Version: v1.0
+* Author: Craig Cheney
+*
+* Brief:
+*  Span based receive path for the packets component. Consumes a contiguous
+*  block of received bytes in a single call instead of one call per byte.
+*
+* Authors:
+*   Craig Cheney
+*
+* Change Log:
+*   2018.08.21 CC - Document created
+********************************************************************************/
+#include "packetsBulk.h"
+#include "micaCommon.h"
+#include <string.h>
+
+/*******************************************************************************
+* Function Name: packetsBulk_processRxBuffer()
+****************************************************************************//**
+* \brief
+*  Processes a span of received bytes into the receive process buffer. The
+*  start symbol is located with memchr, and the header and the remainder of
+*  the frame are copied in as whole runs. The position in the frame is carried
+*  in receive.processBuffer.bufferIndex, so a frame may be split across calls.
+*
+*  Processing stops as soon as a frame is complete, at which point bufferState
+*  is set to packets_BUFFER_RECEIVE_COMPLETE. The packet must then be parsed
+*  and the RX buffers flushed before the remaining bytes (data + bytesUsed)
+*  are passed in again.
+*
+*  Do not mix with packets_processRxByte() on the same frame.
+*
+* \param packetBuffer
+*   Pointer to the packet buffer
+*
+* \param data
+*   Pointer to the received bytes
+*
+* \param len
+*   Number of bytes in data
+*
+* \param bytesUsed [out]
+*   Number of bytes consumed from data
+*
+* \return
+*  Error code of the operation
+*   packets_ERR_SUCCESS - No errors, frame may or may not be complete
+*   packets_ERR_STATE - A completed packet has not been flushed yet
+*   packets_ERR_MEMORY - Buffers have not been generated
+*   packets_ERR_LENGTH - Frame would not fit in the receive buffer
+*   packets_ERR_END_SYM - Frame did not end with the end symbol
+*******************************************************************************/
+uint32 packetsBulk_processRxBuffer(packets_BUFFER_FULL_S* packetBuffer, uint8* data, uint16 len, uint16* bytesUsed){
+    packets_BUFFER_PROCESS_S* rxBuffer = &(packetBuffer->receive.processBuffer);
+    uint8* buffer = rxBuffer->buffer;
+    uint16 index = rxBuffer->bufferIndex;
+    uint16 used = ZERO;
+    uint32 frameLen = ZERO;
+    uint32 error = packets_ERR_SUCCESS;
+    *bytesUsed = ZERO;
+    /* Previous packet must be handled first */
+    if(packetBuffer->receive.bufferState == packets_BUFFER_RECEIVE_COMPLETE){
+        return packets_ERR_STATE;
+    }
+    if(buffer == NULL){
+        return packets_ERR_MEMORY;
+    }
+    /* Length is known once the header has been received */
+    if(index >= packets_LEN_HEADER){
+        frameLen = ((uint32) buffer[packets_INDEX_LEN_MSB] << BITS_ONE_BYTE) | buffer[packets_INDEX_LEN_LSB];
+        frameLen += packetsBulk_LEN_OVERHEAD;
+    }
+
+    while(used < len){
+        uint16 count;
+        /* Scan for the start of a frame */
+        if(index == ZERO){
+            uint8* start = memchr(&data[used], packets_SYM_START, len - used);
+            if(start == NULL){
+                used = len;
+                break;
+            }
+            used = (uint16) (start - data);
+            buffer[index++] = data[used++];
+        }
+        /* Copy in the header */
+        else if(index < packets_LEN_HEADER){
+            count = packets_LEN_HEADER - index;
+            if(count > (len - used)){
+                count = len - used;
+            }
+            memcpy(&buffer[index], &data[used], count);
+            index += count;
+            used += count;
+            /* Extract the length */
+            if(index == packets_LEN_HEADER){
+                frameLen = ((uint32) buffer[packets_INDEX_LEN_MSB] << BITS_ONE_BYTE) | buffer[packets_INDEX_LEN_LSB];
+                frameLen += packetsBulk_LEN_OVERHEAD;
+                if(frameLen > rxBuffer->bufferLen){
+                    error = packets_ERR_LENGTH;
+                    index = ZERO;
+                    break;
+                }
+            }
+        }
+        /* Copy the payload and footer as a single run */
+        else {
+            count = (uint16) (frameLen - index);
+            if(count > (len - used)){
+                count = len - used;
+            }
+            memcpy(&buffer[index], &data[used], count);
+            index += count;
+            used += count;
+            /* Check for the end of the frame */
+            if(index == frameLen){
+                if(buffer[frameLen - ONE] != packets_SYM_END){
+                    error = packets_ERR_END_SYM;
+                    index = ZERO;
+                } else {
+                    packetBuffer->receive.bufferState = packets_BUFFER_RECEIVE_COMPLETE;
+                }
+                break;
+            }
+        }
+    }
+    /* Store the state */
+    rxBuffer->bufferIndex = index;
+    *bytesUsed = used;
+    return error;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,37 @@
+/***************************************************************************
+*                                       MICA
+* File: packetsBulk.h
+* Workspace: micaComponents
+* Project Name: libMica
+* Version: v1.0
+* Author: Craig Cheney
+*
+* Brief:
+*  Span based receive path for the packets component. Consumes a contiguous
+*  block of received bytes in a single call instead of one call per byte.
+*
+* Authors:
+*   Craig Cheney
+*
+* Change Log:
+*   2018.08.21 CC - Document created
+********************************************************************************/
+#ifndef PACKETS_BULK_H
+    #define PACKETS_BULK_H
+
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Framing is the packets component's, only the overhead is derived */
+    #define packetsBulk_LEN_OVERHEAD        (packets_LEN_HEADER + packets_LEN_FOOTER)
+    /***************************************
+    * Function Prototypes
+    ***************************************/
+    uint32 packetsBulk_processRxBuffer(packets_BUFFER_FULL_S* packetBuffer, uint8* data, uint16 len, uint16* bytesUsed);
+#endif /* PACKETS_BULK_H */
+
+/* [] END OF FILE */
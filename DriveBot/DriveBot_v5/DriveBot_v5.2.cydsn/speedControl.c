@@ -0,0 +1,742 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: speedControl.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Closed loop wheel speed control. SystemTimer interrupts at a fixed rate,
+*   encoderVelocity gives the filtered wheel speed in ticks/s, and a PID with
+*   feed-forward sets the signed duty of that wheel. All arithmetic
+*   is integer, gains are Q12. The integrator is clamped to the output range
+*   and stops integrating while the output is saturated in the same direction.
+*
+*   Targets and open loop duties are not applied as steps. Each wheel ramps
+*   to them through a motionProfile stepped in the same interrupt, so a
+*   reversal is fast but the current stays bounded. Without a current sensor
+*   the winding current is estimated from the duty less the back EMF of the
+*   measured speed, and each time it rises above speedControl_PEAK_DRIVE a
+*   peak is counted.
+*
+*   The Motors component only moves both wheels together, so the function that
+*   drives a single wheel is passed to speedControl_init().
+*
+* 2018.11.05  - Document Created
+********************************************************************************/
+#include "speedControl.h"
+#include "micaCommon.h"
+#include "encoderVelocity.h"
+
+/* Loop period in encoderVelocity timestamps */
+#define SAMPLE_TIME     ((uint32) (((uint64) speedControl_TIMER_PERIOD * encoderVelocity_TIMER_HZ) / speedControl_TIMER_CLOCK_HZ))
+
+/* Controller state of a single wheel */
+typedef struct {
+    speedControl_GAINS_S gains;
+    volatile int16 target;      /* Commanded speed [ticks/s] */
+    volatile bool openLoop;     /* Duty set directly, the PID is bypassed */
+    motionProfile_S profile;    /* Ramps the target, or the duty while openLoop */
+    int16 speed;                /* Measured speed [ticks/s] */
+    int16 duty;                 /* Last output */
+    int32 integral;             /* Q12 duty counts */
+    bool peak;                  /* Estimated current is above speedControl_PEAK_DRIVE */
+    uint32 peakCount;           /* Times the current rose above speedControl_PEAK_DRIVE */
+} SPEED_WHEEL_S;
+
+static SPEED_WHEEL_S wheels[speedControl_NUM_WHEELS];
+static speedControl_DRIVE_T driveWheel = NULL;
+static speedControl_SAMPLE_T sampleCallback = NULL;
+static motionProfile_LIMITS_S profileLimits[speedControl_NUM_PROFILES] = {
+    {speedControl_DEFAULT_SPEED_RATE, speedControl_DEFAULT_SPEED_JERK},
+    {speedControl_DEFAULT_DUTY_RATE, speedControl_DEFAULT_DUTY_JERK}
+};
+static volatile bool running = false;
+static uint32 sampleTime = ZERO;             /* Time of the last sample, encoderVelocity_TIMER_HZ */
+
+static void speedControl_ISR(void);
+
+/*******************************************************************************
+* Function Name: speedControl_clamp()
+****************************************************************************//**
+* \brief
+*  Limits a value to +/- limit
+*
+* \param value [in]
+*  Value to limit
+*
+* \param limit [in]
+*  Positive limit
+*
+* \return
+*  The limited value
+*******************************************************************************/
+static int64 speedControl_clamp(int64 value, int32 limit) {
+    if(value > limit) {
+        return limit;
+    } else if(value < -limit) {
+        return -limit;
+    }
+    return value;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setMode()
+****************************************************************************//**
+* \brief
+*  Switches a wheel between closed and open loop. The profile restarts at rest
+*   from the value given, so the switch does not step the output. Call with
+*   interrupts disabled.
+*
+* \param w [in]
+*  Wheel to switch
+*
+* \param openLoop [in]
+*  True to drive the duty directly
+*
+* \param start [in]
+*  Value the profile starts from, speed for closed loop and duty for open
+*
+* \return
+*  None
+*******************************************************************************/
+static void speedControl_setMode(SPEED_WHEEL_S *w, bool openLoop, int16 start) {
+    uint8 profile = openLoop ? speedControl_PROFILE_DUTY : speedControl_PROFILE_SPEED;
+    motionProfile_reset(&w->profile, start);
+    motionProfile_setLimits(&w->profile, &profileLimits[profile], speedControl_RATE_HZ);
+    w->openLoop = openLoop;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_init()
+****************************************************************************//**
+* \brief
+*  Loads the default gains and zeros the targets. dualEncoder and the motors
+*   must be started separately.
+*
+* \param drive [in]
+*  Function that applies a signed duty to a single wheel
+*
+* \return
+*  None
+*******************************************************************************/
+void speedControl_init(speedControl_DRIVE_T drive) {
+    speedControl_stop();
+    driveWheel = drive;
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        wheels[i].gains.kp = speedControl_DEFAULT_KP;
+        wheels[i].gains.ki = speedControl_DEFAULT_KI;
+        wheels[i].gains.kd = speedControl_DEFAULT_KD;
+        wheels[i].gains.kff = speedControl_DEFAULT_KFF;
+        wheels[i].peakCount = ZERO;
+    }
+}
+
+/*******************************************************************************
+* Function Name: speedControl_start()
+****************************************************************************//**
+* \brief
+*  Starts the fixed rate loop from the current encoder counts
+*
+* \return
+*  None
+*******************************************************************************/
+void speedControl_start(void) {
+    encoderVelocity_reset(sampleTime);
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        wheels[i].speed = ZERO;
+        wheels[i].duty = ZERO;
+        wheels[i].integral = ZERO;
+        wheels[i].peak = false;
+    }
+    running = true;
+    SystemTimer_Start();
+    SystemTimer_WritePeriod(speedControl_TIMER_PERIOD);
+    timer_interrupt_StartEx(speedControl_ISR);
+}
+
+/*******************************************************************************
+* Function Name: speedControl_stop()
+****************************************************************************//**
+* \brief
+*  Stops the loop and releases both wheels at once, without a ramp
+*
+* \return
+*  None
+*******************************************************************************/
+void speedControl_stop(void) {
+    timer_interrupt_Stop();
+    SystemTimer_Stop();
+    running = false;
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        wheels[i].target = ZERO;
+        speedControl_setMode(&wheels[i], false, ZERO);
+        wheels[i].duty = ZERO;
+        if(driveWheel != NULL) {
+            driveWheel(i, ZERO);
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: speedControl_isRunning()
+****************************************************************************//**
+* \brief
+*  Reports if the loop is running
+*
+* \return
+*  True while the loop is running
+*******************************************************************************/
+bool speedControl_isRunning(void) {
+    return running;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setTarget()
+****************************************************************************//**
+* \brief
+*  Sets the speed a wheel is driven to. The target ramps from the current one,
+*   or from the measured speed when leaving open loop. A target of zero
+*   releases the wheel once the ramp reaches it.
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \param ticksPerSec [in]
+*  Signed speed, positive is forward
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_setTarget(uint8 wheel, int16 ticksPerSec) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return speedControl_ERR_WHEEL;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    SPEED_WHEEL_S *w = &wheels[wheel];
+    if(w->openLoop) {
+        speedControl_setMode(w, false, w->speed);
+    }
+    w->target = ticksPerSec;
+    motionProfile_setGoal(&w->profile, ticksPerSec);
+    CyExitCriticalSection(intState);
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setDuty()
+****************************************************************************//**
+* \brief
+*  Drives a wheel open loop, while the speed is still measured. The duty ramps
+*   from the current one through speedControl_PROFILE_DUTY, or is applied
+*   immediately when that profile has no rate limit.
+*   speedControl_setTarget() returns the wheel to closed loop.
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \param duty [in]
+*  Signed duty, limited to speedControl_DUTY_MAX
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_setDuty(uint8 wheel, int16 duty) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return speedControl_ERR_WHEEL;
+    }
+    duty = (int16) speedControl_clamp(duty, speedControl_DUTY_MAX);
+    /* The interrupt also drives the wheel */
+    uint8 intState = CyEnterCriticalSection();
+    SPEED_WHEEL_S *w = &wheels[wheel];
+    if(!w->openLoop) {
+        speedControl_setMode(w, true, w->duty);
+        w->target = ZERO;
+        w->integral = ZERO;
+    }
+    motionProfile_setGoal(&w->profile, duty);
+    if(profileLimits[speedControl_PROFILE_DUTY].rate == motionProfile_RATE_NONE) {
+        w->duty = (int16) motionProfile_step(&w->profile);
+        if(driveWheel != NULL) {
+            driveWheel(wheel, w->duty);
+        }
+    }
+    CyExitCriticalSection(intState);
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setGains()
+****************************************************************************//**
+* \brief
+*  Replaces the gains of one or both wheels. The integrator is kept so the
+*   gains can be tuned while driving.
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side> or speedControl_WHEEL_BOTH
+*
+* \param gains [in]
+*  New gains, Q12 and not negative
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_setGains(uint8 wheel, speedControl_GAINS_S *gains) {
+    if((wheel >= speedControl_NUM_WHEELS) && (wheel != speedControl_WHEEL_BOTH)) {
+        return speedControl_ERR_WHEEL;
+    }
+    if((gains->kp < 0) || (gains->ki < 0) || (gains->kd < 0) || (gains->kff < 0)) {
+        return speedControl_ERR_GAIN;
+    }
+    /* The loop reads the gains from the interrupt */
+    uint8 intState = CyEnterCriticalSection();
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        if((wheel == i) || (wheel == speedControl_WHEEL_BOTH)) {
+            wheels[i].gains = *gains;
+        }
+    }
+    CyExitCriticalSection(intState);
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getGains()
+****************************************************************************//**
+* \brief
+*  Gets the gains of a wheel
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \param gains [out]
+*  Active gains
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_getGains(uint8 wheel, speedControl_GAINS_S *gains) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return speedControl_ERR_WHEEL;
+    }
+    *gains = wheels[wheel].gains;
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setProfile()
+****************************************************************************//**
+* \brief
+*  Replaces the limits of a profile. Wheels already ramping continue from
+*   their current value and rate.
+*
+* \param profile [in]
+*  speedControl_PROFILE_<name>
+*
+* \param limits [in]
+*  New limits, motionProfile_RATE_NONE applies targets as steps
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_setProfile(uint8 profile, motionProfile_LIMITS_S *limits) {
+    if(profile >= speedControl_NUM_PROFILES) {
+        return speedControl_ERR_PROFILE;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    profileLimits[profile] = *limits;
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        if(wheels[i].openLoop == (profile == speedControl_PROFILE_DUTY)) {
+            motionProfile_setLimits(&wheels[i].profile, limits, speedControl_RATE_HZ);
+        }
+    }
+    CyExitCriticalSection(intState);
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getProfile()
+****************************************************************************//**
+* \brief
+*  Gets the limits of a profile
+*
+* \param profile [in]
+*  speedControl_PROFILE_<name>
+*
+* \param limits [out]
+*  Active limits
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 speedControl_getProfile(uint8 profile, motionProfile_LIMITS_S *limits) {
+    if(profile >= speedControl_NUM_PROFILES) {
+        return speedControl_ERR_PROFILE;
+    }
+    *limits = profileLimits[profile];
+    return speedControl_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getSpeed()
+****************************************************************************//**
+* \brief
+*  Filtered speed of a wheel at the last sample
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \return
+*  Speed in ticks/s, zero for an unknown wheel
+*******************************************************************************/
+int16 speedControl_getSpeed(uint8 wheel) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return ZERO;
+    }
+    return wheels[wheel].speed;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getDuty()
+****************************************************************************//**
+* \brief
+*  Duty applied to a wheel at the last sample
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \return
+*  Signed duty, zero for an unknown wheel
+*******************************************************************************/
+int16 speedControl_getDuty(uint8 wheel) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return ZERO;
+    }
+    return wheels[wheel].duty;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getPeakCount()
+****************************************************************************//**
+* \brief
+*  Number of times the estimated current of a wheel has risen above
+*   speedControl_PEAK_DRIVE since speedControl_init()
+*
+* \param wheel [in]
+*  speedControl_WHEEL_<side>
+*
+* \return
+*  Peak count, zero for an unknown wheel
+*******************************************************************************/
+uint32 speedControl_getPeakCount(uint8 wheel) {
+    if(wheel >= speedControl_NUM_WHEELS) {
+        return ZERO;
+    }
+    return wheels[wheel].peakCount;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_setSampleCallback()
+****************************************************************************//**
+* \brief
+*  Sets a function to run from the timer interrupt after every sample, e.g. to
+*   record the wheel state at the loop rate
+*
+* \param callback [in]
+*  Function to call, NULL to remove it
+*
+* \return
+*  None
+*******************************************************************************/
+void speedControl_setSampleCallback(speedControl_SAMPLE_T callback) {
+    uint8 intState = CyEnterCriticalSection();
+    sampleCallback = callback;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: speedControl_update()
+****************************************************************************//**
+* \brief
+*  Runs one sample of the loop for both wheels. Called from the timer
+*   interrupt, only call directly when the loop is not running.
+*
+* \return
+*  None
+*******************************************************************************/
+void speedControl_update(void) {
+    /* The timer reloads every period, so each sample is exactly one period later */
+    sampleTime += SAMPLE_TIME;
+    encoderVelocity_update(sampleTime);
+    const int32 limit = ((int32) speedControl_DUTY_MAX) << speedControl_GAIN_SHIFT;
+    uint8 i;
+    for(i = ZERO; i < speedControl_NUM_WHEELS; i++) {
+        SPEED_WHEEL_S *w = &wheels[i];
+        int16 lastSpeed = w->speed;
+        w->speed = encoderVelocity_getVelocity(i);
+        int32 target = motionProfile_step(&w->profile);
+        if(w->openLoop) {
+            w->integral = ZERO;
+            w->duty = (int16) target;
+        } else if((target == ZERO) && (w->target == ZERO)) {
+            /* Released wheel */
+            w->integral = ZERO;
+            w->duty = ZERO;
+        } else {
+            int32 error = target - w->speed;
+            /* Feed-forward, proportional and derivative on measurement so a target step does not kick */
+            int64 output = (int64) w->gains.kff * target;
+            output += (int64) w->gains.kp * error;
+            output -= (int64) w->gains.kd * (w->speed - lastSpeed);
+            /* Integrate unless it pushes further into saturation */
+            int64 step = (int64) w->gains.ki * error;
+            int64 unsaturated = output + w->integral;
+            bool windup = ((unsaturated >= limit) && (step > 0)) || ((unsaturated <= -limit) && (step < 0));
+            if(!windup) {
+                w->integral = (int32) speedControl_clamp(w->integral + step, limit);
+            }
+            output = speedControl_clamp(output + w->integral, limit);
+            w->duty = (int16) (output / speedControl_GAIN_ONE);
+        }
+        /* Count each rise of the estimated current above the peak */
+        bool peak = false;
+        if(w->duty != ZERO) {
+            int32 drive = w->duty - ((int32) speedControl_BACK_EMF * w->speed) / speedControl_GAIN_ONE;
+            peak = (drive > speedControl_PEAK_DRIVE) || (drive < -speedControl_PEAK_DRIVE);
+        }
+        if(peak && !w->peak) {
+            w->peakCount++;
+        }
+        w->peak = peak;
+        if(driveWheel != NULL) {
+            driveWheel(i, w->duty);
+        }
+    }
+    if(sampleCallback != NULL) {
+        sampleCallback();
+    }
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getInt16()
+****************************************************************************//**
+* \brief
+*  Reads a signed MSB first half word
+*
+* \param data [in]
+*  Location of the MSB
+*
+* \return
+*  The value
+*******************************************************************************/
+static int16 speedControl_getInt16(uint8 *data) {
+    return (int16) ((data[ZERO] << BITS_ONE_BYTE) | data[ONE]);
+}
+
+/*******************************************************************************
+* Function Name: speedControl_putInt16()
+****************************************************************************//**
+* \brief
+*  Writes a signed half word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param value [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 speedControl_putInt16(uint8 *data, int16 value) {
+    data[ZERO] = ((uint16) value >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[ONE] = (uint16) value & MASK_BYTE_ONE;
+    return TWO;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_getWord()
+****************************************************************************//**
+* \brief
+*  Reads an MSB first word
+*
+* \param data [in]
+*  Location of the MSB
+*
+* \return
+*  The value
+*******************************************************************************/
+static uint32 speedControl_getWord(uint8 *data) {
+    return ((uint32) data[ZERO] << (3 * BITS_ONE_BYTE)) | ((uint32) data[ONE] << (2 * BITS_ONE_BYTE)) |
+        ((uint32) data[TWO] << BITS_ONE_BYTE) | data[3];
+}
+
+/*******************************************************************************
+* Function Name: speedControl_putWord()
+****************************************************************************//**
+* \brief
+*  Writes a word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param word [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 speedControl_putWord(uint8 *data, uint32 word) {
+    uint8 i = ZERO;
+    data[i++] = (word >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[i++] = word & MASK_BYTE_ONE;
+    return i;
+}
+
+/*******************************************************************************
+* Function Name: speedControl_handleCommand()
+****************************************************************************//**
+* \brief
+*  Handles the speedControl_CMD_<name> commands. Errors are reported in the
+*   flags of the response.
+*
+* \param rxPacket [in]
+*  Pointer to the packet containing the command
+*
+* \param txPacket [out]
+*  Pointer to the response packet
+*
+* \return
+*  Returns the error of associated with the operation
+*******************************************************************************/
+uint32 speedControl_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket) {
+    uint8 *payload = rxPacket->payload;
+    switch(rxPacket->cmd) {
+        /* Set both targets, respond with the measured speeds */
+        case speedControl_CMD_SPEED: {
+            if(rxPacket->payloadLen != speedControl_LEN_SPEED) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            speedControl_setTarget(speedControl_WHEEL_LEFT, speedControl_getInt16(&payload[ZERO]));
+            speedControl_setTarget(speedControl_WHEEL_RIGHT, speedControl_getInt16(&payload[TWO]));
+            if(!running) {
+                txPacket->flags |= packets_FLAG_INVALID_STATE;
+            }
+            uint8 i = ZERO;
+            i += speedControl_putInt16(&txPacket->payload[i], speedControl_getSpeed(speedControl_WHEEL_LEFT));
+            i += speedControl_putInt16(&txPacket->payload[i], speedControl_getSpeed(speedControl_WHEEL_RIGHT));
+            txPacket->payloadLen = i;
+            break;
+        }
+        /* Set the gains of a wheel, or query them with only the wheel */
+        case speedControl_CMD_GAINS: {
+            if((rxPacket->payloadLen != speedControl_LEN_GAINS) && (rxPacket->payloadLen != speedControl_LEN_GAINS_QUERY)) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            uint8 wheel = payload[ZERO];
+            speedControl_GAINS_S gains;
+            if(rxPacket->payloadLen == speedControl_LEN_GAINS) {
+                uint8 i = ONE;
+                gains.kp = speedControl_getInt16(&payload[i]);
+                i += TWO;
+                gains.ki = speedControl_getInt16(&payload[i]);
+                i += TWO;
+                gains.kd = speedControl_getInt16(&payload[i]);
+                i += TWO;
+                gains.kff = speedControl_getInt16(&payload[i]);
+                if(speedControl_setGains(wheel, &gains)) {
+                    txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                    break;
+                }
+            }
+            /* Respond with the active gains, the left wheel stands in for both */
+            if(wheel == speedControl_WHEEL_BOTH) {
+                wheel = speedControl_WHEEL_LEFT;
+            }
+            if(speedControl_getGains(wheel, &gains)) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            uint8 i = ZERO;
+            txPacket->payload[i++] = payload[ZERO];
+            i += speedControl_putInt16(&txPacket->payload[i], gains.kp);
+            i += speedControl_putInt16(&txPacket->payload[i], gains.ki);
+            i += speedControl_putInt16(&txPacket->payload[i], gains.kd);
+            i += speedControl_putInt16(&txPacket->payload[i], gains.kff);
+            txPacket->payloadLen = i;
+            break;
+        }
+        /* Set the limits of a profile, or query them with only the profile */
+        case speedControl_CMD_PROFILE: {
+            if((rxPacket->payloadLen != speedControl_LEN_PROFILE) && (rxPacket->payloadLen != speedControl_LEN_PROFILE_QUERY)) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            uint8 profile = payload[ZERO];
+            motionProfile_LIMITS_S limits;
+            if(rxPacket->payloadLen == speedControl_LEN_PROFILE) {
+                uint8 i = ONE;
+                limits.rate = speedControl_getWord(&payload[i]);
+                i += sizeof(uint32);
+                limits.jerk = speedControl_getWord(&payload[i]);
+                if(speedControl_setProfile(profile, &limits)) {
+                    txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                    break;
+                }
+            }
+            if(speedControl_getProfile(profile, &limits)) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            uint8 i = ZERO;
+            txPacket->payload[i++] = profile;
+            i += speedControl_putWord(&txPacket->payload[i], limits.rate);
+            i += speedControl_putWord(&txPacket->payload[i], limits.jerk);
+            txPacket->payloadLen = i;
+            break;
+        }
+        /* Release both wheels, the loop keeps running */
+        case speedControl_CMD_STOP: {
+            speedControl_setTarget(speedControl_WHEEL_LEFT, ZERO);
+            speedControl_setTarget(speedControl_WHEEL_RIGHT, ZERO);
+            break;
+        }
+        /* Command not found */
+        default: {
+            txPacket->flags |= packets_FLAG_INVALID_CMD;
+            break;
+        }
+    }
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* ISR Name: speedControl_ISR()
+********************************************************************************
+* Summary:
+*   Runs the loop at speedControl_RATE_HZ
+* Interrupt:
+*   timer_interrupt
+*
+*******************************************************************************/
+static void speedControl_ISR(void) {
+    /* Clear the interrupt */
+    SystemTimer_STATUS;
+    speedControl_update();
+}
+
+/* [] END OF FILE */
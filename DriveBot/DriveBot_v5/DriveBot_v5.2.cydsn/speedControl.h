@@ -0,0 +1,123 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: speedControl.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for speedControl.c
+*
+* 2018.11.05  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef speedControl_H
+    #define speedControl_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "packets.h"
+    #include "motionProfile.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Wheels */
+    #define speedControl_WHEEL_LEFT             (0u)
+    #define speedControl_WHEEL_RIGHT            (1u)
+    #define speedControl_NUM_WHEELS             (2u)
+    #define speedControl_WHEEL_BOTH             (0xFFu) /* Gain commands that apply to both wheels */
+    /* Loop rate - SystemTimer is a down counter clocked at 1 MHz */
+    #ifndef speedControl_TIMER_CLOCK_HZ
+        #define speedControl_TIMER_CLOCK_HZ     (1000000u)
+    #endif
+    #ifndef speedControl_RATE_HZ
+        #define speedControl_RATE_HZ            (100u)
+    #endif
+    #define speedControl_TIMER_PERIOD           (speedControl_TIMER_CLOCK_HZ / speedControl_RATE_HZ)
+    /* Output, signed duty in PWM counts */
+    #ifndef speedControl_DUTY_MAX
+        #define speedControl_DUTY_MAX           (255)
+    #endif
+    /* Gains are Q12 - duty counts per tick/s, integral and derivative per sample */
+    #define speedControl_GAIN_SHIFT             (12u)
+    #define speedControl_GAIN_ONE               (1 << speedControl_GAIN_SHIFT)
+    #define speedControl_DEFAULT_KP             (205)   /* 0.05 */
+    #define speedControl_DEFAULT_KI             (41)    /* 0.01 */
+    #define speedControl_DEFAULT_KD             (0)
+    #define speedControl_DEFAULT_KFF            (410)   /* 0.1, duty per tick/s at steady state */
+    /* Profiles that targets and duties are ramped with */
+    #define speedControl_PROFILE_SPEED          (0u)    /* Closed loop targets, ticks/s */
+    #define speedControl_PROFILE_DUTY           (1u)    /* Open loop duty, duty counts */
+    #define speedControl_NUM_PROFILES           (2u)
+    #define speedControl_DEFAULT_SPEED_RATE     (25500u)    /* Full speed in 100 ms [ticks/s^2] */
+    #define speedControl_DEFAULT_SPEED_JERK     (510000u)   /* Full acceleration in 50 ms [ticks/s^3] */
+    #define speedControl_DEFAULT_DUTY_RATE      (2550u)     /* Full duty in 100 ms [counts/s] */
+    #define speedControl_DEFAULT_DUTY_JERK      (51000u)    /* Full rate in 50 ms [counts/s^2] */
+    /* Peak current, estimated as the duty left across the winding after the back EMF */
+    #ifndef speedControl_BACK_EMF
+        #define speedControl_BACK_EMF           (speedControl_DEFAULT_KFF)  /* Q12 duty per tick/s */
+    #endif
+    #define speedControl_PEAK_DRIVE             (speedControl_DUTY_MAX)     /* Above the stall current at full duty */
+    /* Commands, sent to the DriveBot from the IMU */
+    #define speedControl_CMD_SPEED              (0x30u) /* Set wheel speeds, respond with measured speeds */
+    #define speedControl_CMD_GAINS              (0x31u) /* Set or query the gains of a wheel */
+    #define speedControl_CMD_STOP               (0x32u) /* Zero the targets and release the motors */
+    #define speedControl_CMD_PROFILE            (0x33u) /* Set or query the limits of a profile */
+    /* Payloads, all values MSB first */
+    #define speedControl_LEN_SPEED              (4u)    /* [left x2][right x2] ticks/s */
+    #define speedControl_LEN_GAINS_QUERY        (1u)    /* [wheel] */
+    #define speedControl_LEN_GAINS              (9u)    /* [wheel][kp x2][ki x2][kd x2][kff x2] */
+    #define speedControl_LEN_PROFILE_QUERY      (1u)    /* [profile] */
+    #define speedControl_LEN_PROFILE            (9u)    /* [profile][rate x4][jerk x4], zero disables a limit */
+    /* Error codes */
+    #define speedControl_ERR_OK                 (0u)
+    #define speedControl_ERR_WHEEL              (1u)    /* Unknown wheel */
+    #define speedControl_ERR_GAIN               (2u)    /* Negative gain */
+    #define speedControl_ERR_PROFILE            (3u)    /* Unknown profile */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Controller gains, Q12 */
+    typedef struct {
+        int16 kp;               /**< Proportional */
+        int16 ki;               /**< Integral, per sample */
+        int16 kd;               /**< Derivative on measurement, per sample */
+        int16 kff;              /**< Feed-forward from the target */
+    } speedControl_GAINS_S;
+
+    /* Drives a single wheel, duty is -speedControl_DUTY_MAX to speedControl_DUTY_MAX */
+    typedef void (*speedControl_DRIVE_T)(uint8 wheel, int16 duty);
+    /* Called from the timer interrupt after each sample */
+    typedef void (*speedControl_SAMPLE_T)(void);
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void speedControl_init(speedControl_DRIVE_T drive);
+    void speedControl_start(void);
+    void speedControl_stop(void);
+    bool speedControl_isRunning(void);
+    uint32 speedControl_setTarget(uint8 wheel, int16 ticksPerSec);
+    uint32 speedControl_setDuty(uint8 wheel, int16 duty);
+    uint32 speedControl_setGains(uint8 wheel, speedControl_GAINS_S *gains);
+    uint32 speedControl_getGains(uint8 wheel, speedControl_GAINS_S *gains);
+    uint32 speedControl_setProfile(uint8 profile, motionProfile_LIMITS_S *limits);
+    uint32 speedControl_getProfile(uint8 profile, motionProfile_LIMITS_S *limits);
+    int16 speedControl_getSpeed(uint8 wheel);
+    int16 speedControl_getDuty(uint8 wheel);
+    uint32 speedControl_getPeakCount(uint8 wheel);
+    void speedControl_setSampleCallback(speedControl_SAMPLE_T callback);
+    void speedControl_update(void);
+    uint32 speedControl_handleCommand(packets_PACKET_S *rxPacket, packets_PACKET_S *txPacket);
+
+#endif /* speedControl_H */
+/* [] END OF FILE */
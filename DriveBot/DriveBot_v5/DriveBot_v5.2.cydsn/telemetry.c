@@ -0,0 +1,342 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: telemetry.c
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Streams the wheel state to the IMU, which passes it on to the host. A
+*   record is taken from the speedControl interrupt every N loop samples, so
+*   records are evenly spaced at a multiple of the loop period. Records are
+*   packed into one of two frames, and the main loop sends a full frame as a
+*   single packet while the other one fills.
+*
+*   The sequence number counts frames that were sent, so a gap means the link
+*   lost a packet. The first record index counts every record taken, so a gap
+*   with telemetry_FLAG_OVERRUN set means the main loop fell behind and a frame
+*   was dropped before sending.
+*
+* 2018.11.10  - Document Created
+********************************************************************************/
+#include "telemetry.h"
+#include "micaCommon.h"
+#include "speedControl.h"
+#include "encoderVelocity.h"
+#include "actuation.h"
+#include "imuRx.h"
+
+#define NUM_FRAMES          (2u)
+#define MS_PER_SAMPLE       (1000u / speedControl_RATE_HZ)
+#define DEFAULT_PERIOD_MS   (20u)
+/* Frame states, the interrupt only moves a frame out of FREE and FILLING */
+#define FRAME_FREE          (0u)
+#define FRAME_FILLING       (1u)
+#define FRAME_READY         (2u)
+#define FRAME_SENDING       (3u)
+/* Header offsets */
+#define HEADER_SEQUENCE     (0u)
+#define HEADER_FIRST        (2u)
+#define HEADER_RECORDS      (6u)
+
+/* A frame of records */
+typedef struct {
+    volatile uint8 state;
+    uint8 records;
+    uint8 data[telemetry_LEN_FRAME_MAX];
+} TELEMETRY_FRAME_S;
+
+static TELEMETRY_FRAME_S frames[NUM_FRAMES];
+static uint8 fillIndex = ZERO;
+static telemetry_SEND_T sendFrame = NULL;
+/* Configuration */
+static uint16 divider = ZERO;           /* Loop samples per record, zero when stopped */
+static uint8 recordsPerFrame = telemetry_DEFAULT_RECORDS;
+static uint16 divideCount = ZERO;
+/* Stream state */
+static uint16 sequence = ZERO;
+static uint32 recordIndex = ZERO;
+static bool overrun = false;
+static volatile uint8 pendingFlags = ZERO;
+static volatile uint16 supplyMv = ZERO;
+static volatile bool supplyFresh = false;
+static uint32 lastDropped = ZERO;
+static uint32 lastPeaks = ZERO;
+static telemetry_STATS_S stats;
+
+/*******************************************************************************
+* Function Name: telemetry_putInt16()
+****************************************************************************//**
+* \brief
+*  Writes a half word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param value [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 telemetry_putInt16(uint8 *data, uint16 value) {
+    data[ZERO] = (value >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[ONE] = value & MASK_BYTE_ONE;
+    return TWO;
+}
+
+/*******************************************************************************
+* Function Name: telemetry_putWord()
+****************************************************************************//**
+* \brief
+*  Writes a word MSB first
+*
+* \param data [out]
+*  Location of the MSB
+*
+* \param word [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint8 telemetry_putWord(uint8 *data, uint32 word) {
+    uint8 i = ZERO;
+    data[i++] = (word >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    data[i++] = (word >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    data[i++] = word & MASK_BYTE_ONE;
+    return i;
+}
+
+/*******************************************************************************
+* Function Name: telemetry_ISR_sample()
+****************************************************************************//**
+* \brief
+*  Takes a record every divider loop samples. Called from the speedControl
+*   interrupt.
+*
+* \return
+*  None
+*******************************************************************************/
+static void telemetry_ISR_sample(void) {
+    if((divider == ZERO) || (++divideCount < divider)) {
+        return;
+    }
+    divideCount = ZERO;
+    TELEMETRY_FRAME_S *frame = &frames[fillIndex];
+    if(frame->records == ZERO) {
+        telemetry_putWord(&frame->data[HEADER_FIRST], recordIndex);
+    }
+    /* Flags */
+    int16 dutyLeft = speedControl_getDuty(speedControl_WHEEL_LEFT);
+    int16 dutyRight = speedControl_getDuty(speedControl_WHEEL_RIGHT);
+    uint8 flags = pendingFlags;
+    pendingFlags = ZERO;
+    if((dutyLeft >= speedControl_DUTY_MAX) || (dutyLeft <= -speedControl_DUTY_MAX) ||
+        (dutyRight >= speedControl_DUTY_MAX) || (dutyRight <= -speedControl_DUTY_MAX)) {
+        flags |= telemetry_FLAG_SATURATED;
+    }
+    if(!supplyFresh) {
+        flags |= telemetry_FLAG_SUPPLY_STALE;
+    }
+    supplyFresh = false;
+    if(overrun) {
+        flags |= telemetry_FLAG_OVERRUN;
+        overrun = false;
+    }
+    uint32 peaks = speedControl_getPeakCount(speedControl_WHEEL_LEFT) + speedControl_getPeakCount(speedControl_WHEEL_RIGHT);
+    if(peaks != lastPeaks) {
+        flags |= telemetry_FLAG_PEAK_CURRENT;
+        lastPeaks = peaks;
+    }
+    /* Record */
+    uint8 *record = &frame->data[telemetry_LEN_HEADER + (frame->records * telemetry_LEN_RECORD)];
+    uint8 len = ZERO;
+    len += telemetry_putWord(&record[len], (uint32) encoderVelocity_getCount(encoderVelocity_WHEEL_LEFT));
+    len += telemetry_putWord(&record[len], (uint32) encoderVelocity_getCount(encoderVelocity_WHEEL_RIGHT));
+    len += telemetry_putInt16(&record[len], (uint16) speedControl_getSpeed(speedControl_WHEEL_LEFT));
+    len += telemetry_putInt16(&record[len], (uint16) speedControl_getSpeed(speedControl_WHEEL_RIGHT));
+    len += telemetry_putInt16(&record[len], (uint16) dutyLeft);
+    len += telemetry_putInt16(&record[len], (uint16) dutyRight);
+    len += telemetry_putInt16(&record[len], supplyMv);
+    record[len++] = actuation_getMode();
+    record[len++] = flags;
+    recordIndex++;
+    stats.records++;
+    /* Hand a full frame to the main loop */
+    if(++frame->records >= recordsPerFrame) {
+        TELEMETRY_FRAME_S *next = &frames[fillIndex ^ ONE];
+        if(next->state == FRAME_FREE) {
+            telemetry_putInt16(&frame->data[HEADER_SEQUENCE], sequence++);
+            frame->data[HEADER_RECORDS] = frame->records;
+            frame->state = FRAME_READY;
+            next->records = ZERO;
+            next->state = FRAME_FILLING;
+            fillIndex ^= ONE;
+        } else {
+            /* The previous frame has not been sent, drop this one */
+            frame->records = ZERO;
+            overrun = true;
+            stats.overruns++;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: telemetry_start()
+****************************************************************************//**
+* \brief
+*  Starts the supply measurement and records at the default period.
+*   speedControl must be running for records to be taken.
+*
+* \param send [in]
+*  Function that sends a packet to the IMU
+*
+* \return
+*  None
+*******************************************************************************/
+void telemetry_start(telemetry_SEND_T send) {
+    sendFrame = send;
+    speedControl_setSampleCallback(NULL);
+    frames[ZERO].state = FRAME_FILLING;
+    frames[ZERO].records = ZERO;
+    frames[ONE].state = FRAME_FREE;
+    frames[ONE].records = ZERO;
+    fillIndex = ZERO;
+    ADC_Start();
+    ADC_StartConvert();
+    telemetry_configure(DEFAULT_PERIOD_MS, telemetry_DEFAULT_RECORDS);
+    speedControl_setSampleCallback(telemetry_ISR_sample);
+}
+
+/*******************************************************************************
+* Function Name: telemetry_configure()
+****************************************************************************//**
+* \brief
+*  Sets the record period and the number of records in a frame. The frame
+*   being filled is restarted.
+*
+* \param periodMs [in]
+*  Time between records, rounded down to a multiple of the loop period. Zero
+*   stops the stream.
+*
+* \param records [in]
+*  Records in each frame, 1 to telemetry_MAX_RECORDS
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32 telemetry_configure(uint16 periodMs, uint8 records) {
+    if((records == ZERO) || (records > telemetry_MAX_RECORDS)) {
+        return telemetry_ERR_ARGS;
+    }
+    if((periodMs != ZERO) && (periodMs < MS_PER_SAMPLE)) {
+        return telemetry_ERR_ARGS;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    divider = periodMs / MS_PER_SAMPLE;
+    recordsPerFrame = records;
+    divideCount = ZERO;
+    frames[fillIndex].records = ZERO;
+    CyExitCriticalSection(intState);
+    return telemetry_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: telemetry_getPeriod()
+****************************************************************************//**
+* \brief
+*  Gets the time between records
+*
+* \return
+*  Period in ms, zero when stopped
+*******************************************************************************/
+uint16 telemetry_getPeriod(void) {
+    return divider * MS_PER_SAMPLE;
+}
+
+/*******************************************************************************
+* Function Name: telemetry_getRecords()
+****************************************************************************//**
+* \brief
+*  Gets the number of records in each frame
+*
+* \return
+*  Records per frame
+*******************************************************************************/
+uint8 telemetry_getRecords(void) {
+    return recordsPerFrame;
+}
+
+/*******************************************************************************
+* Function Name: telemetry_getStats()
+****************************************************************************//**
+* \brief
+*  Copies the stream statistics
+*
+* \param statsOut [out]
+*  Statistics since the stream was started
+*
+* \return
+*  None
+*******************************************************************************/
+void telemetry_getStats(telemetry_STATS_S *statsOut) {
+    uint8 intState = CyEnterCriticalSection();
+    *statsOut = stats;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: telemetry_process()
+****************************************************************************//**
+* \brief
+*  Reads the supply, checks for receive drops and sends a full frame. Call
+*   from the main loop at least once per frame period.
+*
+* \return
+*  None
+*******************************************************************************/
+void telemetry_process(void) {
+    /* Supply */
+    if(ADC_IsEndConversion(ADC_RETURN_STATUS)) {
+        int32 mv = ADC_CountsTo_mVolts(telemetry_SUPPLY_CHANNEL, ADC_GetResult16(telemetry_SUPPLY_CHANNEL));
+        /* Offset can take a conversion near ground below zero */
+        if(mv < 0) {
+            mv = ZERO;
+        }
+        supplyMv = (uint16) ((mv * telemetry_SUPPLY_NUM) / telemetry_SUPPLY_DEN);
+        supplyFresh = true;
+        ADC_StartConvert();
+    }
+    /* Bytes lost from the IMU */
+    imuRx_STATS_S rxStats;
+    imuRx_getStats(&rxStats);
+    if(rxStats.bytesDropped != lastDropped) {
+        lastDropped = rxStats.bytesDropped;
+        uint8 intState = CyEnterCriticalSection();
+        pendingFlags |= telemetry_FLAG_RX_DROPPED;
+        CyExitCriticalSection(intState);
+    }
+    /* Send a full frame */
+    uint8 i;
+    for(i = ZERO; i < NUM_FRAMES; i++) {
+        TELEMETRY_FRAME_S *frame = &frames[i];
+        if(frame->state == FRAME_READY) {
+            frame->state = FRAME_SENDING;
+            if(sendFrame != NULL) {
+                sendFrame(telemetry_RSP_FRAME, telemetry_LEN_HEADER + (frame->records * telemetry_LEN_RECORD), frame->data);
+            }
+            stats.frames++;
+            frame->state = FRAME_FREE;
+        }
+    }
+}
+
+/* [] END OF FILE */
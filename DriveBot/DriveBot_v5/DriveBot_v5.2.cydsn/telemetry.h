@@ -0,0 +1,78 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: telemetry.h
+* Workspace: DriveBot_v5
+* Project: DriveBot_v5.2
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: DriveBot MCU v5.1.0
+* PSoC: CY8C4245LQI-483
+*
+* Brief:
+*   Header for telemetry.c
+*
+* 2018.11.10  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef telemetry_H
+    #define telemetry_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Frames, sent to the IMU without a command */
+    #define telemetry_RSP_FRAME             (0xA2u)
+    /* Layout, all values MSB first */
+    #define telemetry_LEN_HEADER            (7u)    /* [sequence x2][first record x4][records] */
+    #define telemetry_LEN_RECORD            (20u)   /* [count L x4][count R x4][speed L x2][speed R x2][duty L x2][duty R x2][supply x2][mode][flags] */
+    #define telemetry_MAX_RECORDS           (5u)    /* Keeps a frame inside packets_LEN_BLOCK_PACKET */
+    #define telemetry_LEN_FRAME_MAX         (telemetry_LEN_HEADER + (telemetry_MAX_RECORDS * telemetry_LEN_RECORD))
+    #define telemetry_DEFAULT_RECORDS       (telemetry_MAX_RECORDS)
+    /* Supply measurement, Batt_Measure on the ADC */
+    #define telemetry_SUPPLY_CHANNEL        (0u)
+    #ifndef telemetry_SUPPLY_NUM
+        #define telemetry_SUPPLY_NUM        (1u)    /* Divider ratio from the supply to the pin */
+        #define telemetry_SUPPLY_DEN        (1u)
+    #endif
+    /* Record flags */
+    #define telemetry_FLAG_SATURATED        (0x01u) /* A wheel is at speedControl_DUTY_MAX */
+    #define telemetry_FLAG_RX_DROPPED       (0x02u) /* imuRx dropped bytes since the last record */
+    #define telemetry_FLAG_OVERRUN          (0x04u) /* Records were lost because the frames were not sent in time */
+    #define telemetry_FLAG_SUPPLY_STALE     (0x08u) /* No supply conversion since the last record */
+    #define telemetry_FLAG_PEAK_CURRENT     (0x10u) /* A wheel passed speedControl_PEAK_DRIVE since the last record */
+    /* Error codes */
+    #define telemetry_ERR_OK                (0u)
+    #define telemetry_ERR_ARGS              (1u)    /* Period below the loop period or records out of range */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Sends a packet to the IMU */
+    typedef uint32 (*telemetry_SEND_T)(uint8 cmd, uint16 payloadLen, uint8 *payload);
+
+    /* Stream statistics */
+    typedef struct {
+        uint32 records;         /**< Records taken */
+        uint32 frames;          /**< Frames sent */
+        uint32 overruns;        /**< Frames dropped because both buffers were full */
+    } telemetry_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void telemetry_start(telemetry_SEND_T send);
+    uint32 telemetry_configure(uint16 periodMs, uint8 records);
+    uint16 telemetry_getPeriod(void);
+    uint8 telemetry_getRecords(void);
+    void telemetry_getStats(telemetry_STATS_S *stats);
+    void telemetry_process(void);
+
+#endif /* telemetry_H */
+/* [] END OF FILE */
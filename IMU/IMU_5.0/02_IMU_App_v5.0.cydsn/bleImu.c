@@ -24,6 +24,7 @@
 ********************************************************************************/
 #include "bleImu.h"
 #include "powerManagement.h"
+#include "imuStream.h"
 
 /* Static function prototypes */
 static void bleCallback(uint32 event, void* eventParam);
@@ -145,16 +146,27 @@ void bleCallback(uint32 event, void* eventParam) {
                 /* Request the parameter update */
                 CyBle_L2capLeConnectionParamUpdateRequest(cyBle_connHandle.bdHandle, &connUpdateParam);
             }
-            /* Wakeup device */
-            power_setSystemState(STATE_WAKEUP);
+            /* Connection events limit how long the device can deep sleep */
+            power_setConnectionInterval(connParam.connIntv);
+            break;
+        }
+        /* Connection parameters changed */
+        case CYBLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:{
+            CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T *updateParam = (CYBLE_GAP_CONN_PARAM_UPDATED_IN_CONTROLLER_T*) eventParam;
+            /* HCI status, zero on success */
+            if(updateParam->status == ZERO){
+                power_setConnectionInterval(updateParam->connIntv);
+            }
             break;
         }
         /* Device has been disconnected */
         case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:{
+            /* Stop streaming */
+            imuStream_handleDisconnect();
             /* Start advertising again */
             startAdvertising();
-            /* Set low power State */
-            power_setSystemState(STATE_PREP_SLEEP);
+            /* Only advertising is left to wake for */
+            power_setConnectionInterval(power_NOT_CONNECTED);
             break;
         }
         /* Advertisement period complete */
@@ -177,7 +189,7 @@ void bleCallback(uint32 event, void* eventParam) {
             /* Use the smaller of the two MTUs */
             uint16 negotiatedMtu = (peerMtu < CYBLE_GATT_MTU) ? peerMtu : CYBLE_GATT_MTU;   
             /* Store the MTU */
-//            mica_setNegotiatedMtu(negotiatedMtu);
+            imuStream_setMtu(negotiatedMtu);
             /* Send the response */
             CyBle_GattsExchangeMtuRsp(cyBle_connHandle, negotiatedMtu);
             break;
@@ -194,8 +206,18 @@ void bleCallback(uint32 event, void* eventParam) {
         case CYBLE_EVT_GATTS_WRITE_REQ:{
             /* Cast write params */
             CYBLE_GATTS_WRITE_REQ_PARAM_T writeParam = *(CYBLE_GATTS_WRITE_REQ_PARAM_T*) eventParam;
+            /* Pass streaming configuration to the sampling engine */
+            CYBLE_GATT_ERR_CODE_T gattErr = imuStream_handleWrite(&writeParam);
             /* Respond to the write request */
-            CyBle_GattsWriteRsp(cyBle_connHandle);
+            if(gattErr == CYBLE_GATT_ERR_NONE){
+                CyBle_GattsWriteRsp(cyBle_connHandle);
+            } else {
+                CYBLE_GATTS_ERR_PARAM_T errParam;
+                errParam.opcode = CYBLE_GATT_WRITE_REQ;
+                errParam.attrHandle = writeParam.handleValPair.attrHandle;
+                errParam.errorCode = gattErr;
+                CyBle_GattsErrorRsp(cyBle_connHandle, &errParam);
+            }
             break;
         }
         /**********************************************************
@@ -50,6 +50,10 @@
     #define configTIMER_SAMPLE_IRQ_NAME     sample_Interrupt
     /* Name of the ADC */
     #define configADC_NAME                  ADC
+    /* Handles of the streaming characteristics */
+    #define configBLE_STREAM_DATA_HANDLE    CYBLE_MICA_SENSING_DATA_CHAR_HANDLE
+    #define configBLE_STREAM_CCCD_HANDLE    CYBLE_MICA_SENSING_DATA_CLIENT_CHARACTERISTIC_CONFIGURATION_DESC_HANDLE
+    #define configBLE_STREAM_CONFIG_HANDLE  CYBLE_MICA_SENSING_COMMANDS_CHAR_HANDLE
     /* ------------ Constants ------------- */
     #define configLED_PWM_MAX               (254u)
     #define configLED_PWM_OFF               (0u)
@@ -0,0 +1,44 @@
+/***************************************************************************
+*                                       MICA
+* File: project.h
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0 host test
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* Brief:
+*   Stands in for the generated project.h when scheduler.c is built on a
+*   Linux host. The tick interrupt is never started; the tests move time
+*   with scheduler_advance().
+*
+* Date Written: 2018.11.15
+********************************************************************************/
+#ifndef HOST_PROJECT_H
+    #define HOST_PROJECT_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int32_t int32;
+    #define ZERO    (0u)
+    #define ONE     (1u)
+
+    /* No interrupts on the host */
+    static inline uint8 CyEnterCriticalSection(void) { return ZERO; }
+    static inline void CyExitCriticalSection(uint8 state) { (void) state; }
+    static inline void CySysPmSleep(void) { }
+    #define CY_ISR_PROTO(name)  void name(void)
+    #define CY_ISR(name)        void name(void)
+
+    /* dataSampleTimer and its interrupt, the counter stays at the period */
+    static inline void dataSample_Interrupt_StartEx(void (*isr)(void)) { (void) isr; }
+    static inline void dataSampleTimer_Start(void) { }
+    static inline void dataSampleTimer_WritePeriod(uint32 period) { (void) period; }
+    static inline void dataSampleTimer_WriteCounter(uint32 counter) { (void) counter; }
+    static inline uint32 dataSampleTimer_ReadCounter(void) { return 999u; }
+    extern volatile uint8 dataSampleTimer_STATUS;   /* Defined by the test */
+#endif /* HOST_PROJECT_H */
+/* [] END OF FILE */
@@ -0,0 +1,114 @@
+/***************************************************************************
+*                                       MICA
+* File: test_scheduler.c
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0 host test
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* Brief:
+*   Runs scheduler.c on a Linux host. Time only moves through
+*   scheduler_advance(), so each case checks exactly which tasks a dispatch
+*   runs: nothing before the deadline, earliest deadline first, missed
+*   periods skipped, and the same across the wrap of the tick count.
+*
+*   Build and run from the project directory:
+*     gcc -std=gnu99 -Wall -I hostTest -I . hostTest/test_scheduler.c scheduler.c -o test_scheduler && ./test_scheduler
+*
+* Date Written: 2018.11.15
+********************************************************************************/
+#include <stdio.h>
+#include "scheduler.h"
+
+/* Status register read by the tick interrupt */
+volatile uint8 dataSampleTimer_STATUS;
+
+/* Test helpers */
+static uint32 failures = ZERO;
+static uint8 runOrder[scheduler_MAX_TASKS];
+static uint8 runCount;
+static uint32 lastDeadline;
+
+static void check(const char *name, uint32 actual, uint32 expected){
+    bool pass = (actual == expected);
+    printf("%s: %s (got %u, expected %u)\n", pass ? "PASS" : "FAIL", name, actual, expected);
+    failures += pass ? ZERO : ONE;
+}
+
+static void task(uint8 taskId, uint32 deadline){
+    if(runCount < scheduler_MAX_TASKS){
+        runOrder[runCount] = taskId;
+    }
+    runCount++;
+    lastDeadline = deadline;
+}
+
+static uint32 nextDeadline(void){
+    uint32 deadline = ZERO;
+    return scheduler_getNextDeadline(&deadline) ? deadline : 0xFFFFFFFFu;
+}
+
+int main(void){
+    uint8 a;
+    uint8 b;
+    uint8 c;
+    scheduler_STATS_S stats;
+
+    /* A task that is not due yet does not run */
+    scheduler_start();
+    runCount = ZERO;
+    scheduler_addTask(task, 10u, 10u, &a);
+    check("Not due, dispatch runs nothing", scheduler_dispatch(), ZERO);
+    check("Not due, next deadline", nextDeadline(), 10u);
+    scheduler_advance(9u);
+    check("One tick early runs nothing", scheduler_dispatch(), ZERO);
+    scheduler_advance(ONE);
+    check("Due runs once", scheduler_dispatch(), ONE);
+    check("Due on its deadline", lastDeadline, 10u);
+    check("Rescheduled a period later", nextDeadline(), 20u);
+
+    /* Earliest deadline first, whatever the order they were added in */
+    scheduler_start();
+    runCount = ZERO;
+    scheduler_addTask(task, 30u, scheduler_ONE_SHOT, &a);
+    scheduler_addTask(task, 5u, scheduler_ONE_SHOT, &b);
+    scheduler_addTask(task, 20u, scheduler_ONE_SHOT, &c);
+    check("Head is the earliest", nextDeadline(), 5u);
+    scheduler_advance(30u);
+    check("All three run", scheduler_dispatch(), 3u);
+    check("First run", runOrder[0], b);
+    check("Second run", runOrder[1], c);
+    check("Third run", runOrder[2], a);
+    check("One-shots are not rescheduled", nextDeadline(), 0xFFFFFFFFu);
+
+    /* Missed periods are skipped, not run back to back */
+    scheduler_start();
+    runCount = ZERO;
+    scheduler_addTask(task, 10u, 10u, &a);
+    scheduler_advance(45u);
+    check("Late task runs once", scheduler_dispatch(), ONE);
+    check("Next deadline after now", nextDeadline(), 50u);
+    scheduler_getStats(a, &stats);
+    check("Skipped periods", stats.overruns, 3u);
+    check("Lateness", stats.maxLateness, 35u);
+
+    /* Across the wrap of the tick count */
+    scheduler_start();
+    runCount = ZERO;
+    scheduler_advance(0xFFFFFFF0u);
+    scheduler_addTask(task, 0x20u, 0x20u, &a);
+    scheduler_addTask(task, 0x08u, scheduler_ONE_SHOT, &b);
+    check("Wrap, head before the wrap", nextDeadline(), 0xFFFFFFF8u);
+    check("Wrap, nothing due", scheduler_dispatch(), ZERO);
+    scheduler_advance(0x10u);
+    check("Wrap, first task only", scheduler_dispatch(), ONE);
+    check("Wrap, first task", runOrder[0], b);
+    check("Wrap, head after the wrap", nextDeadline(), 0x10u);
+    scheduler_advance(0x10u);
+    check("Wrap, second task", scheduler_dispatch(), ONE);
+
+    printf("\n%u failure(s)\n", failures);
+    return (failures == ZERO) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,895 @@
+/***************************************************************************
+*                                       MICA
+* File: imuStream.c
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* PCB: MICA_IMU_v3.5.2
+* PSoC: CYBLE-214015-01 (EZBLE, 4.2, 256k)
+* Sensors: BOSCH IMU (BMX055)
+*
+* Brief:
+*   Timer driven acquisition of the BMX055. Each sensor is a periodic
+*   scheduler task that reads it every <period> ticks, and <decimation> reads
+*   are averaged into one timestamped sample. Samples are queued in a ring
+*   that is drained into notifications on the sensing data characteristic.
+*   The I2C reads happen in the main loop from scheduler_dispatch(). Reads
+*   the main loop was too late for are skipped by the scheduler and counted.
+*   Between reads the power manager can suspend the sensors, they are woken
+*   before the next read is due. The power statistics are notified on the
+*   same characteristic when the peer asks for them.
+*
+* Date Written:  2018.10.29
+* Last Modified: 2018.11.15
+********************************************************************************/
+#include "imuStream.h"
+#include <string.h>
+
+/* Defaults - 100 Hz acc & gyro, 20 Hz mag */
+#define imuStream_DEFAULT_PERIOD_ACC    (10u)
+#define imuStream_DEFAULT_PERIOD_GYR    (10u)
+#define imuStream_DEFAULT_PERIOD_MAG    (50u)
+#define imuStream_DEFAULT_DECIMATION    (1u)
+/* Largest notification the stack will accept */
+#define imuStream_LEN_NTF_MAX           (CYBLE_GATT_MTU - imuStream_LEN_ATT_HEADER)
+
+/* BMX055 power registers, written through the MICA_I2C register calls */
+#define imuStream_ACC_ADDR              (0x18u)
+#define imuStream_ACC_REG_PMU_LPW       (0x11u)
+#define imuStream_ACC_PM_NORMAL         (0x00u)
+#define imuStream_ACC_PM_SUSPEND        (0x80u)
+#define imuStream_GYR_ADDR              (0x68u)
+#define imuStream_GYR_REG_LPM1          (0x11u)
+#define imuStream_GYR_PM_NORMAL         (0x00u)
+#define imuStream_GYR_PM_SUSPEND        (0x80u)
+#define imuStream_MAG_ADDR              (0x10u)
+#define imuStream_MAG_REG_OPMODE        (0x4Cu)
+#define imuStream_MAG_OPMODE_MASK       (0x06u)     /* The data rate and self test bits are kept */
+#define imuStream_MAG_OPMODE_NORMAL     (0x00u)
+#define imuStream_MAG_OPMODE_SLEEP      (0x06u)
+
+/* Running sum of the reads making up the next sample */
+typedef struct {
+    int32 sum[imuStream_NUM_AXES];
+    uint8 count;
+} imuStream_ACCUM_S;
+
+static bool sensorsSuspended = false;
+static imuStream_SENSOR_CONFIG_S sensorConfig[imuStream_NUM_SENSORS];
+static imuStream_ACCUM_S sensorAccum[imuStream_NUM_SENSORS];
+/* Sample ring - only touched from the main loop */
+static imuStream_SAMPLE_S sampleRing[imuStream_RING_LEN];
+static uint16 ringHead = ZERO;
+static uint16 ringTail = ZERO;
+/* Scheduler task of each sensor, scheduler_NO_TASK when not reading */
+static uint8 sensorTask[imuStream_NUM_SENSORS];
+static uint32 startTick = ZERO;                 /* Tick that timestamps count from */
+static uint32 skippedBase = ZERO;               /* Skipped reads of tasks already cancelled */
+/* State */
+static bool running = false;
+static bool notifyEnabled = false;
+static bool powerStatsPending = false;
+static uint16 negotiatedMtu = imuStream_MTU_DEFAULT;
+static imuStream_STATS_S streamStats;
+static uint8 ntfBuffer[imuStream_LEN_NTF_MAX];
+
+static void updateRunState(void);
+static void scheduleSensor(uint8 sensorId);
+static void cancelSensor(uint8 sensorId);
+static void sensorTaskRun(uint8 taskId, uint32 deadline);
+static void readSensor(uint8 sensorId, int16 *axis);
+static void pushSample(uint8 sensorId, uint32 tick);
+static void drainRing(void);
+static bool sendPowerStats(void);
+static uint16 getPayloadMax(void);
+static uint32 setSensorPower(bool suspend);
+static bool writePowerReg(uint8 deviceAddr, uint8 reg, uint8 mask, uint8 value);
+
+/*******************************************************************************
+* Function Name: imuStream_init()
+********************************************************************************
+*
+* Summary:
+*   Starts the BMX055 and loads the default rates. The sensors are not read
+*   until the peer enables notifications. scheduler_start() must be called
+*   first.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_init(void){
+    /* Start the IMU */
+    BMX055_Start();
+    /* Default rates */
+    sensorConfig[imuStream_SENSOR_ACC].period = imuStream_DEFAULT_PERIOD_ACC;
+    sensorConfig[imuStream_SENSOR_GYR].period = imuStream_DEFAULT_PERIOD_GYR;
+    sensorConfig[imuStream_SENSOR_MAG].period = imuStream_DEFAULT_PERIOD_MAG;
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        sensorConfig[i].decimation = imuStream_DEFAULT_DECIMATION;
+        sensorTask[i] = scheduler_NO_TASK;
+    }
+    imuStream_resetStats();
+}
+
+/*******************************************************************************
+* Function Name: imuStream_start()
+********************************************************************************
+*
+* Summary:
+*   Clears any queued samples and schedules the enabled sensors. Timestamps
+*   restart from zero.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_start(void){
+    /* Clear the previous run */
+    memset(sensorAccum, ZERO, sizeof(sensorAccum));
+    ringHead = ZERO;
+    ringTail = ZERO;
+    startTick = scheduler_now();
+    running = true;
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        scheduleSensor(i);
+    }
+}
+
+/*******************************************************************************
+* Function Name: imuStream_stop()
+********************************************************************************
+*
+* Summary:
+*   Stops reading the sensors. Samples already queued can still be drained.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_stop(void){
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        cancelSensor(i);
+    }
+    running = false;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_isRunning()
+********************************************************************************
+*
+* Summary:
+*   Reports whether the sensors are being sampled
+*
+* Parameters:
+*   None
+*
+* Return:
+*   True if the sensors are being read
+*
+*******************************************************************************/
+bool imuStream_isRunning(void){
+    return running;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_setSensorConfig()
+********************************************************************************
+*
+* Summary:
+*   Sets the read period and decimation of a sensor. A partially averaged
+*   sample is discarded.
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*   config - Period in ticks (imuStream_PERIOD_DISABLED to turn off) and
+*       number of reads to average into each sample
+*
+* Return:
+*   imuStream_ERR_OK - Configuration applied
+*   imuStream_ERR_SENSOR - Unknown sensor
+*   imuStream_ERR_DECIMATION - Decimation of zero
+*
+*******************************************************************************/
+uint32 imuStream_setSensorConfig(uint8 sensorId, imuStream_SENSOR_CONFIG_S *config){
+    if(sensorId >= imuStream_NUM_SENSORS){
+        return imuStream_ERR_SENSOR;
+    }
+    if(config->decimation == ZERO){
+        return imuStream_ERR_DECIMATION;
+    }
+    sensorConfig[sensorId] = *config;
+    memset(&sensorAccum[sensorId], ZERO, sizeof(imuStream_ACCUM_S));
+    if(running){
+        scheduleSensor(sensorId);
+    }
+    updateRunState();
+    return imuStream_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_getSensorConfig()
+********************************************************************************
+*
+* Summary:
+*   Returns the read period and decimation of a sensor
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*   config [out] - Location to place the configuration
+*
+* Return:
+*   imuStream_ERR_OK - Configuration returned
+*   imuStream_ERR_SENSOR - Unknown sensor
+*
+*******************************************************************************/
+uint32 imuStream_getSensorConfig(uint8 sensorId, imuStream_SENSOR_CONFIG_S *config){
+    if(sensorId >= imuStream_NUM_SENSORS){
+        return imuStream_ERR_SENSOR;
+    }
+    *config = sensorConfig[sensorId];
+    return imuStream_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_setMtu()
+********************************************************************************
+*
+* Summary:
+*   Stores the negotiated MTU, which sets how many samples share a notification
+*
+* Parameters:
+*   mtu - Negotiated ATT MTU
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_setMtu(uint16 mtu){
+    negotiatedMtu = mtu;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_handleWrite()
+********************************************************************************
+*
+* Summary:
+*   Handles peer writes to the streaming characteristics. Enabling
+*   notifications on the data characteristic starts the stream. Writes to
+*   the sensing commands characteristic hold one or more records of
+*   [id][period MSB][period LSB][decimation]. Every record is checked before
+*   any is applied. A single byte write is an imuStream_CMD_<name> command.
+*   Writes to other attributes are ignored.
+*
+* Parameters:
+*   writeParam - Write request from the stack
+*
+* Return:
+*   CYBLE_GATT_ERR_NONE, or the error to send back to the peer
+*
+*******************************************************************************/
+CYBLE_GATT_ERR_CODE_T imuStream_handleWrite(CYBLE_GATTS_WRITE_REQ_PARAM_T *writeParam){
+    CYBLE_GATT_HANDLE_VALUE_PAIR_T *pair = &writeParam->handleValPair;
+    uint8 *val = pair->value.val;
+    uint16 len = pair->value.len;
+    /* Client configuration of the data characteristic */
+    if(pair->attrHandle == configBLE_STREAM_CCCD_HANDLE){
+        CYBLE_GATT_ERR_CODE_T gattErr = CyBle_GattsWriteAttributeValue(pair, ZERO, &writeParam->connHandle, CYBLE_GATT_DB_PEER_INITIATED);
+        if(gattErr == CYBLE_GATT_ERR_NONE){
+            notifyEnabled = (len > ZERO) && (val[ZERO] & CYBLE_CCCD_NOTIFICATION);
+            updateRunState();
+        }
+        return gattErr;
+    }
+    /* Sensor configuration */
+    if(pair->attrHandle == configBLE_STREAM_CONFIG_HANDLE){
+        /* Commands, answered from imuStream_process() */
+        if(len == imuStream_LEN_CMD){
+            switch(val[ZERO]){
+                case imuStream_CMD_POWER_STATS:
+                    powerStatsPending = true;
+                    break;
+                case imuStream_CMD_POWER_RESET:
+                    power_resetStats();
+                    break;
+                default:
+                    return CYBLE_GATT_ERR_OUT_OF_RANGE;
+            }
+            return CYBLE_GATT_ERR_NONE;
+        }
+        if((len == ZERO) || (len % imuStream_LEN_CONFIG_RECORD)){
+            return CYBLE_GATT_ERR_INVALID_ATTRIBUTE_LEN;
+        }
+        uint16 i;
+        /* Validate */
+        for(i = ZERO; i < len; i += imuStream_LEN_CONFIG_RECORD){
+            if((val[i + imuStream_INDEX_CONFIG_ID] >= imuStream_NUM_SENSORS) || (val[i + imuStream_INDEX_CONFIG_DECIMATION] == ZERO)){
+                return CYBLE_GATT_ERR_OUT_OF_RANGE;
+            }
+        }
+        /* Apply */
+        for(i = ZERO; i < len; i += imuStream_LEN_CONFIG_RECORD){
+            imuStream_SENSOR_CONFIG_S config;
+            config.period = (val[i + imuStream_INDEX_CONFIG_PERIOD_MSB] << BITS_ONE_BYTE) | val[i + imuStream_INDEX_CONFIG_PERIOD_LSB];
+            config.decimation = val[i + imuStream_INDEX_CONFIG_DECIMATION];
+            imuStream_setSensorConfig(val[i + imuStream_INDEX_CONFIG_ID], &config);
+        }
+        return CyBle_GattsWriteAttributeValue(pair, ZERO, &writeParam->connHandle, CYBLE_GATT_DB_PEER_INITIATED);
+    }
+    return CYBLE_GATT_ERR_NONE;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_handleDisconnect()
+********************************************************************************
+*
+* Summary:
+*   Stops the stream and returns the link settings to their defaults
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_handleDisconnect(void){
+    notifyEnabled = false;
+    powerStatsPending = false;
+    negotiatedMtu = imuStream_MTU_DEFAULT;
+    updateRunState();
+}
+
+/*******************************************************************************
+* Function Name: imuStream_popSample()
+********************************************************************************
+*
+* Summary:
+*   Removes the oldest sample from the ring, for consumers other than BLE
+*
+* Parameters:
+*   sample [out] - Location to place the sample
+*
+* Return:
+*   imuStream_ERR_OK - Sample returned
+*   imuStream_ERR_EMPTY - No samples waiting
+*
+*******************************************************************************/
+uint32 imuStream_popSample(imuStream_SAMPLE_S *sample){
+    if(ringHead == ringTail){
+        return imuStream_ERR_EMPTY;
+    }
+    *sample = sampleRing[ringTail];
+    ringTail = (ringTail + ONE) & imuStream_RING_MASK;
+    return imuStream_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: imuStream_process()
+********************************************************************************
+*
+* Summary:
+*   Sends the power statistics if the peer asked for them, then as many
+*   queued samples as the stack will accept. Call from the main loop, the
+*   sensors themselves are read by scheduler_dispatch().
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_process(void){
+    if(powerStatsPending && notifyEnabled && sendPowerStats()){
+        powerStatsPending = false;
+    }
+    drainRing();
+}
+
+/*******************************************************************************
+* Function Name: imuStream_getStats()
+********************************************************************************
+*
+* Summary:
+*   Returns a snapshot of the streaming statistics
+*
+* Parameters:
+*   stats [out] - Location to place the statistics
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_getStats(imuStream_STATS_S *stats){
+    *stats = streamStats;
+    /* Reads skipped are the overruns of the sensor tasks */
+    stats->ticksSkipped = skippedBase;
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        scheduler_STATS_S taskStats;
+        if(scheduler_getStats(sensorTask[i], &taskStats) == scheduler_ERR_OK){
+            stats->ticksSkipped += taskStats.overruns;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: imuStream_resetStats()
+********************************************************************************
+*
+* Summary:
+*   Clears the streaming statistics
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void imuStream_resetStats(void){
+    memset(&streamStats, ZERO, sizeof(streamStats));
+    skippedBase = ZERO;
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        scheduler_resetStats(sensorTask[i]);
+    }
+}
+
+/*******************************************************************************
+* Function Name: imuStream_suspendSensors()
+********************************************************************************
+*
+* Summary:
+*   Puts the accelerometer and gyroscope into suspend and the magnetometer
+*   into sleep. These modes keep the sensor configuration, so the sensors can
+*   be resumed without being set up again.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   imuStream_ERR_OK - Sensors suspended, or already suspended
+*   imuStream_ERR_POWER - A sensor did not accept the power mode
+*
+*******************************************************************************/
+uint32 imuStream_suspendSensors(void){
+    if(sensorsSuspended){
+        return imuStream_ERR_OK;
+    }
+    sensorsSuspended = true;
+    return setSensorPower(true);
+}
+
+/*******************************************************************************
+* Function Name: imuStream_resumeSensors()
+********************************************************************************
+*
+* Summary:
+*   Returns the sensors to normal mode. The gyroscope is the slowest to start,
+*   see imuStream_WAKE_TICKS.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   imuStream_ERR_OK - Sensors resumed, or already running
+*   imuStream_ERR_POWER - A sensor did not accept the power mode
+*
+*******************************************************************************/
+uint32 imuStream_resumeSensors(void){
+    if(!sensorsSuspended){
+        return imuStream_ERR_OK;
+    }
+    sensorsSuspended = false;
+    return setSensorPower(false);
+}
+
+/*******************************************************************************
+* Function Name: imuStream_isSuspended()
+********************************************************************************
+*
+* Summary:
+*   Reports if the sensors are suspended
+*
+* Parameters:
+*   None
+*
+* Return:
+*   True if imuStream_suspendSensors() was called without a resume since
+*
+*******************************************************************************/
+bool imuStream_isSuspended(void){
+    return sensorsSuspended;
+}
+
+/*******************************************************************************
+* Function Name: updateRunState()
+********************************************************************************
+*
+* Summary:
+*   Reads the sensors only while notifications are enabled and at least one
+*   sensor is turned on
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void updateRunState(void){
+    bool anyEnabled = false;
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        if(sensorConfig[i].period != imuStream_PERIOD_DISABLED){
+            anyEnabled = true;
+        }
+    }
+    bool shouldRun = notifyEnabled && anyEnabled;
+    if(shouldRun && !running){
+        imuStream_start();
+    } else if(!shouldRun && running){
+        imuStream_stop();
+    }
+}
+
+/*******************************************************************************
+* Function Name: scheduleSensor()
+********************************************************************************
+*
+* Summary:
+*   Replaces the task of a sensor with one at its configured period. Reads
+*   stay on multiples of the period from the start of the stream.
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void scheduleSensor(uint8 sensorId){
+    cancelSensor(sensorId);
+    uint16 period = sensorConfig[sensorId].period;
+    if(period == imuStream_PERIOD_DISABLED){
+        return;
+    }
+    uint32 elapsed = scheduler_now() - startTick;
+    uint32 delay = period - (elapsed % period);
+    scheduler_addTask(sensorTaskRun, delay, period, &sensorTask[sensorId]);
+}
+
+/*******************************************************************************
+* Function Name: cancelSensor()
+********************************************************************************
+*
+* Summary:
+*   Stops reading a sensor, keeping the reads its task skipped
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void cancelSensor(uint8 sensorId){
+    scheduler_STATS_S taskStats;
+    if(scheduler_getStats(sensorTask[sensorId], &taskStats) == scheduler_ERR_OK){
+        skippedBase += taskStats.overruns;
+    }
+    scheduler_cancelTask(sensorTask[sensorId]);
+    sensorTask[sensorId] = scheduler_NO_TASK;
+}
+
+/*******************************************************************************
+* Function Name: sensorTaskRun()
+********************************************************************************
+*
+* Summary:
+*   Scheduler task that reads the sensor it belongs to
+*
+* Parameters:
+*   taskId - Task being run
+*   deadline - Tick the read was due on
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void sensorTaskRun(uint8 taskId, uint32 deadline){
+    uint8 i;
+    /* Late wake, the power manager normally resumes the sensors first */
+    if(sensorsSuspended){
+        imuStream_resumeSensors();
+    }
+    for(i = ZERO; i < imuStream_NUM_SENSORS; i++){
+        if(sensorTask[i] == taskId){
+            pushSample(i, deadline - startTick);
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: readSensor()
+********************************************************************************
+*
+* Summary:
+*   Reads the three axes of a sensor
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*   axis [out] - Location to place the X, Y and Z values
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void readSensor(uint8 sensorId, int16 *axis){
+    uint16 data[BMX055_CHANNEL_INDEX_DATA + imuStream_NUM_AXES];
+    uint8 channels = BMX055_CHANNEL_MASK_X | BMX055_CHANNEL_MASK_Y | BMX055_CHANNEL_MASK_Z;
+    switch(sensorId){
+        case imuStream_SENSOR_ACC:
+            BMX055_Acc_Read(data, channels);
+            break;
+        case imuStream_SENSOR_GYR:
+            BMX055_Gyr_Read(data, channels);
+            break;
+        default:
+            BMX055_Mag_Read(data, channels);
+            break;
+    }
+    axis[ZERO] = (int16) data[BMX055_CHANNEL_INDEX_DATA + BMX055_CHANNEL_INDEX_X];
+    axis[ONE] = (int16) data[BMX055_CHANNEL_INDEX_DATA + BMX055_CHANNEL_INDEX_Y];
+    axis[TWO] = (int16) data[BMX055_CHANNEL_INDEX_DATA + BMX055_CHANNEL_INDEX_Z];
+}
+
+/*******************************************************************************
+* Function Name: pushSample()
+********************************************************************************
+*
+* Summary:
+*   Reads a sensor into its running sum. Once <decimation> reads have been
+*   taken the average is queued, timestamped with the last read.
+*
+* Parameters:
+*   sensorId - imuStream_SENSOR_<name>
+*   tick - Tick the read belongs to
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void pushSample(uint8 sensorId, uint32 tick){
+    imuStream_ACCUM_S *accum = &sensorAccum[sensorId];
+    int16 axis[imuStream_NUM_AXES];
+    readSensor(sensorId, axis);
+    uint8 i;
+    for(i = ZERO; i < imuStream_NUM_AXES; i++){
+        accum->sum[i] += axis[i];
+    }
+    accum->count++;
+    if(accum->count < sensorConfig[sensorId].decimation){
+        return;
+    }
+    /* Queue the average */
+    uint16 next = (ringHead + ONE) & imuStream_RING_MASK;
+    if(next == ringTail){
+        streamStats.samplesDropped++;
+    } else {
+        imuStream_SAMPLE_S *sample = &sampleRing[ringHead];
+        sample->sensorId = sensorId;
+        sample->timestamp = tick * imuStream_TICK_US;
+        for(i = ZERO; i < imuStream_NUM_AXES; i++){
+            sample->axis[i] = (int16) (accum->sum[i] / accum->count);
+        }
+        ringHead = next;
+        streamStats.samplesQueued++;
+        uint16 pending = (ringHead - ringTail) & imuStream_RING_MASK;
+        if(pending > streamStats.highWater){
+            streamStats.highWater = pending;
+        }
+    }
+    memset(accum, ZERO, sizeof(imuStream_ACCUM_S));
+}
+
+/*******************************************************************************
+* Function Name: drainRing()
+********************************************************************************
+*
+* Summary:
+*   Packs as many queued samples as fit the MTU into each notification, and
+*   sends until the ring is empty or the stack is busy. Samples are only
+*   removed once the stack accepts them.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void drainRing(void){
+    if(!notifyEnabled){
+        return;
+    }
+    uint16 payloadMax = getPayloadMax();
+    while((ringHead != ringTail) && (CyBle_GattGetBusyStatus() == CYBLE_STACK_STATE_FREE)){
+        /* Pack samples without removing them */
+        uint16 len = ZERO;
+        uint16 index = ringTail;
+        uint16 count = ZERO;
+        while((index != ringHead) && ((len + imuStream_LEN_RECORD) <= payloadMax)){
+            imuStream_SAMPLE_S *sample = &sampleRing[index];
+            ntfBuffer[len++] = sample->sensorId;
+            /* Timestamp, MSB first */
+            uint8 i;
+            for(i = imuStream_LEN_TIMESTAMP; i > ZERO; i--){
+                ntfBuffer[len++] = (uint8) (sample->timestamp >> ((i - ONE) * BITS_ONE_BYTE));
+            }
+            for(i = ZERO; i < imuStream_NUM_AXES; i++){
+                ntfBuffer[len++] = (uint8) ((uint16) sample->axis[i] >> BITS_ONE_BYTE);
+                ntfBuffer[len++] = (uint8) (sample->axis[i]);
+            }
+            index = (index + ONE) & imuStream_RING_MASK;
+            count++;
+        }
+        /* Send */
+        CYBLE_GATTS_HANDLE_VALUE_NTF_T notification;
+        notification.attrHandle = configBLE_STREAM_DATA_HANDLE;
+        notification.value.val = ntfBuffer;
+        notification.value.len = len;
+        if(CyBle_GattsNotification(cyBle_connHandle, &notification) != CYBLE_ERROR_OK){
+            break;
+        }
+        ringTail = index;
+        streamStats.samplesSent += count;
+    }
+}
+
+/*******************************************************************************
+* Function Name: sendPowerStats()
+********************************************************************************
+*
+* Summary:
+*   Notifies the power statistics as imuStream_LEN_POWER_RECORD records,
+*   packed as many to a notification as fit the MTU
+*
+* Parameters:
+*   None
+*
+* Return:
+*   True if every record was sent. Otherwise the stack was busy and all of
+*   them are sent again on a later call.
+*
+*******************************************************************************/
+static bool sendPowerStats(void){
+    power_STATS_S stats;
+    power_getStats(&stats);
+    uint32 values[imuStream_NUM_POWER_FIELDS];
+    memcpy(values, stats.stateMs, sizeof(stats.stateMs));
+    values[imuStream_POWER_FIELD_DEEP_SLEEPS] = stats.deepSleeps;
+    values[imuStream_POWER_FIELD_SUSPENDS] = stats.sensorSuspends;
+    uint16 payloadMax = getPayloadMax();
+    uint8 field = ZERO;
+    while(field < imuStream_NUM_POWER_FIELDS){
+        if(CyBle_GattGetBusyStatus() != CYBLE_STACK_STATE_FREE){
+            return false;
+        }
+        uint16 len = ZERO;
+        while((field < imuStream_NUM_POWER_FIELDS) && ((len + imuStream_LEN_POWER_RECORD) <= payloadMax)){
+            ntfBuffer[len++] = imuStream_ID_POWER;
+            ntfBuffer[len++] = field;
+            /* Value, MSB first */
+            uint8 i;
+            for(i = sizeof(uint32); i > ZERO; i--){
+                ntfBuffer[len++] = (uint8) (values[field] >> ((i - ONE) * BITS_ONE_BYTE));
+            }
+            field++;
+        }
+        CYBLE_GATTS_HANDLE_VALUE_NTF_T notification;
+        notification.attrHandle = configBLE_STREAM_DATA_HANDLE;
+        notification.value.val = ntfBuffer;
+        notification.value.len = len;
+        if(CyBle_GattsNotification(cyBle_connHandle, &notification) != CYBLE_ERROR_OK){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: getPayloadMax()
+********************************************************************************
+*
+* Summary:
+*   Largest notification payload for the negotiated MTU
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Payload length [bytes]
+*
+*******************************************************************************/
+static uint16 getPayloadMax(void){
+    uint16 payloadMax = negotiatedMtu - imuStream_LEN_ATT_HEADER;
+    if(payloadMax > imuStream_LEN_NTF_MAX){
+        payloadMax = imuStream_LEN_NTF_MAX;
+    }
+    return payloadMax;
+}
+
+/*******************************************************************************
+* Function Name: setSensorPower()
+********************************************************************************
+*
+* Summary:
+*   Sets the power mode of all three sensors
+*
+* Parameters:
+*   suspend - True for the low power modes, false for normal mode
+*
+* Return:
+*   imuStream_ERR_OK - All sensors changed
+*   imuStream_ERR_POWER - A sensor did not accept the power mode
+*
+*******************************************************************************/
+static uint32 setSensorPower(bool suspend){
+    bool ok = true;
+    /* Try every sensor even if one fails */
+    ok &= writePowerReg(imuStream_ACC_ADDR, imuStream_ACC_REG_PMU_LPW, MASK_BYTE_ONE,
+        suspend ? imuStream_ACC_PM_SUSPEND : imuStream_ACC_PM_NORMAL);
+    ok &= writePowerReg(imuStream_GYR_ADDR, imuStream_GYR_REG_LPM1, MASK_BYTE_ONE,
+        suspend ? imuStream_GYR_PM_SUSPEND : imuStream_GYR_PM_NORMAL);
+    ok &= writePowerReg(imuStream_MAG_ADDR, imuStream_MAG_REG_OPMODE, imuStream_MAG_OPMODE_MASK,
+        suspend ? imuStream_MAG_OPMODE_SLEEP : imuStream_MAG_OPMODE_NORMAL);
+    return ok ? imuStream_ERR_OK : imuStream_ERR_POWER;
+}
+
+/*******************************************************************************
+* Function Name: writePowerReg()
+********************************************************************************
+*
+* Summary:
+*   Writes the masked bits of a power register and reads it back. The
+*   register calls do not report bus errors, so the read back is the check
+*   that the sensor took the mode.
+*
+* Parameters:
+*   deviceAddr - 7-bit I2C address of the sensor
+*   reg - Power register
+*   mask - Bits of the register to change
+*   value - New value of the masked bits
+*
+* Return:
+*   True if the register holds the new value
+*
+*******************************************************************************/
+static bool writePowerReg(uint8 deviceAddr, uint8 reg, uint8 mask, uint8 value){
+    uint8 regValue = value;
+    if(mask != MASK_BYTE_ONE){
+        regValue = (readI2CReg(deviceAddr, reg) & ~mask) | value;
+    }
+    writeI2CReg(deviceAddr, reg, regValue);
+    return (readI2CReg(deviceAddr, reg) & mask) == value;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,125 @@
+/***************************************************************************
+*                                       MICA
+* File: imuStream.h
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* PCB: MICA_IMU_v3.5.2
+* PSoC: CYBLE-214015-01 (EZBLE, 4.2, 256k)
+* Sensors: BOSCH IMU (BMX055)
+*
+* Brief:
+*   Header for imuStream.c
+*
+* Date Written:  2018.10.29
+* Last Modified: 2018.11.13
+********************************************************************************/
+/* Header Guard */
+#ifndef IMU_STREAM_H
+    #define IMU_STREAM_H
+
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "configMica.h"
+    #include "scheduler.h"
+    #include "powerManagement.h"
+    /***************************************
+    * Macro definitions
+    ***************************************/
+    /* Sensor periods are in scheduler ticks */
+    #define imuStream_TICK_US                   (scheduler_TICK_US)
+    /* Sensors */
+    #define imuStream_SENSOR_ACC                (0u)
+    #define imuStream_SENSOR_GYR                (1u)
+    #define imuStream_SENSOR_MAG                (2u)
+    #define imuStream_NUM_SENSORS               (3u)
+    #define imuStream_NUM_AXES                  (3u)
+    /* Sample ring */
+    #define imuStream_RING_LEN                  (64u)       /**< Must be a power of 2 */
+    #define imuStream_RING_MASK                 (imuStream_RING_LEN - 1u)
+    /* Sample record sent over the air: [id][timestamp x4][x x2][y x2][z x2] */
+    #define imuStream_LEN_RECORD                (11u)
+    #define imuStream_LEN_TIMESTAMP             (4u)
+    /* Configuration written to the sensing commands characteristic:
+    * one or more records of [id][period MSB][period LSB][decimation] */
+    #define imuStream_LEN_CONFIG_RECORD         (4u)
+    #define imuStream_INDEX_CONFIG_ID           (0u)
+    #define imuStream_INDEX_CONFIG_PERIOD_MSB   (1u)
+    #define imuStream_INDEX_CONFIG_PERIOD_LSB   (2u)
+    #define imuStream_INDEX_CONFIG_DECIMATION   (3u)
+    #define imuStream_PERIOD_DISABLED           (0u)        /**< Period that turns a sensor off */
+    /* Single byte commands written to the sensing commands characteristic */
+    #define imuStream_LEN_CMD                   (1u)
+    #define imuStream_CMD_POWER_STATS           (0xFFu)     /**< Notify the power statistics */
+    #define imuStream_CMD_POWER_RESET           (0xFEu)     /**< Clear the power statistics */
+    /* Power statistics record sent over the air: [id][field][value x4]. Fields
+    * below power_NUM_STATES are the ms spent in that APP_POWER_STATE_T */
+    #define imuStream_ID_POWER                  (0xFFu)
+    #define imuStream_LEN_POWER_RECORD          (6u)
+    #define imuStream_POWER_FIELD_DEEP_SLEEPS   (power_NUM_STATES)
+    #define imuStream_POWER_FIELD_SUSPENDS      (power_NUM_STATES + 1u)
+    #define imuStream_NUM_POWER_FIELDS          (power_NUM_STATES + 2u)
+    /* Notifications */
+    #define imuStream_MTU_DEFAULT               (23u)
+    #define imuStream_LEN_ATT_HEADER            (3u)        /**< Opcode and handle of a notification */
+    /* Error codes */
+    #define imuStream_ERR_OK                    (0u)
+    #define imuStream_ERR_SENSOR                (1u)        /**< Unknown sensor ID */
+    #define imuStream_ERR_DECIMATION            (2u)        /**< Decimation must be at least 1 */
+    #define imuStream_ERR_EMPTY                 (3u)        /**< No samples waiting */
+    #define imuStream_ERR_POWER                 (4u)        /**< A sensor rejected a power mode */
+    /* Time from imuStream_resumeSensors() until the sensors give valid data,
+    * set by the gyroscope leaving suspend [ticks] */
+    #define imuStream_WAKE_TICKS                ((30000u + imuStream_TICK_US - 1u) / imuStream_TICK_US)
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Acquisition settings of a single sensor */
+    typedef struct {
+        uint16 period;          /**< Ticks between reads, imuStream_PERIOD_DISABLED when off */
+        uint8 decimation;       /**< Reads averaged into each streamed sample */
+    } imuStream_SENSOR_CONFIG_S;
+
+    /* Timestamped sample */
+    typedef struct {
+        uint32 timestamp;                       /**< Time of the last read [us] */
+        int16 axis[imuStream_NUM_AXES];         /**< X, Y, Z */
+        uint8 sensorId;                         /**< imuStream_SENSOR_<name> */
+    } imuStream_SAMPLE_S;
+
+    /* Streaming statistics */
+    typedef struct {
+        uint32 samplesQueued;       /**< Samples placed into the ring */
+        uint32 samplesSent;         /**< Samples notified to the peer */
+        uint32 samplesDropped;      /**< Samples lost because the ring was full */
+        uint32 ticksSkipped;        /**< Reads skipped because the main loop fell behind */
+        uint16 highWater;           /**< Maximum number of samples held in the ring */
+    } imuStream_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void imuStream_init(void);
+    void imuStream_start(void);
+    void imuStream_stop(void);
+    bool imuStream_isRunning(void);
+    uint32 imuStream_setSensorConfig(uint8 sensorId, imuStream_SENSOR_CONFIG_S *config);
+    uint32 imuStream_getSensorConfig(uint8 sensorId, imuStream_SENSOR_CONFIG_S *config);
+    void imuStream_setMtu(uint16 mtu);
+    CYBLE_GATT_ERR_CODE_T imuStream_handleWrite(CYBLE_GATTS_WRITE_REQ_PARAM_T *writeParam);
+    void imuStream_handleDisconnect(void);
+    uint32 imuStream_popSample(imuStream_SAMPLE_S *sample);
+    void imuStream_process(void);
+    void imuStream_getStats(imuStream_STATS_S *stats);
+    void imuStream_resetStats(void);
+    uint32 imuStream_suspendSensors(void);
+    uint32 imuStream_resumeSensors(void);
+    bool imuStream_isSuspended(void);
+
+#endif /* IMU_STREAM_H */
+/* [] END OF FILE */
@@ -45,6 +45,8 @@
 #include "project.h"
 #include "bleImu.h"
 #include "powerManagement.h"
+#include "imuStream.h"
+#include "scheduler.h"
 
 /* Private function declaration */
 static void initializeDevice(void);
@@ -132,10 +134,17 @@ int main(void) {
 #endif /* MICA_DEBUG */
     /* %%%%%%%%%%%%%%%%%% End Debugging %%%%%%%%%%%%%%%%%% */
 
+    /* Start the watchdog and deep sleep wakeup timer */
+    power_start();
     /* Infinite loop */
     for(;;){
         /* Mandatory - Process BLE events */
         imuBle_processEvents();   
+        /* Run the tasks that are due, then send queued samples */
+        scheduler_dispatch();
+        imuStream_process();
+        /* Sleep until the next task, BLE event or wakeup timer */
+        power_processSystemState();
     }
 }
 
@@ -218,6 +227,10 @@ void initializeDevice(void){
 
     /* Initialize the BLE component */
     imuBle_init();
+    /* Start the tick that the sampling engine is scheduled from */
+    scheduler_start();
+    /* Initialize the sampling engine - starts when notifications are enabled */
+    imuStream_init();
     
 //    /* Initialize the TIMER ISR */
 //    micaTimer_Init();
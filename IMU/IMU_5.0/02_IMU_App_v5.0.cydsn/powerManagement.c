@@ -11,13 +11,71 @@
 * Sensors: MMA8635 (Accelerometer)
 *
 * Brief:
-* Controls all of the power management states
+* Controls all of the power management states. Between scheduler deadlines the
+* device deep sleeps, woken by WDT counter 0 or the BLESS. The scheduler tick
+* stops in deep sleep, so it is moved forward by the time WDT C0 measured.
+* The BMX055 is suspended when the next read is further off than it takes to
+* wake. WDT counter 1 resets the device if the main loop stops.
 * 
+* 2018.11.13 CC - Tickless deep sleep between scheduler deadlines
 * 2018.02.16 CC - Document created
 ********************************************************************************/
 #include "powerManagement.h"
+#include "imuStream.h"
+#include <string.h>
 /* State of the Application */
 volatile APP_POWER_STATE_T appPowerState = STATE_ACTIVE;
+static bool powerStarted = false;
+static uint16 connInterval = power_NOT_CONNECTED;   /* BLE connection interval [1.25 ms] */
+static uint32 lastFeed = ZERO;                      /* Tick the watchdog was last fed on */
+/* Time accounting in WDT C0 (LFCLK) counts */
+static uint16 lastCount = ZERO;                     /* Count time was last charged at */
+static uint64 stateCounts[power_NUM_STATES];
+static uint32 tickRemainder = ZERO;                 /* Deep sleep not yet added to the scheduler [counts * ticks/s] */
+static uint32 deepSleeps = ZERO;
+static uint32 sensorSuspends = ZERO;
+
+static uint32 chargeTime(void);
+static uint32 getIdleTicks(bool *scheduled);
+static void deepSleep(uint32 ticks);
+static CY_ISR_PROTO(ISR_wdt);
+
+/*******************************************************************************
+* Function Name: power_start()
+********************************************************************************
+* Summary:
+*  Starts the WDT. Counter 0 free runs as the deep sleep wakeup timer and time
+*  base, counter 1 resets the device unless power_processSystemState() is
+*  called. Call once the main loop is about to start.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void power_start(void){
+    /* C0 - interrupts on match, never cleared so it keeps time */
+    CySysWdtWriteMode(CY_SYS_WDT_COUNTER0, CY_SYS_WDT_MODE_INT);
+    CySysWdtWriteClearOnMatch(CY_SYS_WDT_COUNTER0, ZERO);
+    CySysWdtWriteMatch(CY_SYS_WDT_COUNTER0, power_WDT_COUNT_MASK);
+    /* C1 - resets the device on match */
+    CySysWdtWriteMode(CY_SYS_WDT_COUNTER1, CY_SYS_WDT_MODE_RESET);
+    CySysWdtWriteMatch(CY_SYS_WDT_COUNTER1, power_WDT_RESET_MATCH);
+    CySysWdtWriteCascade(CY_SYS_WDT_CASCADE_NONE);
+    /* Assign the wakeup interrupt */
+    CyIntSetVector(power_WDT_IRQN, ISR_wdt);
+    CyIntEnable(power_WDT_IRQN);
+    /* Enable the WDT */
+    CySysWdtEnable(CY_SYS_WDT_COUNTER0_MASK | CY_SYS_WDT_COUNTER1_MASK);
+    CySysWdtResetCounters(CY_SYS_WDT_COUNTER1_RESET);
+    lastFeed = scheduler_now();
+    lastCount = (uint16) CySysWdtReadCount(CY_SYS_WDT_COUNTER0);
+    appPowerState = STATE_ACTIVE;
+    powerStarted = true;
+    power_resetStats();
+}
 
 /*******************************************************************************
 * Function Name: power_getSystemState()
@@ -50,6 +108,8 @@ APP_POWER_STATE_T power_getSystemState(void){
 *
 *******************************************************************************/
 APP_POWER_STATE_T power_setSystemState(APP_POWER_STATE_T nextState){
+    /* Charge the time up to now to the current state */
+    chargeTime();
     /* Switch on the current state */
     switch(appPowerState) {
         /* DEEPSLEEP valid next states: WAKEUP  */
@@ -66,23 +126,30 @@ APP_POWER_STATE_T power_setSystemState(APP_POWER_STATE_T nextState){
             }
             break;
         }
-        /* ACTIVE valid next states: PREP_SLEEP*/
+        /* ACTIVE valid next states: PREP_SLEEP, SLEEP */
         case STATE_ACTIVE:{
-            if(nextState == STATE_PREP_SLEEP){
+            if((nextState == STATE_PREP_SLEEP) || (nextState == STATE_SLEEP)){
+                appPowerState = nextState;   
+            }
+            break;
+        }
+        /* SLEEP valid next states: ACTIVE */
+        case STATE_SLEEP:{
+            if(nextState == STATE_ACTIVE){
                 appPowerState = nextState;   
             }
             break;
         }
-        /* PREP_SLEEP valid next states: WAIT_FOR_SLEEP */
+        /* PREP_SLEEP valid next states: WAIT_FOR_SLEEP, WAKEUP */
         case STATE_PREP_SLEEP:{
-            if(nextState == STATE_WAIT_FOR_SLEEP){
+            if((nextState == STATE_WAIT_FOR_SLEEP) || (nextState == STATE_WAKEUP)){
                 appPowerState = nextState;   
             }
             break;
         }
-        /* WAIT_FOR_SLEEP valid next states: SLEEP */
+        /* WAIT_FOR_SLEEP valid next states: DEEPSLEEP, WAKEUP */
         case STATE_WAIT_FOR_SLEEP:{
-            if(nextState == STATE_DEEPSLEEP){
+            if((nextState == STATE_DEEPSLEEP) || (nextState == STATE_WAKEUP)){
                 appPowerState = nextState;   
             }
             break;
@@ -97,9 +164,12 @@ APP_POWER_STATE_T power_setSystemState(APP_POWER_STATE_T nextState){
 * Function Name: power_processSystemState()
 ********************************************************************************
 * Summary:
-*   handles the usb events. System is woken up the wakeup flag, and put to sleep
-*   by the sleep flag. These need to be seperate as the HFCLK (which controls
-*   the debouncer) is turned off in deep sleep
+*   Advances the power state machine by one step, call once per pass of the
+*   main loop. Feeds the watchdog and wakes the sensors ahead of the next read.
+*   When the next read and the next BLE connection event are both at least
+*   power_DEEPSLEEP_MIN_TICKS away the device goes through PREP_SLEEP and
+*   WAIT_FOR_SLEEP into deep sleep, otherwise the CPU sleeps until the next
+*   interrupt.
 *
 * Parameters:
 *   None
@@ -109,33 +179,256 @@ APP_POWER_STATE_T power_setSystemState(APP_POWER_STATE_T nextState){
 *
 *******************************************************************************/
 void power_processSystemState(void) {
-    /* Disable interrupts */
-    uint8 interrupts = CyEnterCriticalSection();
+    bool scheduled;
+    uint32 idle = getIdleTicks(&scheduled);
+    /* Feed the watchdog */
+    uint32 now = scheduler_now();
+    if((now - lastFeed) >= power_FEED_TICKS){
+        CySysWdtResetCounters(CY_SYS_WDT_COUNTER1_RESET);
+        lastFeed = now;
+    }
+    chargeTime();
+    /* Wake the sensors in time for the next read */
+    if(scheduled && imuStream_isSuspended() && (idle <= (imuStream_WAKE_TICKS + power_WAKE_MARGIN_TICKS))){
+        imuStream_resumeSensors();
+    }
+    /* The BLESS wakes the device itself, but deep sleep is not worth it between close events */
+    uint32 wakeIdle = idle;
+    if(connInterval != power_NOT_CONNECTED){
+        uint32 bleTicks = ((uint32) connInterval * power_CONN_INTV_US) / scheduler_TICK_US;
+        if(bleTicks < wakeIdle){
+            wakeIdle = bleTicks;
+        }
+    }
+    bool deepSleepOk = (wakeIdle >= power_DEEPSLEEP_MIN_TICKS);
     /* Get the current state */
     APP_POWER_STATE_T currentState = power_getSystemState();
-    /* handle wakeup */
-    if(currentState == STATE_WAKEUP ) {
-        /* Wakeup from Sleep */
-        // TODO: wake up blocks
-        /* Set active */
-        power_setSystemState(STATE_ACTIVE);
-    } else if (currentState == STATE_PREP_SLEEP) {
-        /* Put Device to sleep  */
-        // TODO: put blocks to sleep
-        /* Advance to next state */
-        power_setSystemState(STATE_WAIT_FOR_SLEEP);
-    } else if (currentState == STATE_WAIT_FOR_SLEEP) {
-        /* Get the state of the BLE Sub-System (BLESS) */
-        CYBLE_BLESS_STATE_T bleState = CyBle_GetBleSsState();
-        if(bleState == CYBLE_BLESS_STATE_DEEPSLEEP) {
-            /* State to wakeup in */
-            power_setSystemState(STATE_DEEPSLEEP);
-            /* Put to sleep */
-            CySysPmDeepSleep();
-            /* RESUME HERE on wakeup */
+    switch(currentState){
+        case STATE_ACTIVE:{
+            if(deepSleepOk){
+                power_setSystemState(STATE_PREP_SLEEP);
+            } else if(idle != ZERO){
+                /* Too short to deep sleep, wait for the next tick or BLE interrupt */
+                power_setSystemState(STATE_SLEEP);
+                scheduler_sleep();
+                power_setSystemState(STATE_ACTIVE);
+            }
+            break;
+        }
+        case STATE_PREP_SLEEP:{
+            if(!deepSleepOk){
+                power_setSystemState(STATE_WAKEUP);
+                break;
+            }
+            /* Put blocks to sleep - the sensors only if there is time to wake them again */
+            if(!imuStream_isSuspended() && (!scheduled || (idle > (imuStream_WAKE_TICKS + power_WAKE_MARGIN_TICKS)))){
+                if(imuStream_suspendSensors() == imuStream_ERR_OK){
+                    sensorSuspends++;
+                }
+            }
+            /* Advance to next state */
+            power_setSystemState(STATE_WAIT_FOR_SLEEP);
+            break;
         }
+        case STATE_WAIT_FOR_SLEEP:{
+            if(!deepSleepOk){
+                power_setSystemState(STATE_WAKEUP);
+                break;
+            }
+            CYBLE_LP_MODE_T bleMode = CyBle_EnterLPM(CYBLE_BLESS_DEEPSLEEP);
+            /* Disable interrupts */
+            uint8 interrupts = CyEnterCriticalSection();
+            /* Get the state of the BLE Sub-System (BLESS) */
+            CYBLE_BLESS_STATE_T bleState = CyBle_GetBleSsState();
+            /* Wake early enough for the clocks, and the sensors if they are still
+            * suspended, e.g. imuStream_resumeSensors() failed above */
+            uint32 lead = power_WAKE_MARGIN_TICKS;
+            if(scheduled && imuStream_isSuspended()){
+                lead += imuStream_WAKE_TICKS;
+            }
+            if((bleMode == CYBLE_BLESS_DEEPSLEEP) && (idle > lead) &&
+                ((bleState == CYBLE_BLESS_STATE_ECO_ON) || (bleState == CYBLE_BLESS_STATE_DEEPSLEEP))){
+                deepSleep(idle - lead);
+            } else if(bleState != CYBLE_BLESS_STATE_EVENT_CLOSE){
+                /* The BLESS is busy or the read is too close, wait with the CPU asleep */
+                CySysPmSleep();
+            }
+            /* Enable interrupts */
+            CyExitCriticalSection(interrupts);
+            break;
+        }
+        case STATE_WAKEUP:{
+            /* Wake up blocks - the sensors are resumed above once a read is close */
+            power_setSystemState(STATE_ACTIVE);
+            break;
+        }
+        default:
+            break;
     }
-    /* Enable interrupts */
-    CyExitCriticalSection(interrupts);
 }
+
+/*******************************************************************************
+* Function Name: power_setConnectionInterval()
+********************************************************************************
+* Summary:
+*   Records the BLE connection interval, which limits how long the device can
+*   deep sleep between connection events
+*
+* Parameters:
+*   connIntv - Connection interval [1.25 ms], power_NOT_CONNECTED when the
+*       link is down
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void power_setConnectionInterval(uint16 connIntv){
+    connInterval = connIntv;
+}
+
+/*******************************************************************************
+* Function Name: power_getStats()
+********************************************************************************
+* Summary:
+*   Returns the time spent in each power state since power_resetStats(). The
+*   peer reads them with imuStream_CMD_POWER_STATS, after resetting them with
+*   imuStream_CMD_POWER_RESET when the streaming configuration changes.
+*
+* Parameters:
+*   stats [out] - Location to place the statistics
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void power_getStats(power_STATS_S *stats){
+    chargeTime();
+    uint8 i;
+    for(i = ZERO; i < power_NUM_STATES; i++){
+        stats->stateMs[i] = (uint32) ((stateCounts[i] * 1000u) / power_LFCLK_HZ);
+    }
+    stats->deepSleeps = deepSleeps;
+    stats->sensorSuspends = sensorSuspends;
+}
+
+/*******************************************************************************
+* Function Name: power_resetStats()
+********************************************************************************
+* Summary:
+*   Clears the power state statistics
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void power_resetStats(void){
+    chargeTime();
+    memset(stateCounts, ZERO, sizeof(stateCounts));
+    deepSleeps = ZERO;
+    sensorSuspends = ZERO;
+}
+
+/*******************************************************************************
+* Function Name: chargeTime()
+********************************************************************************
+* Summary:
+*   Adds the time since the last call to the current state. Must be called
+*   more often than WDT C0 wraps (2 s).
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Time added [LFCLK counts]
+*
+*******************************************************************************/
+static uint32 chargeTime(void){
+    if(!powerStarted){
+        return ZERO;
+    }
+    uint16 count = (uint16) CySysWdtReadCount(CY_SYS_WDT_COUNTER0);
+    uint32 elapsed = (uint16) (count - lastCount);
+    lastCount = count;
+    stateCounts[appPowerState] += elapsed;
+    return elapsed;
+}
+
+/*******************************************************************************
+* Function Name: getIdleTicks()
+********************************************************************************
+* Summary:
+*   Returns the time until the next scheduler task is due
+*
+* Parameters:
+*   scheduled [out] - True if a task is scheduled
+*
+* Return:
+*   Ticks until the next task, zero if one is due and power_MAX_SLEEP_TICKS
+*   at most
+*
+*******************************************************************************/
+static uint32 getIdleTicks(bool *scheduled){
+    uint32 deadline;
+    uint32 idle = power_MAX_SLEEP_TICKS;
+    *scheduled = scheduler_getNextDeadline(&deadline);
+    if(*scheduled){
+        int32 diff = (int32) (deadline - scheduler_now());
+        /* Signed zero, an overdue deadline has a negative difference */
+        if(diff <= 0){
+            idle = ZERO;
+        } else if((uint32) diff < idle){
+            idle = (uint32) diff;
+        }
+    }
+    return idle;
+}
+
+/*******************************************************************************
+* Function Name: deepSleep()
+********************************************************************************
+* Summary:
+*   Deep sleeps until WDT C0 matches or another interrupt wakes the device,
+*   then moves the scheduler tick forward by the time slept. Call with
+*   interrupts disabled once the BLESS allows deep sleep.
+*
+* Parameters:
+*   ticks - Longest time to sleep [ticks], at most power_MAX_SLEEP_TICKS
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void deepSleep(uint32 ticks){
+    /* Arm the wakeup */
+    uint32 counts = (ticks * power_LFCLK_HZ) / power_TICKS_PER_S;
+    uint32 match = (CySysWdtReadCount(CY_SYS_WDT_COUNTER0) + counts) & power_WDT_COUNT_MASK;
+    CySysWdtWriteMatch(CY_SYS_WDT_COUNTER0, match);
+    /* State to wakeup in */
+    power_setSystemState(STATE_DEEPSLEEP);
+    deepSleeps++;
+    /* Put to sleep */
+    CySysPmDeepSleep();
+    /* RESUME HERE on wakeup */
+    tickRemainder += chargeTime() * power_TICKS_PER_S;
+    scheduler_advance(tickRemainder / power_LFCLK_HZ);
+    tickRemainder %= power_LFCLK_HZ;
+    power_setSystemState(STATE_WAKEUP);
+}
+
+/*******************************************************************************
+* ISR Name: ISR_wdt()
+********************************************************************************
+* Summary:
+*   Clears the WDT C0 match, which only has to wake the device
+* Interrupt:
+*   WDT, power_WDT_IRQN
+*
+*******************************************************************************/
+static CY_ISR(ISR_wdt){
+    CySysWdtClearInterrupt(CY_SYS_WDT_COUNTER0_INT);
+}
+
 /* [] END OF FILE */
@@ -13,6 +13,7 @@
 * Brief:
 *   Definintions for power management
 * 
+* 2018.11.13 CC - Tickless deep sleep between scheduler deadlines
 * 2018.02.16 CC - Document created
 ********************************************************************************/
 /* Header Guard */
@@ -22,10 +23,25 @@
     * Included source files
     ***************************************/
     #include "project.h"
+    #include "scheduler.h"
         
     /***************************************
     * Macro definitions 
     ***************************************/
+    /* WDT - clocked from the 32.768 kHz WCO, runs in deep sleep */
+    #define power_LFCLK_HZ              (32768u)
+    #define power_WDT_IRQN              (8u)        /**< WDT interrupt of the PSoC 4 BLE */
+    #define power_WDT_COUNT_MASK        (0xFFFFu)   /**< Counters 0 and 1 are 16 bit */
+    #define power_WDT_RESET_MATCH       (0xFFFFu)   /**< C1 resets the device 2 s after the last feed */
+    /* Times in scheduler ticks */
+    #define power_TICKS_PER_S           (1000000u / scheduler_TICK_US)
+    #define power_MAX_SLEEP_TICKS       (power_TICKS_PER_S)         /**< Longest deep sleep, well inside the watchdog */
+    #define power_FEED_TICKS            (power_TICKS_PER_S / 2u)    /**< Watchdog feed interval */
+    #define power_DEEPSLEEP_MIN_TICKS   (3u)        /**< Shorter idle periods use CPU sleep */
+    #define power_WAKE_MARGIN_TICKS     (1u)        /**< Wake early for the clocks to restart */
+    /* BLE connection interval units */
+    #define power_CONN_INTV_US          (1250u)
+    #define power_NOT_CONNECTED         (0u)
     
     /***************************************
     * Enumerated types
@@ -36,13 +52,29 @@
         STATE_PREP_SLEEP,
         STATE_WAIT_FOR_SLEEP,
         STATE_DEEPSLEEP,
-        STATE_WAKEUP
+        STATE_WAKEUP,
+        STATE_SLEEP                 /**< CPU sleep, peripherals clocked */
     } APP_POWER_STATE_T;
+    #define power_NUM_STATES        (6u)
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Time spent in each power state */
+    typedef struct {
+        uint32 stateMs[power_NUM_STATES];   /**< Indexed by APP_POWER_STATE_T [ms] */
+        uint32 deepSleeps;                  /**< Times deep sleep was entered */
+        uint32 sensorSuspends;              /**< Times the BMX055 was suspended */
+    } power_STATS_S;
 
     /***************************************
     * Function declarations 
     ***************************************/
+    void power_start(void);
     void power_processSystemState(void);
+    void power_setConnectionInterval(uint16 connIntv);
+    void power_getStats(power_STATS_S *stats);
+    void power_resetStats(void);
     APP_POWER_STATE_T power_getSystemState(void);
     APP_POWER_STATE_T power_setSystemState(APP_POWER_STATE_T nextState);
     
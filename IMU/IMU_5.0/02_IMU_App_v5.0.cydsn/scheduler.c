@@ -0,0 +1,512 @@
+/***************************************************************************
+*                                       MICA
+* File: scheduler.c
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* PCB: MICA_IMU_v3.5.2
+* PSoC: CYBLE-214015-01 (EZBLE, 4.2, 256k)
+* Sensors: BOSCH IMU (BMX055)
+*
+* Brief:
+*   Run to completion scheduler driven by the dataSampleTimer tick. Tasks are
+*   periodic or one-shot and are kept in a list sorted by deadline, so the
+*   main loop only has to look at the head to know if anything is due. An
+*   interrupt that has work for the main loop posts a task instead of setting
+*   a flag. Each task records how late and how long it ran, and a periodic
+*   task that misses its next period skips it and counts an overrun rather
+*   than running back to back.
+*
+*   scheduler_sleep() puts the CPU to sleep when nothing is due, so idle time
+*   in the main loop becomes low power time. The tick wakes it every
+*   scheduler_TICK_US.
+*
+* Date Written:  2018.11.12
+* Last Modified: 2018.11.14
+********************************************************************************/
+#include "scheduler.h"
+#include <string.h>
+
+/* The terminal count is included in the period */
+#define scheduler_TIMER_PERIOD  ((scheduler_TICK_US * (scheduler_TIMER_CLOCK_HZ / 1000000u)) - 1u)
+#define scheduler_US_PER_COUNT  (1000000u / scheduler_TIMER_CLOCK_HZ)
+
+/* A single task */
+typedef struct {
+    scheduler_TASK_T function;  /* NULL when the slot is free */
+    uint32 deadline;            /* Tick the task is due on */
+    uint32 period;              /* Ticks between runs, scheduler_ONE_SHOT to run once */
+    bool armed;                 /* In the deadline list */
+    uint8 next;                 /* Next task in the deadline list */
+    scheduler_STATS_S stats;
+} scheduler_TASK_S;
+
+static scheduler_TASK_S tasks[scheduler_MAX_TASKS];
+static uint8 listHead = scheduler_NO_TASK;
+static volatile uint32 tickCount = ZERO;
+
+static CY_ISR_PROTO(ISR_schedulerTick);
+static bool isDue(uint32 deadline, uint32 now);
+static void insertTask(uint8 taskId);
+static void removeTask(uint8 taskId);
+
+/*******************************************************************************
+* Function Name: scheduler_start()
+********************************************************************************
+*
+* Summary:
+*   Clears every task and starts the tick from zero
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void scheduler_start(void){
+    uint8 intState = CyEnterCriticalSection();
+    memset(tasks, ZERO, sizeof(tasks));
+    listHead = scheduler_NO_TASK;
+    tickCount = ZERO;
+    CyExitCriticalSection(intState);
+    dataSample_Interrupt_StartEx(ISR_schedulerTick);
+    dataSampleTimer_Start();
+    dataSampleTimer_WritePeriod(scheduler_TIMER_PERIOD);
+    dataSampleTimer_WriteCounter(ZERO);
+}
+
+/*******************************************************************************
+* Function Name: scheduler_addTask()
+********************************************************************************
+*
+* Summary:
+*   Adds a task to the schedule
+*
+* Parameters:
+*   function - Function to run
+*   delay - Ticks until the first run
+*   period - Ticks between runs, scheduler_ONE_SHOT to run once. A one-shot
+*       task keeps its slot after running and can be posted again.
+*   taskId [out] - ID of the new task
+*
+* Return:
+*   scheduler_ERR_OK - Task added
+*   scheduler_ERR_ARGS - No function
+*   scheduler_ERR_FULL - All scheduler_MAX_TASKS slots are in use
+*
+*******************************************************************************/
+uint32 scheduler_addTask(scheduler_TASK_T function, uint32 delay, uint32 period, uint8 *taskId){
+    if(function == NULL){
+        return scheduler_ERR_ARGS;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    uint8 i;
+    for(i = ZERO; i < scheduler_MAX_TASKS; i++){
+        if(tasks[i].function == NULL){
+            break;
+        }
+    }
+    if(i == scheduler_MAX_TASKS){
+        CyExitCriticalSection(intState);
+        return scheduler_ERR_FULL;
+    }
+    scheduler_TASK_S *task = &tasks[i];
+    memset(task, ZERO, sizeof(scheduler_TASK_S));
+    task->function = function;
+    task->period = period;
+    task->deadline = tickCount + delay;
+    insertTask(i);
+    CyExitCriticalSection(intState);
+    *taskId = i;
+    return scheduler_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_cancelTask()
+********************************************************************************
+*
+* Summary:
+*   Removes a task and frees its slot. A task may cancel itself.
+*
+* Parameters:
+*   taskId - Task to cancel
+*
+* Return:
+*   scheduler_ERR_OK - Task cancelled
+*   scheduler_ERR_TASK - Unknown task
+*
+*******************************************************************************/
+uint32 scheduler_cancelTask(uint8 taskId){
+    if((taskId >= scheduler_MAX_TASKS) || (tasks[taskId].function == NULL)){
+        return scheduler_ERR_TASK;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    removeTask(taskId);
+    tasks[taskId].function = NULL;
+    CyExitCriticalSection(intState);
+    return scheduler_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_post()
+********************************************************************************
+*
+* Summary:
+*   Makes a task due now. Safe to call from an interrupt. Posting a one-shot
+*   task that is already due merges the posts and counts an overrun. A
+*   periodic task continues its period from this run.
+*
+* Parameters:
+*   taskId - Task to run
+*
+* Return:
+*   scheduler_ERR_OK - Task posted
+*   scheduler_ERR_TASK - Unknown task
+*
+*******************************************************************************/
+uint32 scheduler_post(uint8 taskId){
+    if((taskId >= scheduler_MAX_TASKS) || (tasks[taskId].function == NULL)){
+        return scheduler_ERR_TASK;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    scheduler_TASK_S *task = &tasks[taskId];
+    uint32 now = tickCount;
+    if(task->armed){
+        if(isDue(task->deadline, now)){
+            /* Already due, keep its place */
+            if(task->period == scheduler_ONE_SHOT){
+                task->stats.overruns++;
+            }
+            CyExitCriticalSection(intState);
+            return scheduler_ERR_OK;
+        }
+        removeTask(taskId);
+    }
+    task->deadline = now;
+    insertTask(taskId);
+    CyExitCriticalSection(intState);
+    return scheduler_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_getStats()
+********************************************************************************
+*
+* Summary:
+*   Returns a snapshot of the statistics of a task
+*
+* Parameters:
+*   taskId - Task to read
+*   stats [out] - Location to place the statistics
+*
+* Return:
+*   scheduler_ERR_OK - Statistics returned
+*   scheduler_ERR_TASK - Unknown task
+*
+*******************************************************************************/
+uint32 scheduler_getStats(uint8 taskId, scheduler_STATS_S *stats){
+    if((taskId >= scheduler_MAX_TASKS) || (tasks[taskId].function == NULL)){
+        return scheduler_ERR_TASK;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    *stats = tasks[taskId].stats;
+    CyExitCriticalSection(intState);
+    return scheduler_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_resetStats()
+********************************************************************************
+*
+* Summary:
+*   Clears the statistics of a task
+*
+* Parameters:
+*   taskId - Task to clear
+*
+* Return:
+*   scheduler_ERR_OK - Statistics cleared
+*   scheduler_ERR_TASK - Unknown task
+*
+*******************************************************************************/
+uint32 scheduler_resetStats(uint8 taskId){
+    if((taskId >= scheduler_MAX_TASKS) || (tasks[taskId].function == NULL)){
+        return scheduler_ERR_TASK;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    memset(&tasks[taskId].stats, ZERO, sizeof(scheduler_STATS_S));
+    CyExitCriticalSection(intState);
+    return scheduler_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_now()
+********************************************************************************
+*
+* Summary:
+*   Returns the tick count
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Ticks since scheduler_start()
+*
+*******************************************************************************/
+uint32 scheduler_now(void){
+    return tickCount;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_nowUs()
+********************************************************************************
+*
+* Summary:
+*   Returns the time from the tick count and the timer counter. Wraps every
+*   71 minutes.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Time since scheduler_start() [us]
+*
+*******************************************************************************/
+uint32 scheduler_nowUs(void){
+    uint32 ticks;
+    uint32 counter;
+    /* Read again if the tick advanced between the two reads */
+    do {
+        ticks = tickCount;
+        counter = dataSampleTimer_ReadCounter();
+    } while(ticks != tickCount);
+    /* The timer counts down from the period */
+    return (ticks * scheduler_TICK_US) + ((scheduler_TIMER_PERIOD - counter) * scheduler_US_PER_COUNT);
+}
+
+/*******************************************************************************
+* Function Name: scheduler_advance()
+********************************************************************************
+*
+* Summary:
+*   Moves the tick count forward by time that passed while the tick was
+*   stopped, e.g. in deep sleep. Tasks that became due run on the next
+*   scheduler_dispatch().
+*
+* Parameters:
+*   ticks - Ticks to add
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void scheduler_advance(uint32 ticks){
+    uint8 intState = CyEnterCriticalSection();
+    tickCount += ticks;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: scheduler_getNextDeadline()
+********************************************************************************
+*
+* Summary:
+*   Returns when the next task is due
+*
+* Parameters:
+*   deadline [out] - Tick the next task is due on
+*
+* Return:
+*   True if a task is scheduled
+*
+*******************************************************************************/
+bool scheduler_getNextDeadline(uint32 *deadline){
+    uint8 intState = CyEnterCriticalSection();
+    bool scheduled = (listHead != scheduler_NO_TASK);
+    if(scheduled){
+        *deadline = tasks[listHead].deadline;
+    }
+    CyExitCriticalSection(intState);
+    return scheduled;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_dispatch()
+********************************************************************************
+*
+* Summary:
+*   Runs every task that is due, earliest deadline first, each to completion.
+*   Call from the main loop.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Number of tasks run
+*
+*******************************************************************************/
+uint8 scheduler_dispatch(void){
+    uint8 count = ZERO;
+    for(;;){
+        /* Take the head if it is due */
+        uint8 intState = CyEnterCriticalSection();
+        uint8 taskId = listHead;
+        uint32 now = tickCount;
+        if((taskId == scheduler_NO_TASK) || !isDue(tasks[taskId].deadline, now)){
+            CyExitCriticalSection(intState);
+            break;
+        }
+        scheduler_TASK_S *task = &tasks[taskId];
+        removeTask(taskId);
+        uint32 deadline = task->deadline;
+        scheduler_TASK_T function = task->function;
+        CyExitCriticalSection(intState);
+        /* Run */
+        uint32 lateness = now - deadline;
+        uint32 startUs = scheduler_nowUs();
+        function(taskId, deadline);
+        uint32 runtime = scheduler_nowUs() - startUs;
+        count++;
+        /* Record and reschedule */
+        intState = CyEnterCriticalSection();
+        task->stats.runs++;
+        task->stats.totalRuntime += runtime;
+        if(runtime > task->stats.maxRuntime){
+            task->stats.maxRuntime = runtime;
+        }
+        if(lateness > task->stats.maxLateness){
+            task->stats.maxLateness = lateness;
+        }
+        /* Cancelled or posted while running */
+        if((task->function == function) && !task->armed && (task->period != scheduler_ONE_SHOT)){
+            uint32 next = deadline + task->period;
+            now = tickCount;
+            if(!isDue(now, next)){
+                /* Skip the periods already missed */
+                uint32 missed = ((now - next) + task->period - ONE) / task->period;
+                task->stats.overruns += missed;
+                next += missed * task->period;
+            }
+            task->deadline = next;
+            insertTask(taskId);
+        }
+        CyExitCriticalSection(intState);
+    }
+    return count;
+}
+
+/*******************************************************************************
+* Function Name: scheduler_sleep()
+********************************************************************************
+*
+* Summary:
+*   Sleeps the CPU until the next interrupt if no task is due. Interrupts are
+*   masked while checking so one that arrives in between still wakes the CPU.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void scheduler_sleep(void){
+    uint8 intState = CyEnterCriticalSection();
+    if((listHead == scheduler_NO_TASK) || !isDue(tasks[listHead].deadline, tickCount)){
+        CySysPmSleep();
+    }
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: isDue()
+********************************************************************************
+*
+* Summary:
+*   Compares ticks across the wrap of the tick count
+*
+* Parameters:
+*   deadline - Tick to check
+*   now - Current tick
+*
+* Return:
+*   True if deadline is at or before now
+*
+*******************************************************************************/
+static bool isDue(uint32 deadline, uint32 now){
+    /* Signed zero, ZERO would make the comparison unsigned */
+    return ((int32) (now - deadline)) >= 0;
+}
+
+/*******************************************************************************
+* Function Name: insertTask()
+********************************************************************************
+*
+* Summary:
+*   Links a task into the deadline list, after any task with the same
+*   deadline. Call with interrupts disabled.
+*
+* Parameters:
+*   taskId - Task to insert
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void insertTask(uint8 taskId){
+    scheduler_TASK_S *task = &tasks[taskId];
+    uint8 *link = &listHead;
+    while((*link != scheduler_NO_TASK) && isDue(tasks[*link].deadline, task->deadline)){
+        link = &tasks[*link].next;
+    }
+    task->next = *link;
+    *link = taskId;
+    task->armed = true;
+}
+
+/*******************************************************************************
+* Function Name: removeTask()
+********************************************************************************
+*
+* Summary:
+*   Unlinks a task from the deadline list if it is there. Call with interrupts
+*   disabled.
+*
+* Parameters:
+*   taskId - Task to remove
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+static void removeTask(uint8 taskId){
+    uint8 *link = &listHead;
+    while(*link != scheduler_NO_TASK){
+        if(*link == taskId){
+            *link = tasks[taskId].next;
+            break;
+        }
+        link = &tasks[*link].next;
+    }
+    tasks[taskId].armed = false;
+}
+
+/*******************************************************************************
+* ISR Name: ISR_schedulerTick()
+********************************************************************************
+* Summary:
+*   Advances the tick count
+* Interrupt:
+*   dataSample_Interrupt
+*
+*******************************************************************************/
+static CY_ISR(ISR_schedulerTick){
+    /* Clear the interrupt */
+    dataSampleTimer_STATUS;
+    tickCount++;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,79 @@
+/***************************************************************************
+*                                       MICA
+* File: scheduler.h
+* Workspace: IMU_v5.0
+* Project Name: 02_IMU_App_v5.0
+* Version: v5.0.0
+* Author: Craig Cheney
+*
+* PCB: MICA_IMU_v3.5.2
+* PSoC: CYBLE-214015-01 (EZBLE, 4.2, 256k)
+* Sensors: BOSCH IMU (BMX055)
+*
+* Brief:
+*   Header for scheduler.c
+*
+* Date Written:  2018.11.12
+* Last Modified: 2018.11.13
+********************************************************************************/
+/* Header Guard */
+#ifndef SCHEDULER_H
+    #define SCHEDULER_H
+
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro definitions
+    ***************************************/
+    /* Tick - dataSampleTimer is clocked at 1 MHz */
+    #define scheduler_TIMER_CLOCK_HZ        (1000000u)
+    #ifndef scheduler_TICK_US
+        #define scheduler_TICK_US           (1000u)     /**< Period of the tick [us] */
+    #endif
+    /* Tasks */
+    #ifndef scheduler_MAX_TASKS
+        #define scheduler_MAX_TASKS         (8u)
+    #endif
+    #define scheduler_NO_TASK               (0xFFu)
+    #define scheduler_ONE_SHOT              (0u)        /**< Period of a task that runs once */
+    /* Error codes */
+    #define scheduler_ERR_OK                (0u)
+    #define scheduler_ERR_FULL              (1u)        /**< No free task slots */
+    #define scheduler_ERR_TASK              (2u)        /**< Unknown or free task */
+    #define scheduler_ERR_ARGS              (3u)        /**< NULL task function */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Task function, given its ID and the tick it was due on */
+    typedef void (*scheduler_TASK_T)(uint8 taskId, uint32 deadline);
+
+    /* Run time statistics of a task */
+    typedef struct {
+        uint32 runs;            /**< Times the task has run */
+        uint32 overruns;        /**< Periods skipped because the task ran late, or posts merged into one run */
+        uint32 maxLateness;     /**< Longest time from the deadline to the task starting [ticks] */
+        uint32 maxRuntime;      /**< Longest single run [us] */
+        uint32 totalRuntime;    /**< Time spent in the task [us] */
+    } scheduler_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void scheduler_start(void);
+    uint32 scheduler_addTask(scheduler_TASK_T function, uint32 delay, uint32 period, uint8 *taskId);
+    uint32 scheduler_cancelTask(uint8 taskId);
+    uint32 scheduler_post(uint8 taskId);
+    uint32 scheduler_getStats(uint8 taskId, scheduler_STATS_S *stats);
+    uint32 scheduler_resetStats(uint8 taskId);
+    uint32 scheduler_now(void);
+    uint32 scheduler_nowUs(void);
+    void scheduler_advance(uint32 ticks);
+    bool scheduler_getNextDeadline(uint32 *deadline);
+    uint8 scheduler_dispatch(void);
+    void scheduler_sleep(void);
+
+#endif /* SCHEDULER_H */
+/* [] END OF FILE */
@@ -15,6 +15,51 @@
 ********************************************************************************/
 
 #include "I2C_cc.h"
+#include <string.h>
+
+/* Address, register and restart address bytes that frame a transfer */
+#define I2C_cc_LEN_READ_OVERHEAD    (3u)
+#define I2C_cc_LEN_WRITE_OVERHEAD   (2u)
+
+/* Non-blocking transfer state, advanced from the I2C interrupt */
+typedef enum {
+    I2C_cc_STATE_IDLE,
+    I2C_cc_STATE_READ_ADDR,     /* Sending the register address */
+    I2C_cc_STATE_READ_DATA,     /* Reading after the restart */
+    I2C_cc_STATE_WRITE          /* Sending address and data */
+} I2C_cc_STATE_T;
+
+static volatile I2C_cc_STATE_T xferState = I2C_cc_STATE_IDLE;
+static uint8 xferAddr;
+static uint8 *xferBuf;
+static uint16 xferLen;
+static I2C_cc_CALLBACK_T xferCallback;
+static uint8 xferTxBuf[I2C_cc_MAX_WRITE_LEN + 1u];
+static volatile I2C_cc_STATS_S busStats;
+
+/*******************************************************************************
+* Function Name: countTransaction
+********************************************************************************
+* Summary:
+*        Adds a finished transaction to the bus statistics
+*
+* Params:
+*       bytes - bytes on the bus, including address bytes
+*       error - error code of the transaction
+*
+* Returns
+*       void
+*
+*******************************************************************************/
+static void countTransaction (uint32 bytes, uint32 error){
+    uint8 intState = CyEnterCriticalSection();
+    busStats.transactions++;
+    busStats.bytes += bytes;
+    if(error != I2C_cc_ERR_OK){
+        busStats.errors++;
+    }
+    CyExitCriticalSection(intState);
+}
 
 /*******************************************************************************
 * Function Name: writeI2CReg
@@ -33,16 +78,7 @@
 *
 *******************************************************************************/
 void writeI2CReg (uint8 deviceAddr, uint8 registerAddr, uint8 registerData){
-    // ST & SAD + W
-    
-    I2C_I2CMasterSendStart(deviceAddr, I2C_WRITE);
-    // SUB
-    I2C_I2CMasterWriteByte(registerAddr);
-    // DATA
-    I2C_I2CMasterWriteByte(registerData);
-    // SP
-    I2C_I2CMasterSendStop();
-    
+    writeI2CRegs(deviceAddr, registerAddr, &registerData, ONE);
 }
 
 
@@ -62,17 +98,323 @@ void writeI2CReg (uint8 deviceAddr, uint8 registerAddr, uint8 registerData){
 *
 *******************************************************************************/
 uint8 readI2CReg (uint8 deviceAddr, uint8 registerAddr){
+    uint8 data = ZERO;
+    readI2CRegs(deviceAddr, registerAddr, &data, ONE);
+    return data;
+}
+
+/*******************************************************************************
+* Function Name: readI2CRegs
+********************************************************************************
+* Summary:
+*        Reads consecutive registers of the target I2C device in a single
+*        transaction: start, register address, restart, len bytes, stop.
+*        Reading a 6 byte XYZ vector costs one transaction instead of six.
+*
+* Params: 
+*       deviceAddr - device I2C address
+*       startReg - address of the first register to read
+*       buf - location to place the register values
+*       len - number of registers to read
+*
+* Returns
+*       I2C_cc_ERR_OK on success, I2C_cc_ERR_<cause> otherwise
+*
+*******************************************************************************/
+uint32 readI2CRegs (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len){
+    if(len == ZERO){
+        return I2C_cc_ERR_LENGTH;
+    }
+    if(xferState != I2C_cc_STATE_IDLE){
+        return I2C_cc_ERR_BUSY;
+    }
     // ST & SAD + W
-    I2C_I2CMasterSendStart(deviceAddr, I2C_I2C_WRITE_XFER_MODE);
+    uint32 status = I2C_I2CMasterSendStart(deviceAddr, I2C_I2C_WRITE_XFER_MODE);
     // SUB
-    I2C_I2CMasterWriteByte(registerAddr);
+    if(status == I2C_I2C_MSTR_NO_ERROR){
+        status = I2C_I2CMasterWriteByte(startReg);
+    }
     // SR & SAD + R
-    I2C_I2CMasterSendRestart(deviceAddr, I2C_I2C_READ_XFER_MODE);
-    // READ
-    uint8 data = I2C_I2CMasterReadByte(I2C_I2C_NAK_DATA);
+    if(status == I2C_I2C_MSTR_NO_ERROR){
+        status = I2C_I2CMasterSendRestart(deviceAddr, I2C_I2C_READ_XFER_MODE);
+    }
+    // READ - ACK all but the last byte
+    if(status == I2C_I2C_MSTR_NO_ERROR){
+        uint16 i;
+        for(i = ZERO; i < (len - ONE); i++){
+            buf[i] = (uint8) I2C_I2CMasterReadByte(I2C_I2C_ACK_DATA);
+        }
+        buf[i] = (uint8) I2C_I2CMasterReadByte(I2C_I2C_NAK_DATA);
+    }
     // SP
     I2C_I2CMasterSendStop();
-    return data;
+    uint32 error = (status == I2C_I2C_MSTR_NO_ERROR) ? I2C_cc_ERR_OK : I2C_cc_ERR_I2C;
+    countTransaction(len + I2C_cc_LEN_READ_OVERHEAD, error);
+    return error;
+}
+
+/*******************************************************************************
+* Function Name: writeI2CRegs
+********************************************************************************
+* Summary:
+*        Writes consecutive registers of the target I2C device in a single
+*        transaction: start, register address, len bytes, stop
+*
+* Params: 
+*       deviceAddr - device I2C address
+*       startReg - address of the first register to write
+*       buf - data to write
+*       len - number of registers to write
+*
+* Returns
+*       I2C_cc_ERR_OK on success, I2C_cc_ERR_<cause> otherwise
+*
+*******************************************************************************/
+uint32 writeI2CRegs (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len){
+    if(len == ZERO){
+        return I2C_cc_ERR_LENGTH;
+    }
+    if(xferState != I2C_cc_STATE_IDLE){
+        return I2C_cc_ERR_BUSY;
+    }
+    // ST & SAD + W
+    uint32 status = I2C_I2CMasterSendStart(deviceAddr, I2C_I2C_WRITE_XFER_MODE);
+    // SUB
+    if(status == I2C_I2C_MSTR_NO_ERROR){
+        status = I2C_I2CMasterWriteByte(startReg);
+    }
+    // DATA
+    uint16 i;
+    for(i = ZERO; (i < len) && (status == I2C_I2C_MSTR_NO_ERROR); i++){
+        status = I2C_I2CMasterWriteByte(buf[i]);
+    }
+    // SP
+    I2C_I2CMasterSendStop();
+    uint32 error = (status == I2C_I2C_MSTR_NO_ERROR) ? I2C_cc_ERR_OK : I2C_cc_ERR_I2C;
+    countTransaction(len + I2C_cc_LEN_WRITE_OVERHEAD, error);
+    return error;
+}
+
+/*******************************************************************************
+* Function Name: readI2CRegsNonBlocking
+********************************************************************************
+* Summary:
+*        Starts an interrupt driven burst read and returns immediately. The
+*        register address is sent without a stop, and the read is started
+*        with a restart from the I2C interrupt. callback is called from the
+*        interrupt once the data is in buf, or on error. buf must stay valid
+*        until then.
+*
+* Params: 
+*       deviceAddr - device I2C address
+*       startReg - address of the first register to read
+*       buf - location to place the register values
+*       len - number of registers to read
+*       callback - completion callback, may be NULL
+*
+* Returns
+*       I2C_cc_ERR_OK if the transfer was started, I2C_cc_ERR_<cause> otherwise
+*
+*******************************************************************************/
+uint32 readI2CRegsNonBlocking (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len, I2C_cc_CALLBACK_T callback){
+    if(len == ZERO){
+        return I2C_cc_ERR_LENGTH;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    if(xferState != I2C_cc_STATE_IDLE){
+        CyExitCriticalSection(intState);
+        return I2C_cc_ERR_BUSY;
+    }
+    xferAddr = deviceAddr;
+    xferBuf = buf;
+    xferLen = len;
+    xferCallback = callback;
+    xferTxBuf[ZERO] = startReg;
+    xferState = I2C_cc_STATE_READ_ADDR;
+    CyExitCriticalSection(intState);
+    /* Send the register address, holding the bus for the restart */
+    I2C_I2CMasterClearStatus();
+    if(I2C_I2CMasterWriteBuf(deviceAddr, xferTxBuf, ONE, I2C_I2C_MODE_NO_STOP) != I2C_I2C_MSTR_NO_ERROR){
+        xferState = I2C_cc_STATE_IDLE;
+        countTransaction(ZERO, I2C_cc_ERR_I2C);
+        return I2C_cc_ERR_I2C;
+    }
+    return I2C_cc_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: writeI2CRegsNonBlocking
+********************************************************************************
+* Summary:
+*        Starts an interrupt driven burst write and returns immediately. The
+*        data is copied, so buf may be reused at once. callback is called from
+*        the interrupt when the write finishes.
+*
+* Params: 
+*       deviceAddr - device I2C address
+*       startReg - address of the first register to write
+*       buf - data to write
+*       len - number of registers to write, at most I2C_cc_MAX_WRITE_LEN
+*       callback - completion callback, may be NULL
+*
+* Returns
+*       I2C_cc_ERR_OK if the transfer was started, I2C_cc_ERR_<cause> otherwise
+*
+*******************************************************************************/
+uint32 writeI2CRegsNonBlocking (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len, I2C_cc_CALLBACK_T callback){
+    if((len == ZERO) || (len > I2C_cc_MAX_WRITE_LEN)){
+        return I2C_cc_ERR_LENGTH;
+    }
+    uint8 intState = CyEnterCriticalSection();
+    if(xferState != I2C_cc_STATE_IDLE){
+        CyExitCriticalSection(intState);
+        return I2C_cc_ERR_BUSY;
+    }
+    xferAddr = deviceAddr;
+    xferBuf = NULL;
+    xferLen = len;
+    xferCallback = callback;
+    xferTxBuf[ZERO] = startReg;
+    memcpy(&xferTxBuf[ONE], buf, len);
+    xferState = I2C_cc_STATE_WRITE;
+    CyExitCriticalSection(intState);
+    /* Address and data in one transfer */
+    I2C_I2CMasterClearStatus();
+    if(I2C_I2CMasterWriteBuf(deviceAddr, xferTxBuf, len + ONE, I2C_I2C_MODE_COMPLETE_XFER) != I2C_I2C_MSTR_NO_ERROR){
+        xferState = I2C_cc_STATE_IDLE;
+        countTransaction(ZERO, I2C_cc_ERR_I2C);
+        return I2C_cc_ERR_I2C;
+    }
+    return I2C_cc_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: isI2CBusy
+********************************************************************************
+* Summary:
+*        Reports whether a non-blocking transfer is in progress
+*
+* Params: 
+*       None
+*
+* Returns
+*       true until the completion callback has run
+*
+*******************************************************************************/
+bool isI2CBusy (void){
+    return (xferState != I2C_cc_STATE_IDLE);
+}
+
+/*******************************************************************************
+* Function Name: getI2CStats
+********************************************************************************
+* Summary:
+*        Returns the bus usage since the last reset
+*
+* Params: 
+*       stats - location to place the statistics
+*
+* Returns
+*       void
+*
+*******************************************************************************/
+void getI2CStats (I2C_cc_STATS_S *stats){
+    uint8 intState = CyEnterCriticalSection();
+    stats->transactions = busStats.transactions;
+    stats->bytes = busStats.bytes;
+    stats->errors = busStats.errors;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: resetI2CStats
+********************************************************************************
+* Summary:
+*        Clears the bus usage statistics
+*
+* Params: 
+*       None
+*
+* Returns
+*       void
+*
+*******************************************************************************/
+void resetI2CStats (void){
+    uint8 intState = CyEnterCriticalSection();
+    busStats.transactions = ZERO;
+    busStats.bytes = ZERO;
+    busStats.errors = ZERO;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: finishTransfer
+********************************************************************************
+* Summary:
+*        Ends the non-blocking transfer and reports the result
+*
+* Params: 
+*       error - result of the transfer
+*
+* Returns
+*       void
+*
+*******************************************************************************/
+static void finishTransfer (uint32 error){
+    uint32 overhead = (xferState == I2C_cc_STATE_WRITE) ? I2C_cc_LEN_WRITE_OVERHEAD : I2C_cc_LEN_READ_OVERHEAD;
+    I2C_cc_CALLBACK_T callback = xferCallback;
+    I2C_I2CMasterClearStatus();
+    countTransaction(xferLen + overhead, error);
+    xferState = I2C_cc_STATE_IDLE;
+    if(callback != NULL){
+        callback(error);
+    }
+}
+
+/*******************************************************************************
+* ISR Name: I2C_I2C_ISR_ExitCallback
+********************************************************************************
+* Summary:
+*        Advances the non-blocking transfer. Runs at the end of the I2C
+*        interrupt, enabled by I2C_I2C_ISR_EXIT_CALLBACK in cyapicallbacks.h
+*
+* Interrupt: 
+*       I2C_SCB_IRQ
+*
+*******************************************************************************/
+void I2C_I2C_ISR_ExitCallback (void){
+    if(xferState == I2C_cc_STATE_IDLE){
+        return;
+    }
+    uint32 status = I2C_I2CMasterStatus();
+    if(status & I2C_I2C_MSTAT_ERR_XFER){
+        finishTransfer(I2C_cc_ERR_I2C);
+        return;
+    }
+    switch(xferState){
+        case I2C_cc_STATE_READ_ADDR:
+            /* Address sent - restart and read */
+            if(status & I2C_I2C_MSTAT_WR_CMPLT){
+                I2C_I2CMasterClearStatus();
+                xferState = I2C_cc_STATE_READ_DATA;
+                if(I2C_I2CMasterReadBuf(xferAddr, xferBuf, xferLen, I2C_I2C_MODE_REPEAT_START) != I2C_I2C_MSTR_NO_ERROR){
+                    finishTransfer(I2C_cc_ERR_I2C);
+                }
+            }
+            break;
+        case I2C_cc_STATE_READ_DATA:
+            if(status & I2C_I2C_MSTAT_RD_CMPLT){
+                finishTransfer(I2C_cc_ERR_OK);
+            }
+            break;
+        case I2C_cc_STATE_WRITE:
+            if(status & I2C_I2C_MSTAT_WR_CMPLT){
+                finishTransfer(I2C_cc_ERR_OK);
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 
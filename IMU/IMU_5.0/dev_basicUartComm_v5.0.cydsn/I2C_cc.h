@@ -28,16 +28,44 @@
     #define I2C_WRITE       (0x00u)
     #define PULLUP_ENABLE   (0x00u)
     #define PULLUP_DISABLE  (0x01u)
+    /* Error codes */
+    #define I2C_cc_ERR_OK           (0u)
+    #define I2C_cc_ERR_I2C          (1u)    /* Not acknowledged or bus error */
+    #define I2C_cc_ERR_BUSY         (2u)    /* A non-blocking transfer is in progress */
+    #define I2C_cc_ERR_LENGTH       (3u)    /* Zero length or too long to buffer */
+    /* Largest non-blocking write, excluding the register address */
+    #define I2C_cc_MAX_WRITE_LEN    (16u)
+
+    /***************************************
+    * Structures & types
+    ***************************************/
+    /* Called from the I2C interrupt when a non-blocking transfer finishes */
+    typedef void (*I2C_cc_CALLBACK_T)(uint32 error);
+
+    /* Bus usage, for measuring the cost of a sensor read */
+    typedef struct {
+        uint32 transactions;    /* Start conditions issued (restarts excluded) */
+        uint32 bytes;           /* Bytes on the bus, including address bytes */
+        uint32 errors;          /* Transactions that failed */
+    } I2C_cc_STATS_S;
 
     /***************************************
     * Function declarations 
     ***************************************/
     uint8 readI2CReg (uint8 deviceAddr, uint8 registerAddr);
     void writeI2CReg (uint8 deviceAddr, uint8 registerAddr, uint8 registerData);
+    uint32 readI2CRegs (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len);
+    uint32 writeI2CRegs (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len);
+    uint32 readI2CRegsNonBlocking (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len, I2C_cc_CALLBACK_T callback);
+    uint32 writeI2CRegsNonBlocking (uint8 deviceAddr, uint8 startReg, uint8 *buf, uint16 len, I2C_cc_CALLBACK_T callback);
+    bool isI2CBusy (void);
+    void getI2CStats (I2C_cc_STATS_S *stats);
+    void resetI2CStats (void);
 
     /***************************************
     * Interrupt Prototype declaration
     ***************************************/
+    void I2C_I2C_ISR_ExitCallback (void);
 
 #endif /*I2C_H*/
 
@@ -15,6 +15,9 @@
 
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
+    /* Advance non-blocking transfers in I2C_cc.c */
+    #define I2C_I2C_ISR_EXIT_CALLBACK
+    void I2C_I2C_ISR_ExitCallback(void);
 
     
 #endif /* CYAPICALLBACKS_H */   
@@ -0,0 +1,54 @@
+/***************************************************************************
+*                                       lib_cc
+* File: project.h
+* Project Name: dev_basicUartComm_v5.0 host test
+* Version: 0.1
+* Author: Craig Cheney
+*
+* Brief:
+*   Stands in for the generated project.h when I2C_cc.c is built on a Linux
+*   host. The I2C component calls go to the mock bus in test_I2C_cc.c.
+*
+* Date Written: 2018.11.14
+********************************************************************************/
+#ifndef HOST_PROJECT_H
+    #define HOST_PROJECT_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    #define ZERO    (0u)
+    #define ONE     (1u)
+
+    /* No interrupts on the host */
+    static inline uint8 CyEnterCriticalSection(void) { return ZERO; }
+    static inline void CyExitCriticalSection(uint8 state) { (void) state; }
+
+    /* SCB I2C master API used by I2C_cc.c */
+    #define I2C_I2C_WRITE_XFER_MODE     (0x00u)
+    #define I2C_I2C_READ_XFER_MODE      (0x01u)
+    #define I2C_I2C_ACK_DATA            (0x01u)
+    #define I2C_I2C_NAK_DATA            (0x00u)
+    #define I2C_I2C_MSTR_NO_ERROR       (0x00u)
+    #define I2C_I2C_MSTR_ERR_LB_NAK     (0x02u)
+    #define I2C_I2C_MODE_COMPLETE_XFER  (0x00u)
+    #define I2C_I2C_MODE_REPEAT_START   (0x01u)
+    #define I2C_I2C_MODE_NO_STOP        (0x02u)
+    #define I2C_I2C_MSTAT_RD_CMPLT      (0x01u)
+    #define I2C_I2C_MSTAT_WR_CMPLT      (0x02u)
+    #define I2C_I2C_MSTAT_ERR_XFER      (0x200u)
+
+    uint32 I2C_I2CMasterSendStart(uint32 slaveAddress, uint32 bitRnW);
+    uint32 I2C_I2CMasterSendRestart(uint32 slaveAddress, uint32 bitRnW);
+    uint32 I2C_I2CMasterSendStop(void);
+    uint32 I2C_I2CMasterWriteByte(uint32 theByte);
+    uint32 I2C_I2CMasterReadByte(uint32 ackNack);
+    uint32 I2C_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode);
+    uint32 I2C_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode);
+    uint32 I2C_I2CMasterStatus(void);
+    uint32 I2C_I2CMasterClearStatus(void);
+#endif /* HOST_PROJECT_H */
+/* [] END OF FILE */
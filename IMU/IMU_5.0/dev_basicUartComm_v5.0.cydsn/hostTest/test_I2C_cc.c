@@ -0,0 +1,238 @@
+/***************************************************************************
+*                                       lib_cc
+* File: test_I2C_cc.c
+* Project Name: dev_basicUartComm_v5.0 host test
+* Version: 0.1
+* Author: Craig Cheney
+*
+* Brief:
+*   Runs I2C_cc.c against a mock I2C bus on a Linux host. The mock holds one
+*   register mapped device and counts start conditions and bytes itself, so
+*   the burst, single register and non-blocking paths are checked for both
+*   the data they move and the bus cost they report.
+*
+*   Build and run from the project directory:
+*     gcc -std=gnu99 -Wall -I hostTest -I . hostTest/test_I2C_cc.c I2C_cc.c -o test_I2C_cc && ./test_I2C_cc
+*
+* Date Written: 2018.11.14
+********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "I2C_cc.h"
+
+#define MOCK_ADDR           (0x18u)     /* BMX055 accelerometer */
+#define MOCK_REG_ACC_X_LSB  (0x02u)
+#define LEN_XYZ             (6u)
+
+/* Mock bus */
+static uint8 mockRegs[256];
+static uint8 mockPtr;
+static bool mockFirstWrite;
+static bool mockNak;
+static uint32 mockStarts;
+static uint32 mockBytes;
+static uint32 mockStatus;
+
+uint32 I2C_I2CMasterSendStart(uint32 slaveAddress, uint32 bitRnW){
+    (void) bitRnW;
+    mockStarts++;
+    mockBytes++;
+    mockFirstWrite = true;
+    mockNak = (slaveAddress != MOCK_ADDR);
+    return mockNak ? I2C_I2C_MSTR_ERR_LB_NAK : I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterSendRestart(uint32 slaveAddress, uint32 bitRnW){
+    (void) bitRnW;
+    mockBytes++;
+    mockNak = (slaveAddress != MOCK_ADDR);
+    return mockNak ? I2C_I2C_MSTR_ERR_LB_NAK : I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterSendStop(void){
+    return I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterWriteByte(uint32 theByte){
+    mockBytes++;
+    if(mockFirstWrite){
+        mockPtr = (uint8) theByte;
+        mockFirstWrite = false;
+    } else {
+        mockRegs[mockPtr++] = (uint8) theByte;
+    }
+    return I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterReadByte(uint32 ackNack){
+    (void) ackNack;
+    mockBytes++;
+    return mockRegs[mockPtr++];
+}
+
+uint32 I2C_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode){
+    if(!(mode & I2C_I2C_MODE_REPEAT_START)){
+        mockStarts++;
+    }
+    mockBytes += ONE + cnt;
+    if(slaveAddress != MOCK_ADDR){
+        mockStatus |= I2C_I2C_MSTAT_ERR_XFER;
+        return I2C_I2C_MSTR_NO_ERROR;
+    }
+    mockPtr = wrData[ZERO];
+    uint32 i;
+    for(i = ONE; i < cnt; i++){
+        mockRegs[mockPtr++] = wrData[i];
+    }
+    mockStatus |= I2C_I2C_MSTAT_WR_CMPLT;
+    return I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode){
+    if(!(mode & I2C_I2C_MODE_REPEAT_START)){
+        mockStarts++;
+    }
+    mockBytes += ONE + cnt;
+    if(slaveAddress != MOCK_ADDR){
+        mockStatus |= I2C_I2C_MSTAT_ERR_XFER;
+        return I2C_I2C_MSTR_NO_ERROR;
+    }
+    uint32 i;
+    for(i = ZERO; i < cnt; i++){
+        rdData[i] = mockRegs[mockPtr++];
+    }
+    mockStatus |= I2C_I2C_MSTAT_RD_CMPLT;
+    return I2C_I2C_MSTR_NO_ERROR;
+}
+
+uint32 I2C_I2CMasterStatus(void){
+    return mockStatus;
+}
+
+uint32 I2C_I2CMasterClearStatus(void){
+    uint32 status = mockStatus;
+    mockStatus = ZERO;
+    return status;
+}
+
+/* Test helpers */
+static uint32 failures = ZERO;
+static uint32 callbackCount;
+static uint32 callbackError;
+
+static void check(const char *name, uint32 actual, uint32 expected){
+    bool pass = (actual == expected);
+    printf("%s: %s (got %u, expected %u)\n", pass ? "PASS" : "FAIL", name, actual, expected);
+    failures += pass ? ZERO : ONE;
+}
+
+static void resetBus(void){
+    uint32 i;
+    for(i = ZERO; i < sizeof(mockRegs); i++){
+        mockRegs[i] = (uint8) (i * 7u + 3u);
+    }
+    mockStarts = ZERO;
+    mockBytes = ZERO;
+    mockStatus = ZERO;
+    resetI2CStats();
+}
+
+static void checkStats(const char *name, uint32 transactions, uint32 bytes){
+    I2C_cc_STATS_S stats;
+    getI2CStats(&stats);
+    char label[80];
+    snprintf(label, sizeof(label), "%s transactions", name);
+    check(label, stats.transactions, transactions);
+    snprintf(label, sizeof(label), "%s bytes", name);
+    check(label, stats.bytes, bytes);
+    snprintf(label, sizeof(label), "%s matches the bus", name);
+    check(label, (stats.transactions == mockStarts) && (stats.bytes == mockBytes), true);
+}
+
+static void onComplete(uint32 error){
+    callbackCount++;
+    callbackError = error;
+}
+
+/* Runs the I2C interrupt until the transfer is done */
+static void runIsr(void){
+    uint8 i;
+    for(i = ZERO; (i < 4u) && isI2CBusy(); i++){
+        I2C_I2C_ISR_ExitCallback();
+    }
+}
+
+int main(void){
+    uint8 data[LEN_XYZ];
+    uint8 *expected;
+
+    /* One register at a time: six transactions of four bytes */
+    resetBus();
+    uint8 i;
+    for(i = ZERO; i < LEN_XYZ; i++){
+        data[i] = readI2CReg(MOCK_ADDR, MOCK_REG_ACC_X_LSB + i);
+    }
+    expected = &mockRegs[MOCK_REG_ACC_X_LSB];
+    check("Single reads data", memcmp(data, expected, LEN_XYZ), ZERO);
+    checkStats("Single reads", LEN_XYZ, 4u * LEN_XYZ);
+
+    /* Burst: one transaction of nine bytes */
+    resetBus();
+    memset(data, ZERO, sizeof(data));
+    check("Burst read", readI2CRegs(MOCK_ADDR, MOCK_REG_ACC_X_LSB, data, LEN_XYZ), I2C_cc_ERR_OK);
+    check("Burst read data", memcmp(data, expected, LEN_XYZ), ZERO);
+    checkStats("Burst read", ONE, LEN_XYZ + 3u);
+
+    /* Burst write, read back */
+    resetBus();
+    uint8 writeData[3] = {0xA1, 0xB2, 0xC3};
+    check("Burst write", writeI2CRegs(MOCK_ADDR, 0x40, writeData, sizeof(writeData)), I2C_cc_ERR_OK);
+    check("Burst write data", memcmp(&mockRegs[0x40], writeData, sizeof(writeData)), ZERO);
+    checkStats("Burst write", ONE, sizeof(writeData) + 2u);
+
+    /* Errors */
+    resetBus();
+    check("Zero length", readI2CRegs(MOCK_ADDR, ZERO, data, ZERO), I2C_cc_ERR_LENGTH);
+    check("No device", readI2CRegs(MOCK_ADDR + ONE, ZERO, data, LEN_XYZ), I2C_cc_ERR_I2C);
+    I2C_cc_STATS_S stats;
+    getI2CStats(&stats);
+    check("No device counted", stats.errors, ONE);
+
+    /* Non-blocking read: address, restart from the interrupt, data */
+    resetBus();
+    memset(data, ZERO, sizeof(data));
+    callbackCount = ZERO;
+    check("Non-blocking read", readI2CRegsNonBlocking(MOCK_ADDR, MOCK_REG_ACC_X_LSB, data, LEN_XYZ, onComplete), I2C_cc_ERR_OK);
+    check("Busy while reading", isI2CBusy(), true);
+    check("Second transfer rejected", readI2CRegs(MOCK_ADDR, ZERO, data, ONE), I2C_cc_ERR_BUSY);
+    runIsr();
+    check("Non-blocking read done", isI2CBusy(), false);
+    check("Callback once", callbackCount, ONE);
+    check("Callback error", callbackError, I2C_cc_ERR_OK);
+    check("Non-blocking read data", memcmp(data, expected, LEN_XYZ), ZERO);
+    checkStats("Non-blocking read", ONE, LEN_XYZ + 3u);
+
+    /* Non-blocking write, the caller's buffer is copied */
+    resetBus();
+    callbackCount = ZERO;
+    check("Non-blocking write", writeI2CRegsNonBlocking(MOCK_ADDR, 0x50, writeData, sizeof(writeData), onComplete), I2C_cc_ERR_OK);
+    writeData[ZERO] = 0x00;
+    runIsr();
+    check("Non-blocking write callback", callbackCount, ONE);
+    check("Non-blocking write data", mockRegs[0x50], 0xA1);
+    checkStats("Non-blocking write", ONE, sizeof(writeData) + 2u);
+
+    /* Non-blocking error reaches the callback */
+    resetBus();
+    callbackCount = ZERO;
+    readI2CRegsNonBlocking(MOCK_ADDR + ONE, ZERO, data, LEN_XYZ, onComplete);
+    runIsr();
+    check("Non-blocking error callback", callbackCount, ONE);
+    check("Non-blocking error", callbackError, I2C_cc_ERR_I2C);
+    check("Idle after error", isI2CBusy(), false);
+
+    printf("\n%u failure(s)\n", failures);
+    return (failures == ZERO) ? 0 : 1;
+}
+
+/* [] END OF FILE */
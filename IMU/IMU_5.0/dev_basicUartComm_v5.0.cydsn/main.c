@@ -20,6 +20,7 @@
 ********************************************************************************/
 #include "project.h"
 #include "math.h"
+#include "I2C_cc.h"
 /*  -------------- DEBUGGING --------------
 * Uncomment MICA_DEBUG to enable general debugging.
 * Uncomment MICA_DEBUG_<case> below to
@@ -35,12 +36,22 @@
 //#define MICA_DEBUG_UART_TX        /* Send data through the UART to test connectivity */
 //#define MICA_DEBUG_ECHO           /* Echo to the USB UART */
 #define MICA_DEBUG_IMU          /* Test for the IMU */
+//#define MICA_DEBUG_I2C_BURST    /* Compare per-register and burst reads of the IMU */
 //#define MICA_DEBUG_FULL           /* Run a composite set of debugging functions */
 
 /* -------------- END DEBUG CONFIG --------------  */
 
 
 /* --------- Local Variables --------- */
+#if defined(MICA_DEBUG) && defined(MICA_DEBUG_I2C_BURST)
+/* Completion of the non-blocking read, set from the I2C interrupt */
+static volatile bool xferDone = false;
+static volatile uint32 xferError = ZERO;
+static void burstDone(uint32 error){
+    xferError = error;
+    xferDone = true;
+}
+#endif
 
 
 /*******************************************************************************
@@ -156,6 +167,59 @@ int main(void)
             MICA_delayMs(MICA_DELAY_MS_SEC_ONE);
         }
     /* End MICA_DEBUG_IMU */
+    #elif defined MICA_DEBUG_I2C_BURST
+        /* Compare per-register and burst reads of the IMU */
+        /* Expected outcome: Loop
+        * 1. Print the transactions & bytes used to read the Acc XYZ registers
+        *    one at a time (6 & 24), with one burst (1 & 9) and non-blocking (1 & 9)
+        * 2. Print the X MSB returned by each method
+        * 3a. Toggle the Blue LED - all reads succeeded
+        * 3b. Red LED - an I2C error occured
+        */
+        #define ACC_ADDR            (0x18u)
+        #define ACC_REG_X_LSB       (0x02u)
+        #define ACC_LEN_XYZ         (6u)
+        /* Start Components */
+        I2C_Start();
+        UART_Start();
+        LEDS_Write(LEDS_ON_GREEN);
+        for(;;){
+            uint8 single[ACC_LEN_XYZ];
+            uint8 burst[ACC_LEN_XYZ];
+            uint8 nonBlocking[ACC_LEN_XYZ];
+            I2C_cc_STATS_S stats;
+            uint8 i;
+            /* One register per transaction */
+            resetI2CStats();
+            for(i = ZERO; i < ACC_LEN_XYZ; i++){
+                single[i] = readI2CReg(ACC_ADDR, ACC_REG_X_LSB + i);
+            }
+            getI2CStats(&stats);
+            uartApi("Single: %lu transactions, %lu bytes\r\n", (unsigned long) stats.transactions, (unsigned long) stats.bytes);
+            /* Burst */
+            resetI2CStats();
+            uint32 err = readI2CRegs(ACC_ADDR, ACC_REG_X_LSB, burst, ACC_LEN_XYZ);
+            getI2CStats(&stats);
+            uartApi("Burst: %lu transactions, %lu bytes\r\n", (unsigned long) stats.transactions, (unsigned long) stats.bytes);
+            /* Non-blocking burst */
+            resetI2CStats();
+            xferDone = false;
+            err |= readI2CRegsNonBlocking(ACC_ADDR, ACC_REG_X_LSB, nonBlocking, ACC_LEN_XYZ, burstDone);
+            while(!err && !xferDone){}
+            err |= xferError;
+            getI2CStats(&stats);
+            uartApi("Non-blocking: %lu transactions, %lu bytes\r\n", (unsigned long) stats.transactions, (unsigned long) stats.bytes);
+            /* Data is sampled at different times, so print it rather than compare */
+            uartApi("X MSB: 0x%x 0x%x 0x%x\r\n", single[ONE], burst[ONE], nonBlocking[ONE]);
+            if(err){
+                LEDS_Write(LEDS_ON_RED);
+            } else {
+                LEDS_B_Toggle();
+            }
+            /* Delay for 1 second */
+            MICA_delayMs(MICA_DELAY_MS_SEC_ONE);
+        }
+    /* End MICA_DEBUG_I2C_BURST */
     #else
         #error "Exactly ONE MICA_DEBUG_<case> must be defined if MICA_DEBUG is defined"
     #endif /* MICA_DEBUG_<case> */
@@ -0,0 +1,342 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: bmx055Fifo.c
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   FIFO mode for the BMX055 accelerometer and gyroscope. Both FIFOs run in
+*   stream mode with an optional watermark interrupt on INT1, and are
+*   drained with a single I2C burst of up to bmx055Fifo_MAX_BURST_FRAMES
+*   frames, instead of one set of register reads per sample.
+*
+* 2018.10.30 CC - Document Created
+********************************************************************************/
+#include "bmx055Fifo.h"
+
+/* Accelerometer registers */
+#define ACC_REG_FIFO_STATUS     (0x0Eu)
+#define ACC_REG_RANGE           (0x0Fu)
+#define ACC_REG_BW              (0x10u)
+#define ACC_REG_INT_EN_1        (0x17u)
+#define ACC_REG_INT_MAP_1       (0x1Au)
+#define ACC_REG_FIFO_CONFIG_0   (0x30u)
+#define ACC_REG_FIFO_CONFIG_1   (0x3Eu)
+#define ACC_REG_FIFO_DATA       (0x3Fu)
+#define ACC_INT_EN_FWM          (0x40u)
+#define ACC_INT_MAP_INT1_FWM    (0x02u)
+/* Gyroscope registers */
+#define GYR_REG_FIFO_STATUS     (0x0Eu)
+#define GYR_REG_RANGE           (0x0Fu)
+#define GYR_REG_BW              (0x10u)
+#define GYR_REG_INT_EN_0        (0x15u)
+#define GYR_REG_INT_MAP_1       (0x18u)
+#define GYR_REG_FIFO_WM_EN      (0x1Eu)
+#define GYR_REG_FIFO_CONFIG_0   (0x3Du)
+#define GYR_REG_FIFO_CONFIG_1   (0x3Eu)
+#define GYR_REG_FIFO_DATA       (0x3Fu)
+#define GYR_INT_EN_FIFO         (0x40u)
+#define GYR_INT_MAP_INT1_FIFO   (0x04u)
+#define GYR_FIFO_WM_EN          (0x80u)
+/* Shared FIFO fields */
+#define FIFO_MODE_BYPASS        (0x00u)
+#define FIFO_MODE_STREAM        (0x80u) /**< Oldest frame is discarded when full, XYZ frames */
+#define FIFO_STATUS_OVERRUN     (0x80u)
+#define FIFO_STATUS_FRAMES      (0x7Fu)
+/* Frame layout, each axis LSB first */
+#define FRAME_INDEX_X           (0u)
+#define FRAME_INDEX_Y           (2u)
+#define FRAME_INDEX_Z           (4u)
+/* Scaling */
+#define ACC_SHIFT               (4u)    /**< 12 bit data is left aligned */
+#define ACC_COUNTS_FULL_SCALE   (2048.0f)
+#define GYR_COUNTS_FULL_SCALE   (32768.0f)
+#define GYR_FULL_SCALE_DPS      (2000u)
+#define GRAVITY_MS2             (9.80665f)
+#define DEG_TO_RAD              (0.0174532925f)
+
+/* Signed axis value from a frame */
+#define FRAME_AXIS(frame, index)    ((int16) (((frame)[(index) + ONE] << BITS_ONE_BYTE) | (frame)[(index)]))
+
+/* Burst buffer */
+static uint8 burstBuffer[bmx055Fifo_MAX_BURST_FRAMES * bmx055Fifo_LEN_FRAME];
+/* Scale factors of the active configuration */
+static float accScale = ZERO_F;
+static float gyrScale = ZERO_F;
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_readRegs()
+****************************************************************************//**
+* \brief
+*  Reads consecutive registers in one I2C transaction. Reading the FIFO data
+*   register repeatedly returns successive FIFO bytes.
+*
+* \param deviceAddr
+*   7-bit I2C address of the device
+*
+* \param startReg
+*   First register to read
+*
+* \param data [out]
+*   Location to place the register values
+*
+* \param len
+*   Number of bytes to read
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - The device did not acknowledge
+*******************************************************************************/
+uint32 bmx055Fifo_readRegs(uint8 deviceAddr, uint8 startReg, uint8 *data, uint16 len) {
+    if(len == ZERO){
+        return bmx055Fifo_ERR_OK;
+    }
+    uint32 err = I2C_I2CMasterSendStart(deviceAddr, I2C_I2C_WRITE_XFER_MODE);
+    if(err == I2C_I2C_MSTR_NO_ERROR){
+        err = I2C_I2CMasterWriteByte(startReg);
+    }
+    if(err == I2C_I2C_MSTR_NO_ERROR){
+        err = I2C_I2CMasterSendRestart(deviceAddr, I2C_I2C_READ_XFER_MODE);
+    }
+    if(err == I2C_I2C_MSTR_NO_ERROR){
+        /* ACK every byte but the last */
+        uint16 i;
+        for(i = ZERO; i < (len - ONE); i++){
+            data[i] = (uint8) I2C_I2CMasterReadByte(I2C_I2C_ACK_DATA);
+        }
+        data[i] = (uint8) I2C_I2CMasterReadByte(I2C_I2C_NAK_DATA);
+    }
+    I2C_I2CMasterSendStop();
+    return (err == I2C_I2C_MSTR_NO_ERROR) ? bmx055Fifo_ERR_OK : bmx055Fifo_ERR_I2C;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_writeReg()
+****************************************************************************//**
+* \brief
+*  Writes a single register
+*
+* \param deviceAddr
+*   7-bit I2C address of the device
+*
+* \param reg
+*   Register to write
+*
+* \param value
+*   Value to write
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - The device did not acknowledge
+*******************************************************************************/
+uint32 bmx055Fifo_writeReg(uint8 deviceAddr, uint8 reg, uint8 value) {
+    uint32 err = I2C_I2CMasterSendStart(deviceAddr, I2C_I2C_WRITE_XFER_MODE);
+    if(err == I2C_I2C_MSTR_NO_ERROR){
+        err = I2C_I2CMasterWriteByte(reg);
+    }
+    if(err == I2C_I2C_MSTR_NO_ERROR){
+        err = I2C_I2CMasterWriteByte(value);
+    }
+    I2C_I2CMasterSendStop();
+    return (err == I2C_I2C_MSTR_NO_ERROR) ? bmx055Fifo_ERR_OK : bmx055Fifo_ERR_I2C;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_start()
+****************************************************************************//**
+* \brief
+*  Sets the rate and range of the accelerometer and gyroscope, clears both
+*   FIFOs and places them in stream mode. A non zero watermark routes the
+*   watermark interrupt of that sensor to its INT1 pin.
+*
+* \param config
+*   FIFO configuration
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - A write was not acknowledged
+*  bmx055Fifo_ERR_WATERMARK - A watermark does not fit in its FIFO
+*******************************************************************************/
+uint32 bmx055Fifo_start(bmx055Fifo_CONFIG_S *config) {
+    if((config->accWatermark >= bmx055Fifo_ACC_DEPTH) || (config->gyrWatermark >= bmx055Fifo_GYR_DEPTH)){
+        return bmx055Fifo_ERR_WATERMARK;
+    }
+    uint32 err = bmx055Fifo_ERR_OK;
+    /* Accelerometer */
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_RANGE, config->accRange);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_BW, config->accBandwidth);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_FIFO_CONFIG_0, config->accWatermark);
+    /* Writing the mode also clears the FIFO */
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_FIFO_CONFIG_1, FIFO_MODE_STREAM);
+    bool accInt = (config->accWatermark != ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_INT_MAP_1, accInt ? ACC_INT_MAP_INT1_FWM : ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_INT_EN_1, accInt ? ACC_INT_EN_FWM : ZERO);
+    /* Gyroscope */
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_RANGE, config->gyrRange);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_BW, config->gyrRate);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_CONFIG_0, config->gyrWatermark);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_CONFIG_1, FIFO_MODE_STREAM);
+    bool gyrInt = (config->gyrWatermark != ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_WM_EN, gyrInt ? GYR_FIFO_WM_EN : ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_INT_MAP_1, gyrInt ? GYR_INT_MAP_INT1_FIFO : ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_INT_EN_0, gyrInt ? GYR_INT_EN_FIFO : ZERO);
+    /* Scale factors - [m/s^2] and [rad/s] per count */
+    float accRangeG;
+    switch(config->accRange){
+        case bmx055Fifo_ACC_RANGE_4G:
+            accRangeG = 4.0f;
+            break;
+        case bmx055Fifo_ACC_RANGE_8G:
+            accRangeG = 8.0f;
+            break;
+        case bmx055Fifo_ACC_RANGE_16G:
+            accRangeG = 16.0f;
+            break;
+        default:
+            accRangeG = 2.0f;
+            break;
+    }
+    accScale = (accRangeG * GRAVITY_MS2) / ACC_COUNTS_FULL_SCALE;
+    gyrScale = ((float) (GYR_FULL_SCALE_DPS >> config->gyrRange) * DEG_TO_RAD) / GYR_COUNTS_FULL_SCALE;
+    return err ? bmx055Fifo_ERR_I2C : bmx055Fifo_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_stop()
+****************************************************************************//**
+* \brief
+*  Returns both FIFOs to bypass mode and disables their interrupts
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - A write was not acknowledged
+*******************************************************************************/
+uint32 bmx055Fifo_stop(void) {
+    uint32 err = bmx055Fifo_ERR_OK;
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_INT_EN_1, ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_ACC_ADDR, ACC_REG_FIFO_CONFIG_1, FIFO_MODE_BYPASS);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_INT_EN_0, ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_WM_EN, ZERO);
+    err |= bmx055Fifo_writeReg(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_CONFIG_1, FIFO_MODE_BYPASS);
+    return err ? bmx055Fifo_ERR_I2C : bmx055Fifo_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_drain()
+****************************************************************************//**
+* \brief
+*  Reads the frame count of a FIFO, then bursts out as many frames as are
+*   available, up to maxFrames and bmx055Fifo_MAX_BURST_FRAMES
+*
+* \param deviceAddr
+*   I2C address of the sensor
+*
+* \param statusReg
+*   FIFO status register
+*
+* \param dataReg
+*   FIFO data register
+*
+* \param maxFrames
+*   Maximum number of frames to read
+*
+* \param status [out]
+*   Number of frames read into burstBuffer, and the overrun flag
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - A transaction was not acknowledged
+*******************************************************************************/
+static uint32 bmx055Fifo_drain(uint8 deviceAddr, uint8 statusReg, uint8 dataReg, uint8 maxFrames, bmx055Fifo_STATUS_S *status) {
+    status->frames = ZERO;
+    status->overrun = false;
+    uint8 fifoStatus;
+    uint32 err = bmx055Fifo_readRegs(deviceAddr, statusReg, &fifoStatus, ONE);
+    if(err){
+        return err;
+    }
+    uint8 frames = fifoStatus & FIFO_STATUS_FRAMES;
+    if(frames > maxFrames){
+        frames = maxFrames;
+    }
+    if(frames > bmx055Fifo_MAX_BURST_FRAMES){
+        frames = bmx055Fifo_MAX_BURST_FRAMES;
+    }
+    status->overrun = (fifoStatus & FIFO_STATUS_OVERRUN) ? true : false;
+    err = bmx055Fifo_readRegs(deviceAddr, dataReg, burstBuffer, (uint16) frames * bmx055Fifo_LEN_FRAME);
+    if(!err){
+        status->frames = frames;
+    }
+    return err;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_readAcc()
+****************************************************************************//**
+* \brief
+*  Drains the accelerometer FIFO, oldest frame first
+*
+* \param data [out]
+*   Array of at least maxFrames samples [m/s^2]
+*
+* \param maxFrames
+*   Maximum number of frames to read
+*
+* \param status [out]
+*   Number of frames read, and whether the FIFO overran
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - A transaction was not acknowledged
+*******************************************************************************/
+uint32 bmx055Fifo_readAcc(ACC_DATA_F *data, uint8 maxFrames, bmx055Fifo_STATUS_S *status) {
+    uint32 err = bmx055Fifo_drain(bmx055Fifo_ACC_ADDR, ACC_REG_FIFO_STATUS, ACC_REG_FIFO_DATA, maxFrames, status);
+    uint8 i;
+    for(i = ZERO; i < status->frames; i++){
+        uint8 *frame = &burstBuffer[i * bmx055Fifo_LEN_FRAME];
+        data[i].Ax = accScale * (float) (FRAME_AXIS(frame, FRAME_INDEX_X) >> ACC_SHIFT);
+        data[i].Ay = accScale * (float) (FRAME_AXIS(frame, FRAME_INDEX_Y) >> ACC_SHIFT);
+        data[i].Az = accScale * (float) (FRAME_AXIS(frame, FRAME_INDEX_Z) >> ACC_SHIFT);
+    }
+    return err;
+}
+
+/*******************************************************************************
+* Function Name: bmx055Fifo_readGyr()
+****************************************************************************//**
+* \brief
+*  Drains the gyroscope FIFO, oldest frame first
+*
+* \param data [out]
+*   Array of at least maxFrames samples [rad/s]
+*
+* \param maxFrames
+*   Maximum number of frames to read
+*
+* \param status [out]
+*   Number of frames read, and whether the FIFO overran
+*
+* \return
+*  bmx055Fifo_ERR_OK - Success
+*  bmx055Fifo_ERR_I2C - A transaction was not acknowledged
+*******************************************************************************/
+uint32 bmx055Fifo_readGyr(GYR_DATA_RAD_F *data, uint8 maxFrames, bmx055Fifo_STATUS_S *status) {
+    uint32 err = bmx055Fifo_drain(bmx055Fifo_GYR_ADDR, GYR_REG_FIFO_STATUS, GYR_REG_FIFO_DATA, maxFrames, status);
+    uint8 i;
+    for(i = ZERO; i < status->frames; i++){
+        uint8 *frame = &burstBuffer[i * bmx055Fifo_LEN_FRAME];
+        data[i].Wx = gyrScale * (float) FRAME_AXIS(frame, FRAME_INDEX_X);
+        data[i].Wy = gyrScale * (float) FRAME_AXIS(frame, FRAME_INDEX_Y);
+        data[i].Wz = gyrScale * (float) FRAME_AXIS(frame, FRAME_INDEX_Z);
+    }
+    return err;
+}
+
+/* [] END OF FILE */
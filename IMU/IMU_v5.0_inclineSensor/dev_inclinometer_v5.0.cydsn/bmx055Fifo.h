@@ -0,0 +1,100 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: bmx055Fifo.h
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   Header for bmx055Fifo.c
+*
+* 2018.10.30 CC - Document Created
+********************************************************************************/
+/* Header Guard */
+#ifndef BMX055_FIFO_H
+    #define BMX055_FIFO_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "micaCommon.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* I2C addresses */
+    #ifndef bmx055Fifo_ACC_ADDR
+        #define bmx055Fifo_ACC_ADDR             (0x18u)
+    #endif
+    #ifndef bmx055Fifo_GYR_ADDR
+        #define bmx055Fifo_GYR_ADDR             (0x68u)
+    #endif
+    /* FIFO sizes */
+    #define bmx055Fifo_ACC_DEPTH                (32u)   /**< Frames held by the accelerometer FIFO */
+    #define bmx055Fifo_GYR_DEPTH                (100u)  /**< Frames held by the gyroscope FIFO */
+    #define bmx055Fifo_LEN_FRAME                (6u)    /**< X, Y, Z LSB first */
+    #define bmx055Fifo_MAX_BURST_FRAMES         (32u)   /**< Frames read in a single burst */
+    /* Accelerometer bandwidth (output rate is twice the bandwidth) */
+    #define bmx055Fifo_ACC_BW_62_5HZ            (0x0Bu)
+    #define bmx055Fifo_ACC_BW_125HZ             (0x0Cu)
+    #define bmx055Fifo_ACC_BW_250HZ             (0x0Du)
+    #define bmx055Fifo_ACC_BW_500HZ             (0x0Eu)
+    #define bmx055Fifo_ACC_BW_1000HZ            (0x0Fu)
+    /* Accelerometer range */
+    #define bmx055Fifo_ACC_RANGE_2G             (0x03u)
+    #define bmx055Fifo_ACC_RANGE_4G             (0x05u)
+    #define bmx055Fifo_ACC_RANGE_8G             (0x08u)
+    #define bmx055Fifo_ACC_RANGE_16G            (0x0Cu)
+    /* Gyroscope output data rate */
+    #define bmx055Fifo_GYR_ODR_2000HZ           (0x01u)
+    #define bmx055Fifo_GYR_ODR_1000HZ           (0x02u)
+    #define bmx055Fifo_GYR_ODR_400HZ            (0x03u)
+    #define bmx055Fifo_GYR_ODR_200HZ            (0x04u)
+    #define bmx055Fifo_GYR_ODR_100HZ            (0x05u)
+    /* Gyroscope range, full scale is 2000 deg/s >> range */
+    #define bmx055Fifo_GYR_RANGE_2000DPS        (0x00u)
+    #define bmx055Fifo_GYR_RANGE_1000DPS        (0x01u)
+    #define bmx055Fifo_GYR_RANGE_500DPS         (0x02u)
+    #define bmx055Fifo_GYR_RANGE_250DPS         (0x03u)
+    #define bmx055Fifo_GYR_RANGE_125DPS         (0x04u)
+    /* Error codes */
+    #define bmx055Fifo_ERR_OK                   (0u)
+    #define bmx055Fifo_ERR_I2C                  (1u)    /**< Transaction was not acknowledged */
+    #define bmx055Fifo_ERR_WATERMARK            (2u)    /**< Watermark larger than the FIFO */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* FIFO configuration */
+    typedef struct {
+        uint8 accBandwidth;     /**< bmx055Fifo_ACC_BW_<rate> */
+        uint8 accRange;         /**< bmx055Fifo_ACC_RANGE_<range> */
+        uint8 accWatermark;     /**< Frames before INT1 asserts, 0 disables */
+        uint8 gyrRate;          /**< bmx055Fifo_GYR_ODR_<rate> */
+        uint8 gyrRange;         /**< bmx055Fifo_GYR_RANGE_<range> */
+        uint8 gyrWatermark;     /**< Frames before INT1 asserts, 0 disables */
+    } bmx055Fifo_CONFIG_S;
+
+    /* Result of a drain */
+    typedef struct {
+        uint8 frames;           /**< Frames returned */
+        bool overrun;           /**< Frames were lost before the drain */
+    } bmx055Fifo_STATUS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    uint32 bmx055Fifo_start(bmx055Fifo_CONFIG_S *config);
+    uint32 bmx055Fifo_stop(void);
+    uint32 bmx055Fifo_readAcc(ACC_DATA_F *data, uint8 maxFrames, bmx055Fifo_STATUS_S *status);
+    uint32 bmx055Fifo_readGyr(GYR_DATA_RAD_F *data, uint8 maxFrames, bmx055Fifo_STATUS_S *status);
+    uint32 bmx055Fifo_readRegs(uint8 deviceAddr, uint8 startReg, uint8 *data, uint16 len);
+    uint32 bmx055Fifo_writeReg(uint8 deviceAddr, uint8 reg, uint8 value);
+
+#endif /* BMX055_FIFO_H */
+/* [] END OF FILE */
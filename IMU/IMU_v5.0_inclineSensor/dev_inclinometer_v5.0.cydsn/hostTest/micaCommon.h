@@ -0,0 +1,44 @@
+/***************************************************************************
+*                                       MICA
+* File: micaCommon.h
+* Project Name: dev_inclinometer host test
+*
+* Brief:
+*   Stands in for the libMica and BMX055 component headers when
+*   inclinometer.c, trace.c and traceDecode.c are built on a Linux host.
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#ifndef HOST_MICA_COMMON_H
+    #define HOST_MICA_COMMON_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <math.h>
+
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef uint64_t uint64;
+    typedef int8_t int8;
+    typedef int16_t int16;
+    typedef int32_t int32;
+    typedef int64_t int64;
+
+    #define ZERO    (0u)
+    #define ONE     (1u)
+    #define TWO     (2u)
+    #define ZERO_F  (0.0f)
+    #define HALF_F  (0.5f)
+    #define ONE_F   (1.0f)
+    #define TWO_F   (2.0f)
+    #define MASK_BYTE_ONE   (0xFFu)
+    #define BITS_ONE_BYTE   (8u)
+
+    typedef struct { float Ax; float Ay; float Az; } ACC_DATA_F;
+    typedef struct { float Wx; float Wy; float Wz; } GYR_DATA_RAD_F;
+    typedef struct { float X; float Y; float Z; } MAG_DATA_F;
+    typedef struct { float q1; float q2; float q3; float q4; } QUATERNION_T;
+    typedef struct { float pitch; float yaw; float roll; } EULER_ANGLE_T;
+#endif /* HOST_MICA_COMMON_H */
+/* [] END OF FILE */
@@ -0,0 +1,26 @@
+/***************************************************************************
+*                                       MICA
+* File: project.h
+* Project Name: dev_inclinometer host test
+*
+* Brief:
+*   Stands in for the generated project.h when trace.c is built on a Linux
+*   host. The UART calls go to the mock TX FIFO in test_trace.c.
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#ifndef HOST_PROJECT_H
+    #define HOST_PROJECT_H
+    #include "micaCommon.h"
+
+    /* No interrupts on the host */
+    static inline uint8 CyEnterCriticalSection(void) { return ZERO; }
+    static inline void CyExitCriticalSection(uint8 state) { (void) state; }
+
+    /* SCB UART API used by trace.c */
+    #define UART_FIFO_SIZE  (8u)
+    uint32 UART_SpiUartGetTxBufferSize(void);
+    void UART_SpiUartWriteTxData(uint32 txData);
+#endif /* HOST_PROJECT_H */
+/* [] END OF FILE */
@@ -0,0 +1,108 @@
+/***************************************************************************
+*                                       MICA
+* File: test_inclinometer.c
+* Project Name: dev_inclinometer host test
+*
+* Brief:
+*   Compares the fixed point filter with the float filter on a Linux host.
+*   Each case turns at a constant rate about the gravity axis for 10 s, so the
+*   accelerometer applies no correction and the heading is pure integration.
+*   A last case holds the sensor still with a gyroscope bias and checks the
+*   magnetometer (MARG) update holds the heading and starts to track the bias.
+*
+*   Build and run from the project directory:
+*     gcc -std=gnu99 -Wall -I hostTest -I . hostTest/test_inclinometer.c inclinometer.c -lm -o test_inclinometer && ./test_inclinometer
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#include <stdio.h>
+#include "inclinometer.h"
+
+#define TEST_DURATION_S     (10.0f)
+#define TEST_TOLERANCE      (0.02f)     /**< Fixed may differ from float by 2% */
+#define TEST_TOLERANCE_DEG  (0.5f)      /**< or by half a degree */
+#define TEST_MARG_PERIOD    (0.01f)     /**< MARG update period [s] */
+#define TEST_MARG_DURATION_S    (60.0f)
+#define TEST_MARG_BIAS      (1.0f)      /**< Gyroscope bias about z [deg/s] */
+#define TEST_MARG_DIP       (60.0f)     /**< Inclination of the field [deg] */
+#define TEST_MARG_TOLERANCE_DEG (2.0f)  /**< Largest heading error with the magnetometer */
+
+/* Heading of a quaternion turned about z [deg] */
+static float headingDeg(float q1, float q4){
+    return atan2f(TWO_F * q1 * q4, ONE_F - (TWO_F * q4 * q4)) / INCLINOMETER_DEG_TO_RAD;
+}
+
+/* Adds the change in heading, unwrapped across +/-180 deg */
+static void unwrap(float *total, float *last, float now){
+    float step = now - *last;
+    step -= (step > 180.0f) ? 360.0f : ((step < -180.0f) ? -360.0f : ZERO_F);
+    *total += step;
+    *last = now;
+}
+
+/* Holds the sensor still with a gyroscope bias about z. Returns the heading
+* after TEST_MARG_DURATION_S [deg], with or without the magnetometer */
+static float margDrift(bool useMag, float *biasEstimate){
+    INCLINOMETER_FILTER_T filter;
+    inclinometer_init(&filter, TEST_MARG_PERIOD, GYRO_MEAS_ERROR / INCLINOMETER_DEG_TO_RAD);
+    ACC_DATA_F acc = {ZERO_F, ZERO_F, ONE_F};
+    GYR_DATA_RAD_F gyr = {ZERO_F, ZERO_F, TEST_MARG_BIAS * INCLINOMETER_DEG_TO_RAD};
+    MAG_DATA_F mag = {cosf(TEST_MARG_DIP * INCLINOMETER_DEG_TO_RAD), ZERO_F, sinf(TEST_MARG_DIP * INCLINOMETER_DEG_TO_RAD)};
+    uint32 steps = (uint32) (TEST_MARG_DURATION_S / TEST_MARG_PERIOD + HALF_F);
+    uint32 i;
+    for(i = ZERO; i < steps; i++){
+        if(useMag){
+            inclinometer_updateMarg(&filter, &acc, &gyr, &mag);
+        } else {
+            inclinometer_update(&filter, &acc, &gyr);
+        }
+    }
+    *biasEstimate = filter.gyrBias.Wz / INCLINOMETER_DEG_TO_RAD;
+    return headingDeg(filter.state.q1, filter.state.q4);
+}
+
+int main(void){
+    const float rates[] = {0.5f, 1.0f, 2.0f, 5.0f, 20.0f, 90.0f};
+    const float periods[] = {0.01f, 0.001f};
+    uint32 failures = ZERO;
+    uint8 p, r;
+    for(p = ZERO; p < sizeof(periods) / sizeof(periods[ZERO]); p++){
+        float dt = periods[p];
+        uint32 steps = (uint32) (TEST_DURATION_S / dt + HALF_F);
+        for(r = ZERO; r < sizeof(rates) / sizeof(rates[ZERO]); r++){
+            ACC_DATA_F acc = {ZERO_F, ZERO_F, ONE_F};
+            GYR_DATA_RAD_F gyr = {ZERO_F, ZERO_F, rates[r] * INCLINOMETER_DEG_TO_RAD};
+            VECTOR_Q15_T accQ15 = {ZERO, ZERO, Q15_ONE};
+            VECTOR_Q15_T gyrQ15 = {ZERO, ZERO, FLOAT_TO_Q15(gyr.Wz)};
+            QUATERNION_T stateF = {ONE_F, ZERO_F, ZERO_F, ZERO_F};
+            QUATERNION_Q30_T stateQ = {Q30_ONE, ZERO, ZERO, ZERO};
+            float totalF = ZERO_F, lastF = ZERO_F, totalQ = ZERO_F, lastQ = ZERO_F;
+            uint32 i;
+            for(i = ZERO; i < steps; i++){
+                inclinometer_updateFilterFloat(&acc, &gyr, dt, BETA, &stateF);
+                inclinometer_updateFilterFixed(&accQ15, &gyrQ15, FLOAT_TO_Q24(dt), FLOAT_TO_Q15(BETA), &stateQ);
+                unwrap(&totalF, &lastF, headingDeg(stateF.q1, stateF.q4));
+                unwrap(&totalQ, &lastQ, headingDeg(Q30_TO_FLOAT(stateQ.q1), Q30_TO_FLOAT(stateQ.q4)));
+            }
+            float error = fabsf(totalQ - totalF);
+            bool pass = (error <= TEST_TOLERANCE_DEG) || (error <= TEST_TOLERANCE * fabsf(totalF));
+            printf("%s: dt %5.3f s, %5.1f deg/s: float %7.2f deg, fixed %7.2f deg\n",
+                pass ? "PASS" : "FAIL", dt, rates[r], totalF, totalQ);
+            failures += pass ? ZERO : ONE;
+        }
+    }
+    /* Heading held by the magnetometer while the gyroscope is biased */
+    float bias;
+    float imuYaw = margDrift(false, &bias);
+    float margYaw = margDrift(true, &bias);
+    bool pass = (fabsf(margYaw) <= TEST_MARG_TOLERANCE_DEG) && (bias > HALF_F * TEST_MARG_BIAS);
+    printf("%s: %4.1f deg/s bias for %2.0f s: IMU heading %6.2f deg, MARG heading %5.2f deg, bias estimate %4.2f deg/s\n",
+        pass ? "PASS" : "FAIL", TEST_MARG_BIAS, TEST_MARG_DURATION_S, imuYaw, margYaw, bias);
+    failures += pass ? ZERO : ONE;
+
+    printf("\n%u failure(s)\n", failures);
+    return (failures == ZERO) ? 0 : 1;
+}
+
+/* [] END OF FILE */
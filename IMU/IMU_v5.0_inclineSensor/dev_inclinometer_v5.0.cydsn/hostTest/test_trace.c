@@ -0,0 +1,125 @@
+/***************************************************************************
+*                                       MICA
+* File: test_trace.c
+* Project Name: dev_inclinometer host test
+*
+* Brief:
+*   Round trip of the binary trace channel on a Linux host. trace.c writes
+*   into a mock UART TX FIFO and traceDecode.c decodes the captured stream,
+*   including a corrupted byte and a ring overflow.
+*
+*   Build and run from the project directory:
+*     gcc -std=gnu99 -Wall -DTRACE_DECODE_NO_MAIN -I hostTest -I . hostTest/test_trace.c hostTest/traceDecode.c trace.c -o test_trace && ./test_trace
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "traceDecode.h"
+
+#define TEST_LEN_STREAM     (4096u)
+
+/* Mock UART, the TX FIFO never fills */
+static uint8 stream[TEST_LEN_STREAM];
+static uint32 streamLen;
+static uint32 now;
+
+uint32 UART_SpiUartGetTxBufferSize(void){
+    return ZERO;
+}
+
+void UART_SpiUartWriteTxData(uint32 txData){
+    if(streamLen < TEST_LEN_STREAM){
+        stream[streamLen++] = (uint8) txData;
+    }
+}
+
+static uint32 testTimestamp(void){
+    return now;
+}
+
+/* Test helpers */
+static uint32 failures = ZERO;
+
+static void checkLine(const char *name, const char *actual, const char *expected){
+    bool pass = (strcmp(actual, expected) == ZERO);
+    printf("%s: %s\n", pass ? "PASS" : "FAIL", name);
+    if(!pass){
+        printf("  got      '%s'\n  expected '%s'\n", actual, expected);
+    }
+    failures += pass ? ZERO : ONE;
+}
+
+static void check(const char *name, uint32 actual, uint32 expected){
+    bool pass = (actual == expected);
+    printf("%s: %s (got %u, expected %u)\n", pass ? "PASS" : "FAIL", name, actual, expected);
+    failures += pass ? ZERO : ONE;
+}
+
+/* Decodes the captured stream, returns the number of lines */
+static uint32 decode(traceDecode_STATE_T *state, char lines[][traceDecode_LEN_LINE], uint32 maxLines){
+    uint32 count = ZERO;
+    uint32 i;
+    for(i = ZERO; (i < streamLen) && (count < maxLines); i++){
+        if(traceDecode_feed(state, stream[i], lines[count], traceDecode_LEN_LINE)){
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(void){
+    traceDecode_STATE_T state;
+    char lines[8][traceDecode_LEN_LINE];
+
+    /* Formats, floats and integers */
+    trace_init(testTimestamp);
+    streamLen = ZERO;
+    now = 1000u;
+    trace_write(trace_ID_EULER, trace_float(12.34f), trace_float(-5.0f), trace_float(0.06f));
+    now = 2000u;
+    trace_write(trace_ID_PERIOD, trace_float(1.5f), trace_float(-2.25f), 5000u);
+    trace_process();
+    check("Stream length", streamLen, TWO * trace_LEN_RECORD);
+    traceDecode_init(&state);
+    check("Records decoded", decode(&state, lines, 8u), TWO);
+    checkLine("Float arguments", lines[0], "      1000   0 Yaw: 12.3, Pitch: -5.0, Roll: 0.1");
+    checkLine("Integer argument", lines[1], "      2000   1 Pitch: 1.5, Roll: -2.2, Period: 5000 us");
+
+    /* A corrupted record is dropped and the next one still decodes */
+    trace_init(testTimestamp);
+    streamLen = ZERO;
+    now = 7u;
+    trace_write(trace_ID_TILT_DIFF, trace_float(0.5f), ZERO, ZERO);
+    trace_write(trace_ID_QUATERNION_Z, trace_float(1.0f), ZERO, ZERO);
+    trace_process();
+    stream[trace_INDEX_ARGS] ^= 0x10u;
+    traceDecode_init(&state);
+    check("Records after corruption", decode(&state, lines, 8u), ONE);
+    checkLine("Resynchronized", lines[0], "         7   1 Qz: 1.0000");
+    check("Bad records", state.badRecords, ONE);
+
+    /* Ring overflow is reported by the firmware */
+    trace_init(testTimestamp);
+    streamLen = ZERO;
+    now = ZERO;
+    uint32 i;
+    for(i = ZERO; i < trace_RING_LEN + 4u; i++){
+        trace_write(trace_ID_GYR_BIAS, ZERO, ZERO, ZERO);
+    }
+    trace_process();
+    trace_write(trace_ID_GYR_BIAS, ZERO, ZERO, ZERO);
+    trace_process();
+    traceDecode_init(&state);
+    char all[trace_RING_LEN + 2u][traceDecode_LEN_LINE];
+    uint32 count = decode(&state, all, trace_RING_LEN + 2u);
+    check("Records after overflow", count, trace_RING_LEN + ONE);
+    checkLine("Dropped report", all[trace_RING_LEN - ONE], "         0  31 Trace dropped 5 records");
+    check("No records lost on the link", state.lostRecords, ZERO);
+
+    printf("\n%u failure(s)\n", failures);
+    return (failures == ZERO) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,226 @@
+/***************************************************************************
+*                                       MICA
+* File: traceDecode.c
+* Project Name: dev_inclinometer host tools
+*
+* Brief:
+*   Decodes the binary trace records of trace.c on a Linux host. The format
+*   strings are built from the same trace_FORMATS table as the firmware IDs,
+*   so the two cannot get out of step. Records that fail the checksum are
+*   dropped and the decoder resynchronizes on the next sync byte.
+*
+*   Build, then read a port set up with stty, or a capture file:
+*     gcc -std=gnu99 -Wall -I hostTest -I . hostTest/traceDecode.c -o traceDecode
+*     stty -F /dev/ttyACM0 115200 raw && ./traceDecode /dev/ttyACM0
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "traceDecode.h"
+
+/* Format strings, indexed by trace_ID_T */
+#define trace_FORMAT_ENTRY(id, format)  format,
+static const char *formats[trace_NUM_IDS] = {
+    trace_FORMATS(trace_FORMAT_ENTRY)
+};
+
+/*******************************************************************************
+* Function Name: unpackWord()
+****************************************************************************//**
+* \brief
+*   Reads a 32 bit word from a record, MSB first
+*******************************************************************************/
+static uint32 unpackWord(const uint8 *src){
+    uint32 word = ZERO;
+    uint8 i;
+    for(i = ZERO; i < trace_LEN_ARG; i++){
+        word = (word << BITS_ONE_BYTE) | src[i];
+    }
+    return word;
+}
+
+/*******************************************************************************
+* Function Name: formatArgs()
+****************************************************************************//**
+* \brief
+*   Expands a trace format with the record arguments. %f, %e and %g take the
+*   bit pattern of a float, %d and %i a signed word, anything else unsigned.
+*******************************************************************************/
+static void formatArgs(const char *format, const uint32 *args, char *out, size_t outLen){
+    size_t used = ZERO;
+    uint8 argIndex = ZERO;
+    while((*format != '\0') && (used + ONE < outLen)){
+        if(*format != '%'){
+            out[used++] = *format++;
+            continue;
+        }
+        if(format[ONE] == '%'){
+            out[used++] = '%';
+            format += TWO;
+            continue;
+        }
+        /* Copy the conversion specification */
+        const char *end = format + ONE;
+        while((*end != '\0') && (strchr("diufeEgGxX", *end) == NULL)){
+            end++;
+        }
+        char spec[16];
+        size_t specLen = (size_t) (end - format) + ONE;
+        if((*end == '\0') || (specLen >= sizeof(spec))){
+            break;
+        }
+        memcpy(spec, format, specLen);
+        spec[specLen] = '\0';
+        uint32 arg = (argIndex < trace_MAX_ARGS) ? args[argIndex++] : ZERO;
+        int written;
+        if(strchr("feEgG", *end) != NULL){
+            float value;
+            memcpy(&value, &arg, sizeof(value));
+            written = snprintf(&out[used], outLen - used, spec, (double) value);
+        } else if((*end == 'd') || (*end == 'i')){
+            written = snprintf(&out[used], outLen - used, spec, (int32) arg);
+        } else {
+            written = snprintf(&out[used], outLen - used, spec, arg);
+        }
+        if(written > 0){
+            used += (size_t) written;
+            if(used >= outLen){
+                used = outLen - ONE;
+            }
+        }
+        format = end + ONE;
+    }
+    out[used] = '\0';
+}
+
+/*******************************************************************************
+* Function Name: checkRecord()
+****************************************************************************//**
+* \brief
+*   Returns true if the XOR of the record bytes matches its checksum
+*******************************************************************************/
+static bool checkRecord(const uint8 *record){
+    uint8 checksum = ZERO;
+    uint8 i;
+    for(i = ZERO; i < trace_LEN_RECORD; i++){
+        if(i != trace_INDEX_CHECKSUM){
+            checksum ^= record[i];
+        }
+    }
+    return checksum == record[trace_INDEX_CHECKSUM];
+}
+
+/*******************************************************************************
+* Function Name: traceDecode_init()
+****************************************************************************//**
+* \brief
+*   Resets a decoder, call before the first byte of a stream
+*
+* \param state
+*   Decoder state
+*******************************************************************************/
+void traceDecode_init(traceDecode_STATE_T *state){
+    memset(state, ZERO, sizeof(*state));
+}
+
+/*******************************************************************************
+* Function Name: traceDecode_feed()
+****************************************************************************//**
+* \brief
+*   Adds one received byte. When it completes a valid record, the record is
+*   decoded as "<timestamp> <sequence> <text>".
+*
+* \param state
+*   Decoder state
+*
+* \param byte
+*   Received byte
+*
+* \param line
+*   Buffer for the decoded record
+*
+* \param lineLen
+*   Size of line, traceDecode_LEN_LINE is enough for every format
+*
+* \return
+*   true if a record was decoded into line
+*******************************************************************************/
+bool traceDecode_feed(traceDecode_STATE_T *state, uint8 byte, char *line, size_t lineLen){
+    /* Wait for a sync byte */
+    if((state->count == ZERO) && (byte != trace_SYNC)){
+        return false;
+    }
+    state->record[state->count++] = byte;
+    if(state->count < trace_LEN_RECORD){
+        return false;
+    }
+    /* Bad record, resynchronize on the next sync byte in what was received */
+    if(!checkRecord(state->record)){
+        state->badRecords++;
+        uint8 i = ONE;
+        while((i < trace_LEN_RECORD) && (state->record[i] != trace_SYNC)){
+            i++;
+        }
+        state->count = trace_LEN_RECORD - i;
+        memmove(state->record, &state->record[i], state->count);
+        return false;
+    }
+    state->count = ZERO;
+    /* Sequence gaps are records lost on the link */
+    uint8 sequence = state->record[trace_INDEX_SEQUENCE];
+    if(state->sequenceValid){
+        state->lostRecords += (uint8) (sequence - state->nextSequence);
+    }
+    state->nextSequence = sequence + ONE;
+    state->sequenceValid = true;
+    /* Decode */
+    uint8 id = state->record[trace_INDEX_ID];
+    uint32 timestamp = unpackWord(&state->record[trace_INDEX_TIMESTAMP]);
+    uint32 args[trace_MAX_ARGS];
+    uint8 i;
+    for(i = ZERO; i < trace_MAX_ARGS; i++){
+        args[i] = unpackWord(&state->record[trace_INDEX_ARGS + (i * trace_LEN_ARG)]);
+    }
+    char text[traceDecode_LEN_LINE];
+    if(id < trace_NUM_IDS){
+        formatArgs(formats[id], args, text, sizeof(text));
+    } else {
+        snprintf(text, sizeof(text), "Unknown ID %u: 0x%08X 0x%08X 0x%08X", id, args[0], args[1], args[2]);
+    }
+    snprintf(line, lineLen, "%10u %3u %s", timestamp, sequence, text);
+    return true;
+}
+
+#ifndef TRACE_DECODE_NO_MAIN
+int main(int argc, char **argv){
+    FILE *in = stdin;
+    if(argc > 1){
+        in = fopen(argv[ONE], "rb");
+        if(in == NULL){
+            perror(argv[ONE]);
+            return 1;
+        }
+    }
+    traceDecode_STATE_T state;
+    traceDecode_init(&state);
+    char line[traceDecode_LEN_LINE];
+    uint32 lost = ZERO;
+    int byte;
+    while((byte = fgetc(in)) != EOF){
+        if(traceDecode_feed(&state, (uint8) byte, line, sizeof(line))){
+            if(state.lostRecords != lost){
+                printf("-- %u record(s) lost --\n", state.lostRecords - lost);
+                lost = state.lostRecords;
+            }
+            puts(line);
+            fflush(stdout);
+        }
+    }
+    fprintf(stderr, "%u bad record(s), %u lost\n", state.badRecords, state.lostRecords);
+    return 0;
+}
+#endif /* TRACE_DECODE_NO_MAIN */
+
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/***************************************************************************
+*                                       MICA
+* File: traceDecode.h
+* Project Name: dev_inclinometer host tools
+*
+* Brief:
+*   Header for traceDecode.c
+*
+* Change Log:
+*   2018.11.14 CC - Document created
+********************************************************************************/
+#ifndef TRACE_DECODE_H
+    #define TRACE_DECODE_H
+    #include <stddef.h>
+    #include "trace.h"
+
+    #define traceDecode_LEN_LINE    (160u)  /**< Longest decoded line */
+
+    /* Decoder state, one per trace stream */
+    typedef struct {
+        uint8 record[trace_LEN_RECORD]; /**< Bytes of the record being received */
+        uint8 count;                    /**< Bytes in record */
+        bool sequenceValid;             /**< nextSequence is known */
+        uint8 nextSequence;             /**< Expected sequence of the next record */
+        uint32 badRecords;              /**< Records discarded on the checksum */
+        uint32 lostRecords;             /**< Records missing from the sequence */
+    } traceDecode_STATE_T;
+
+    void traceDecode_init(traceDecode_STATE_T *state);
+    bool traceDecode_feed(traceDecode_STATE_T *state, uint8 byte, char *line, size_t lineLen);
+#endif /* TRACE_DECODE_H */
+/* [] END OF FILE */
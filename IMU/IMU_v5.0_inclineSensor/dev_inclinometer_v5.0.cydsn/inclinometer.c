@@ -15,12 +15,706 @@
 #include "inclinometer.h"
 #include <math.h> /**< Needed for sqrt function */
 
+/* Fixed point filter constants */
+#define BETA_Q15            FLOAT_TO_Q15(BETA)      /**< Gain of inclinometer_updateFilter() */
+#define DELTA_T_Q24         FLOAT_TO_Q24(DELTA_T)   /**< Sampling period of inclinometer_updateFilter() */
+#define MAX_ROTATION_Q24    (3L << Q24_SHIFT)       /**< Largest rotation per update [rad], keeps products in range */
+#define NORM_MIN            (1L << 13)  /**< Lower bound of the largest element before normalizing */
+#define NORM_MAX            (1L << 14)  /**< Upper bound of the largest element before normalizing */
+#define INV_SQRT_MIN        (1UL << 30) /**< Lower bound of the mantissa of the inverse sqrt */
+#define INV_SQRT_ITERATIONS (3u)    /**< Newton-Raphson iterations of the inverse sqrt */
+#define ONE_SIXTH_Q15       (5461)  /**< 1/6 in Q15 */
+#define LEN_VECT            (3u)    /**< Elements in an axis vector */
+#define LEN_QUAT            (4u)    /**< Elements in a quaternion */
+#define Q15_ROUND           (1L << (Q15_SHIFT - 1u))  /**< Half an LSB before the shift */
+/* Multiply two Q15 values, rounded to nearest so the integration does not drift */
+#define Q15_MUL(a, b)       ((((a) * (b)) + Q15_ROUND) >> Q15_SHIFT)
+/* Gradient product of a half quaternion element (Q14) and the objective function (Q15).
+* Only the direction of the gradient is kept, so the result is left in Q20 */
+#define GRAD_MUL(h, f)      (((h) * (f)) >> 9u)
+/* Rounded Q30 to Q15, the gradient only needs the direction of the estimate */
+#define Q30_TO_Q15(x)       (((x) + Q15_ROUND) >> Q15_SHIFT)
+/* The integration is accumulated in Q54 (Q30 state x Q24 rotation) and shifted once */
+#define Q54_TO_Q30_SHIFT    (24u)
+#define Q54_ROUND           (1LL << (Q54_TO_Q30_SHIFT - 1u))
+
+/*******************************************************************************
+* Function Name: invSqrtQ15()
+****************************************************************************//**
+*
+* \brief Computes 1/sqrt(x) without a divide. The Cortex-M0 has neither an FPU
+* nor a hardware divider, so x is normalized by an even power of two and a
+* linear seed is refined with Newton-Raphson, which only multiplies.
+*
+* \param x
+* Value to take the inverse square root of, must be non-zero
+*
+* \param halfExp
+* Set to half of the shift applied to x. The result must be shifted left by
+* this many bits to get 1/sqrt(x) relative to the unshifted mantissa.
+*
+* \return
+* Inverse square root of the mantissa of x in Q15, in (0.5, 1]
+*
+*******************************************************************************/
+static int32 invSqrtQ15(uint32 x, uint8 *halfExp){
+    uint8 shift = ZERO;
+    /* Bring x into [2^30, 2^32) using an even shift */
+    while(x < INV_SQRT_MIN){
+        x <<= TWO;
+        shift++;
+    }
+    *halfExp = shift;
+    /* Mantissa in [1, 4) as Q14 */
+    uint32 m = x >> 16u;
+    /* Linear seed y0 = (7 - m) / 6 */
+    uint32 y = (((7UL << 14u) - m) * ONE_SIXTH_Q15) >> 14u;
+    /* Newton-Raphson: y = y * (3 - m*y^2) / 2 */
+    uint8 i;
+    for(i = ZERO; i < INV_SQRT_ITERATIONS; i++){
+        uint32 y2 = (y * y) >> Q15_SHIFT;
+        uint32 my2 = (m * y2) >> 14u;
+        y = (y * ((3UL << Q15_SHIFT) - my2)) >> 16u;
+    }
+    return (int32) y;
+}
+
+/*******************************************************************************
+* Function Name: normalizeQ15()
+****************************************************************************//**
+*
+* \brief Scales a vector to unit length in Q15. The vector is first block scaled
+* so the squares are summed without overflow and with enough resolution.
+*
+* \param vect
+* Vector to normalize, in any scale
+*
+* \param len
+* Number of elements in the vector, at most 4
+*
+* \return
+* false if the vector is zero and could not be normalized, otherwise true
+*
+*******************************************************************************/
+static bool normalizeQ15(int32 *vect, uint8 len){
+    uint32 maxAbs = ZERO;
+    uint8 i;
+    /* Find the largest element */
+    for(i = ZERO; i < len; i++){
+        uint32 absVal = (vect[i] < 0) ? (uint32) (-vect[i]) : (uint32) vect[i];
+        if(absVal > maxAbs){
+            maxAbs = absVal;
+        }
+    }
+    if(maxAbs == ZERO){
+        return false;
+    }
+    /* Block scale so the largest element is in [2^13, 2^14) */
+    uint8 down = ZERO;
+    uint8 up = ZERO;
+    while(maxAbs >= NORM_MAX){
+        maxAbs >>= ONE;
+        down++;
+    }
+    while(maxAbs < NORM_MIN){
+        maxAbs <<= ONE;
+        up++;
+    }
+    uint32 sumSq = ZERO;
+    for(i = ZERO; i < len; i++){
+        vect[i] = (vect[i] >> down) * (1L << up);
+        sumSq += (uint32) (vect[i] * vect[i]);
+    }
+    /* Scale by the inverse norm */
+    uint8 halfExp;
+    int32 invNorm = invSqrtQ15(sumSq, &halfExp);
+    for(i = ZERO; i < len; i++){
+        vect[i] = ((vect[i] * invNorm) + (1L << (Q15_SHIFT - halfExp - 1u))) >> (Q15_SHIFT - halfExp);
+    }
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: normalizeQ30()
+****************************************************************************//**
+*
+* \brief Scales the integrated state back to a unit quaternion in Q30. The
+* norm is found from a block scaled copy as in normalizeQ15(), but the scale
+* is applied to the full precision elements so small rotations are kept.
+*
+* \param quat
+* Quaternion to normalize, close to Q30
+*
+* \return
+* false if the quaternion is zero and could not be normalized, otherwise true
+*
+*******************************************************************************/
+static bool normalizeQ30(int64 *quat){
+    uint64 maxAbs = ZERO;
+    uint8 i;
+    /* Find the largest element */
+    for(i = ZERO; i < LEN_QUAT; i++){
+        uint64 absVal = (quat[i] < 0) ? (uint64) (-quat[i]) : (uint64) quat[i];
+        if(absVal > maxAbs){
+            maxAbs = absVal;
+        }
+    }
+    if(maxAbs == ZERO){
+        return false;
+    }
+    /* Block scale the copy so the largest element is in [2^13, 2^14) */
+    int8 shift = ZERO;
+    while(maxAbs >= NORM_MAX){
+        maxAbs >>= ONE;
+        shift++;
+    }
+    while(maxAbs < NORM_MIN){
+        maxAbs <<= ONE;
+        shift--;
+    }
+    uint32 sumSq = ZERO;
+    for(i = ZERO; i < LEN_QUAT; i++){
+        int32 scaled = (shift >= 0) ? (int32) (quat[i] >> shift) : (int32) (quat[i] * (1LL << -shift));
+        sumSq += (uint32) (scaled * scaled);
+    }
+    uint8 halfExp;
+    int64 invNorm = invSqrtQ15(sumSq, &halfExp);
+    /* Unit quaternion in Q30 = quat * invNorm >> (shift - halfExp) */
+    int8 outShift = shift - (int8) halfExp;
+    for(i = ZERO; i < LEN_QUAT; i++){
+        int64 product = quat[i] * invNorm;
+        quat[i] = (outShift > 0) ? ((product + (1LL << (outShift - 1))) >> outShift) : (product * (1LL << -outShift));
+    }
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: rotationQ24()
+****************************************************************************//**
+*
+* \brief Scales an angular rate by the sample period. The result is limited to
+* MAX_ROTATION_Q24 so the quaternion products cannot overflow after a long gap.
+*
+* \param rate
+* Angular rate [rad/s] in Q15
+*
+* \param deltaTQ24
+* Sample period [s] in Q24
+*
+* \return
+* Rotation over the sample period [rad] in Q24
+*
+*******************************************************************************/
+static int32 rotationQ24(int32 rate, uint32 deltaTQ24){
+    int64 angle = ((int64) rate * deltaTQ24) >> Q15_SHIFT;
+    if(angle > MAX_ROTATION_Q24){
+        angle = MAX_ROTATION_Q24;
+    } else if(angle < -MAX_ROTATION_Q24){
+        angle = -MAX_ROTATION_Q24;
+    }
+    return (int32) angle;
+}
+
+#if INCLINOMETER_USE_FIXED
+/*******************************************************************************
+* Function Name: updateFixed()
+****************************************************************************//**
+*
+* \brief Converts the float measurements into Q15 and runs the fixed point filter
+*
+* \param accData
+* Pointer to the struct that contains the latest Acc data [m/s^2]
+* 
+* \param gyroData
+* Pointer to the struct that contains the latest Gyr data [rad/s]
+*
+* \param deltaTQ24
+* Time since the previous update [s] in Q24
+*
+* \param betaQ15
+* Filter gain in Q15
+*
+* \param state
+* Pointer to the Q30 state, replaced with the new state
+*
+*******************************************************************************/
+static void updateFixed(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, uint32 deltaTQ24, int32 betaQ15, QUATERNION_Q30_T* state){
+    VECTOR_Q15_T acc = {
+        .x = FLOAT_TO_Q15(accData->Ax),
+        .y = FLOAT_TO_Q15(accData->Ay),
+        .z = FLOAT_TO_Q15(accData->Az),
+    };
+    VECTOR_Q15_T gyr = {
+        .x = FLOAT_TO_Q15(gyroData->Wx),
+        .y = FLOAT_TO_Q15(gyroData->Wy),
+        .z = FLOAT_TO_Q15(gyroData->Wz),
+    };
+    inclinometer_updateFilterFixed(&acc, &gyr, deltaTQ24, betaQ15, state);
+}
+
+/*******************************************************************************
+* Function Name: stateToFloat()
+****************************************************************************//**
+*
+* \brief Copies a Q30 quaternion into a float quaternion
+*
+* \param fixed - Pointer to the Q30 quaternion
+*
+* \param quat - Pointer to the float quaternion to write
+*
+*******************************************************************************/
+static void stateToFloat(QUATERNION_Q30_T* fixed, QUATERNION_T* quat){
+    quat->q1 = Q30_TO_FLOAT(fixed->q1);
+    quat->q2 = Q30_TO_FLOAT(fixed->q2);
+    quat->q3 = Q30_TO_FLOAT(fixed->q3);
+    quat->q4 = Q30_TO_FLOAT(fixed->q4);
+}
+#endif /* INCLINOMETER_USE_FIXED */
+
+/*******************************************************************************
+* Function Name: updateInstance()
+****************************************************************************//**
+*
+* \brief Runs the selected filter implementation on a filter instance
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+* \param deltaT - Time since the previous update [s]
+*
+* \param deltaTQ24 - deltaT in Q24
+*
+*******************************************************************************/
+static void updateInstance(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, float deltaT, uint32 deltaTQ24){
+#if INCLINOMETER_USE_FIXED
+    (void) deltaT;
+    updateFixed(accData, gyroData, deltaTQ24, filter->betaQ15, &filter->stateQ30);
+    stateToFloat(&filter->stateQ30, &filter->state);
+#else
+    (void) deltaTQ24;
+    inclinometer_updateFilterFloat(accData, gyroData, deltaT, filter->beta, &filter->state);
+#endif /* INCLINOMETER_USE_FIXED */
+}
+
+/*******************************************************************************
+* Function Name: measureDelta()
+****************************************************************************//**
+*
+* \brief Measures the time since the previous timestamped update
+*
+* \param filter - Pointer to the filter instance
+*
+* \param timestamp - Time of the current update [us]
+*
+* \param deltaUs - Set to the time since the previous update [us], clamped to
+* INCLINOMETER_MAX_DT_US
+*
+* \return
+* false on the first timestamp, when no period can be measured
+*
+*******************************************************************************/
+static bool measureDelta(INCLINOMETER_FILTER_T* filter, uint32 timestamp, uint32* deltaUs){
+    bool valid = filter->timestampValid;
+    /* Unsigned difference handles the counter wrapping */
+    uint32 delta = timestamp - filter->lastTimestamp;
+    filter->lastTimestamp = timestamp;
+    filter->timestampValid = true;
+    if(delta > INCLINOMETER_MAX_DT_US){
+        delta = INCLINOMETER_MAX_DT_US;
+    }
+    *deltaUs = delta;
+    return valid;
+}
+
+/*******************************************************************************
+* Function Name: updateMarg()
+****************************************************************************//**
+*
+* \brief Magnetic, angular rate and gravity (MARG) update of the filter, from
+* the same paper as the IMU filter. The earth's field is re-estimated on every
+* update from the measured field, so only its inclination and magnitude are
+* used and magnetic distortions in the horizontal plane do not tilt the
+* estimate. The gyroscope bias is integrated from the error direction of the
+* gradient and removed from the rate before it is integrated.
+*
+* Runs in single precision. When the fixed point filter is selected the Q15
+* state is kept in step so the IMU and MARG updates can be mixed.
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+* \param magData - Pointer to the latest Mag data, any scale
+*
+* \param deltaT - Time since the previous update [s]
+*
+*******************************************************************************/
+static void updateMarg(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, MAG_DATA_F* magData, float deltaT){
+    /*** Local variables ***/
+    float norm;                 /**< Vector norm */
+    float f1, f2, f3, f4, f5, f6;   /**< Objective function elements */
+    QUATERNION_T SEqHatDot;     /**< Estimated direction of the gyroscope error*/
+    QUATERNION_T SEq = filter->state;
+    /* Unpack input data */
+    float Ax = accData->Ax;
+    float Ay = accData->Ay;
+    float Az = accData->Az;
+    float Mx = magData->X;
+    float My = magData->Y;
+    float Mz = magData->Z;
+
+    /* Fall back to the IMU update without a valid field or gravity */
+    float accNorm = sqrt( (Ax * Ax) + (Ay * Ay) + (Az * Az) );
+    float magNorm = sqrt( (Mx * Mx) + (My * My) + (Mz * Mz) );
+    if((accNorm == ZERO_F) || (magNorm == ZERO_F)){
+        updateInstance(filter, accData, gyroData, deltaT, FLOAT_TO_Q24(deltaT));
+        return;
+    }
+    Ax /= accNorm;
+    Ay /= accNorm;
+    Az /= accNorm;
+    Mx /= magNorm;
+    My /= magNorm;
+    Mz /= magNorm;
+
+    /*** Auxilary variables to avoid repeated calculations ***/
+    float twoQ1 = TWO_F * SEq.q1;
+    float twoQ2 = TWO_F * SEq.q2;
+    float twoQ3 = TWO_F * SEq.q3;
+    float twoQ4 = TWO_F * SEq.q4;
+    float twoBx = TWO_F * filter->fluxX;
+    float twoBz = TWO_F * filter->fluxZ;
+    float twoBxQ1 = twoBx * SEq.q1;
+    float twoBxQ2 = twoBx * SEq.q2;
+    float twoBxQ3 = twoBx * SEq.q3;
+    float twoBxQ4 = twoBx * SEq.q4;
+    float twoBzQ1 = twoBz * SEq.q1;
+    float twoBzQ2 = twoBz * SEq.q2;
+    float twoBzQ3 = twoBz * SEq.q3;
+    float twoBzQ4 = twoBz * SEq.q4;
+    float q1q3 = SEq.q1 * SEq.q3;
+    float q2q4 = SEq.q2 * SEq.q4;
+
+    /* Compute objective function, gravity (Eqn. 25) and field (Eqn. 29) */
+    f1 =         (twoQ2 * SEq.q4) - (twoQ1 * SEq.q3) - Ax;
+    f2 =         (twoQ1 * SEq.q2) + (twoQ3 * SEq.q4) - Ay;
+    f3 = ONE_F - (twoQ2 * SEq.q2) - (twoQ3 * SEq.q3) - Az;
+    f4 = (twoBx * (HALF_F - (SEq.q3 * SEq.q3) - (SEq.q4 * SEq.q4))) + (twoBz * (q2q4 - q1q3)) - Mx;
+    f5 = (twoBx * ((SEq.q2 * SEq.q3) - (SEq.q1 * SEq.q4))) + (twoBz * ((SEq.q1 * SEq.q2) + (SEq.q3 * SEq.q4))) - My;
+    f6 = (twoBx * (q1q3 + q2q4)) + (twoBz * (HALF_F - (SEq.q2 * SEq.q2) - (SEq.q3 * SEq.q3))) - Mz;
+
+    /* Compute the Jacobian (Eqn. 26 and 30), negated terms noted */
+    float J11or24 = twoQ3;                      /**< J11 negated */
+    float J12or23 = twoQ4;
+    float J13or22 = twoQ1;                      /**< J13 negated */
+    float J14or21 = twoQ2;
+    float J32 = TWO_F * J14or21;                /**< Negated */
+    float J33 = TWO_F * J11or24;                /**< Negated */
+    float J41 = twoBzQ3;                        /**< Negated */
+    float J42 = twoBzQ4;
+    float J43 = (TWO_F * twoBxQ3) + twoBzQ1;    /**< Negated */
+    float J44 = (TWO_F * twoBxQ4) - twoBzQ2;    /**< Negated */
+    float J51 = twoBxQ4 - twoBzQ2;              /**< Negated */
+    float J52 = twoBxQ3 + twoBzQ1;
+    float J53 = twoBxQ2 + twoBzQ4;
+    float J54 = twoBxQ1 - twoBzQ3;              /**< Negated */
+    float J61 = twoBxQ3;
+    float J62 = twoBxQ4 - (TWO_F * twoBzQ2);
+    float J63 = twoBxQ1 - (TWO_F * twoBzQ3);
+    float J64 = twoBxQ2;
+
+    /* Compute the gradient */
+    SEqHatDot.q1 = (J14or21 * f2) - (J11or24 * f1) - (J41 * f4) - (J51 * f5) + (J61 * f6);
+    SEqHatDot.q2 = (J12or23 * f1) + (J13or22 * f2) - (J32 * f3) + (J42 * f4) + (J52 * f5) + (J62 * f6);
+    SEqHatDot.q3 = (J12or23 * f2) - (J33 * f3) - (J13or22 * f1) - (J43 * f4) + (J53 * f5) + (J63 * f6);
+    SEqHatDot.q4 = (J14or21 * f1) + (J11or24 * f2) - (J44 * f4) - (J54 * f5) + (J64 * f6);
+    /* Normalize the gradient, zero when the estimate already matches */
+    norm = sqrt( (SEqHatDot.q1 * SEqHatDot.q1) + (SEqHatDot.q2 * SEqHatDot.q2) +\
+                 (SEqHatDot.q3 * SEqHatDot.q3) + (SEqHatDot.q4 * SEqHatDot.q4) );
+    if(norm > ZERO_F){
+        SEqHatDot.q1 /= norm;
+        SEqHatDot.q2 /= norm;
+        SEqHatDot.q3 /= norm;
+        SEqHatDot.q4 /= norm;
+    }
+
+    /* Gyroscope error direction (Eqn. 47), integrated into the bias (Eqn. 48) */
+    float errX = (twoQ1 * SEqHatDot.q2) - (twoQ2 * SEqHatDot.q1) - (twoQ3 * SEqHatDot.q4) + (twoQ4 * SEqHatDot.q3);
+    float errY = (twoQ1 * SEqHatDot.q3) + (twoQ2 * SEqHatDot.q4) - (twoQ3 * SEqHatDot.q1) - (twoQ4 * SEqHatDot.q2);
+    float errZ = (twoQ1 * SEqHatDot.q4) - (twoQ2 * SEqHatDot.q3) + (twoQ3 * SEqHatDot.q2) - (twoQ4 * SEqHatDot.q1);
+    filter->gyrBias.Wx += errX * deltaT * filter->zeta;
+    filter->gyrBias.Wy += errY * deltaT * filter->zeta;
+    filter->gyrBias.Wz += errZ * deltaT * filter->zeta;
+    /* Remove the bias */
+    float Wx = gyroData->Wx - filter->gyrBias.Wx;
+    float Wy = gyroData->Wy - filter->gyrBias.Wy;
+    float Wz = gyroData->Wz - filter->gyrBias.Wz;
+
+    /* Compute the quaternion derivative measured by GYR */
+    QUATERNION_T halfSEq = {
+        .q1 = (HALF_F * SEq.q1),
+        .q2 = (HALF_F * SEq.q2),
+        .q3 = (HALF_F * SEq.q3),
+        .q4 = (HALF_F * SEq.q4),
+    };
+    QUATERNION_T SEqDot_omega;
+    SEqDot_omega.q1 = (-halfSEq.q2 * Wx) - (halfSEq.q3 * Wy) - (halfSEq.q4 * Wz);
+    SEqDot_omega.q2 = ( halfSEq.q1 * Wx) + (halfSEq.q3 * Wz) - (halfSEq.q4 * Wy);
+    SEqDot_omega.q3 = ( halfSEq.q1 * Wy) - (halfSEq.q2 * Wz) + (halfSEq.q4 * Wx);
+    SEqDot_omega.q4 = ( halfSEq.q1 * Wz) + (halfSEq.q2 * Wy) - (halfSEq.q3 * Wx);
+
+    /* Compute and integrate the estimated quaternion derivative */
+    SEq.q1 += (SEqDot_omega.q1 - (filter->beta * SEqHatDot.q1)) * deltaT;
+    SEq.q2 += (SEqDot_omega.q2 - (filter->beta * SEqHatDot.q2)) * deltaT;
+    SEq.q3 += (SEqDot_omega.q3 - (filter->beta * SEqHatDot.q3)) * deltaT;
+    SEq.q4 += (SEqDot_omega.q4 - (filter->beta * SEqHatDot.q4)) * deltaT;
+    /* Normalize */
+    norm = sqrt( (SEq.q1 * SEq.q1) + (SEq.q2 * SEq.q2) + (SEq.q3 * SEq.q3) + (SEq.q4 * SEq.q4) );
+    SEq.q1 /= norm;
+    SEq.q2 /= norm;
+    SEq.q3 /= norm;
+    SEq.q4 /= norm;
+
+    /* Rotate the measured field into the earth frame (Eqn. 45) */
+    float twoMx = TWO_F * Mx;
+    float twoMy = TWO_F * My;
+    float twoMz = TWO_F * Mz;
+    float q1q2 = SEq.q1 * SEq.q2;
+    float q1q4 = SEq.q1 * SEq.q4;
+    float q2q3 = SEq.q2 * SEq.q3;
+    float q3q4 = SEq.q3 * SEq.q4;
+    q1q3 = SEq.q1 * SEq.q3;
+    q2q4 = SEq.q2 * SEq.q4;
+    float Hx = (twoMx * (HALF_F - (SEq.q3 * SEq.q3) - (SEq.q4 * SEq.q4))) + (twoMy * (q2q3 - q1q4)) + (twoMz * (q2q4 + q1q3));
+    float Hy = (twoMx * (q2q3 + q1q4)) + (twoMy * (HALF_F - (SEq.q2 * SEq.q2) - (SEq.q4 * SEq.q4))) + (twoMz * (q3q4 - q1q2));
+    float Hz = (twoMx * (q2q4 - q1q3)) + (twoMy * (q3q4 + q1q2)) + (twoMz * (HALF_F - (SEq.q2 * SEq.q2) - (SEq.q3 * SEq.q3)));
+    /* Only the horizontal magnitude and the inclination are kept (Eqn. 46) */
+    filter->fluxX = sqrt( (Hx * Hx) + (Hy * Hy) );
+    filter->fluxZ = Hz;
+
+    /* Copy output to state */
+    filter->state = SEq;
+    filter->stateQ30.q1 = FLOAT_TO_Q30(SEq.q1);
+    filter->stateQ30.q2 = FLOAT_TO_Q30(SEq.q2);
+    filter->stateQ30.q3 = FLOAT_TO_Q30(SEq.q3);
+    filter->stateQ30.q4 = FLOAT_TO_Q30(SEq.q4);
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_init()
+****************************************************************************//**
+*
+* \brief Initializes a filter instance to the identity orientation with its
+* own sample period and gain. The gain is computed once here rather than on
+* every update.
+*
+* \param filter
+* Pointer to the filter instance
+*
+* \param samplePeriod
+* Nominal sample period [s], used by inclinometer_update() and for the first
+* inclinometer_updateTimestamp(). Falls back to DELTA_T when out of range.
+*
+* \param gyrError
+* Estimated gyroscope measurement error [deg/s]
+*
+*******************************************************************************/
+void inclinometer_init(INCLINOMETER_FILTER_T* filter, float samplePeriod, float gyrError){
+    /* Identity orientation */
+    filter->state.q1 = ONE_F;
+    filter->state.q2 = ZERO_F;
+    filter->state.q3 = ZERO_F;
+    filter->state.q4 = ZERO_F;
+    filter->stateQ30.q1 = Q30_ONE;
+    filter->stateQ30.q2 = 0;
+    filter->stateQ30.q3 = 0;
+    filter->stateQ30.q4 = 0;
+    /* No timestamp yet */
+    filter->lastTimestamp = ZERO;
+    filter->timestampValid = false;
+    /* No gyroscope bias, field assumed horizontal until the first MARG update */
+    filter->gyrBias.Wx = ZERO_F;
+    filter->gyrBias.Wy = ZERO_F;
+    filter->gyrBias.Wz = ZERO_F;
+    filter->fluxX = ONE_F;
+    filter->fluxZ = ZERO_F;
+    /* Rate and gains */
+    inclinometer_setBiasGain(filter, INCLINOMETER_DEFAULT_GYR_DRIFT);
+    inclinometer_setGain(filter, gyrError);
+    if(inclinometer_setSamplePeriod(filter, samplePeriod) != INCLINOMETER_ERR_OK){
+        inclinometer_setSamplePeriod(filter, DELTA_T);
+    }
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_setSamplePeriod()
+****************************************************************************//**
+*
+* \brief Changes the nominal sample period of a filter instance
+*
+* \param filter
+* Pointer to the filter instance
+*
+* \param samplePeriod
+* Nominal sample period [s], in (0, INCLINOMETER_MAX_PERIOD]
+*
+* \return
+* INCLINOMETER_ERR_OK on success, INCLINOMETER_ERR_PERIOD if out of range
+*
+*******************************************************************************/
+uint32 inclinometer_setSamplePeriod(INCLINOMETER_FILTER_T* filter, float samplePeriod){
+    if(!(samplePeriod > ZERO_F) || (samplePeriod > INCLINOMETER_MAX_PERIOD)){
+        return INCLINOMETER_ERR_PERIOD;
+    }
+    filter->samplePeriod = samplePeriod;
+    filter->samplePeriodQ24 = FLOAT_TO_Q24(samplePeriod);
+    return INCLINOMETER_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_setGain()
+****************************************************************************//**
+*
+* \brief Computes the filter gain, beta = sqrt(3/4) * gyroscope error
+*
+* \param filter
+* Pointer to the filter instance
+*
+* \param gyrError
+* Estimated gyroscope measurement error [deg/s]
+*
+*******************************************************************************/
+void inclinometer_setGain(INCLINOMETER_FILTER_T* filter, float gyrError){
+    filter->beta = SQRT_THREE_FOURTHS * gyrError * INCLINOMETER_DEG_TO_RAD;
+    filter->betaQ15 = FLOAT_TO_Q15(filter->beta);
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_update()
+****************************************************************************//**
+*
+* \brief Updates a filter instance, assuming the nominal sample period has
+* passed since the previous update
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+*******************************************************************************/
+void inclinometer_update(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData){
+    updateInstance(filter, accData, gyroData, filter->samplePeriod, filter->samplePeriodQ24);
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_updateTimestamp()
+****************************************************************************//**
+*
+* \brief Updates a filter instance using the measured time since the previous
+* update, so the sample rate can change at run time. The first update after
+* inclinometer_init() uses the nominal sample period.
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+* \param timestamp
+* Time the data was sampled [us], from a free running counter. Wrapping is
+* handled, gaps longer than INCLINOMETER_MAX_DT_US are clamped.
+*
+*******************************************************************************/
+void inclinometer_updateTimestamp(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, uint32 timestamp){
+    uint32 deltaUs;
+    if(measureDelta(filter, timestamp, &deltaUs)){
+        updateInstance(filter, accData, gyroData, (float) deltaUs * INCLINOMETER_US_TO_S, US_TO_Q24(deltaUs));
+    } else {
+        inclinometer_update(filter, accData, gyroData);
+    }
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_setBiasGain()
+****************************************************************************//**
+*
+* \brief Computes the gyroscope bias gain, zeta = sqrt(3/4) * bias drift. A
+* drift of zero turns the bias estimation off.
+*
+* \param filter
+* Pointer to the filter instance
+*
+* \param gyrDrift
+* Estimated rate of the gyroscope bias drift [deg/s/s]
+*
+*******************************************************************************/
+void inclinometer_setBiasGain(INCLINOMETER_FILTER_T* filter, float gyrDrift){
+    filter->zeta = SQRT_THREE_FOURTHS * gyrDrift * INCLINOMETER_DEG_TO_RAD;
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_updateMarg()
+****************************************************************************//**
+*
+* \brief Updates a filter instance with the magnetometer as well, assuming the
+* nominal sample period has passed since the previous update. Yaw is corrected
+* towards magnetic north and the gyroscope bias is tracked.
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+* \param magData - Pointer to the latest Mag data, any scale
+*
+*******************************************************************************/
+void inclinometer_updateMarg(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, MAG_DATA_F* magData){
+    updateMarg(filter, accData, gyroData, magData, filter->samplePeriod);
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_updateMargTimestamp()
+****************************************************************************//**
+*
+* \brief Magnetometer update of a filter instance using the measured time
+* since the previous update, see inclinometer_updateTimestamp()
+*
+* \param filter - Pointer to the filter instance
+*
+* \param accData - Pointer to the latest Acc data [m/s^2]
+*
+* \param gyroData - Pointer to the latest Gyr data [rad/s]
+*
+* \param magData - Pointer to the latest Mag data, any scale
+*
+* \param timestamp - Time the data was sampled [us]
+*
+*******************************************************************************/
+void inclinometer_updateMargTimestamp(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, MAG_DATA_F* magData, uint32 timestamp){
+    uint32 deltaUs;
+    float deltaT = filter->samplePeriod;
+    if(measureDelta(filter, timestamp, &deltaUs)){
+        deltaT = (float) deltaUs * INCLINOMETER_US_TO_S;
+    }
+    updateMarg(filter, accData, gyroData, magData, deltaT);
+}
+
 /*******************************************************************************
 * Function Name: inclinometer_updateFilter()
 ****************************************************************************//**
 *
 * \brief Takes the new accelerometer and gyroscope datapoint and the previous
-* state and calculates the new state. Replaces the old state with new.
+* state and calculates the new state. Replaces the old state with new. Runs the
+* fixed point filter when INCLINOMETER_USE_FIXED is set, otherwise the float.
+* Uses the DELTA_T and BETA defaults, see inclinometer_init() for instances
+* with their own rate and gain.
 *
 * \param accData
 * Pointer to the struct that contains the latest Acc data [m/s^2]
@@ -34,6 +728,44 @@
 *
 *******************************************************************************/
 void inclinometer_updateFilter(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, QUATERNION_T* State){
+#if INCLINOMETER_USE_FIXED
+    QUATERNION_Q30_T state = {
+        .q1 = FLOAT_TO_Q30(State->q1),
+        .q2 = FLOAT_TO_Q30(State->q2),
+        .q3 = FLOAT_TO_Q30(State->q3),
+        .q4 = FLOAT_TO_Q30(State->q4),
+    };
+    updateFixed(accData, gyroData, DELTA_T_Q24, BETA_Q15, &state);
+    stateToFloat(&state, State);
+#else
+    inclinometer_updateFilterFloat(accData, gyroData, DELTA_T, BETA, State);
+#endif /* INCLINOMETER_USE_FIXED */
+}
+
+/*******************************************************************************
+* Function Name: inclinometer_updateFilterFloat()
+****************************************************************************//**
+*
+* \brief Single precision implementation of inclinometer_updateFilter().
+*
+* \param accData
+* Pointer to the struct that contains the latest Acc data [m/s^2]
+* 
+* \param gyroData
+* Pointer to the struct that contains the latest Gyr data [rad/s]
+*
+* \param deltaT
+* Time since the previous update [s]
+*
+* \param beta
+* Filter gain
+*
+* \param State
+* Pointer to the quaternion for the previous state. Use these values to calculate
+* new state, place in state. 
+*
+*******************************************************************************/
+void inclinometer_updateFilterFloat(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, float deltaT, float beta, QUATERNION_T* State){
     /*** Local variables ***/
     float norm;                 /**< Vector norm */
     float f1, f2, f3;           /**< Objective function elements */
@@ -93,13 +825,15 @@ void inclinometer_updateFilter(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, QU
     SEqHatDot.q2 = (J12 * f1) + (J13 * f2) - (J32 * f3);
     SEqHatDot.q3 = (J12 * f2) - (J33 * f3) - (J13 * f1);
     SEqHatDot.q4 = (J14 * f1) + (J11 * f2);
-    /* Normalize the gradient */
+    /* Normalize the gradient, zero when the estimate already matches */
     norm = sqrt( (SEqHatDot.q1 * SEqHatDot.q1) + (SEqHatDot.q2 * SEqHatDot.q2) +\
                  (SEqHatDot.q3 * SEqHatDot.q3) + (SEqHatDot.q4 * SEqHatDot.q4) ); 
-    SEqHatDot.q1 /= norm;
-    SEqHatDot.q2 /= norm;
-    SEqHatDot.q3 /= norm;
-    SEqHatDot.q4 /= norm;
+    if(norm > ZERO_F){
+        SEqHatDot.q1 /= norm;
+        SEqHatDot.q2 /= norm;
+        SEqHatDot.q3 /= norm;
+        SEqHatDot.q4 /= norm;
+    }
 
     /* Compute the quaternion derivative measured by GYR */
     SEqDot_omega.q1 = (-halfSEq.q2 * Wx) - (halfSEq.q3 * Wy) - (halfSEq.q4 * Wz);
@@ -108,10 +842,10 @@ void inclinometer_updateFilter(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, QU
     SEqDot_omega.q4 = ( halfSEq.q1 * Wz) + (halfSEq.q2 * Wy) - (halfSEq.q3 * Wx);
     
     /* Compute and integrate the estimated quaternion derivative */
-    SEq.q1 += (SEqDot_omega.q1 - (BETA * SEqHatDot.q1)) * DELTA_T;
-    SEq.q2 += (SEqDot_omega.q2 - (BETA * SEqHatDot.q2)) * DELTA_T;
-    SEq.q3 += (SEqDot_omega.q3 - (BETA * SEqHatDot.q3)) * DELTA_T;
-    SEq.q4 += (SEqDot_omega.q4 - (BETA * SEqHatDot.q4)) * DELTA_T;
+    SEq.q1 += (SEqDot_omega.q1 - (beta * SEqHatDot.q1)) * deltaT;
+    SEq.q2 += (SEqDot_omega.q2 - (beta * SEqHatDot.q2)) * deltaT;
+    SEq.q3 += (SEqDot_omega.q3 - (beta * SEqHatDot.q3)) * deltaT;
+    SEq.q4 += (SEqDot_omega.q4 - (beta * SEqHatDot.q4)) * deltaT;
     /* Normalize */
     norm = sqrt( (SEq.q1 * SEq.q1) + (SEq.q2 * SEq.q2) + (SEq.q3 * SEq.q3) + (SEq.q4 * SEq.q4) );
     SEq.q1 /= norm;
@@ -123,6 +857,97 @@ void inclinometer_updateFilter(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, QU
     *State = SEq;
 }
 
+/*******************************************************************************
+* Function Name: inclinometer_updateFilterFixed()
+****************************************************************************//**
+*
+* \brief Fixed point implementation of the filter for cores without an FPU.
+* Follows inclinometer_updateFilterFloat(), with the square roots replaced by
+* invSqrtQ15(). The gradient only needs a direction and is formed in Q15 from
+* the half quaternion. The state is held in Q30 and the integration is
+* accumulated in 64 bits (Q30 x Q24 rotation, Q39 gain x Q15 gradient) and
+* shifted once, so rotations below one Q15 LSB per update are kept.
+*
+* \param accData
+* Pointer to the latest Acc data, any scale
+* 
+* \param gyroData
+* Pointer to the latest Gyr data [rad/s] in Q15
+*
+* \param deltaTQ24
+* Time since the previous update [s] in Q24
+*
+* \param betaQ15
+* Filter gain in Q15
+*
+* \param State
+* Pointer to the quaternion for the previous state in Q30, replaced with the
+* new state
+*
+*******************************************************************************/
+void inclinometer_updateFilterFixed(VECTOR_Q15_T* accData, VECTOR_Q15_T* gyroData, uint32 deltaTQ24, int32 betaQ15, QUATERNION_Q30_T* State){
+    /* Current estimate in Q15 for the gradient */
+    int32 q1 = Q30_TO_Q15(State->q1);
+    int32 q2 = Q30_TO_Q15(State->q2);
+    int32 q3 = Q30_TO_Q15(State->q3);
+    int32 q4 = Q30_TO_Q15(State->q4);
+    /* Half of the current estimate */
+    int32 h1 = q1 >> 1;
+    int32 h2 = q2 >> 1;
+    int32 h3 = q3 >> 1;
+    int32 h4 = q4 >> 1;
+    int32 grad[LEN_QUAT] = {0, 0, 0, 0};  /**< Normalized gradient */
+
+    /* Normalize the Accelerometer measurements, skip the correction in free fall */
+    int32 acc[LEN_VECT] = {accData->x, accData->y, accData->z};
+    if(normalizeQ15(acc, LEN_VECT)){
+        /* Compute objective function (Eqn. 25) */
+        int32 f1 = (2 * (Q15_MUL(q2, q4) - Q15_MUL(q1, q3))) - acc[0];
+        int32 f2 = (2 * (Q15_MUL(q1, q2) + Q15_MUL(q3, q4))) - acc[1];
+        int32 f3 = Q15_ONE - (2 * (Q15_MUL(q2, q2) + Q15_MUL(q3, q3))) - acc[2];
+        /* Compute the gradient from the Jacobian (Eqn. 26), scaled by 1/4 */
+        grad[0] = GRAD_MUL(h2, f2) - GRAD_MUL(h3, f1);
+        grad[1] = GRAD_MUL(h4, f1) + GRAD_MUL(h1, f2) - (2 * GRAD_MUL(h2, f3));
+        grad[2] = GRAD_MUL(h4, f2) - GRAD_MUL(h1, f1) - (2 * GRAD_MUL(h3, f3));
+        grad[3] = GRAD_MUL(h2, f1) + GRAD_MUL(h3, f2);
+        /* Normalize the gradient, zero when the estimate already matches */
+        if(!normalizeQ15(grad, LEN_QUAT)){
+            grad[0] = 0;
+        }
+    }
+    /* Rotation over the sample period [rad] in Q24 */
+    int64 wx = rotationQ24(gyroData->x, deltaTQ24);
+    int64 wy = rotationQ24(gyroData->y, deltaTQ24);
+    int64 wz = rotationQ24(gyroData->z, deltaTQ24);
+    /* Gain over the sample period in Q39 */
+    int64 betaDt = (int64) betaQ15 * deltaTQ24;
+    /* Half of the current estimate in Q30 */
+    int64 half1 = State->q1 >> 1;
+    int64 half2 = State->q2 >> 1;
+    int64 half3 = State->q3 >> 1;
+    int64 half4 = State->q4 >> 1;
+    /* Quaternion derivative measured by GYR and the correction, over the period in Q54 */
+    int64 quat[LEN_QUAT];
+    quat[0] = - (half2 * wx) - (half3 * wy) - (half4 * wz) - (betaDt * grad[0]);
+    quat[1] =   (half1 * wx) + (half3 * wz) - (half4 * wy) - (betaDt * grad[1]);
+    quat[2] =   (half1 * wy) - (half2 * wz) + (half4 * wx) - (betaDt * grad[2]);
+    quat[3] =   (half1 * wz) + (half2 * wy) - (half3 * wx) - (betaDt * grad[3]);
+    /* Integrate */
+    quat[0] = State->q1 + ((quat[0] + Q54_ROUND) >> Q54_TO_Q30_SHIFT);
+    quat[1] = State->q2 + ((quat[1] + Q54_ROUND) >> Q54_TO_Q30_SHIFT);
+    quat[2] = State->q3 + ((quat[2] + Q54_ROUND) >> Q54_TO_Q30_SHIFT);
+    quat[3] = State->q4 + ((quat[3] + Q54_ROUND) >> Q54_TO_Q30_SHIFT);
+    /* Normalize, an all zero state restarts at the identity */
+    if(!normalizeQ30(quat)){
+        quat[0] = Q30_ONE;
+    }
+    /* Copy output to state */
+    State->q1 = (int32) quat[0];
+    State->q2 = (int32) quat[1];
+    State->q3 = (int32) quat[2];
+    State->q4 = (int32) quat[3];
+}
+
 /*******************************************************************************
 * Function Name: quaternionToEuler()
 ****************************************************************************//**
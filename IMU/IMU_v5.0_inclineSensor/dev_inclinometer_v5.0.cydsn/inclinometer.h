@@ -25,25 +25,94 @@
     /***************************************
     * Macro Definitions
     ***************************************/
-    /* System Constants */
+    /* System Constants - defaults of inclinometer_updateFilter() */
     #define DELTA_T             (0.1f) /**< Sampling period in seconds */
-    #define GYRO_MEAS_ERROR     (3.14159265358979f) * (5.0f / 180.0f) /**< Gyroscope measurement error */
-    #define BETA                sqrt(3.0f / 4.0f) * GYRO_MEAS_ERROR /**< Compute beta */
+    #define GYRO_MEAS_ERROR     ((3.14159265358979f) * (5.0f / 180.0f)) /**< Gyroscope measurement error */
+    #define SQRT_THREE_FOURTHS  (0.8660254f) /**< sqrt(3/4) */
+    #define BETA                (SQRT_THREE_FOURTHS * GYRO_MEAS_ERROR) /**< Compute beta */
+    /* Filter instances */
+    #define INCLINOMETER_MAX_PERIOD     (1.0f)      /**< Longest sample period [s] */
+    #define INCLINOMETER_MAX_DT_US      (1000000u)  /**< Measured periods are clamped to this [us] */
+    #define INCLINOMETER_US_TO_S        (0.000001f)
+    #define INCLINOMETER_DEG_TO_RAD     (0.017453293f)
+    #define INCLINOMETER_DEFAULT_GYR_DRIFT  (0.2f)  /**< Gyroscope bias drift [deg/s/s] */
+    /* Error codes */
+    #define INCLINOMETER_ERR_OK         (0u)
+    #define INCLINOMETER_ERR_PERIOD     (1u)        /**< Sample period out of range */
+    /* Filter implementation used by inclinometer_updateFilter()
+    * 1 - Q15 fixed point, 0 - single precision float (default). Compare the
+    * two with hostTest/test_inclinometer.c before changing the default */
+    #ifndef INCLINOMETER_USE_FIXED
+        #define INCLINOMETER_USE_FIXED  (0u)
+    #endif
+    /* Q15 fixed point */
+    #define Q15_SHIFT           (15u)
+    #define Q15_ONE             (1L << Q15_SHIFT)
+    #define FLOAT_TO_Q15(x)     ((int32) ((x) * (float) Q15_ONE))
+    #define Q15_TO_FLOAT(x)     ((float) (x) / (float) Q15_ONE)
+    /* Q30 fixed point, the state of the fixed point filter. The rotation in one
+    * 1 ms update is below one Q15 LSB at low rates */
+    #define Q30_SHIFT           (30u)
+    #define Q30_ONE             (1L << Q30_SHIFT)
+    #define FLOAT_TO_Q30(x)     ((int32) ((x) * (float) Q30_ONE))
+    #define Q30_TO_FLOAT(x)     ((float) (x) / (float) Q30_ONE)
+    /* Sample periods are held in Q24 seconds */
+    #define Q24_SHIFT           (24u)
+    #define Q24_ONE             (1UL << Q24_SHIFT)
+    #define FLOAT_TO_Q24(x)     ((uint32) ((x) * (float) Q24_ONE))
+    #define US_TO_Q24(us)       ((uint32) (((uint64) (us) * 274878u) >> 14u)) /**< 2^38 / 10^6 = 274878 */
     
     /***************************************
     * Structs
     ***************************************/
 
-    // /* Struct for representing a Quaternion */
-    // typedef struct {
-    //     float beta; /**< Value used in filter */
-    //     float deltaT; /**< Second element (i) */
-    // } FILTER_SETTING_T;
+    /* Quaternion in Q30 */
+    typedef struct {
+        int32 q1;   /**< Scalar element */
+        int32 q2;   /**< i */
+        int32 q3;   /**< j */
+        int32 q4;   /**< k */
+    } QUATERNION_Q30_T;
+
+    /* Filter instance with its own rate and gain */
+    typedef struct {
+        QUATERNION_T state;         /**< Orientation estimate */
+        QUATERNION_Q30_T stateQ30;  /**< Orientation estimate of the fixed point filter */
+        float samplePeriod;         /**< Nominal sample period [s] */
+        uint32 samplePeriodQ24;     /**< Nominal sample period [s] in Q24 */
+        float beta;                 /**< Filter gain, computed once from the gyroscope error */
+        int32 betaQ15;              /**< Filter gain in Q15 */
+        uint32 lastTimestamp;       /**< Timestamp of the previous update [us] */
+        bool timestampValid;        /**< lastTimestamp has been set */
+        /* Magnetometer (MARG) updates */
+        float zeta;                 /**< Gyroscope bias gain, computed once from the bias drift */
+        GYR_DATA_RAD_F gyrBias;     /**< Estimated gyroscope bias [rad/s] */
+        float fluxX;                /**< Horizontal component of the earth's field, normalized */
+        float fluxZ;                /**< Vertical component of the earth's field, normalized */
+    } INCLINOMETER_FILTER_T;
+
+    /* Three axis measurement in Q15. Only the direction of the accelerometer
+    * vector is used, so any scale works; the gyroscope is in [rad/s] */
+    typedef struct {
+        int32 x;    /**< X axis */
+        int32 y;    /**< Y axis */
+        int32 z;    /**< Z axis */
+    } VECTOR_Q15_T;
     
     /***************************************
     * Functions Prototypes
     ***************************************/
+    void inclinometer_init(INCLINOMETER_FILTER_T* filter, float samplePeriod, float gyrError);
+    uint32 inclinometer_setSamplePeriod(INCLINOMETER_FILTER_T* filter, float samplePeriod);
+    void inclinometer_setGain(INCLINOMETER_FILTER_T* filter, float gyrError);
+    void inclinometer_update(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData);
+    void inclinometer_updateTimestamp(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, uint32 timestamp);
+    void inclinometer_setBiasGain(INCLINOMETER_FILTER_T* filter, float gyrDrift);
+    void inclinometer_updateMarg(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, MAG_DATA_F* magData);
+    void inclinometer_updateMargTimestamp(INCLINOMETER_FILTER_T* filter, ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, MAG_DATA_F* magData, uint32 timestamp);
     void inclinometer_updateFilter(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, QUATERNION_T* State);
+    void inclinometer_updateFilterFloat(ACC_DATA_F* accData, GYR_DATA_RAD_F* gyroData, float deltaT, float beta, QUATERNION_T* State);
+    void inclinometer_updateFilterFixed(VECTOR_Q15_T* accData, VECTOR_Q15_T* gyroData, uint32 deltaTQ24, int32 betaQ15, QUATERNION_Q30_T* State);
     void quaternionToEuler(QUATERNION_T * quat, EULER_ANGLE_T * eAngle);
 
 
@@ -22,6 +22,9 @@
 #include "math.h"
 #include <stdio.h>
 #include "inclinometer.h"
+#include "bmx055Fifo.h"
+#include "quatStream.h"
+#include "trace.h"
 /*  -------------- DEBUGGING --------------
 * Uncomment MICA_DEBUG to enable general debugging.
 * Uncomment MICA_DEBUG_<case> below to
@@ -50,6 +53,10 @@
 //#define MICA_DEBUG_IMU_ACC_POWER    /* Test the new power settings of the Accelerometer */
 //#define MICA_DEBUG_IMU_GYR_POWER    /* Test the new power settings of the gyroscope */
 //#define MICA_DEBUG_IMU_MAG_POWER      /* Test the new power settings of the Accelerometer */
+//#define MICA_DEBUG_IMU_FIFO        /* Drain the Acc & Gyr FIFOs with burst reads */
+//#define MICA_DEBUG_INCLINE_FIXED   /* Compare the fixed point filter against the float filter */
+//#define MICA_DEBUG_INCLINE_RATE    /* Run the filter at a rate that follows the motion */
+//#define MICA_DEBUG_INCLINE_MARG    /* Compare the yaw drift of the MARG and IMU filters */
 //#define MICA_DEBUG_FULL           /* Run a composite set of debugging functions */
 #endif /* End MICA_DEBUG */
 
@@ -61,7 +68,7 @@
 * Uncomment MICA_TEST_<case> below to
 * enable ONE of the test levels. */
 
-#define MICA_TEST
+//#define MICA_TEST
 
 /* -------------- TEST LEVEL --------------
 * Uncomment ONE of the following
@@ -73,9 +80,19 @@
 /* -------------- END TEST LEVEL --------------  */
 
 
+/* Orientation stream */
+#define STREAM_PERIOD_US        (10000u)    /* Filter and stream period [us] */
+#ifndef STREAM_RECORDS
+    #define STREAM_RECORDS      (5u)        /* Records per packet, 20 packets/s. Use 1 for the self balancing DriveBot */
+#endif
+#define STREAM_GYR_ERROR        (5.0f)      /* Gyroscope measurement error [deg/s] */
+
 CY_ISR_PROTO(ISR_systemTimer);
+void orientationStream(void);
+uint32 traceTimestamp(void);
 /* --------- Local Variables --------- */
 volatile bool systemTimerFlag = false;
+volatile uint32 systemTimerTicks = ZERO;
 
 /*******************************************************************************
 * Function Name: main()
@@ -453,11 +470,11 @@ int main(void)
         BMX055_STATE_T imuState;
         ACC_DATA_F accData;
         GYR_DATA_RAD_F gyrData;
-        char str[80];
         const bool verbose = false;
 
         /* Start hardware blocks */
         UART_Start();
+        trace_init(traceTimestamp);
         I2C_Start();
         BMX055_Start(&imuState);
         Timer_Start();
@@ -494,28 +511,23 @@ int main(void)
                 /* Convert to Euler Angle */
                 Incline_QuaternionToEuler(&inclineState.state, &stateAngle);
                 
-                /* Clear the Screen */
-                uartApi_clearScreen();
                 /* Verbosity level */
                 if(verbose){
-                    /* New lines */
-                    uartApi_putString("\r\n\n");
                     /* Display Gryo data */
-                    sprintf(str, "Gyro - X: %f, Y: %f, Z: %f\r\n", gyrData.Wx, gyrData.Wy, gyrData.Wz);
-                    uartApi_putString(str);
+                    trace_write(trace_ID_GYR, trace_float(gyrData.Wx), trace_float(gyrData.Wy), trace_float(gyrData.Wz));
                     /* Display Accd ata */
-                    sprintf(str, "Acc - X: %f, Y: %f, Z: %f\r\n", accData.Ax, accData.Ay, accData.Az);
-                    uartApi_putString(str);
-                    /* Format string */ 
-                    sprintf(str, "Qw: %.4f, Qx: %.4f, Qy: %.4f, Qz: %.4f\r\n", inclineState.state.q1, inclineState.state.q2, inclineState.state.q3, inclineState.state.q4 ); 
-                    uartApi_putString(str);
+                    trace_write(trace_ID_ACC, trace_float(accData.Ax), trace_float(accData.Ay), trace_float(accData.Az));
+                    /* Quaternion */
+                    trace_write(trace_ID_QUATERNION, trace_float(inclineState.state.q1), trace_float(inclineState.state.q2), trace_float(inclineState.state.q3));
+                    trace_write(trace_ID_QUATERNION_Z, trace_float(inclineState.state.q4), ZERO, ZERO);
                 }
-                /* Format string */ 
-                sprintf(str, "Yaw: %.1f\r\nPitch: %.1f\r\nRoll: %.1f\r\n", to_degrees(stateAngle.yaw), to_degrees(stateAngle.pitch), to_degrees(stateAngle.roll) ); 
-                uartApi_putString(str);
+                /* Angles */
+                trace_write(trace_ID_EULER, trace_float(to_degrees(stateAngle.yaw)), trace_float(to_degrees(stateAngle.pitch)), trace_float(to_degrees(stateAngle.roll)));
                 /* Toggle LED */
                 LEDS_R_Toggle();
             }
+            /* Send trace records in the background */
+            trace_process();
         }
     /* End MICA_DEBUG_INCLINOMETER */
     #elif defined MICA_DEBUG_IMU_ACC_POWER
@@ -676,6 +688,337 @@ int main(void)
             MICA_delayMs(2500);
         }
     /* End MICA_DEBUG_IMU_MAG_POWER */
+    #elif defined MICA_DEBUG_IMU_FIFO
+        /* Drain the Acc & Gyr FIFOs with burst reads */
+        /* Expected outcome:
+        1. Green LED on
+        2. Every 100 ms print the number of frames drained and the newest sample
+        2a. Toggle Blue LED - successful drain
+        2b. Red LED - I2C error or a FIFO overran
+        */
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Initilize interrupt vectors */
+        timer_interrupt_StartEx(ISR_systemTimer);
+        /* State variables */
+        BMX055_STATE_T imuState;
+        ACC_DATA_F accFrames[bmx055Fifo_MAX_BURST_FRAMES];
+        GYR_DATA_RAD_F gyrFrames[bmx055Fifo_MAX_BURST_FRAMES];
+        bmx055Fifo_STATUS_S accStatus;
+        bmx055Fifo_STATUS_S gyrStatus;
+        char str[80];
+
+        /* Start hardware blocks */
+        UART_Start();
+        I2C_Start();
+        BMX055_Start(&imuState);
+        Timer_Start();
+
+        /* 250 Hz Acc & 200 Hz Gyr - about 25 and 20 frames per 100 ms */
+        bmx055Fifo_CONFIG_S fifoConfig = {
+            .accBandwidth = bmx055Fifo_ACC_BW_125HZ,
+            .accRange = bmx055Fifo_ACC_RANGE_4G,
+            .accWatermark = ZERO,
+            .gyrRate = bmx055Fifo_GYR_ODR_200HZ,
+            .gyrRange = bmx055Fifo_GYR_RANGE_500DPS,
+            .gyrWatermark = ZERO,
+        };
+        uint32 fifoErr = bmx055Fifo_start(&fifoConfig);
+        if(fifoErr != bmx055Fifo_ERR_OK){
+            LEDS_Write(LEDS_ON_RED);
+            for(;;){}
+        }
+
+        /* Set the period - disable interrupts */
+        uint8 intState = CyEnterCriticalSection();
+        /* Change period */
+        Timer_WritePeriod(MICA_DELAY_US_SEC_TENTH);
+        /* Force reload */
+        Timer_WriteCounter(ZERO);
+        /* Re-enable interrupts */
+        CyExitCriticalSection(intState);
+
+        /* Infinite loop */
+        for(;;){
+            /* Check the system flag */
+            if(systemTimerFlag) {
+                /* Reset flag */
+                systemTimerFlag = false;
+                /* One status read and one burst per sensor */
+                fifoErr = bmx055Fifo_readAcc(accFrames, bmx055Fifo_MAX_BURST_FRAMES, &accStatus);
+                fifoErr |= bmx055Fifo_readGyr(gyrFrames, bmx055Fifo_MAX_BURST_FRAMES, &gyrStatus);
+                if(fifoErr || accStatus.overrun || gyrStatus.overrun || !accStatus.frames || !gyrStatus.frames){
+                    LEDS_Write(LEDS_ON_RED);
+                    continue;
+                }
+                /* Newest frames */
+                ACC_DATA_F *acc = &accFrames[accStatus.frames - ONE];
+                GYR_DATA_RAD_F *gyr = &gyrFrames[gyrStatus.frames - ONE];
+                sprintf(str, "Acc[%u] X: %.2f, Y: %.2f, Z: %.2f\r\n", accStatus.frames, acc->Ax, acc->Ay, acc->Az);
+                uartApi_putString(str);
+                sprintf(str, "Gyr[%u] X: %.2f, Y: %.2f, Z: %.2f\r\n", gyrStatus.frames, gyr->Wx, gyr->Wy, gyr->Wz);
+                uartApi_putString(str);
+                /* Toggle LED */
+                LEDS_B_Toggle();
+            }
+        }
+    /* End MICA_DEBUG_IMU_FIFO */
+    #elif defined MICA_DEBUG_INCLINE_FIXED
+        /* Compare the fixed point filter against the float filter */
+        /* Expected outcome:
+        1. Green LED on
+        2. Every 100 ms print the angles of both filters, the largest
+        difference seen so far and the cycles taken by each update
+        3. Toggle Blue LED
+        */
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Initilize interrupt vectors */
+        timer_interrupt_StartEx(ISR_systemTimer);
+        /* State variables */
+        BMX055_STATE_T imuState;
+        ACC_DATA_F accData;
+        GYR_DATA_RAD_F gyrData;
+        QUATERNION_T floatState = {ONE_F, ZERO_F, ZERO_F, ZERO_F};
+        QUATERNION_T fixedState;
+        QUATERNION_Q30_T stateQ30 = {Q30_ONE, ZERO, ZERO, ZERO};
+        EULER_ANGLE_T floatAngle;
+        EULER_ANGLE_T fixedAngle;
+        float maxDiff = ZERO_F;
+
+        /* Start hardware blocks */
+        UART_Start();
+        trace_init(traceTimestamp);
+        I2C_Start();
+        BMX055_Start(&imuState);
+        Timer_Start();
+        /* Free running SysTick at the system clock to count cycles */
+        CySysTickStop();
+        CySysTickDisableInterrupt();
+        CySysTickSetClockSource(CY_SYS_SYST_CSR_CLK_SRC_SYSCLK);
+        CySysTickSetReload(0xFFFFFFu);
+        CySysTickClear();
+        CySysTickEnable();
+
+        /* Set the period - disable interrupts */
+        uint8 intState = CyEnterCriticalSection();
+        /* Change period */
+        Timer_WritePeriod(MICA_DELAY_US_SEC_TENTH);
+        /* Force reload */
+        Timer_WriteCounter(ZERO);
+        /* Re-enable interrupts */
+        CyExitCriticalSection(intState);
+
+        /* Infinite loop */
+        for(;;){
+            /* Check the system flag */
+            if(systemTimerFlag) {
+                /* Reset flag */
+                systemTimerFlag = false;
+                /* Read in the values for the Acceleromter & Gyro */
+                BMX055_Acc_Readf(&imuState.acc, &accData);
+                BMX055_Gyr_Readf_rad(&imuState.gyr, &gyrData);
+                /* Convert before timing, so only the filters are compared */
+                VECTOR_Q15_T accQ15 = {FLOAT_TO_Q15(accData.Ax), FLOAT_TO_Q15(accData.Ay), FLOAT_TO_Q15(accData.Az)};
+                VECTOR_Q15_T gyrQ15 = {FLOAT_TO_Q15(gyrData.Wx), FLOAT_TO_Q15(gyrData.Wy), FLOAT_TO_Q15(gyrData.Wz)};
+                /* Float filter - SysTick counts down */
+                uint32 start = CySysTickGetValue();
+                inclinometer_updateFilterFloat(&accData, &gyrData, DELTA_T, BETA, &floatState);
+                uint32 floatCycles = (start - CySysTickGetValue()) & 0xFFFFFFu;
+                /* Fixed filter */
+                start = CySysTickGetValue();
+                inclinometer_updateFilterFixed(&accQ15, &gyrQ15, FLOAT_TO_Q24(DELTA_T), FLOAT_TO_Q15(BETA), &stateQ30);
+                uint32 fixedCycles = (start - CySysTickGetValue()) & 0xFFFFFFu;
+                /* Compare the angles */
+                fixedState.q1 = Q30_TO_FLOAT(stateQ30.q1);
+                fixedState.q2 = Q30_TO_FLOAT(stateQ30.q2);
+                fixedState.q3 = Q30_TO_FLOAT(stateQ30.q3);
+                fixedState.q4 = Q30_TO_FLOAT(stateQ30.q4);
+                quaternionToEuler(&floatState, &floatAngle);
+                quaternionToEuler(&fixedState, &fixedAngle);
+                float diff = fabsf(floatAngle.pitch - fixedAngle.pitch) + fabsf(floatAngle.roll - fixedAngle.roll);
+                if(diff > maxDiff){
+                    maxDiff = diff;
+                }
+                trace_write(trace_ID_FLOAT_FILTER, trace_float(to_degrees(floatAngle.pitch)), trace_float(to_degrees(floatAngle.roll)), floatCycles);
+                trace_write(trace_ID_FIXED_FILTER, trace_float(to_degrees(fixedAngle.pitch)), trace_float(to_degrees(fixedAngle.roll)), fixedCycles);
+                trace_write(trace_ID_TILT_DIFF, trace_float(to_degrees(maxDiff)), ZERO, ZERO);
+                /* Toggle LED */
+                LEDS_B_Toggle();
+            }
+            /* Send trace records in the background */
+            trace_process();
+        }
+    /* End MICA_DEBUG_INCLINE_FIXED */
+    #elif defined MICA_DEBUG_INCLINE_RATE
+        /* Run the filter at a rate that follows the motion */
+        /* Expected outcome:
+        1. Green LED on
+        2. Filter runs every 5 ms while rotating, every 250 ms when still
+        2a. Toggle Blue LED - fast rate
+        2b. Toggle Red LED - slow rate
+        3. Print the angle and the measured period twice a second
+        */
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Initilize interrupt vectors */
+        timer_interrupt_StartEx(ISR_systemTimer);
+        /* State variables */
+        const uint32 tickUs = 1000u;        /* Timer period [us] */
+        const uint32 fastTicks = 5u;        /* Sample period while moving [ms] */
+        const uint32 slowTicks = 250u;      /* Sample period while still [ms] */
+        const uint32 printTicks = 500u;     /* Print period [ms] */
+        const float motionThreshold = 0.1f; /* Rotation rate that counts as motion [rad/s] */
+        BMX055_STATE_T imuState;
+        INCLINOMETER_FILTER_T filter;
+        EULER_ANGLE_T stateAngle;
+        ACC_DATA_F accData;
+        GYR_DATA_RAD_F gyrData;
+        uint32 sampleTicks = slowTicks;
+        uint32 lastSample = ZERO;
+        uint32 lastPrint = ZERO;
+        uint32 lastTimestamp = ZERO;
+        uint32 periodUs = ZERO;
+
+        /* Start hardware blocks */
+        UART_Start();
+        trace_init(traceTimestamp);
+        I2C_Start();
+        BMX055_Start(&imuState);
+        Timer_Start();
+        /* Nominal rate is the slow rate, gyroscope error of 5 deg/s */
+        inclinometer_init(&filter, (float) slowTicks * (float) tickUs * INCLINOMETER_US_TO_S, 5.0f);
+
+        /* Set the period - disable interrupts */
+        uint8 intState = CyEnterCriticalSection();
+        /* Change period */
+        Timer_WritePeriod(tickUs);
+        /* Force reload */
+        Timer_WriteCounter(ZERO);
+        /* Re-enable interrupts */
+        CyExitCriticalSection(intState);
+
+        /* Infinite loop */
+        for(;;){
+            /* Check the system flag */
+            if(systemTimerFlag) {
+                /* Reset flag */
+                systemTimerFlag = false;
+                uint32 ticks = systemTimerTicks;
+                if((ticks - lastSample) >= sampleTicks){
+                    lastSample = ticks;
+                    /* Timestamp from the tick count and the down counter */
+                    intState = CyEnterCriticalSection();
+                    uint32 timestamp = (systemTimerTicks * tickUs) + (tickUs - Timer_ReadCounter());
+                    CyExitCriticalSection(intState);
+                    /* Read in the values for the Acceleromter & Gyro */
+                    BMX055_Acc_Readf(&imuState.acc, &accData);
+                    BMX055_Gyr_Readf_rad(&imuState.gyr, &gyrData);
+                    /* Update the filter with the measured period */
+                    inclinometer_updateTimestamp(&filter, &accData, &gyrData, timestamp);
+                    periodUs = timestamp - lastTimestamp;
+                    lastTimestamp = timestamp;
+                    /* Pick the next rate from the rotation rate */
+                    bool moving = (fabsf(gyrData.Wx) > motionThreshold) || (fabsf(gyrData.Wy) > motionThreshold) || (fabsf(gyrData.Wz) > motionThreshold);
+                    sampleTicks = moving ? fastTicks : slowTicks;
+                    if(moving){
+                        LEDS_B_Toggle();
+                    } else {
+                        LEDS_R_Toggle();
+                    }
+                }
+                if((ticks - lastPrint) >= printTicks){
+                    lastPrint = ticks;
+                    quaternionToEuler(&filter.state, &stateAngle);
+                    trace_write(trace_ID_PERIOD, trace_float(to_degrees(stateAngle.pitch)), trace_float(to_degrees(stateAngle.roll)), periodUs);
+                }
+            }
+            /* Send trace records in the background */
+            trace_process();
+        }
+    /* End MICA_DEBUG_INCLINE_RATE */
+    #elif defined MICA_DEBUG_INCLINE_MARG
+        /* Compare the yaw drift of the MARG and IMU filters */
+        /* Expected outcome:
+        1. Green LED on
+        2. Every 50 ms run both filters, print the angles and the gyroscope
+        bias estimate once a second. Leave the sensor still, the IMU filter
+        angles drift while the MARG angles stay put
+        2a. Toggle Blue LED - successful update
+        2b. Red LED - Mag could not be read
+        */
+        LEDS_Write(LEDS_ON_GREEN);
+        /* Initilize interrupt vectors */
+        timer_interrupt_StartEx(ISR_systemTimer);
+        /* State variables */
+        const float samplePeriod = 0.05f;   /* [s] */
+        const uint32 printCount = 20u;      /* Updates between prints */
+        BMX055_STATE_T imuState;
+        INCLINOMETER_FILTER_T margFilter;
+        INCLINOMETER_FILTER_T imuFilter;
+        EULER_ANGLE_T margAngle;
+        EULER_ANGLE_T imuAngle;
+        ACC_DATA_F accData;
+        GYR_DATA_RAD_F gyrData;
+        MAG_DATA_F magData;
+        uint32 updates = ZERO;
+
+        /* Start hardware blocks */
+        UART_Start();
+        trace_init(traceTimestamp);
+        I2C_Start();
+        BMX055_Start(&imuState);
+        /* turn on the Magnetometer */
+        uint32 powerErr = BMX055_Mag_SetPowerMode(&imuState.mag, BMX055_MAG_PM_NORMAL);
+        if( powerErr != BMX055_ERR_OK) {
+            /* Don't advance if not valid */
+            LEDS_Write(LEDS_ON_WHITE);
+            for(;;){}
+        }
+        Timer_Start();
+        /* Gyroscope error of 5 deg/s, default bias drift */
+        inclinometer_init(&margFilter, samplePeriod, 5.0f);
+        inclinometer_init(&imuFilter, samplePeriod, 5.0f);
+
+        /* Set the period - disable interrupts */
+        uint8 intState = CyEnterCriticalSection();
+        /* Change period */
+        Timer_WritePeriod(MICA_DELAY_US_SEC_TENTH / TWO);
+        /* Force reload */
+        Timer_WriteCounter(ZERO);
+        /* Re-enable interrupts */
+        CyExitCriticalSection(intState);
+
+        /* Infinite loop */
+        for(;;){
+            /* Check the system flag */
+            if(systemTimerFlag) {
+                /* Reset flag */
+                systemTimerFlag = false;
+                /* Read in the values for the Acceleromter, Gyro & Mag */
+                BMX055_Acc_Readf(&imuState.acc, &accData);
+                BMX055_Gyr_Readf_rad(&imuState.gyr, &gyrData);
+                uint32 err = BMX055_Mag_Readf(&imuState.mag, &magData);
+                if(err != BMX055_ERR_OK) {
+                    LEDS_Write(LEDS_ON_RED);
+                    continue;
+                }
+                /* Update both filters */
+                inclinometer_updateMarg(&margFilter, &accData, &gyrData, &magData);
+                inclinometer_update(&imuFilter, &accData, &gyrData);
+                LEDS_B_Toggle();
+                /* Print once a second */
+                if(++updates < printCount){
+                    continue;
+                }
+                updates = ZERO;
+                quaternionToEuler(&margFilter.state, &margAngle);
+                quaternionToEuler(&imuFilter.state, &imuAngle);
+                trace_write(trace_ID_EULER_MARG, trace_float(to_degrees(margAngle.yaw)), trace_float(to_degrees(margAngle.pitch)), trace_float(to_degrees(margAngle.roll)));
+                trace_write(trace_ID_EULER_IMU, trace_float(to_degrees(imuAngle.yaw)), trace_float(to_degrees(imuAngle.pitch)), trace_float(to_degrees(imuAngle.roll)));
+                trace_write(trace_ID_GYR_BIAS, trace_float(margFilter.gyrBias.Wx), trace_float(margFilter.gyrBias.Wy), trace_float(margFilter.gyrBias.Wz));
+            }
+            /* Send trace records in the background */
+            trace_process();
+        }
+    /* End MICA_DEBUG_INCLINE_MARG */
     #else
         #error "Exactly ONE MICA_DEBUG_<case> must be defined if MICA_DEBUG is defined"
     #endif /* MICA_DEBUG_<case> */
@@ -733,17 +1076,97 @@ int main(void)
 /* %%%%%%%%%%%%%%%%%%  End Debugging  %%%%%%%%%%%%%%%%%% */
     /* LEDs initial state */    
     LEDS_Write(LEDS_ON_GREEN);
+    /* Fuse on the device and stream the orientation */
+    orientationStream();
+}
+
+/*******************************************************************************
+* Function Name: orientationStream()
+********************************************************************************
+* Summary:
+*   Runs the inclinometer filter on the system timer and streams the
+*   orientation as quaternion records. Never returns.
+*
+* Parameters:
+*   None
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void orientationStream(void){
+    /* Initilize interrupt vectors */
+    timer_interrupt_StartEx(ISR_systemTimer);
     /* Start Hardware blocks */
     I2C_Start();
     UART_Start();
+    BMX055_STATE_T imuState;
+    BMX055_Start(&imuState);
+    Timer_Start();
+    
+    /* Packet buffers for the orientation stream */
+    packets_BUFFER_FULL_S packetBuffer;
+    packets_initialize(&packetBuffer);
+    uint32 error = packets_generateBuffers(&packetBuffer, quatStream_LEN_PAYLOAD);
+    error |= quatStream_init(&packetBuffer, STREAM_RECORDS);
+    if(error){
+        LEDS_Write(LEDS_ON_WHITE);
+        for(;;){}
+    }
+    /* Fuse on the device, stream the orientation */
+    INCLINOMETER_FILTER_T filter;
+    inclinometer_init(&filter, (float) STREAM_PERIOD_US * INCLINOMETER_US_TO_S, STREAM_GYR_ERROR);
+    ACC_DATA_F accData;
+    GYR_DATA_RAD_F gyrData;
+    
+    /* Set the period - disable interrupts */
+    uint8 intState = CyEnterCriticalSection();
+    /* Change period */
+    Timer_WritePeriod(STREAM_PERIOD_US);
+    /* Force reload */
+    Timer_WriteCounter(ZERO);
+    /* Re-enable interrupts */
+    CyExitCriticalSection(intState);
     
     /* Infinite Loop */
     for(;;)
     {
-
+        /* Check the system flag */
+        if(systemTimerFlag) {
+            /* Reset flag */
+            systemTimerFlag = false;
+            uint32 timestamp = systemTimerTicks * STREAM_PERIOD_US;
+            /* Read in the values for the Acceleromter & Gyro */
+            BMX055_Acc_Readf(&imuState.acc, &accData);
+            BMX055_Gyr_Readf_rad(&imuState.gyr, &gyrData);
+            inclinometer_updateTimestamp(&filter, &accData, &gyrData, timestamp);
+            /* Send the quaternion in place of the raw samples */
+            if(quatStream_push(timestamp, &filter.state)){
+                LEDS_Write(LEDS_ON_RED);
+            } else {
+                LEDS_G_Toggle();
+            }
+        }
     }
 }
 
+/*******************************************************************************
+* Function Name: traceTimestamp()
+********************************************************************************
+* Summary:
+*   Timestamp of the trace records, in periods of the system timer
+*
+* Parameters:
+*   None
+*
+* Return:
+*   Number of system timer periods since start up
+*
+*******************************************************************************/
+uint32 traceTimestamp(void){
+    return systemTimerTicks;
+}
+
 /*******************************************************************************
 * ISR Name: ISR_systemTimer
 ********************************************************************************
@@ -757,6 +1180,8 @@ int main(void)
 CY_ISR(ISR_systemTimer){
     /* Clear Interrupt */
     Timer_STATUS;
+    /* Count periods, used for timestamps */
+    systemTimerTicks++;
     /* Indicate system flag */
     systemTimerFlag = true;
 }
@@ -0,0 +1,176 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: quatStream.c
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   Binary orientation stream. Each fused sample is sent as a timestamp and
+*   four Q14 quaternion elements (12 bytes) instead of the raw Acc, Gyr and
+*   Mag triples (18 bytes plus timestamp). Records are batched into a single
+*   MICA packet to spread the framing over several samples.
+*
+* 2018.11.01 CC - Document Created
+********************************************************************************/
+#include "quatStream.h"
+#include <string.h>
+
+/* Record layout */
+#define RECORD_INDEX_TIMESTAMP      (0u)
+#define RECORD_INDEX_ELEMENTS       (quatStream_LEN_TIMESTAMP)
+
+/* --------- Local Variables --------- */
+static packets_BUFFER_FULL_S *streamBuffer = NULL;
+static uint8 maxRecords = quatStream_MAX_RECORDS;
+static uint8 numRecords = ZERO;
+static uint8 payload[quatStream_LEN_PAYLOAD];
+
+/*******************************************************************************
+* Function Name: toQ14()
+****************************************************************************//**
+* \brief
+*   Converts a quaternion element to Q14, rounded and limited to [-1, 1]
+*
+* \param element
+*   Quaternion element
+*
+* \return
+*   Element in Q14
+*******************************************************************************/
+static int16 toQ14(float element){
+    if(element > ONE_F){
+        element = ONE_F;
+    } else if(element < -ONE_F){
+        element = -ONE_F;
+    }
+    float scaled = element * quatStream_SCALE;
+    return (int16) ((scaled >= ZERO_F) ? (scaled + HALF_F) : (scaled - HALF_F));
+}
+
+/*******************************************************************************
+* Function Name: quatStream_init()
+****************************************************************************//**
+* \brief
+*   Sets the packet buffer used to send the stream and how many records are
+*   batched into each packet. Any pending records are discarded.
+*
+* \param buffer
+*   Packet buffer, generated with a payload of at least quatStream_LEN_PAYLOAD
+*
+* \param recordsPerPacket
+*   Records per packet, 1 to quatStream_MAX_RECORDS. Fewer records lower the
+*   latency, more records lower the framing overhead.
+*
+* \return
+*   quatStream_ERR_OK on success, quatStream_ERR_RECORDS if out of range
+*******************************************************************************/
+uint32 quatStream_init(packets_BUFFER_FULL_S *buffer, uint8 recordsPerPacket){
+    if((recordsPerPacket == ZERO) || (recordsPerPacket > quatStream_MAX_RECORDS)){
+        return quatStream_ERR_RECORDS;
+    }
+    streamBuffer = buffer;
+    maxRecords = recordsPerPacket;
+    numRecords = ZERO;
+    return quatStream_ERR_OK;
+}
+
+/*******************************************************************************
+* Function Name: quatStream_encode()
+****************************************************************************//**
+* \brief
+*   Packs a quaternion into a record. The sign is chosen so q1 is positive, as
+*   q and -q are the same orientation.
+*
+* \param timestamp
+*   Time of the sample [us]
+*
+* \param quat
+*   Unit quaternion to send
+*
+* \param record
+*   Destination, quatStream_LEN_RECORD bytes
+*******************************************************************************/
+void quatStream_encode(uint32 timestamp, QUATERNION_T *quat, uint8 *record){
+    float sign = (quat->q1 < ZERO_F) ? -ONE_F : ONE_F;
+    int16 elements[quatStream_NUM_ELEMENTS] = {
+        toQ14(sign * quat->q1),
+        toQ14(sign * quat->q2),
+        toQ14(sign * quat->q3),
+        toQ14(sign * quat->q4),
+    };
+    /* Timestamp, MSB first */
+    uint8 i;
+    for(i = ZERO; i < quatStream_LEN_TIMESTAMP; i++){
+        uint8 shift = BITS_ONE_BYTE * (quatStream_LEN_TIMESTAMP - ONE - i);
+        record[RECORD_INDEX_TIMESTAMP + i] = MASK_BYTE_ONE & (timestamp >> shift);
+    }
+    /* Elements, MSB first */
+    uint8 *element = &record[RECORD_INDEX_ELEMENTS];
+    for(i = ZERO; i < quatStream_NUM_ELEMENTS; i++){
+        uint16 value = (uint16) elements[i];
+        *element++ = MASK_BYTE_ONE & (value >> BITS_ONE_BYTE);
+        *element++ = MASK_BYTE_ONE & value;
+    }
+}
+
+/*******************************************************************************
+* Function Name: quatStream_push()
+****************************************************************************//**
+* \brief
+*   Adds a sample to the stream, sending the batch once it is full
+*
+* \param timestamp
+*   Time of the sample [us]
+*
+* \param quat
+*   Unit quaternion to send
+*
+* \return
+*   quatStream_ERR_OK on success, quatStream_ERR_SEND if a full batch could
+*   not be sent. The batch is dropped in that case.
+*******************************************************************************/
+uint32 quatStream_push(uint32 timestamp, QUATERNION_T *quat){
+    quatStream_encode(timestamp, quat, &payload[numRecords * quatStream_LEN_RECORD]);
+    numRecords++;
+    if(numRecords < maxRecords){
+        return quatStream_ERR_OK;
+    }
+    return quatStream_flush();
+}
+
+/*******************************************************************************
+* Function Name: quatStream_flush()
+****************************************************************************//**
+* \brief
+*   Sends the pending records, if any
+*
+* \return
+*   quatStream_ERR_OK on success, quatStream_ERR_SEND if the packet could
+*   not be sent. The pending records are dropped either way.
+*******************************************************************************/
+uint32 quatStream_flush(void){
+    if((numRecords == ZERO) || (streamBuffer == NULL)){
+        numRecords = ZERO;
+        return quatStream_ERR_OK;
+    }
+    packets_PACKET_S *txPacket = &(streamBuffer->send.packet);
+    txPacket->moduleId = quatStream_MODULE_ID;
+    txPacket->cmd = quatStream_CMD_QUATERNION;
+    txPacket->flags = packets_FLAG_NONE;
+    txPacket->payloadLen = numRecords * quatStream_LEN_RECORD;
+    memcpy(txPacket->payload, payload, txPacket->payloadLen);
+    numRecords = ZERO;
+    if(packets_sendPacket(streamBuffer) != packets_ERR_SUCCESS){
+        return quatStream_ERR_SEND;
+    }
+    return quatStream_ERR_OK;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,58 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: quatStream.h
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   Header for quatStream.c
+*
+* 2018.11.01 CC - Document Created
+********************************************************************************/
+/* Header Guard */
+#ifndef QUAT_STREAM_H
+    #define QUAT_STREAM_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "micaCommon.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Packet identifiers */
+    #ifndef quatStream_MODULE_ID
+        #define quatStream_MODULE_ID            (1u)
+    #endif
+    #define quatStream_CMD_QUATERNION           (0x51u) /**< Payload is quaternion records */
+    /* Record: [timestamp x4][q1 x2][q2 x2][q3 x2][q4 x2], MSB first */
+    #define quatStream_LEN_TIMESTAMP            (4u)
+    #define quatStream_LEN_ELEMENT              (2u)
+    #define quatStream_NUM_ELEMENTS             (4u)
+    #define quatStream_LEN_RECORD               (quatStream_LEN_TIMESTAMP + (quatStream_NUM_ELEMENTS * quatStream_LEN_ELEMENT))
+    #define quatStream_SCALE                    (16384.0f)  /**< Elements are sent in Q14, so 1.0 fits an int16 */
+    /* Batching */
+    #define quatStream_MAX_RECORDS              (8u)    /**< Records held before a packet is sent */
+    #define quatStream_LEN_PAYLOAD              (quatStream_MAX_RECORDS * quatStream_LEN_RECORD)
+    /* Error codes */
+    #define quatStream_ERR_OK                   (0u)
+    #define quatStream_ERR_RECORDS              (1u)    /**< Records per packet out of range */
+    #define quatStream_ERR_SEND                 (2u)    /**< Packet could not be sent */
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    uint32 quatStream_init(packets_BUFFER_FULL_S *buffer, uint8 recordsPerPacket);
+    void quatStream_encode(uint32 timestamp, QUATERNION_T *quat, uint8 *record);
+    uint32 quatStream_push(uint32 timestamp, QUATERNION_T *quat);
+    uint32 quatStream_flush(void);
+
+#endif /* QUAT_STREAM_H */
+/* [] END OF FILE */
@@ -0,0 +1,214 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: trace.c
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   Binary trace channel. trace_write() copies a format ID and up to three
+*   32 bit arguments into a ring of fixed size records, which takes a few
+*   microseconds instead of the milliseconds sprintf("%f") takes. The ring
+*   is drained into the UART TX FIFO by trace_process() without ever
+*   waiting on the UART. The host resolves the IDs with trace_FORMATS.
+*
+* 2018.11.02 CC - Document Created
+********************************************************************************/
+#include "trace.h"
+#include <string.h>
+
+/* --------- Local Variables --------- */
+static uint8 ring[trace_RING_LEN][trace_LEN_RECORD];
+static volatile uint8 ringHead = ZERO;      /**< Next record to write */
+static volatile uint8 ringTail = ZERO;      /**< Next record to send */
+static uint8 byteIndex = ZERO;              /**< Bytes of the tail record already sent */
+static uint8 sequence = ZERO;
+static uint32 dropped = ZERO;               /**< Records dropped since the last report */
+static uint32 droppedTotal = ZERO;
+static trace_TIMESTAMP_T timestampSource = NULL;
+
+/*******************************************************************************
+* Function Name: packWord()
+****************************************************************************//**
+* \brief
+*   Writes a 32 bit word into a record, MSB first
+*
+* \param dest
+*   Destination, 4 bytes
+*
+* \param word
+*   Value to write
+*******************************************************************************/
+static void packWord(uint8 *dest, uint32 word){
+    uint8 i;
+    for(i = ZERO; i < trace_LEN_ARG; i++){
+        dest[i] = MASK_BYTE_ONE & (word >> (BITS_ONE_BYTE * (trace_LEN_ARG - ONE - i)));
+    }
+}
+
+/*******************************************************************************
+* Function Name: pushRecord()
+****************************************************************************//**
+* \brief
+*   Places a record into the ring, called with interrupts disabled
+*
+* \param id
+*   Format ID
+*
+* \param args
+*   trace_MAX_ARGS arguments
+*
+* \return
+*   false if the ring was full and the record was dropped
+*******************************************************************************/
+static bool pushRecord(trace_ID_T id, uint32 *args){
+    uint8 next = (ringHead + ONE) & trace_RING_MASK;
+    if(next == ringTail){
+        dropped++;
+        droppedTotal++;
+        return false;
+    }
+    uint8 *record = ring[ringHead];
+    record[trace_INDEX_SYNC] = trace_SYNC;
+    record[trace_INDEX_ID] = (uint8) id;
+    record[trace_INDEX_SEQUENCE] = sequence++;
+    packWord(&record[trace_INDEX_TIMESTAMP], (timestampSource != NULL) ? timestampSource() : ZERO);
+    uint8 i;
+    for(i = ZERO; i < trace_MAX_ARGS; i++){
+        packWord(&record[trace_INDEX_ARGS + (i * trace_LEN_ARG)], args[i]);
+    }
+    /* Checksum over every other byte */
+    uint8 checksum = ZERO;
+    for(i = ZERO; i < trace_LEN_RECORD; i++){
+        if(i != trace_INDEX_CHECKSUM){
+            checksum ^= record[i];
+        }
+    }
+    record[trace_INDEX_CHECKSUM] = checksum;
+    ringHead = next;
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: trace_init()
+****************************************************************************//**
+* \brief
+*   Empties the trace ring. The UART must be started separately.
+*
+* \param getTimestamp
+*   Function returning the current time, NULL to send zero timestamps
+*******************************************************************************/
+void trace_init(trace_TIMESTAMP_T getTimestamp){
+    uint8 intState = CyEnterCriticalSection();
+    timestampSource = getTimestamp;
+    ringHead = ZERO;
+    ringTail = ZERO;
+    byteIndex = ZERO;
+    sequence = ZERO;
+    dropped = ZERO;
+    droppedTotal = ZERO;
+    CyExitCriticalSection(intState);
+}
+
+/*******************************************************************************
+* Function Name: trace_write()
+****************************************************************************//**
+* \brief
+*   Queues a trace record. Safe to call from interrupts. When records were
+*   dropped since the last successful write, a trace_ID_DROPPED record is
+*   queued first.
+*
+* \param id
+*   Format ID, from trace_FORMATS
+*
+* \param arg0
+*   First argument, use trace_float() for %f
+*
+* \param arg1
+*   Second argument, zero if unused
+*
+* \param arg2
+*   Third argument, zero if unused
+*
+* \return
+*   false if the ring was full and the record was dropped
+*******************************************************************************/
+bool trace_write(trace_ID_T id, uint32 arg0, uint32 arg1, uint32 arg2){
+    bool success = true;
+    uint8 intState = CyEnterCriticalSection();
+    if(dropped){
+        uint32 report[trace_MAX_ARGS] = {dropped, ZERO, ZERO};
+        success = pushRecord(trace_ID_DROPPED, report);
+        if(success){
+            /* The report itself was queued, so only its count is cleared */
+            dropped -= report[ZERO];
+        }
+    }
+    /* A full ring has already counted this record as dropped */
+    if(success){
+        uint32 args[trace_MAX_ARGS] = {arg0, arg1, arg2};
+        success = pushRecord(id, args);
+    }
+    CyExitCriticalSection(intState);
+    return success;
+}
+
+/*******************************************************************************
+* Function Name: trace_float()
+****************************************************************************//**
+* \brief
+*   Returns the bit pattern of a float, so it can be traced without formatting
+*
+* \param value
+*   Value to trace
+*
+* \return
+*   IEEE 754 bit pattern of value
+*******************************************************************************/
+uint32 trace_float(float value){
+    uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/*******************************************************************************
+* Function Name: trace_process()
+****************************************************************************//**
+* \brief
+*   Moves queued record bytes into the UART TX FIFO while it has room. Never
+*   waits on the UART, call from the main loop.
+*******************************************************************************/
+void trace_process(void){
+    while(ringTail != ringHead){
+        if(UART_SpiUartGetTxBufferSize() >= UART_FIFO_SIZE){
+            return;
+        }
+        UART_SpiUartWriteTxData(ring[ringTail][byteIndex]);
+        byteIndex++;
+        if(byteIndex >= trace_LEN_RECORD){
+            byteIndex = ZERO;
+            ringTail = (ringTail + ONE) & trace_RING_MASK;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: trace_getDropped()
+****************************************************************************//**
+* \brief
+*   Returns the number of records dropped because the ring was full
+*
+* \return
+*   Records dropped since trace_init()
+*******************************************************************************/
+uint32 trace_getDropped(void){
+    return droppedTotal;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,93 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: trace.h
+* Workspace: IMU_v5.0
+* Project: dev_inclinometer_v5.0
+* Version: v5.0.0
+* Authors: Craig Cheney
+*
+* PCB: MICA IMU v3.5.2
+* PSoC: CYBLE214015-01
+*
+* Brief:
+*   Header for trace.c
+*
+* 2018.11.02 CC - Document Created
+********************************************************************************/
+/* Header Guard */
+#ifndef TRACE_H
+    #define TRACE_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "micaCommon.h"
+    /***************************************
+    * Trace formats
+    ***************************************/
+    /* Format strings are resolved by the host (hostTest/traceDecode.c) and are
+    * never compiled into the firmware. Add new formats at the end so existing
+    * IDs keep their value.
+    * Arguments are 32 bits: %d and %u are integers, %f is the bit pattern of
+    * a float, formats take at most trace_MAX_ARGS arguments. */
+    #define trace_FORMATS(X) \
+        X(trace_ID_DROPPED,         "Trace dropped %u records") \
+        X(trace_ID_EULER,           "Yaw: %.1f, Pitch: %.1f, Roll: %.1f") \
+        X(trace_ID_QUATERNION,      "Qw: %.4f, Qx: %.4f, Qy: %.4f") \
+        X(trace_ID_QUATERNION_Z,    "Qz: %.4f") \
+        X(trace_ID_GYR,             "Gyro - X: %f, Y: %f, Z: %f") \
+        X(trace_ID_ACC,             "Acc - X: %f, Y: %f, Z: %f") \
+        X(trace_ID_FLOAT_FILTER,    "Float - Pitch: %.1f, Roll: %.1f, Cycles: %u") \
+        X(trace_ID_FIXED_FILTER,    "Fixed - Pitch: %.1f, Roll: %.1f, Cycles: %u") \
+        X(trace_ID_TILT_DIFF,       "Max tilt difference: %.2f") \
+        X(trace_ID_PERIOD,          "Pitch: %.1f, Roll: %.1f, Period: %u us") \
+        X(trace_ID_EULER_MARG,      "MARG - Yaw: %.1f, Pitch: %.1f, Roll: %.1f") \
+        X(trace_ID_EULER_IMU,       "IMU - Yaw: %.1f, Pitch: %.1f, Roll: %.1f") \
+        X(trace_ID_GYR_BIAS,        "Bias - X: %.4f, Y: %.4f, Z: %.4f")
+    /* Format IDs */
+    #define trace_ENUM_ENTRY(id, format)    id,
+    typedef enum {
+        trace_FORMATS(trace_ENUM_ENTRY)
+        trace_NUM_IDS
+    } trace_ID_T;
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Record: [sync][id][sequence][checksum][timestamp x4][arg0 x4][arg1 x4][arg2 x4], MSB first */
+    #define trace_SYNC                      (0xA5u)
+    #define trace_MAX_ARGS                  (3u)
+    #define trace_LEN_ARG                   (4u)
+    #define trace_LEN_HEADER                (4u)
+    #define trace_LEN_TIMESTAMP             (4u)
+    #define trace_LEN_RECORD                (trace_LEN_HEADER + trace_LEN_TIMESTAMP + (trace_MAX_ARGS * trace_LEN_ARG))
+    #define trace_INDEX_SYNC                (0u)
+    #define trace_INDEX_ID                  (1u)
+    #define trace_INDEX_SEQUENCE            (2u)
+    #define trace_INDEX_CHECKSUM            (3u)    /**< XOR of every other byte of the record */
+    #define trace_INDEX_TIMESTAMP           (4u)
+    #define trace_INDEX_ARGS                (8u)
+    /* Ring of records */
+    #ifndef trace_RING_LEN
+        #define trace_RING_LEN              (32u)   /**< Must be a power of 2 */
+    #endif
+    #define trace_RING_MASK                 (trace_RING_LEN - 1u)
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Source of the record timestamps, in any unit known to the host */
+    typedef uint32 (*trace_TIMESTAMP_T)(void);
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void trace_init(trace_TIMESTAMP_T getTimestamp);
+    bool trace_write(trace_ID_T id, uint32 arg0, uint32 arg1, uint32 arg2);
+    uint32 trace_float(float value);
+    void trace_process(void);
+    uint32 trace_getDropped(void);
+
+#endif /* TRACE_H */
+/* [] END OF FILE */
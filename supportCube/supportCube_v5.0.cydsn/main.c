@@ -19,6 +19,9 @@
 #include "project.h"
 #include "usbPacketManager.h"
 #include "supportBleCallback.h"
+#include "notifyBatch.h"
+#include "profile.h"
+#include <string.h>
 
 /* ####################### BEGIN PROGRAM CONFIGURATION ###################### */
 
@@ -40,7 +43,7 @@
 * Testing will only occur when MICA_TEST is defined
 */
 #ifdef MICA_TEST
-    #define MICA_TEST_case      /* Test Description */
+    #define MICA_TEST_SEND_SEGMENTS     /* Segmented packets match packets_constructPacket */
 #endif
 /* -------------- END TEST CASE ---------------  */
 
@@ -78,13 +81,27 @@ int main(void)
         LEDS_Write(LEDS_ON_MAGENTA);
         for(;;){}
     }
+    /* Notification batching, enabled by the host */
+    notifyBatch_init();
+    /* Hot path probes, read with SUPPORT_CMD_PROFILE */
+    #if profile_ENABLE
+        profile_init();
+    #endif
 
     /* Infinite Loop */
     for(;;){
         /* Process the recieved packet */
+        profile_BEGIN(profile_PROBE_USB_RX);
         usbPackets_processIncoming();
+        profile_END(profile_PROBE_USB_RX);
         /* Process BLE events */
+        profile_BEGIN(profile_PROBE_BLE_EVENTS);
         CyBle_ProcessEvents();
+        profile_END(profile_PROBE_BLE_EVENTS);
+        /* Send batched notifications that have waited long enough */
+        profile_BEGIN(profile_PROBE_NOTIFY_BATCH);
+        notifyBatch_process();
+        profile_END(profile_PROBE_NOTIFY_BATCH);
     }
 }
 #endif /* !defined(MICA_DEBUG) && !defined(MICA_TEST) */
@@ -156,9 +173,47 @@ int main (void) {
     #warning "MICA_TEST is enabled"
     /* Enable global interrupts. */
     CyGlobalIntEnable; 
-    #ifdef MICA_TEST_case
-        /* Test descriptions */
-    /* End MICA_TEST_case*/
+    #ifdef MICA_TEST_SEND_SEGMENTS
+        /* Frame a payload split across segments and compare it to the same 
+        packet built by packets_constructPacket, then send it to the host
+        Expected outcome: 
+        Green LED - Frames match
+        Red LED - Frames do not match
+        Host receives a packet with cmd 0xCC and payload 01 03 05 */
+        usbUart_Start();
+        uint32_t err = usbPackets_init();
+        if(err){
+            LEDS_Write(LEDS_ON_MAGENTA);
+            for(;;){}
+        }
+        /* Segmented payload */
+        uint8_t seg1[] = {0x01, 0x03};
+        uint8_t seg2[] = {0x05};
+        usbPackets_SEGMENT_S segments[] = {{seg1, sizeof(seg1)}, {seg2, sizeof(seg2)}};
+        uint8_t header[packets_LEN_HEADER];
+        uint8_t footer[packets_LEN_FOOTER];
+        err |= usbPackets_frameSegments(0xCC, segments, TWO, packets_FLAG_RESP, header, footer);
+        /* Reference packet */
+        packets_PACKET_S *txPacket = &(usbPackets.send.packet);
+        txPacket->cmd = 0xCC;
+        txPacket->payloadLen = sizeof(seg1) + sizeof(seg2);
+        txPacket->flags = packets_FLAG_RESP;
+        memcpy(txPacket->payload, seg1, sizeof(seg1));
+        memcpy(&txPacket->payload[sizeof(seg1)], seg2, sizeof(seg2));
+        err |= packets_constructPacket(&usbPackets);
+        /* Compare */
+        uint8_t *refBuffer = usbPackets.send.processBuffer.buffer;
+        uint16_t frameLen = packets_LEN_HEADER + txPacket->payloadLen + packets_LEN_FOOTER;
+        bool match = (usbPackets.send.processBuffer.bufferIndex == frameLen);
+        match &= !memcmp(refBuffer, header, packets_LEN_HEADER);
+        match &= !memcmp(&refBuffer[packets_LEN_HEADER], seg1, sizeof(seg1));
+        match &= !memcmp(&refBuffer[packets_LEN_HEADER + sizeof(seg1)], seg2, sizeof(seg2));
+        match &= !memcmp(&refBuffer[frameLen - packets_LEN_FOOTER], footer, packets_LEN_FOOTER);
+        packets_flushTxBuffers(&usbPackets);
+        LEDS_Write((match && !err) ? LEDS_ON_GREEN : LEDS_ON_RED);
+        /* Send to the host */
+        usbPackets_sendSegments(0xCC, segments, TWO, packets_FLAG_RESP);
+    /* End MICA_TEST_SEND_SEGMENTS */
     #else 
         #error "At least ONE MICA_TEST_<case> must be defined if MICA_TEST is defined"
     #endif /* End MICA_TEST_<case> */    
@@ -0,0 +1,90 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: memPool.h
+* Workspace: supportCube_v5
+* Project: supportCube_v5.0
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: supportCube v2.1.1
+* PSoC: CYBLE-214015-01
+*
+* Brief:
+*   Header for memPool.c
+*
+* 2018.08.24  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef memPool_H
+    #define memPool_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    /* Framing bytes around a payload */
+    #define memPool_PACKET_OVERHEAD         (packets_LEN_HEADER + packets_LEN_FOOTER)
+    /* Largest packet payload the pool holds buffers for, set by usbPackets */
+    #ifndef memPool_LEN_PAYLOAD
+        #define memPool_LEN_PAYLOAD         (512u)
+    #endif
+    #define memPool_ROUND_WORD(x)           (((x) + 3u) & ~3u)
+    /* Block sizes in bytes, ascending and multiples of 4. Medium blocks hold
+    * a payload and large blocks a whole frame, so one set of packet buffers
+    * is two of each. */
+    #ifndef memPool_SIZE_SMALL
+        #define memPool_SIZE_SMALL          (64u)
+    #endif
+    #define memPool_SIZE_MEDIUM             memPool_ROUND_WORD(memPool_LEN_PAYLOAD)
+    #define memPool_SIZE_LARGE              memPool_ROUND_WORD(memPool_LEN_PAYLOAD + memPool_PACKET_OVERHEAD)
+    /* Number of blocks of each size, 1 to 32 */
+    #ifndef memPool_COUNT_SMALL
+        #define memPool_COUNT_SMALL         (4u)
+    #endif
+    #ifndef memPool_COUNT_MEDIUM
+        #define memPool_COUNT_MEDIUM        (2u)
+    #endif
+    #ifndef memPool_COUNT_LARGE
+        #define memPool_COUNT_LARGE         (2u)
+    #endif
+    #define memPool_NUM_CLASSES             (3u)
+    #define memPool_CLASS_SMALL             (0u)
+    #define memPool_CLASS_MEDIUM            (1u)
+    #define memPool_CLASS_LARGE             (2u)
+
+    /* Error codes */
+    #define memPool_ERR_SUCCESS             (0u)
+    #define memPool_ERR_INVALID             (1u)    /* Pointer is not a pool block */
+    #define memPool_ERR_CLASS               (2u)    /* No such size class */
+    #define memPool_ERR_DOUBLE_FREE         (3u)    /* Block is already free */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Usage of a single size class */
+    typedef struct {
+        uint16 blockSize;       /**< Size of each block in bytes */
+        uint16 numBlocks;       /**< Number of blocks in the class */
+        uint16 inUse;           /**< Blocks currently allocated */
+        uint16 highWater;       /**< Maximum blocks allocated at once */
+        uint32 failures;        /**< Allocations that found the class empty */
+    } memPool_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void memPool_init(void);
+    void* memPool_alloc(uint16 size);
+    uint32 memPool_free(void *block);
+    uint32 memPool_getStats(uint8 sizeClass, memPool_STATS_S *stats);
+    uint32 memPool_getOversizeFailures(void);
+    uint32 memPool_generateBuffers(packets_BUFFER_FULL_S *packetBuffer, uint16 payloadLen);
+    uint32 memPool_destroyBuffers(packets_BUFFER_FULL_S *packetBuffer);
+
+#endif /* memPool_H */
+/* [] END OF FILE */
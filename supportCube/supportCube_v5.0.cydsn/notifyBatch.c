@@ -0,0 +1,249 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: notifyBatch.c
+* Workspace: supportCube_v5
+* Project: supportCube_v5.0
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: supportCube v2.1.1
+* PSoC: CYBLE-214015-01
+*
+* Brief:
+*   Coalesces BLE notifications into multi-record USB frames. Each record is
+*   the same as a packets_RSP_NOTIFY payload (device ID, characteristic handle,
+*   data length, data) and the frame starts with the number of records. A
+*   frame is sent once the size threshold is reached or the oldest record has
+*   waited for the time window.
+*
+* 2018.10.24  - Document Created
+********************************************************************************/
+#include "notifyBatch.h"
+#include "usbPacketManager.h"
+#include "supportCommands.h"
+
+/* Batch buffer, [count][record][record]... */
+static uint8_t batchBuffer[notifyBatch_BUFFER_LEN];
+static uint16_t batchIndex = notifyBatch_LEN_COUNT;
+static uint8_t batchCount = ZERO;
+static uint32_t batchStartMs = ZERO;
+static uint32_t lostRecords = ZERO;
+/* Configuration */
+static notifyBatch_CONFIG_S batchConfig = {false, notifyBatch_DEFAULT_THRESHOLD, notifyBatch_DEFAULT_WINDOW_MS};
+/* Millisecond time base */
+static volatile uint32_t batchMs = ZERO;
+
+static void notifyBatch_ISR_sysTick(void);
+
+/*******************************************************************************
+* Function Name: notifyBatch_init()
+****************************************************************************//**
+* \brief
+*  Starts the millisecond time base and empties the batch. Batching is 
+*   disabled until enabled by the host.
+*
+* \return
+*  None
+*******************************************************************************/
+void notifyBatch_init(void) {
+    batchIndex = notifyBatch_LEN_COUNT;
+    batchCount = ZERO;
+    batchConfig.enabled = false;
+    batchConfig.threshold = notifyBatch_DEFAULT_THRESHOLD;
+    batchConfig.windowMs = notifyBatch_DEFAULT_WINDOW_MS;
+    /* 1 ms tick */
+    CySysTickStart();
+    CySysTickSetCallback(ZERO, notifyBatch_ISR_sysTick);
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_setConfig()
+****************************************************************************//**
+* \brief
+*  Applies a new configuration. Anything queued is sent first.
+*
+* \param config [in]
+*  Pointer to the new configuration. The threshold must be between one record
+*   header and notifyBatch_BUFFER_LEN.
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32_t notifyBatch_setConfig(notifyBatch_CONFIG_S *config) {
+    if((config->threshold <= notifyBatch_LEN_RECORD_HEADER) || (config->threshold > notifyBatch_BUFFER_LEN)) {
+        return notifyBatch_ERR_INVALID;
+    }
+    notifyBatch_flush();
+    batchConfig = *config;
+    return notifyBatch_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_getConfig()
+****************************************************************************//**
+* \brief
+*  Returns the current configuration
+*
+* \param config [out]
+*  Location to place the configuration
+*
+* \return
+*  None
+*******************************************************************************/
+void notifyBatch_getConfig(notifyBatch_CONFIG_S *config) {
+    *config = batchConfig;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_isEnabled()
+****************************************************************************//**
+* \brief
+*  Returns whether notifications should be batched
+*
+* \return
+*  True when batching is enabled
+*******************************************************************************/
+bool notifyBatch_isEnabled(void) {
+    return batchConfig.enabled;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_add()
+****************************************************************************//**
+* \brief
+*  Adds a notification to the batch. The batch is sent first if the record
+*   does not fit, and afterwards if the size threshold is reached.
+*
+* \param bdAddr [in]
+*  Device ID of the peer that sent the notification
+*
+* \param charHandle
+*  Characteristic handle of the notification
+*
+* \param data [in]
+*  Pointer to the notification data
+*
+* \param dataLen
+*  Length of the notification data
+*
+* \return
+*  Error code of the operation. notifyBatch_ERR_LENGTH indicates the record
+*   will never fit and must be sent on its own. notifyBatch_ERR_SEND indicates
+*   a batch was lost, its records are already counted by notifyBatch_getLost().
+*******************************************************************************/
+uint32_t notifyBatch_add(uint8_t *bdAddr, uint8_t charHandle, uint8_t *data, uint16_t dataLen) {
+    uint32_t recordLen = notifyBatch_LEN_RECORD_HEADER + (uint32_t) dataLen;
+    if(recordLen > (notifyBatch_BUFFER_LEN - notifyBatch_LEN_COUNT)) {
+        return notifyBatch_ERR_LENGTH;
+    }
+    uint32_t err = notifyBatch_ERR_SUCCESS;
+    /* Make room */
+    if((batchIndex + recordLen) > notifyBatch_BUFFER_LEN) {
+        err = notifyBatch_flush();
+    }
+    /* Start the window with the first record */
+    if(batchCount == ZERO) {
+        batchStartMs = batchMs;
+    }
+    /* Pack the record */
+    memcpy(&batchBuffer[batchIndex], bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    batchIndex += CYBLE_GAP_BD_ADDR_SIZE;
+    batchBuffer[batchIndex++] = charHandle;
+    batchBuffer[batchIndex++] = (dataLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    batchBuffer[batchIndex++] = (dataLen & MASK_BYTE_ONE);
+    memcpy(&batchBuffer[batchIndex], data, dataLen);
+    batchIndex += dataLen;
+    batchCount++;
+    /* Size threshold */
+    if(((batchIndex >= batchConfig.threshold) || (batchCount == notifyBatch_MAX_RECORDS)) &&
+        (notifyBatch_flush() != notifyBatch_ERR_SUCCESS)) {
+        err = notifyBatch_ERR_SEND;
+    }
+    return err;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_flush()
+****************************************************************************//**
+* \brief
+*  Sends any queued records as a single SUPPORT_RSP_NOTIFY_BATCH packet. If
+*   the packet cannot be sent, every record in it is counted as lost.
+*
+* \return
+*  notifyBatch_ERR_SUCCESS, or notifyBatch_ERR_SEND if the batch was lost
+*******************************************************************************/
+uint32_t notifyBatch_flush(void) {
+    if(batchCount == ZERO) {
+        return notifyBatch_ERR_SUCCESS;
+    }
+    batchBuffer[ZERO] = batchCount;
+    uint32_t err = notifyBatch_ERR_SUCCESS;
+    if(usbPackets_sendPacket(SUPPORT_RSP_NOTIFY_BATCH, batchIndex, batchBuffer, packets_FLAG_NONE) != packets_ERR_SUCCESS) {
+        lostRecords += batchCount;
+        err = notifyBatch_ERR_SEND;
+    }
+    /* Reset the batch */
+    batchIndex = notifyBatch_LEN_COUNT;
+    batchCount = ZERO;
+    return err;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_process()
+****************************************************************************//**
+* \brief
+*  Sends the batch once the oldest record has waited for the time window.
+*   Call from the main loop.
+*
+* \return
+*  notifyBatch_ERR_SUCCESS, or notifyBatch_ERR_SEND if the batch was lost
+*******************************************************************************/
+uint32_t notifyBatch_process(void) {
+    if((batchCount != ZERO) && ((batchMs - batchStartMs) >= batchConfig.windowMs)) {
+        return notifyBatch_flush();
+    }
+    return notifyBatch_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_getLost()
+****************************************************************************//**
+* \brief
+*  Returns the number of records lost with batches that could not be sent
+*
+* \return
+*  Number of lost records
+*******************************************************************************/
+uint32_t notifyBatch_getLost(void) {
+    return lostRecords;
+}
+
+/*******************************************************************************
+* Function Name: notifyBatch_resetLost()
+****************************************************************************//**
+* \brief
+*  Clears the lost record counter
+*
+* \return
+*  None
+*******************************************************************************/
+void notifyBatch_resetLost(void) {
+    lostRecords = ZERO;
+}
+
+/*******************************************************************************
+* ISR Name: notifyBatch_ISR_sysTick()
+********************************************************************************
+* Summary:
+*   Millisecond time base for the batch window
+* Interrupt: 
+*   SysTick
+*
+*******************************************************************************/
+static void notifyBatch_ISR_sysTick(void) {
+    batchMs++;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,69 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: notifyBatch.h
+* Workspace: supportCube_v5
+* Project: supportCube_v5.0
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: supportCube v2.1.1
+* PSoC: CYBLE-214015-01
+*
+* Brief:
+*   Header for notifyBatch.c
+*
+* 2018.10.24  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef notifyBatch_H
+    #define notifyBatch_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    #define notifyBatch_BUFFER_LEN              (256u)  /* Bytes of records per batch frame */
+    #define notifyBatch_LEN_COUNT               (1u)    /* Record count at the start of the frame */
+    #define notifyBatch_LEN_RECORD_HEADER       (CYBLE_GAP_BD_ADDR_SIZE + 3u) /* Device ID, handle, length */
+    #define notifyBatch_MAX_RECORDS             (0xFFu)
+    /* Defaults */
+    #define notifyBatch_DEFAULT_THRESHOLD       (notifyBatch_BUFFER_LEN)
+    #define notifyBatch_DEFAULT_WINDOW_MS       (10u)
+    /* Config command payload */
+    #define notifyBatch_LEN_CONFIG              (5u)    /* Enable, threshold MSB/LSB, window MSB/LSB */
+    /* Error codes */
+    #define notifyBatch_ERR_SUCCESS             (0u)
+    #define notifyBatch_ERR_INVALID             (1u)    /* Invalid configuration */
+    #define notifyBatch_ERR_LENGTH              (2u)    /* Record can never fit in a batch */
+    #define notifyBatch_ERR_SEND                (3u)    /* A batch frame was not sent, its records are counted as lost */
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Batching configuration */
+    typedef struct {
+        bool enabled;           /**< Coalesce notifications when true */
+        uint16_t threshold;     /**< Flush once this many bytes are queued */
+        uint16_t windowMs;      /**< Flush once the oldest record is this old */
+    } notifyBatch_CONFIG_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    void notifyBatch_init(void);
+    uint32_t notifyBatch_setConfig(notifyBatch_CONFIG_S *config);
+    void notifyBatch_getConfig(notifyBatch_CONFIG_S *config);
+    bool notifyBatch_isEnabled(void);
+    uint32_t notifyBatch_add(uint8_t *bdAddr, uint8_t charHandle, uint8_t *data, uint16_t dataLen);
+    uint32_t notifyBatch_flush(void);
+    uint32_t notifyBatch_process(void);
+    uint32_t notifyBatch_getLost(void);
+    void notifyBatch_resetLost(void);
+
+#endif /* notifyBatch_H */
+/* [] END OF FILE */
@@ -0,0 +1,250 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: profile.c
+* Workspace: supportCube_v5
+* Project: supportCube_v5.0
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: supportCube v2.1.1
+* PSoC: CYBLE-214015-01
+*
+* Brief:
+*   Cycle counting probes for the hot paths of the main loop. Time is taken
+*   from SysTick, which counts down SYSCLK cycles and wraps every millisecond;
+*   the wraps are counted here so a probe can span many milliseconds. Each
+*   probe keeps its count, minimum, maximum and total in a static table that
+*   the host reads with SUPPORT_CMD_PROFILE.
+*
+* 2018.11.02  - Document Created
+********************************************************************************/
+#include "profile.h"
+#include "micaCommon.h"
+
+#if profile_ENABLE
+/* Running statistics of a probe */
+typedef struct {
+    uint32_t start;         /* Cycle count at profile_begin() */
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} PROFILE_PROBE_S;
+
+static PROFILE_PROBE_S probes[profile_NUM_PROBES];
+/* SysTick wraps since profile_init() */
+static volatile uint32_t profileWraps = ZERO;
+
+static void profile_ISR_sysTick(void);
+
+/*******************************************************************************
+* Function Name: profile_now()
+****************************************************************************//**
+* \brief
+*  Cycles since profile_init(). Wraps after 2^32 cycles, which is longer than
+*   any probe. The wrap count is read again after SysTick to catch a wrap
+*   between the two reads. Inside a critical section a pending wrap is not
+*   counted, so probes should not span one.
+*
+* \return
+*  The current cycle count
+*******************************************************************************/
+static uint32_t profile_now(void) {
+    uint32_t wraps;
+    uint32_t value;
+    uint32_t reload = CySysTickGetReload();
+    do {
+        wraps = profileWraps;
+        value = CySysTickGetValue();
+    } while(wraps != profileWraps);
+    /* SysTick counts down from the reload value */
+    return (wraps * (reload + 1u)) + (reload - value);
+}
+
+/*******************************************************************************
+* Function Name: profile_init()
+****************************************************************************//**
+* \brief
+*  Clears the table and hooks the SysTick. SysTick is started if it is not
+*   already running.
+*
+* \return
+*  None
+*******************************************************************************/
+void profile_init(void) {
+    profile_reset();
+    CySysTickStart();
+    CySysTickSetCallback(profile_SYSTICK_CALLBACK, profile_ISR_sysTick);
+}
+
+/*******************************************************************************
+* Function Name: profile_begin()
+****************************************************************************//**
+* \brief
+*  Marks the start of a probe. Use profile_BEGIN() so the call disappears when
+*   profiling is disabled.
+*
+* \param probe [in]
+*  profile_PROBE_<name>
+*
+* \return
+*  None
+*******************************************************************************/
+void profile_begin(uint8_t probe) {
+    if(probe < profile_NUM_PROBES) {
+        probes[probe].start = profile_now();
+    }
+}
+
+/*******************************************************************************
+* Function Name: profile_end()
+****************************************************************************//**
+* \brief
+*  Marks the end of a probe and accumulates the cycles since profile_begin().
+*
+* \param probe [in]
+*  profile_PROBE_<name>
+*
+* \return
+*  None
+*******************************************************************************/
+void profile_end(uint8_t probe) {
+    uint32_t now = profile_now();
+    if(probe >= profile_NUM_PROBES) {
+        return;
+    }
+    PROFILE_PROBE_S *p = &probes[probe];
+    uint32_t cycles = now - p->start;
+    if(cycles < p->min) {
+        p->min = cycles;
+    }
+    if(cycles > p->max) {
+        p->max = cycles;
+    }
+    p->total += cycles;
+    p->count++;
+}
+
+/*******************************************************************************
+* Function Name: profile_getStats()
+****************************************************************************//**
+* \brief
+*  Gets the statistics of a probe. All fields are zero until the probe has
+*   completed once.
+*
+* \param probe [in]
+*  profile_PROBE_<name>
+*
+* \param stats [out]
+*  Statistics in SYSCLK cycles
+*
+* \return
+*  Error code of the operation
+*******************************************************************************/
+uint32_t profile_getStats(uint8_t probe, profile_STATS_S *stats) {
+    if(probe >= profile_NUM_PROBES) {
+        return profile_ERR_PROBE;
+    }
+    PROFILE_PROBE_S *p = &probes[probe];
+    stats->count = p->count;
+    if(p->count == ZERO) {
+        stats->min = ZERO;
+        stats->max = ZERO;
+        stats->mean = ZERO;
+    } else {
+        stats->min = p->min;
+        stats->max = p->max;
+        stats->mean = (uint32_t) (p->total / p->count);
+    }
+    return profile_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: profile_reset()
+****************************************************************************//**
+* \brief
+*  Clears the statistics of every probe
+*
+* \return
+*  None
+*******************************************************************************/
+void profile_reset(void) {
+    uint8_t i;
+    for(i = ZERO; i < profile_NUM_PROBES; i++) {
+        probes[i].count = ZERO;
+        probes[i].min = UINT32_MAX;
+        probes[i].max = ZERO;
+        probes[i].total = ZERO;
+    }
+}
+
+/*******************************************************************************
+* Function Name: profile_putWord()
+****************************************************************************//**
+* \brief
+*  Writes a word MSB first
+*
+* \param payload [out]
+*  Location to write to
+*
+* \param word [in]
+*  Value to write
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+static uint16_t profile_putWord(uint8_t *payload, uint32_t word) {
+    uint16_t i = ZERO;
+    payload[i++] = (word >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    payload[i++] = (word >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+    payload[i++] = (word >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    payload[i++] = word & MASK_BYTE_ONE;
+    return i;
+}
+
+/*******************************************************************************
+* Function Name: profile_report()
+****************************************************************************//**
+* \brief
+*  Writes the table as a SUPPORT_CMD_PROFILE response. The SYSCLK frequency is
+*   included so the host can convert cycles to time.
+*
+* \param payload [out]
+*  Buffer of at least profile_LEN_REPORT bytes
+*
+* \return
+*  Number of bytes written
+*******************************************************************************/
+uint16_t profile_report(uint8_t *payload) {
+    uint16_t i = ZERO;
+    uint8_t probe;
+    payload[i++] = profile_NUM_PROBES;
+    i += profile_putWord(&payload[i], CYDEV_BCLK__SYSCLK__HZ);
+    for(probe = ZERO; probe < profile_NUM_PROBES; probe++) {
+        profile_STATS_S stats;
+        profile_getStats(probe, &stats);
+        i += profile_putWord(&payload[i], stats.count);
+        i += profile_putWord(&payload[i], stats.min);
+        i += profile_putWord(&payload[i], stats.max);
+        i += profile_putWord(&payload[i], stats.mean);
+    }
+    return i;
+}
+
+/*******************************************************************************
+* ISR Name: profile_ISR_sysTick()
+********************************************************************************
+* Summary:
+*   Counts SysTick wraps
+* Interrupt:
+*   SysTick
+*
+*******************************************************************************/
+static void profile_ISR_sysTick(void) {
+    profileWraps++;
+}
+#endif /* profile_ENABLE */
+
+/* [] END OF FILE */
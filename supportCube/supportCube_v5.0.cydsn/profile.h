@@ -0,0 +1,83 @@
+/***************************************************************************
+*                                 MICA  © 2018
+*                           MIT BioInstrumentation Lab
+*
+* File: profile.h
+* Workspace: supportCube_v5
+* Project: supportCube_v5.0
+* Version: 1.0.0
+* Authors: Craig Cheney
+*
+* PCB: supportCube v2.1.1
+* PSoC: CYBLE-214015-01
+*
+* Brief:
+*   Header for profile.c. Define profile_ENABLE as 1 to build the probes in,
+*   otherwise profile_BEGIN() and profile_END() compile to nothing.
+*
+* 2018.11.02  - Document Created
+********************************************************************************/
+
+/* Header Guard */
+#ifndef profile_H
+    #define profile_H
+    /***************************************
+    * Included files
+    ***************************************/
+    #include "project.h"
+    #include "packets.h"
+    /***************************************
+    * Macro Definitions
+    ***************************************/
+    #ifndef profile_ENABLE
+        #define profile_ENABLE              (0)
+    #endif
+    /* SysTick callback slot, slot 0 belongs to notifyBatch */
+    #define profile_SYSTICK_CALLBACK        (1u)
+    /* Probes */
+    #define profile_PROBE_USB_RX            (0u)    /* usbPackets_processIncoming(), parse and dispatch */
+    #define profile_PROBE_BLE_EVENTS        (1u)    /* CyBle_ProcessEvents() */
+    #define profile_PROBE_RELAY             (2u)    /* Notification relay in supportBleHandler() */
+    #define profile_PROBE_NOTIFY_BATCH      (3u)    /* notifyBatch_process() */
+    #define profile_NUM_PROBES              (4u)
+    /* Report payload: [probes][sysclk x4] then [count x4][min x4][max x4][mean x4] per probe */
+    #define profile_LEN_REPORT_HEADER       (5u)
+    #define profile_LEN_REPORT_PROBE        (16u)
+    #define profile_LEN_REPORT              (profile_LEN_REPORT_HEADER + (profile_NUM_PROBES * profile_LEN_REPORT_PROBE))
+    /* Error codes */
+    #define profile_ERR_SUCCESS             (0u)
+    #define profile_ERR_PROBE               (1u)    /* Unknown probe ID */
+    /* Markers */
+    #if profile_ENABLE
+        #define profile_BEGIN(probe)        profile_begin(probe)
+        #define profile_END(probe)          profile_end(probe)
+    #else
+        #define profile_BEGIN(probe)
+        #define profile_END(probe)
+    #endif
+
+    /***************************************
+    * Structures
+    ***************************************/
+    /* Statistics of a single probe, in SYSCLK cycles */
+    typedef struct {
+        uint32_t count;         /**< Completed begin/end pairs */
+        uint32_t min;           /**< Shortest pair */
+        uint32_t max;           /**< Longest pair */
+        uint32_t mean;          /**< Average pair */
+    } profile_STATS_S;
+
+    /***************************************
+    * Function declarations
+    ***************************************/
+    #if profile_ENABLE
+        void profile_init(void);
+        void profile_begin(uint8_t probe);
+        void profile_end(uint8_t probe);
+        uint32_t profile_getStats(uint8_t probe, profile_STATS_S *stats);
+        void profile_reset(void);
+        uint16_t profile_report(uint8_t *payload);
+    #endif
+
+#endif /* profile_H */
+/* [] END OF FILE */
@@ -18,12 +18,65 @@
 ********************************************************************************/
 #include "supportBleCallback.h"
 #include "usbPacketManager.h"
-#include "stdlib.h"
+#include "notifyBatch.h"
+#include "profile.h"
 
 /* Store the connecting device ID */
 uint8_t connectingDevice[CYBLE_GAP_BD_ADDR_SIZE];
-CYBLE_CONN_HANDLE_T bleHandle;
 volatile bool pendingConnection = false;
+/* Connected peers */
+SUPPORT_CONN_S connTable[SUPPORT_MAX_CONNECTIONS];
+/* Device ID of the last peer to disconnect */
+uint8_t disconnectedDevice[CYBLE_GAP_BD_ADDR_SIZE];
+bool disconnectedValid = false;
+/* Notifications that could not be relayed */
+uint32_t droppedNotifications = ZERO;
+
+/*******************************************************************************
+* Function Name: relayCharValue()
+****************************************************************************//**
+* \brief
+*  Relays a characteristic value to the host. The device ID, characteristic
+*   handle and data length are sent as a header segment from the stack, and
+*   the data is sent from where the BLE stack left it. No buffer is allocated
+*   and the data is not copied.
+*
+* \param cmd
+*  Response command to send
+*
+* \param bdAddr
+*  Device ID of the peer the value came from
+*
+* \param charHandle
+*  Characteristic handle of the value
+*
+* \param data
+*  Pointer to the value. NULL sends only the header.
+*
+* \param dataLen
+*  Length of the value
+*
+* \param flags
+*  Flags to include
+*
+* \return
+*  The error associated with sending the packet
+*******************************************************************************/
+static uint32_t relayCharValue(uint8_t cmd, uint8_t *bdAddr, uint8_t charHandle, uint8_t *data, uint16_t dataLen, uint16_t flags) {
+    uint8_t relayHeader[SUPPORT_RELAY_LEN_HEADER];
+    /* Device ID */
+    memcpy(relayHeader, bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+    uint8_t i = CYBLE_GAP_BD_ADDR_SIZE;
+    /* Characteristic handle */
+    relayHeader[i++] = charHandle;
+    /* data length */
+    relayHeader[i++] = (dataLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    relayHeader[i++] = (dataLen & MASK_BYTE_ONE);
+    /* Header and data */
+    usbPackets_SEGMENT_S segments[] = {{relayHeader, SUPPORT_RELAY_LEN_HEADER}, {data, dataLen}};
+    uint8_t numSegments = (data != NULL) ? TWO : ONE;
+    return usbPackets_sendSegments(cmd, segments, numSegments, flags);
+}
 
 /*******************************************************************************
 * Function Name: supportBleHandler()
@@ -114,22 +167,44 @@ void supportBleHandler(uint32 eventCode, void *eventParam){
         }
         /* Connected to the device */
         case CYBLE_EVT_GAP_DEVICE_CONNECTED: {
-            /* Initiate an MTU exchange request */
-            CyBle_GattcExchangeMtuReq(bleHandle, CYBLE_GATT_MTU);
+            /* Initiate an MTU exchange request with the new peer */
+            SUPPORT_CONN_S *conn = findConnByAddr(connectingDevice);
+            if(conn != NULL) {
+                CyBle_GattcExchangeMtuReq(conn->connHandle, CYBLE_GATT_MTU);
+            }
             break;
         }
         /* The peer device responded to the MTU request */
         case CYBLE_EVT_GATTC_XCHNG_MTU_RSP:{
-            /* indicate the command was a sucess */
-            uint8_t bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
-            getConnectingDeviceId(bdAddr);
-            /* Send response packet */
-            usbPackets_sendPacket(packets_RSP_CONNECTED, CYBLE_GAP_BD_ADDR_SIZE, bdAddr, packets_FLAG_NONE);            
+            CYBLE_GATT_XCHG_MTU_PARAM_T *mtuRsp = (CYBLE_GATT_XCHG_MTU_PARAM_T *) eventParam;
+            SUPPORT_CONN_S *conn = findConnByHandle(mtuRsp->connHandle.bdHandle);
+            if(conn != NULL) {
+                /* indicate the command was a sucess */
+                usbPackets_sendPacket(packets_RSP_CONNECTED, CYBLE_GAP_BD_ADDR_SIZE, conn->bdAddr, packets_FLAG_NONE);            
+            }
             break;   
         }
-        /* Store the BLE handle */
+        /* Store the BLE handle of the connecting device */
         case CYBLE_EVT_GATT_CONNECT_IND: {
-            memcpy(&bleHandle, eventParam, sizeof(CYBLE_CONN_HANDLE_T));
+            CYBLE_CONN_HANDLE_T *connHandle = (CYBLE_CONN_HANDLE_T *) eventParam;
+            SUPPORT_CONN_S *conn = findConnByAddr(NULL);
+            if(conn != NULL) {
+                memcpy(conn->bdAddr, connectingDevice, CYBLE_GAP_BD_ADDR_SIZE);
+                conn->connHandle = *connHandle;
+                conn->readHandle = ZERO;
+                conn->active = true;
+            }
+            break;
+        }
+        /* Remove the peer from the table */
+        case CYBLE_EVT_GATT_DISCONNECT_IND: {
+            CYBLE_CONN_HANDLE_T *connHandle = (CYBLE_CONN_HANDLE_T *) eventParam;
+            SUPPORT_CONN_S *conn = findConnByHandle(connHandle->bdHandle);
+            if(conn != NULL) {
+                memcpy(disconnectedDevice, conn->bdAddr, CYBLE_GAP_BD_ADDR_SIZE);
+                disconnectedValid = true;
+                conn->active = false;
+            }
             break;
         }
         /* Disover complete */
@@ -140,22 +215,25 @@ void supportBleHandler(uint32 eventCode, void *eventParam){
         
         case CYBLE_EVT_GATTC_LONG_PROCEDURE_END: {
             LEDS_Write(LEDS_ON_WHITE);   
+            break;
         }
         /* A device was disconnected */
         case CYBLE_EVT_GAP_DEVICE_DISCONNECTED:{
             uint8_t *disconnectReason = (uint8_t *) eventParam;
+            /* Peer that was removed from the table, otherwise a failed connection attempt */
+            uint8_t bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
+            if(disconnectedValid) {
+                memcpy(bdAddr, disconnectedDevice, CYBLE_GAP_BD_ADDR_SIZE);
+                disconnectedValid = false;
+            } else {
+                getConnectingDeviceId(bdAddr);
+            }
             /* If user directed */
             if(*disconnectReason == CYBLE_HCI_CONNECTION_TERMINATED_LOCAL_HOST_ERROR){
                 /* indicate to the remote device the disconnect*/
-                uint8_t bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
-                getConnectingDeviceId(bdAddr);
-                /* Send response packet */
                 usbPackets_sendPacket(packets_RSP_DISCONNECTED, CYBLE_GAP_BD_ADDR_SIZE, bdAddr, packets_FLAG_NONE);
             } else {
                 /* indicate to the remote device the disconnect*/
-                uint8_t bdAddr[CYBLE_GAP_BD_ADDR_SIZE];
-                getConnectingDeviceId(bdAddr);
-                /* Send response packet */
                 usbPackets_sendPacket(packets_RSP_CONNECTION_LOST, CYBLE_GAP_BD_ADDR_SIZE, bdAddr, packets_FLAG_NONE);
             }
             break;   
@@ -163,42 +241,20 @@ void supportBleHandler(uint32 eventCode, void *eventParam){
         /* Response to ther read request */
         case CYBLE_EVT_GATTC_READ_RSP: {
             CYBLE_GATTC_READ_RSP_PARAM_T *readRsp = (CYBLE_GATTC_READ_RSP_PARAM_T *) eventParam;
-            uint16_t dataLen = readRsp->value.len;
-            uint8_t charHandle = readRsp->connHandle.bdHandle;
-            uint16_t bufferLen =  CYBLE_GAP_BD_ADDR_SIZE+ sizeof(charHandle) + sizeof(dataLen) + dataLen;
-            uint8_t * outBuffer = malloc(bufferLen);
-            if (outBuffer != NULL) {
+            SUPPORT_CONN_S *conn = findConnByHandle(readRsp->connHandle.bdHandle);
+            if(conn == NULL) {
+                break;
+            }
+            /* The response does not carry the handle, use the one that was read */
+            uint8_t charHandle = (uint8_t) conn->readHandle;
+            /* Relay the value straight from the event */
+            uint32_t err = relayCharValue(packets_RSP_READ, conn->bdAddr, charHandle, readRsp->value.val, readRsp->value.len, packets_FLAG_NONE);
+            if(!err) {
                 usbPackets_log("Read successful");
-                /* Pack the buffer */
-                /* Device ID */
-                getConnectingDeviceId(outBuffer);
-                uint16_t i = CYBLE_GAP_BD_ADDR_SIZE;
-                /* Characteristic handle  */
-                outBuffer[i++] = charHandle;
-                /* data length */
-                outBuffer[i++] = (dataLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
-                outBuffer[i++] = (dataLen & MASK_BYTE_ONE);
-                /* Data */
-                memcpy(&outBuffer[i], readRsp->value.val, dataLen);
-                /* Send response packet */
-                usbPackets_sendPacket(packets_RSP_READ, bufferLen, outBuffer, packets_FLAG_NONE);
-                /* Destroy buffer */
-                free(outBuffer);
-                /* failed to create the buffer, send everything but the data */
+            /* Value did not fit, send everything but the data */
             } else {
                 usbPackets_log("Read failed");
-                uint16_t failedLen = CYBLE_GAP_BD_ADDR_SIZE+ sizeof(charHandle) + sizeof(dataLen);
-                uint8_t failedBuffer[failedLen];
-                getConnectingDeviceId(outBuffer);
-                uint16_t i = CYBLE_GAP_BD_ADDR_SIZE;
-                /* Characteristic handle  */
-                outBuffer[i++] = charHandle;
-                /* data length */
-                outBuffer[i++] = (dataLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
-                outBuffer[i++] = (dataLen & MASK_BYTE_ONE);
-                /* Send out the data */
-                usbPackets_sendPacket(packets_RSP_READ, failedLen, failedBuffer, packets_FLAG_MEMORY);
-                
+                relayCharValue(packets_RSP_READ, conn->bdAddr, charHandle, NULL, readRsp->value.len, packets_FLAG_MEMORY);
             }
             break;
         }
@@ -207,33 +263,27 @@ void supportBleHandler(uint32 eventCode, void *eventParam){
             CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T * notification = (CYBLE_GATTC_HANDLE_VALUE_NTF_PARAM_T *) eventParam;
             /* Unpack data */
             uint8_t charHandle = notification->handleValPair.attrHandle;
-            uint16_t dataLen = notification->handleValPair.value.len;
-            uint16_t bufferLen = CYBLE_GAP_BD_ADDR_SIZE + sizeof(charHandle) + sizeof(dataLen) + dataLen;
-            /* Create the buffer */
-            uint8_t *outBuffer = malloc(bufferLen);
-            if(outBuffer != NULL) {
-                /* Pack the buffer */
-                /* Device ID */
-                getConnectingDeviceId(outBuffer);
-                uint16_t i = CYBLE_GAP_BD_ADDR_SIZE;
-                /* Characteristic handle */
-                outBuffer[i++] = charHandle;
-                /* data length */
-                outBuffer[i++] = (dataLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
-                outBuffer[i++] = (dataLen & MASK_BYTE_ONE);
-                /* Data */
-                memcpy(&outBuffer[i], notification->handleValPair.value.val, dataLen);
-                /* Send response packet */
-                uint32_t err = usbPackets_sendPacket(packets_RSP_NOTIFY, bufferLen, outBuffer, packets_FLAG_NONE);
-                if(err) {
-                    usbPackets_log("Notify send err: 0x%x", err);      
+            CYBLE_GATT_VALUE_T *value = &(notification->handleValPair.value);
+            SUPPORT_CONN_S *conn = findConnByHandle(notification->connHandle.bdHandle);
+            uint32_t err = notifyBatch_ERR_LENGTH;
+            if(conn == NULL) {
+                droppedNotifications++;
+                break;
+            }
+            profile_BEGIN(profile_PROBE_RELAY);
+            /* Queue into the current batch */
+            if(notifyBatch_isEnabled()) {
+                err = notifyBatch_add(conn->bdAddr, charHandle, value->val, value->len);
+            }
+            /* Relay the value straight from the event, after the older notifications.
+            * Records lost with a batch are counted by notifyBatch itself */
+            if(err == notifyBatch_ERR_LENGTH) {
+                notifyBatch_flush();
+                if(relayCharValue(packets_RSP_NOTIFY, conn->bdAddr, charHandle, value->val, value->len, packets_FLAG_NONE)) {
+                    droppedNotifications++;
                 }
-                /* Destroy buffer */
-                free(outBuffer);
-                /* failed to create the buffer, send everything but the data */
-            } else {
-                usbPackets_log("Notify buffer err");      
             }
+            profile_END(profile_PROBE_RELAY);
             break;   
         }
         /* An unhandled event occured */
@@ -307,16 +357,99 @@ bool getPendingConnection(void) {
 }
 
 /*******************************************************************************
-* Function Name: getBleHandle()
+* Function Name: findConnByAddr()
 ****************************************************************************//**
 * \brief
-*  Returns a pointer to the BLE handle
+*  Finds the connection table entry of a peer
+*
+* \param bdAddr [in]
+*  Device ID of the peer. NULL returns the first free entry.
 *
 * \return
-*  Pointer to the BLE handle
+*  Pointer to the entry, or NULL if not found
+*******************************************************************************/
+SUPPORT_CONN_S *findConnByAddr(uint8_t *bdAddr){
+    uint8_t i;
+    for(i = ZERO; i < SUPPORT_MAX_CONNECTIONS; i++){
+        SUPPORT_CONN_S *conn = &connTable[i];
+        if(bdAddr == NULL){
+            if(!conn->active){
+                return conn;
+            }
+        } else if(conn->active && !memcmp(conn->bdAddr, bdAddr, CYBLE_GAP_BD_ADDR_SIZE)){
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+* Function Name: findConnByHandle()
+****************************************************************************//**
+* \brief
+*  Finds the connection table entry from the BD handle assigned by the stack
+*
+* \param bdHandle
+*  BD handle of the peer
+*
+* \return
+*  Pointer to the entry, or NULL if not found
+*******************************************************************************/
+SUPPORT_CONN_S *findConnByHandle(uint8_t bdHandle){
+    uint8_t i;
+    for(i = ZERO; i < SUPPORT_MAX_CONNECTIONS; i++){
+        SUPPORT_CONN_S *conn = &connTable[i];
+        if(conn->active && (conn->connHandle.bdHandle == bdHandle)){
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+* Function Name: getConnectionCount()
+****************************************************************************//**
+* \brief
+*  Returns the number of connected peers
+*
+* \return
+*  Number of active entries in the connection table
+*******************************************************************************/
+uint8_t getConnectionCount(void){
+    uint8_t count = ZERO;
+    uint8_t i;
+    for(i = ZERO; i < SUPPORT_MAX_CONNECTIONS; i++){
+        count += connTable[i].active;
+    }
+    return count;
+}
+
+/*******************************************************************************
+* Function Name: getDroppedNotifications()
+****************************************************************************//**
+* \brief
+*  Returns the number of notifications that could not be relayed to the host,
+*   including the records of batches that could not be sent
+*
+* \return
+*  Number of dropped notifications
+*******************************************************************************/
+uint32_t getDroppedNotifications(void){
+    return droppedNotifications + notifyBatch_getLost();
+}
+
+/*******************************************************************************
+* Function Name: resetDroppedNotifications()
+****************************************************************************//**
+* \brief
+*  Clears the dropped notification counter
+*
+* \return
+*  None
 *******************************************************************************/
-CYBLE_CONN_HANDLE_T *getBleHandle(void){
-    return &bleHandle;   
+void resetDroppedNotifications(void){
+    droppedNotifications = ZERO;
+    notifyBatch_resetLost();
 }
 
 
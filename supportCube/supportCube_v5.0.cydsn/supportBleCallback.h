@@ -19,6 +19,7 @@
 
 /* Header Guard */
 #ifndef supportBleCallback_H
+    #define supportBleCallback_H
     /***************************************
     * Included files
     ***************************************/
@@ -26,6 +27,14 @@
     /***************************************
     * Macro Definitions
     ***************************************/
+    /* Device ID, characteristic handle and data length ahead of relayed data */
+    #define SUPPORT_RELAY_LEN_HEADER        (CYBLE_GAP_BD_ADDR_SIZE + 3u)
+    /* Simultaneous peers, limited by the BLE component */
+    #ifdef CYBLE_CONN_COUNT
+        #define SUPPORT_MAX_CONNECTIONS     (CYBLE_CONN_COUNT)
+    #else
+        #define SUPPORT_MAX_CONNECTIONS     (1u)
+    #endif
     
     /***************************************
     * Enumerated Types
@@ -35,6 +44,13 @@
     /***************************************
     * Structures
     ***************************************/
+    /* Connection table entry */
+    typedef struct {
+        bool active;                                /**< Entry is in use */
+        uint8_t bdAddr[CYBLE_GAP_BD_ADDR_SIZE];     /**< Device ID of the peer */
+        CYBLE_CONN_HANDLE_T connHandle;             /**< Handle assigned by the stack */
+        uint16_t readHandle;                        /**< Attribute handle of the outstanding read */
+    } SUPPORT_CONN_S;
 
     /***************************************
     * Function declarations 
@@ -46,7 +62,12 @@
     
     void setPendingConnection(bool newState);
     bool getPendingConnection(void);
-    CYBLE_CONN_HANDLE_T *getBleHandle(void);
+    SUPPORT_CONN_S *findConnByAddr(uint8_t *bdAddr);
+    SUPPORT_CONN_S *findConnByHandle(uint8_t bdHandle);
+    uint8_t getConnectionCount(void);
+    
+    uint32_t getDroppedNotifications(void);
+    void resetDroppedNotifications(void);
         
 
 #endif /* supportBleCallback_H */
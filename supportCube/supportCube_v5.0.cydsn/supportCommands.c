@@ -20,6 +20,8 @@
 #include "micaCommon.h"
 #include "project.h"
 #include "supportBleCallback.h"
+#include "notifyBatch.h"
+#include "profile.h"
 
 /*******************************************************************************
 * Function Name: cmdHandler_supportCube()
@@ -40,6 +42,9 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
     LEDS_B_Toggle();
     /* State of the BLE */
     CYBLE_STATE_T bleState = CyBle_GetState();
+    /* Idle, or connected with room for another peer */
+    bool canConnect = (bleState == CYBLE_STATE_DISCONNECTED) || 
+        ((bleState == CYBLE_STATE_CONNECTED) && (getConnectionCount() < SUPPORT_MAX_CONNECTIONS));
     /* extract command */
     switch(rxPacket->cmd) {
         /* Respond with the device ID */
@@ -55,7 +60,7 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
         /* Start the scan */
         case packets_CMD_SCAN_START: {
             /* Ensure valid state */
-            if(bleState == CYBLE_STATE_DISCONNECTED) {
+            if(canConnect) {
                 CyBle_GapcStartScan(CYBLE_SCANNING_FAST);
             } else {
                 /* Set the invalid state flag */
@@ -84,8 +89,11 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             /* Respond with device ID */
             memcpy(txPacket->payload, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE);
             txPacket->payloadLen = CYBLE_GAP_BD_ADDR_SIZE;
-            /* Connect directly if disconnected */
-            if(bleState == CYBLE_STATE_DISCONNECTED) {
+            /* Already connected to this peer */
+            if(findConnByAddr(rxPacket->payload) != NULL) {
+                txPacket->flags |= packets_FLAG_INVALID_STATE;
+            /* Connect directly if not scanning */
+            } else if(canConnect) {
                 /* Store the device id */
                 setConnectingDeviceId( rxPacket->payload);
                 /* Initiate the connection */
@@ -131,15 +139,11 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             /* Respond with device ID */
             memcpy(txPacket->payload, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE);
             txPacket->payloadLen = CYBLE_GAP_BD_ADDR_SIZE;
-            if(bleState == CYBLE_STATE_CONNECTED) {
             /* Get the peer BD handle from the adddress */
-                uint8_t bdHandle;
-                CYBLE_GAP_BD_ADDR_T deviceId;
-                memcpy(deviceId.bdAddr, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE);
-                CyBle_GapGetPeerBdHandle(&bdHandle, &deviceId);
+            SUPPORT_CONN_S *conn = findConnByAddr(rxPacket->payload);
+            if(conn != NULL) {
                 /* Initiate the disconnect */
-                CyBle_GapDisconnect(getBleHandle()->bdHandle);
-                
+                CyBle_GapDisconnect(conn->connHandle.bdHandle);
             } else {
                 txPacket->flags |= packets_FLAG_INVALID_STATE;   
             }
@@ -156,10 +160,11 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             memcpy(txPacket->payload, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE + 1);
             txPacket->payloadLen = CYBLE_GAP_BD_ADDR_SIZE +1;
             /* Get the peer BD handle from the adddress */
-            CYBLE_CONN_HANDLE_T bdHandle;
-            CYBLE_GAP_BD_ADDR_T deviceId;
-            memcpy(deviceId.bdAddr, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE);
-            CyBle_GapGetPeerBdHandle(&bdHandle.bdHandle, &deviceId);
+            SUPPORT_CONN_S *conn = findConnByAddr(rxPacket->payload);
+            if(conn == NULL) {
+                txPacket->flags |= packets_FLAG_INVALID_STATE;
+                break;
+            }
             /* Extract the handle */
             uint16_t charHandle =  rxPacket->payload[CYBLE_GAP_BD_ADDR_SIZE];
             
@@ -169,7 +174,7 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             writeReq.value.val = &rxPacket->payload[CYBLE_GAP_BD_ADDR_SIZE+1];
             writeReq.value.len = (rxPacket->payloadLen - 7);
             /* Initiate the write */
-            CYBLE_API_RESULT_T result = CyBle_GattcWriteCharacteristicValue(*getBleHandle(), &writeReq);
+            CYBLE_API_RESULT_T result = CyBle_GattcWriteCharacteristicValue(conn->connHandle, &writeReq);
             
             switch(result) {
                 case CYBLE_ERROR_OK:{
@@ -204,12 +209,20 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             /* Pass the device ID and handle back */
             memcpy(txPacket->payload, rxPacket->payload, CYBLE_GAP_BD_ADDR_SIZE + 1);
             txPacket->payloadLen = CYBLE_GAP_BD_ADDR_SIZE +1;
+            /* Get the peer BD handle from the adddress */
+            SUPPORT_CONN_S *conn = findConnByAddr(rxPacket->payload);
+            if(conn == NULL) {
+                txPacket->flags |= packets_FLAG_INVALID_STATE;
+                break;
+            }
             /* Extract the handle */
             uint16_t charHandle =  rxPacket->payload[CYBLE_GAP_BD_ADDR_SIZE];
             CYBLE_GATTC_READ_REQ_T readReq = charHandle;
-            CYBLE_API_RESULT_T result = CyBle_GattcReadCharacteristicValue(*getBleHandle(), readReq);
+            CYBLE_API_RESULT_T result = CyBle_GattcReadCharacteristicValue(conn->connHandle, readReq);
             switch(result) {
                 case CYBLE_ERROR_OK:{
+                    /* GATT allows one request at a time, the read response is for this handle */
+                    conn->readHandle = charHandle;
                     break;
                 }
                 case CYBLE_ERROR_INVALID_PARAMETER: {
@@ -231,6 +244,53 @@ uint32_t cmdHandler_supportCube(packets_PACKET_S* rxPacket, packets_PACKET_S* tx
             }
             break;   
         }
+        /* Configure notification batching */
+        case SUPPORT_CMD_NOTIFY_BATCH: {
+            notifyBatch_CONFIG_S config;
+            /* Apply a new configuration, an empty payload only queries it */
+            if(rxPacket->payloadLen == notifyBatch_LEN_CONFIG) {
+                uint8_t i = ZERO;
+                config.enabled = (rxPacket->payload[i++] != ZERO);
+                config.threshold = rxPacket->payload[i++] << BITS_ONE_BYTE;
+                config.threshold |= rxPacket->payload[i++];
+                config.windowMs = rxPacket->payload[i++] << BITS_ONE_BYTE;
+                config.windowMs |= rxPacket->payload[i++];
+                if(notifyBatch_setConfig(&config)) {
+                    txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                }
+            } else if(rxPacket->payloadLen != ZERO) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+            }
+            /* Respond with the active configuration and the dropped notification count */
+            notifyBatch_getConfig(&config);
+            uint32_t dropped = getDroppedNotifications();
+            uint8_t i = ZERO;
+            txPacket->payload[i++] = config.enabled;
+            txPacket->payload[i++] = (config.threshold >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+            txPacket->payload[i++] = config.threshold & MASK_BYTE_ONE;
+            txPacket->payload[i++] = (config.windowMs >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+            txPacket->payload[i++] = config.windowMs & MASK_BYTE_ONE;
+            txPacket->payload[i++] = (dropped >> (3 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+            txPacket->payload[i++] = (dropped >> (2 * BITS_ONE_BYTE)) & MASK_BYTE_ONE;
+            txPacket->payload[i++] = (dropped >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+            txPacket->payload[i++] = dropped & MASK_BYTE_ONE;
+            txPacket->payloadLen = i;
+            break;
+        }
+        #if profile_ENABLE
+        /* Read the profiling probes, a non-zero payload byte also clears them */
+        case SUPPORT_CMD_PROFILE: {
+            if(rxPacket->payloadLen > ONE) {
+                txPacket->flags |= packets_FLAG_INVALID_ARGS;
+                break;
+            }
+            txPacket->payloadLen = profile_report(txPacket->payload);
+            if((rxPacket->payloadLen == ONE) && (rxPacket->payload[ZERO] != ZERO)) {
+                profile_reset();
+            }
+            break;
+        }
+        #endif /* profile_ENABLE */
         /* Change mode (bootloader) command*/
         case packets_CMD_MODE: {
              /* Make sure the correct size, and only bootloader command */
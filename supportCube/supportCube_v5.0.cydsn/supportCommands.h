@@ -19,6 +19,7 @@
 
 /* Header Guard */
 #ifndef supportCommands_H
+    #define supportCommands_H
     /***************************************
     * Included files
     ***************************************/
@@ -31,6 +32,11 @@
     #define SUPPORT_ID_DEVICE_LSB           (0x01)
     #define SUPPORT_ID_FIRMWARE_MSB         (0x05)
     #define SUPPORT_ID_FIRMWARE_LSB         (0x00)
+    /* Support cube specific commands, outside of the packets_CMD_ range */
+    #define SUPPORT_CMD_NOTIFY_BATCH        (0x40)  /* Configure notification batching */
+    #define SUPPORT_CMD_PROFILE             (0x41)  /* Read the profiling probes, only when profile_ENABLE */
+    /* Support cube specific responses */
+    #define SUPPORT_RSP_NOTIFY_BATCH        (0xC0)  /* Multiple notifications in one packet */
     
     /***************************************
     * Enumerated Types
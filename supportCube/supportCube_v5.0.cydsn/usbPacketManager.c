@@ -18,6 +18,7 @@
 ********************************************************************************/
 #include "usbPacketManager.h"
 #include "supportCommands.h"
+#include "memPool.h"
 
 /* USB Packet instance */
 packets_BUFFER_FULL_S usbPackets;
@@ -35,7 +36,7 @@ uint32_t usbPackets_init(void) {
     uint32_t err = packets_initialize(&usbPackets);
     if(!err) {
 //        err = packets_generateBuffers(&usbPackets, packets_LEN_PACKET_128);
-        err = packets_generateBuffers(&usbPackets, 512);
+        err = memPool_generateBuffers(&usbPackets, memPool_LEN_PAYLOAD);
     }
     /* Register callback functions */
     if(!err){
@@ -84,13 +85,146 @@ uint32_t usbPackets_processIncoming(void) {
 *  The error associated with the processing
 *******************************************************************************/
 uint32_t usbPackets_sendPacket(uint8_t cmd, uint16_t payloadLen, uint8_t *payload, uint16_t flags) {
-    usbPackets.send.packet.cmd = cmd;
-    usbPackets.send.packet.payloadLen = payloadLen;
-    usbPackets.send.packet.flags = flags;
-    if(payloadLen) {
-        memcpy(usbPackets.send.packet.payload, payload, payloadLen);
+    usbPackets_SEGMENT_S segment = {payload, payloadLen};
+    return usbPackets_sendSegments(cmd, &segment, ONE, flags);
+}
+
+/*******************************************************************************
+* Function Name: usbPackets_sumBytes()
+****************************************************************************//**
+* \brief
+*  Adds an array of bytes to a running packet checksum
+*
+* \param sum
+*   The current sum
+*
+* \param data
+*   Pointer to the bytes to add
+*
+* \param len
+*   Number of bytes to add
+*
+* \return
+*  The updated sum
+*******************************************************************************/
+static uint16_t usbPackets_sumBytes(uint16_t sum, uint8_t *data, uint16_t len) {
+    uint16_t i;
+    for(i = ZERO; i < len; i++){
+        sum += data[i];
     }
-    return packets_sendPacket(&usbPackets);
+    return sum;
+}
+
+/*******************************************************************************
+* Function Name: usbPackets_frameSegments()
+****************************************************************************//**
+* \brief
+*  Creates the header and footer that surround a payload made up of one or
+*   more segments. The checksum is accumulated over the segments in place, 
+*   so the payload is never copied.
+*
+* \param cmd
+*   The command value to write
+*
+* \param segments
+*   Array of payload segments, in the order they are sent
+* 
+* \param numSegments
+*   Number of segments in the array
+*
+* \param flags
+*   The flags to include
+*
+* \param header [out]
+*   Location to place the header, must be packets_LEN_HEADER long
+*
+* \param footer [out]
+*   Location to place the footer, must be packets_LEN_FOOTER long
+*
+* \return
+*  The error associated with the processing
+*******************************************************************************/
+uint32_t usbPackets_frameSegments(uint8_t cmd, usbPackets_SEGMENT_S *segments, uint8_t numSegments, uint16_t flags, uint8_t *header, uint8_t *footer) {
+    /* Find the total length */
+    uint32_t payloadLen = ZERO;
+    uint8_t i;
+    for(i = ZERO; i < numSegments; i++){
+        payloadLen += segments[i].len;
+    }
+    if(payloadLen > usbPackets.send.packet.payloadMax){
+        return packets_ERR_LENGTH;
+    }
+    /* Header */
+    uint8_t index = ZERO;
+    header[index++] = packets_SYM_START;
+    header[index++] = usbPackets.send.packet.moduleId;
+    header[index++] = cmd;
+    header[index++] = (payloadLen >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    header[index++] = payloadLen & MASK_BYTE_ONE;
+    /* Footer, error code and flags */
+    uint16_t error = usbPackets.send.packet.error;
+    index = ZERO;
+    footer[index++] = (error >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    footer[index++] = error & MASK_BYTE_ONE;
+    footer[index++] = (flags >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    footer[index++] = flags & MASK_BYTE_ONE;
+    /* Checksum covers everything between the start symbol and the checksum */
+    uint16_t sum = usbPackets_sumBytes(ZERO, &header[ONE], packets_LEN_HEADER - ONE);
+    for(i = ZERO; i < numSegments; i++){
+        sum = usbPackets_sumBytes(sum, segments[i].data, segments[i].len);
+    }
+    sum = usbPackets_sumBytes(sum, footer, index);
+    uint16_t checksum = ~sum;
+    footer[index++] = (checksum >> BITS_ONE_BYTE) & MASK_BYTE_ONE;
+    footer[index++] = checksum & MASK_BYTE_ONE;
+    footer[index++] = packets_SYM_END;
+    return packets_ERR_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: usbPackets_sendSegments()
+****************************************************************************//**
+* \brief
+*  Sends a packet whose payload is made up of one or more segments. The 
+*   header, each segment and the footer are written straight to the usbUart
+*   in turn, without being staged in the send buffers.
+*
+* \param cmd
+*   The command value to write
+*
+* \param segments
+*   Array of payload segments, in the order they are sent
+* 
+* \param numSegments
+*   Number of segments in the array
+*
+* \param flags
+*   The flags to include
+*
+* \return
+*  The error associated with the processing. If the usbUart drops a write its
+*   error is returned and the rest of the packet is not sent.
+*******************************************************************************/
+uint32_t usbPackets_sendSegments(uint8_t cmd, usbPackets_SEGMENT_S *segments, uint8_t numSegments, uint16_t flags) {
+    if(usbPackets.comms.txPutArray == NULL){
+        return packets_ERR_STATE;
+    }
+    uint8_t header[packets_LEN_HEADER];
+    uint8_t footer[packets_LEN_FOOTER];
+    uint32_t err = usbPackets_frameSegments(cmd, segments, numSegments, flags, header, footer);
+    if(!err){
+        err = usbPackets.comms.txPutArray(header, packets_LEN_HEADER);
+        uint8_t i;
+        for(i = ZERO; (i < numSegments) && !err; i++){
+            if(segments[i].len){
+                err = usbPackets.comms.txPutArray(segments[i].data, segments[i].len);
+            }
+        }
+        if(!err){
+            err = usbPackets.comms.txPutArray(footer, packets_LEN_FOOTER);
+        }
+    }
+    return err;
 }
 
 
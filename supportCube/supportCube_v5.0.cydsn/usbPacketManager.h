@@ -19,6 +19,7 @@
 
 /* Header Guard */
 #ifndef usbPacketManager_H
+    #define usbPacketManager_H
     /***************************************
     * Included files
     ***************************************/
@@ -26,6 +27,7 @@
     /***************************************
     * Macro Definitions
     ***************************************/
+    /* Framing uses packets_LEN_HEADER, packets_LEN_FOOTER and packets_SYM_END */
     
     /***************************************
     * Enumerated Types
@@ -35,13 +37,24 @@
     /***************************************
     * Structures
     ***************************************/
+    /* A piece of a packet payload, sent without copying */
+    typedef struct {
+        uint8_t *data;      /**< Pointer to the segment data */
+        uint16_t len;       /**< Number of bytes in the segment */
+    } usbPackets_SEGMENT_S;
     
+    /***************************************
+    * External Variables
+    ***************************************/
+    extern packets_BUFFER_FULL_S usbPackets;
     /***************************************
     * Function declarations 
     ***************************************/
     uint32_t usbPackets_init(void);
     uint32_t usbPackets_processIncoming(void);
     uint32_t usbPackets_sendPacket(uint8_t cmd, uint16_t payloadLen, uint8_t *payload, uint16_t flags);    
+    uint32_t usbPackets_sendSegments(uint8_t cmd, usbPackets_SEGMENT_S *segments, uint8_t numSegments, uint16_t flags);
+    uint32_t usbPackets_frameSegments(uint8_t cmd, usbPackets_SEGMENT_S *segments, uint8_t numSegments, uint16_t flags, uint8_t *header, uint8_t *footer);
     uint32_t usbPackets_log(char *msg, ...);
 
 #endif /* usbPacketManager_H */